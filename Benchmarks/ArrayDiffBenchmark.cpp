@@ -0,0 +1,164 @@
+//
+//  ArrayDiffBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Diffs arrays with a few elements deleted, inserted and moved, through AS::Diff::compute and through the LCS length
+// table -asdk_diffWithArray: filled before it, and reports diffs per second. With --check, only verifies that unique
+// keys give a longest common subsequence, that duplicates pair up in order, and that keys which collide without their
+// elements being equal still pair each new element with its equal old one.
+
+#include "ASArrayDiffCore.h"
+#include "BenchmarkSupport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using AS::Diff::Key;
+
+/// The length of the longest common subsequence, from the table the diff used to fill.
+std::size_t lcsLength(const std::vector<Key> &oldKeys, const std::vector<Key> &newKeys)
+{
+  std::vector<std::vector<uint32_t>> lengths(oldKeys.size() + 1, std::vector<uint32_t>(newKeys.size() + 1, 0));
+  for (std::size_t i = 1; i <= oldKeys.size(); i++) {
+    for (std::size_t j = 1; j <= newKeys.size(); j++) {
+      lengths[i][j] = (oldKeys[i - 1] == newKeys[j - 1] ? lengths[i - 1][j - 1] + 1
+                                                        : std::max(lengths[i - 1][j], lengths[i][j - 1]));
+    }
+  }
+  return lengths[oldKeys.size()][newKeys.size()];
+}
+
+/// @c count unique keys, then a copy with about a tenth of them deleted, inserted or moved.
+void editedKeys(std::size_t count, std::mt19937 &random, std::vector<Key> &oldKeys, std::vector<Key> &newKeys)
+{
+  oldKeys.clear();
+  for (std::size_t i = 0; i < count; i++) {
+    oldKeys.push_back(i);
+  }
+  newKeys = oldKeys;
+  Key nextKey = count;
+  for (std::size_t edit = 0; edit < count / 10 + 1 && !newKeys.empty(); edit++) {
+    const std::size_t position = random() % newKeys.size();
+    switch (random() % 3) {
+      case 0:
+        newKeys.erase(newKeys.begin() + position);
+        break;
+      case 1:
+        newKeys.insert(newKeys.begin() + position, nextKey++);
+        break;
+      default: {
+        const Key key = newKeys[position];
+        newKeys.erase(newKeys.begin() + position);
+        newKeys.insert(newKeys.begin() + random() % (newKeys.size() + 1), key);
+        break;
+      }
+    }
+  }
+}
+
+bool checkUniqueKeysGiveLCS()
+{
+  std::mt19937 random(1);
+  std::vector<Key> oldKeys, newKeys;
+  AS::Diff::Result result;
+  for (std::size_t count = 0; count < 200; count += 7) {
+    editedKeys(count, random, oldKeys, newKeys);
+    AS::Diff::compute(oldKeys.data(), oldKeys.size(), newKeys.data(), newKeys.size(), AS::Diff::Moves::None, result);
+    const std::size_t common = lcsLength(oldKeys, newKeys);
+    CHECK(oldKeys.size() - result.deletions.size() == common);
+    CHECK(newKeys.size() - result.insertions.size() == common);
+    CHECK(result.moves.empty());
+  }
+  return true;
+}
+
+bool checkDuplicates()
+{
+  const std::vector<Key> oldKeys = {1, 1, 2};
+  const std::vector<Key> newKeys = {1, 2, 1, 1};
+  AS::Diff::Result result;
+  AS::Diff::compute(oldKeys.data(), oldKeys.size(), newKeys.data(), newKeys.size(), AS::Diff::Moves::All, result);
+  // The first 1 stays, the second moves after the 2, and the third is new.
+  CHECK(result.deletions.empty());
+  CHECK(result.insertions == std::vector<std::size_t>{3});
+  CHECK(result.moves.size() == 2);
+  CHECK(result.moves[0].from == 2 && result.moves[0].to == 1);
+  CHECK(result.moves[1].from == 1 && result.moves[1].to == 2);
+  return true;
+}
+
+bool checkCollisions()
+{
+  // Every element has the same key, as when hashes collide, so only the values tell them apart.
+  const std::vector<int> oldValues = {1, 2, 3, 4};
+  const std::vector<int> newValues = {3, 1, 5, 4, 2};
+  const std::vector<Key> oldKeys(oldValues.size(), 7);
+  const std::vector<Key> newKeys(newValues.size(), 7);
+  const auto equal = [&](std::size_t oldIndex, std::size_t newIndex) {
+    return oldValues[oldIndex] == newValues[newIndex];
+  };
+
+  AS::Diff::Result result;
+  AS::Diff::compute(oldKeys.data(), oldKeys.size(), newKeys.data(), newKeys.size(), AS::Diff::Moves::All, result,
+                    equal);
+  // Each value is matched with itself, however far down the chain of its key: only the 5 is new and the 4 stays.
+  CHECK(result.deletions.empty());
+  CHECK(result.insertions == std::vector<std::size_t>{2});
+  CHECK(result.moves.size() == 3);
+  CHECK(result.moves[0].from == 2 && result.moves[0].to == 0);
+  CHECK(result.moves[1].from == 0 && result.moves[1].to == 1);
+  CHECK(result.moves[2].from == 1 && result.moves[2].to == 4);
+
+  // Without moves, two of the matches stay in place and the other two are deleted and inserted again.
+  AS::Diff::compute(oldKeys.data(), oldKeys.size(), newKeys.data(), newKeys.size(), AS::Diff::Moves::None, result,
+                    equal);
+  CHECK(result.insertions.size() == 3 && result.deletions.size() == 2);
+  for (std::size_t deletion : result.deletions) {
+    CHECK(std::count(newValues.begin(), newValues.end(), oldValues[deletion]) == 1);
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkUniqueKeysGiveLCS, checkDuplicates, checkCollisions}, status)) {
+    return status;
+  }
+
+  std::mt19937 random(1);
+  std::vector<Key> oldKeys, newKeys;
+  AS::Diff::Result result;
+  std::size_t checksum = 0;
+  std::printf("%8s %14s %14s\n", "elements", "LCS diffs/s", "keyed diffs/s");
+  for (std::size_t count : {10, 100, 1000, 5000}) {
+    editedKeys(count, random, oldKeys, newKeys);
+    const std::size_t lcsIterations = std::max<std::size_t>(1, 2000000 / (count * count));
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lcsIterations; i++) {
+      checksum += lcsLength(oldKeys, newKeys);
+    }
+    const std::chrono::duration<double> lcsElapsed = std::chrono::steady_clock::now() - start;
+
+    const std::size_t keyedIterations = 2000000 / count;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < keyedIterations; i++) {
+      AS::Diff::compute(oldKeys.data(), oldKeys.size(), newKeys.data(), newKeys.size(), AS::Diff::Moves::None, result);
+      checksum += result.insertions.size();
+    }
+    const std::chrono::duration<double> keyedElapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%8zu %14.0f %14.0f\n", count, lcsIterations / lcsElapsed.count(), keyedIterations / keyedElapsed.count());
+  }
+  return checksum > 0 ? 0 : 1;
+}
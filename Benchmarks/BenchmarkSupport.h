@@ -0,0 +1,52 @@
+//
+//  BenchmarkSupport.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The correctness checks every benchmark runs before timing anything. Each check is a function returning bool that uses
+ CHECK for its conditions. With --check on the command line, a benchmark runs only its checks, which is what ctest
+ does.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+
+/// Fails the enclosing check, printing the condition that did not hold.
+#define CHECK(condition)                                                                \
+  do {                                                                                  \
+    if (!(condition)) {                                                                 \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      return false;                                                                     \
+    }                                                                                   \
+  } while (0)
+
+namespace Benchmark {
+
+/**
+ * Runs @c checks in order until one fails. Returns true if main should return @c status right away: 1 when a check
+ * failed, or 0 after printing "ok" when only the checks were asked for. Returns false if the benchmark should run.
+ */
+inline bool runChecks(int argc, char *argv[], std::initializer_list<bool (*)()> checks, int &status)
+{
+  for (const auto check : checks) {
+    if (!check()) {
+      status = 1;
+      return true;
+    }
+  }
+  if (argc > 1 && std::strcmp(argv[1], "--check") == 0) {
+    std::printf("ok\n");
+    status = 0;
+    return true;
+  }
+  return false;
+}
+
+} // namespace Benchmark
@@ -0,0 +1,304 @@
+//
+//  BufferPoolBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Scrolls a list one cell per display pass, drawing cell images into buffers from an AS::BufferPool and into buffers
+// allocated per image, as NSImage's lockFocus did before ASGraphicsCreateImage used the pool. Each pass draws the cell
+// that scrolls in and redraws one already visible, then releases the images of the cell that scrolled out and of the
+// one redrawn. Reports allocations and page faults per display pass and passes per second, for cells of four heights
+// and of random heights. With --check, only verifies the size classes, reuse, the byte limit, lending from several
+// threads at once and that scrolling through cells of a few heights stops allocating once warm.
+
+#include "ASBufferPool.h"
+#include "BenchmarkSupport.h"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::size_t kKB = 1024;
+
+bool checkSizeClasses()
+{
+  CHECK(AS::BufferPool::sizeClass(0) == 16 * kKB);
+  CHECK(AS::BufferPool::sizeClass(1) == 16 * kKB);
+  CHECK(AS::BufferPool::sizeClass(16 * kKB) == 16 * kKB);
+
+  for (unsigned shift = 14; shift < 30; ++shift) {
+    const std::size_t low = std::size_t(1) << shift;
+    std::set<std::size_t> classes;
+    for (std::size_t byteCount = low + 1; byteCount <= 2 * low; byteCount += low / 64) {
+      const std::size_t capacity = AS::BufferPool::sizeClass(byteCount);
+      classes.insert(capacity);
+      CHECK(capacity >= byteCount);
+      // At most a quarter wasted.
+      CHECK(capacity - byteCount < byteCount / 4);
+      CHECK(AS::BufferPool::sizeClass(capacity) == capacity);
+    }
+    CHECK(classes.size() == 4);
+  }
+  return true;
+}
+
+bool checkReuse()
+{
+  AS::BufferPool pool(kKB * kKB);
+  void *buffer = pool.borrow(16 * kKB);
+  CHECK(buffer != nullptr);
+  CHECK(pool.metrics().allocationCount == 1);
+  pool.giveBack(buffer, 16 * kKB);
+  CHECK(pool.metrics().idleByteCount == 16 * kKB);
+
+  CHECK(pool.borrow(16 * kKB) == buffer);
+  CHECK(pool.metrics().reuseCount == 1 && pool.metrics().idleByteCount == 0);
+
+  // Another size class is not shared.
+  pool.giveBack(buffer, 16 * kKB);
+  void *larger = pool.borrow(32 * kKB);
+  CHECK(larger != buffer && pool.metrics().allocationCount == 2);
+  pool.giveBack(larger, 32 * kKB);
+  CHECK(pool.metrics().idleByteCount == 48 * kKB);
+  return true;
+}
+
+bool checkByteLimit()
+{
+  AS::BufferPool pool(200 * kKB);
+  std::vector<void *> small;
+  for (int i = 0; i < 3; ++i) {
+    small.push_back(pool.borrow(16 * kKB));
+  }
+  void *large = pool.borrow(64 * kKB);
+  void *extra = pool.borrow(160 * kKB);
+  for (void *buffer : small) {
+    pool.giveBack(buffer, 16 * kKB);
+  }
+  pool.giveBack(large, 64 * kKB);
+  // Over the limit, so freed rather than kept.
+  pool.giveBack(extra, 160 * kKB);
+  CHECK(pool.metrics().idleByteCount == 112 * kKB);
+
+  // Lowering the limit frees the largest first.
+  pool.setByteLimit(100 * kKB);
+  CHECK(pool.metrics().idleByteCount == 48 * kKB);
+  const uint64_t allocationCount = pool.metrics().allocationCount;
+  void *buffer = pool.borrow(16 * kKB);
+  CHECK(pool.metrics().allocationCount == allocationCount);
+  pool.giveBack(buffer, 16 * kKB);
+
+  pool.removeAllBuffers();
+  CHECK(pool.metrics().idleByteCount == 0);
+  CHECK(pool.metrics().byteLimit == 100 * kKB);
+  return true;
+}
+
+bool checkConcurrent()
+{
+  AS::BufferPool pool(kKB * kKB);
+  const std::size_t threadCount = 8, borrowsPerThread = 20000;
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 random(t);
+      for (std::size_t i = 0; i < borrowsPerThread; ++i) {
+        const std::size_t capacity = 16 * kKB * (1 + random() % 4);
+        auto *buffer = static_cast<uint64_t *>(pool.borrow(capacity));
+        const std::size_t last = capacity / sizeof(uint64_t) - 1;
+        buffer[0] = buffer[last] = t;
+        if (i % 16 == 0) {
+          std::this_thread::yield();
+        }
+        // No other thread may have been lent the same buffer meanwhile.
+        if (buffer[0] != t || buffer[last] != t) {
+          failed = true;
+        }
+        pool.giveBack(buffer, capacity);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(!failed);
+  const AS::BufferPool::Metrics metrics = pool.metrics();
+  CHECK(metrics.allocationCount + metrics.reuseCount == threadCount * borrowsPerThread);
+  CHECK(metrics.idleByteCount <= metrics.byteLimit);
+  return true;
+}
+
+struct Image
+{
+  void *buffer;
+  std::size_t capacity;
+};
+
+// A cell image 320 points wide at 2x, with rows aligned as ASGraphicsCreateImage aligns them.
+std::size_t byteCountForHeight(std::size_t height)
+{
+  const std::size_t bytesPerRow = ((320 * 2 * 4) + 63) & ~std::size_t(63);
+  return bytesPerRow * height * 2;
+}
+
+// Stand-in for drawing: clears the buffer, as ASGraphicsCreateImage does, then fills a row of pixels.
+void draw(void *buffer, std::size_t byteCount)
+{
+  std::memset(buffer, 0, byteCount);
+  std::memset(buffer, 0xff, 320 * 2 * 4);
+}
+
+class PooledImages
+{
+public:
+  PooledImages() : _pool(32 * kKB * kKB) {}
+
+  Image draw(std::size_t byteCount)
+  {
+    const std::size_t capacity = AS::BufferPool::sizeClass(byteCount);
+    Image image = {_pool.borrow(capacity), capacity};
+    ::draw(image.buffer, byteCount);
+    return image;
+  }
+
+  void release(const Image &image) { _pool.giveBack(image.buffer, image.capacity); }
+
+  uint64_t allocationCount() { return _pool.metrics().allocationCount; }
+
+private:
+  AS::BufferPool _pool;
+};
+
+// Before the pool: a new buffer for every image, freed with it.
+class AllocatedImages
+{
+public:
+  AllocatedImages() : _allocationCount(0) {}
+
+  Image draw(std::size_t byteCount)
+  {
+    Image image = {std::malloc(byteCount), byteCount};
+    _allocationCount++;
+    ::draw(image.buffer, byteCount);
+    return image;
+  }
+
+  void release(const Image &image) { std::free(image.buffer); }
+
+  uint64_t allocationCount() { return _allocationCount; }
+
+private:
+  uint64_t _allocationCount;
+};
+
+long pageFaultCount()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt + usage.ru_majflt;
+}
+
+struct ScrollResult
+{
+  double allocationsPerPass;
+  double pageFaultsPerPass;
+  double passesPerSecond;
+};
+
+/// Scrolls through @c warmUpPasses and then @c passCount cells, measuring the latter.
+template <typename Images>
+ScrollResult scroll(Images &images, const std::function<std::size_t(std::size_t)> &heightOfCell,
+                    std::size_t warmUpPasses, std::size_t passCount)
+{
+  const std::size_t visibleCount = 20;
+  std::mt19937 random(1);
+  std::deque<std::pair<std::size_t, Image>> visible;
+  uint64_t allocationCount = 0;
+  long pageFaults = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t cell = 0; cell < warmUpPasses + passCount; ++cell) {
+    if (cell == warmUpPasses) {
+      allocationCount = images.allocationCount();
+      pageFaults = pageFaultCount();
+      start = std::chrono::steady_clock::now();
+    }
+    visible.emplace_back(cell, images.draw(byteCountForHeight(heightOfCell(cell))));
+    if (visible.size() > visibleCount) {
+      images.release(visible.front().second);
+      visible.pop_front();
+    }
+    // The new image is drawn while the old one is still on screen.
+    auto &redrawn = visible[random() % visible.size()];
+    const Image image = images.draw(byteCountForHeight(heightOfCell(redrawn.first)));
+    images.release(redrawn.second);
+    redrawn.second = image;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  ScrollResult result = {double(images.allocationCount() - allocationCount) / passCount,
+                         double(pageFaultCount() - pageFaults) / passCount, passCount / elapsed.count()};
+  for (const auto &cell : visible) {
+    images.release(cell.second);
+  }
+  return result;
+}
+
+std::size_t fourHeights(std::size_t cell)
+{
+  static const std::size_t heights[] = {44, 88, 150, 300};
+  return heights[cell % 4];
+}
+
+std::size_t randomHeight(std::size_t cell)
+{
+  return 44 + std::mt19937(cell)() % 257;
+}
+
+bool checkWarmScrolling()
+{
+  PooledImages pooled;
+  CHECK(scroll(pooled, fourHeights, 100, 1000).allocationsPerPass == 0);
+  AllocatedImages allocated;
+  CHECK(scroll(allocated, fourHeights, 100, 1000).allocationsPerPass == 2);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkSizeClasses, checkReuse, checkByteLimit, checkConcurrent,
+                                        checkWarmScrolling}, status)) {
+    return status;
+  }
+
+  std::printf("%8s %10s %12s %10s %10s %12s %10s\n", "heights", "alloc/pass", "faults/pass", "passes/s",
+              "pool alloc", "pool faults", "passes/s");
+  const std::pair<const char *, std::size_t (*)(std::size_t)> layouts[] = {{"four", fourHeights},
+                                                                            {"random", randomHeight}};
+  for (const auto &layout : layouts) {
+    AllocatedImages allocated;
+    PooledImages pooled;
+    const ScrollResult before = scroll(allocated, layout.second, 200, 5000);
+    const ScrollResult after = scroll(pooled, layout.second, 200, 5000);
+    std::printf("%8s %10.2f %12.1f %10.0f %10.2f %12.1f %10.0f\n", layout.first, before.allocationsPerPass,
+                before.pageFaultsPerPass, before.passesPerSecond, after.allocationsPerPass, after.pageFaultsPerPass,
+                after.passesPerSecond);
+  }
+  return 0;
+}
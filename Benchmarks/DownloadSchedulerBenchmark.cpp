@@ -0,0 +1,494 @@
+//
+//  DownloadSchedulerBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Downloads images from a local HTTP stand-in server, through a downloader that drives AS::DownloadScheduler the way
+// ASBasicImageDownloader does. Simulates a fling through a list whose cells request their image as they enter the
+// preload range, raise its priority once visible and cancel it once they leave, faster than the server's link can
+// keep up with, with the scheduler's limit of 6 and with no limit, as before it. Reports how many downloads the server
+// served, how many cells showed their image before leaving and how long visible cells waited. With --check, only
+// verifies the concurrency limit, the start order by priority and that cancelled downloads never reach the server.
+
+#include "ASDownloadScheduler.h"
+#include "BenchmarkSupport.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Serves GET requests on a loopback port. Each response takes @c delay on its own; with more than @c linkCapacity
+ * being sent at once, they share the link and each takes proportionally longer. Requests for /gate are held until
+ * releaseGate().
+ */
+class StandInServer
+{
+public:
+  StandInServer(std::chrono::milliseconds delay, std::size_t linkCapacity)
+    : _delay(delay), _linkCapacity(linkCapacity), _sendingCount(0), _connectionCount(0), _maximumConnectionCount(0),
+      _gateOpen(false), _stopping(false)
+  {
+    _listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(_listener, (sockaddr *)&address, length) != 0 || listen(_listener, 256) != 0
+        || getsockname(_listener, (sockaddr *)&address, &length) != 0) {
+      std::perror("StandInServer");
+      std::abort();
+    }
+    _port = ntohs(address.sin_port);
+    _acceptThread = std::thread([this] {
+      accept();
+    });
+  }
+
+  ~StandInServer()
+  {
+    releaseGate();
+    _stopping = true;
+    // Wake the accept loop with a connection of our own.
+    close(connect(_port));
+    _acceptThread.join();
+    close(_listener);
+    std::vector<std::thread> handlers;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      handlers.swap(_handlers);
+    }
+    for (auto &thread : handlers) {
+      thread.join();
+    }
+  }
+
+  uint16_t port() const { return _port; }
+
+  void releaseGate()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _gateOpen = true;
+    _condition.notify_all();
+  }
+
+  /// Waits until @c count requests have arrived.
+  bool waitForRequests(std::size_t count)
+  {
+    std::unique_lock<std::mutex> l(_mutex);
+    return _condition.wait_for(l, std::chrono::seconds(10), [&] {
+      return _paths.size() >= count;
+    });
+  }
+
+  /// The paths requested, in order of arrival.
+  std::vector<std::string> paths()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _paths;
+  }
+
+  /// The most connections that were being served at once.
+  std::size_t maximumConnectionCount()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _maximumConnectionCount;
+  }
+
+  static int connect(uint16_t port)
+  {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (::connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+private:
+  void accept()
+  {
+    while (true) {
+      const int fd = ::accept(_listener, nullptr, nullptr);
+      if (_stopping) {
+        close(fd);
+        return;
+      }
+      if (fd < 0) {
+        continue;
+      }
+      std::lock_guard<std::mutex> l(_mutex);
+      _handlers.emplace_back([this, fd] {
+        serve(fd);
+      });
+    }
+  }
+
+  void serve(int fd)
+  {
+    std::string request;
+    char buffer[512];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+      const ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n <= 0) {
+        close(fd);
+        return;
+      }
+      request.append(buffer, n);
+    }
+    const std::size_t pathStart = request.find(' ') + 1;
+    const std::string path = request.substr(pathStart, request.find(' ', pathStart) - pathStart);
+
+    {
+      std::unique_lock<std::mutex> l(_mutex);
+      _paths.push_back(path);
+      _maximumConnectionCount = std::max(_maximumConnectionCount, ++_connectionCount);
+      _condition.notify_all();
+      if (path == "/gate") {
+        _condition.wait(l, [&] {
+          return _gateOpen;
+        });
+      }
+      _sendingCount++;
+    }
+    // Progress in steps of a millisecond, by this response's share of the link.
+    double sent = 0;
+    while (sent < _delay.count()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      std::lock_guard<std::mutex> l(_mutex);
+      sent += (_linkCapacity == 0) ? 1 : std::min(1.0, double(_linkCapacity) / _sendingCount);
+    }
+    const std::string body(1024, 'x');
+    const std::string response = "HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      _sendingCount--;
+      _connectionCount--;
+      _condition.notify_all();
+    }
+    // The response goes out after the connection stops counting, since the client may start another once it has it.
+    write(fd, response.data(), response.size());
+    close(fd);
+  }
+
+  const std::chrono::milliseconds _delay;
+  const std::size_t _linkCapacity;
+  int _listener;
+  uint16_t _port;
+  std::thread _acceptThread;
+
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::vector<std::thread> _handlers;
+  std::vector<std::string> _paths;
+  std::size_t _sendingCount;
+  std::size_t _connectionCount;
+  std::size_t _maximumConnectionCount;
+  bool _gateOpen;
+  std::atomic<bool> _stopping;
+};
+
+enum Priority { Preload, Imminent, Visible };
+
+/// Requests for one path share a download, as requests for one URL share an ASBasicImageDownloaderContext.
+struct Download
+{
+  explicit Download(const std::string &path) : path(path) {}
+
+  std::string path;
+  std::mutex mutex;
+  std::vector<int> requestPriorities; // -1 once cancelled.
+
+  int priority()
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    return *std::max_element(requestPriorities.begin(), requestPriorities.end());
+  }
+
+  bool isActive()
+  {
+    return priority() >= 0;
+  }
+};
+
+struct Request
+{
+  std::shared_ptr<Download> download;
+  std::size_t index;
+};
+
+/// Drives the scheduler as ASBasicImageDownloader does, fetching over plain sockets.
+class Downloader
+{
+public:
+  Downloader(uint16_t port, std::size_t maximumRunning) : _port(port), _scheduler(maximumRunning) {}
+
+  ~Downloader()
+  {
+    waitUntilIdle();
+    // Nothing starts once idle, but the last threads may still be on their way out.
+    std::vector<std::thread> threads;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      threads.swap(_threads);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  Request download(const std::string &path, Priority priority)
+  {
+    std::shared_ptr<Download> download;
+    Request request;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      auto &current = _downloads[path];
+      if (!current) {
+        current = std::make_shared<Download>(path);
+      }
+      download = current;
+      std::lock_guard<std::mutex> dl(download->mutex);
+      download->requestPriorities.push_back(priority);
+      request = {download, download->requestPriorities.size() - 1};
+    }
+    if (_scheduler.schedule(download)) {
+      startPendingDownloads();
+    }
+    return request;
+  }
+
+  void setPriority(const Request &request, Priority priority)
+  {
+    std::lock_guard<std::mutex> l(request.download->mutex);
+    if (request.download->requestPriorities[request.index] >= 0) {
+      request.download->requestPriorities[request.index] = priority;
+    }
+  }
+
+  void cancel(const Request &request)
+  {
+    {
+      std::lock_guard<std::mutex> l(request.download->mutex);
+      request.download->requestPriorities[request.index] = -1;
+    }
+    if (!request.download->isActive()) {
+      _scheduler.remove(request.download);
+      std::lock_guard<std::mutex> l(_mutex);
+      _idle.notify_all();
+    }
+  }
+
+  /// When each path finished downloading.
+  std::map<std::string, Clock::time_point> finishTimes()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _finishTimes;
+  }
+
+  bool waitUntilIdle()
+  {
+    std::unique_lock<std::mutex> l(_mutex);
+    return _idle.wait_for(l, std::chrono::seconds(30), [&] {
+      return _scheduler.runningCount() == 0 && _scheduler.pendingCount() == 0;
+    });
+  }
+
+private:
+  void startPendingDownloads()
+  {
+    std::shared_ptr<Download> download;
+    while (_scheduler.startNext(download, [](const std::shared_ptr<Download> &d) {
+      return d->priority();
+    }, [](const std::shared_ptr<Download> &d) {
+      return d->isActive();
+    })) {
+      std::lock_guard<std::mutex> l(_mutex);
+      _threads.emplace_back([this, download] {
+        fetch(download->path);
+        {
+          std::lock_guard<std::mutex> l(_mutex);
+          _finishTimes[download->path] = Clock::now();
+          _downloads.erase(download->path);
+        }
+        _scheduler.finish(download);
+        startPendingDownloads();
+        std::lock_guard<std::mutex> l(_mutex);
+        _idle.notify_all();
+      });
+    }
+  }
+
+  void fetch(const std::string &path)
+  {
+    const int fd = StandInServer::connect(_port);
+    const std::string request = "GET " + path + " HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+    write(fd, request.data(), request.size());
+    char buffer[4096];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+    close(fd);
+  }
+
+  const uint16_t _port;
+  AS::DownloadScheduler<std::shared_ptr<Download>> _scheduler;
+  std::mutex _mutex;
+  std::condition_variable _idle;
+  std::map<std::string, std::shared_ptr<Download>> _downloads;
+  std::map<std::string, Clock::time_point> _finishTimes;
+  std::vector<std::thread> _threads;
+};
+
+bool checkConcurrencyLimit()
+{
+  StandInServer server(std::chrono::milliseconds(20), 0);
+  {
+    Downloader downloader(server.port(), 2);
+    for (int i = 0; i < 10; ++i) {
+      downloader.download("/" + std::to_string(i), Preload);
+    }
+    CHECK(downloader.waitUntilIdle());
+  }
+  CHECK(server.paths().size() == 10);
+  CHECK(server.maximumConnectionCount() == 2);
+  return true;
+}
+
+bool checkPriorityOrder()
+{
+  StandInServer server(std::chrono::milliseconds(0), 0);
+  {
+    // One at a time, held up by the gate while the rest are requested.
+    Downloader downloader(server.port(), 1);
+    downloader.download("/gate", Visible);
+    CHECK(server.waitForRequests(1));
+    downloader.download("/a", Preload);
+    const Request b = downloader.download("/b", Preload);
+    downloader.download("/c", Visible);
+    downloader.download("/d", Imminent);
+    // b becomes visible after c was requested, and wins the tie as the older of the two.
+    downloader.setPriority(b, Visible);
+    server.releaseGate();
+    CHECK(downloader.waitUntilIdle());
+  }
+  CHECK((server.paths() == std::vector<std::string>{"/gate", "/b", "/c", "/d", "/a"}));
+  return true;
+}
+
+bool checkCancellation()
+{
+  StandInServer server(std::chrono::milliseconds(0), 0);
+  {
+    Downloader downloader(server.port(), 1);
+    downloader.download("/gate", Visible);
+    CHECK(server.waitForRequests(1));
+
+    // Still wanted by one of its two requests.
+    const Request first = downloader.download("/shared", Visible);
+    downloader.download("/shared", Preload);
+    downloader.cancel(first);
+
+    // No longer wanted by anyone.
+    const Request gone = downloader.download("/gone", Visible);
+    const Request goneToo = downloader.download("/gone", Imminent);
+    downloader.cancel(gone);
+    downloader.cancel(goneToo);
+
+    server.releaseGate();
+    CHECK(downloader.waitUntilIdle());
+  }
+  CHECK((server.paths() == std::vector<std::string>{"/gate", "/shared"}));
+  return true;
+}
+
+/**
+ * Flings through @c cellCount cells, one entering the preload range every @c interval. A cell becomes visible when
+ * the tenth cell after it enters, and leaves the preload range when the fortieth does.
+ */
+void run(std::size_t maximumRunning, std::size_t &servedCount, std::size_t &shownCount, double &visibleWait)
+{
+  const std::size_t cellCount = 200, visibleLag = 10, preloadLag = 40;
+  const auto interval = std::chrono::milliseconds(4);
+  StandInServer server(std::chrono::milliseconds(20), 4);
+  std::vector<Request> requests;
+  std::vector<Clock::time_point> visibleTimes;
+  std::map<std::string, Clock::time_point> finishTimes;
+  {
+    Downloader downloader(server.port(), maximumRunning);
+    for (std::size_t i = 0; i < cellCount + preloadLag; ++i) {
+      if (i < cellCount) {
+        requests.push_back(downloader.download("/" + std::to_string(i), Preload));
+      }
+      if (i >= visibleLag && i - visibleLag < cellCount) {
+        downloader.setPriority(requests[i - visibleLag], Visible);
+        visibleTimes.push_back(Clock::now());
+      }
+      if (i >= preloadLag) {
+        downloader.cancel(requests[i - preloadLag]);
+      }
+      std::this_thread::sleep_for(interval);
+    }
+    downloader.waitUntilIdle();
+    finishTimes = downloader.finishTimes();
+  }
+
+  servedCount = server.paths().size();
+  // How long each visible cell waited for its image; those that never got it waited until they left.
+  double totalWait = 0;
+  shownCount = 0;
+  for (std::size_t i = 0; i < cellCount; ++i) {
+    const Clock::time_point left = visibleTimes[i] + interval * int(preloadLag - visibleLag);
+    const auto finish = finishTimes.find("/" + std::to_string(i));
+    const auto arrived = (finish == finishTimes.end()) ? left : std::min(finish->second, left);
+    shownCount += (arrived < left);
+    totalWait += std::chrono::duration<double, std::milli>(std::max(arrived, visibleTimes[i]) - visibleTimes[i]).count();
+  }
+  visibleWait = totalWait / cellCount;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  // The stand-in server writes to connections the client may already have given up on.
+  signal(SIGPIPE, SIG_IGN);
+
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkConcurrencyLimit, checkPriorityOrder, checkCancellation}, status)) {
+    return status;
+  }
+
+  std::printf("%10s %8s %8s %18s\n", "limit", "served", "shown", "visible wait (ms)");
+  for (std::size_t maximumRunning : {6, 1000}) {
+    std::size_t servedCount = 0, shownCount = 0;
+    double visibleWait = 0;
+    run(maximumRunning, servedCount, shownCount, visibleWait);
+    std::printf("%10zu %8zu %8zu %18.1f\n", maximumRunning, servedCount, shownCount, visibleWait);
+  }
+  return 0;
+}
@@ -0,0 +1,220 @@
+//
+//  HashingBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Hashes inputs of 8 to 4096 bytes through ASHashBytes64 and through the ELF hash it replaced, and reports bytes per
+// second, then times combining four fields with ASHashState. With --check, only verifies a few known hash values,
+// that a million small keys hash without collisions and spread evenly over buckets, and that one flipped input bit
+// flips about half of the output bits.
+
+#include "ASHashingCore.h"
+#include "BenchmarkSupport.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+bool checkKnownValues()
+{
+  // Pinned so that a change to the function is deliberate. The seed is the message's index.
+  const struct {
+    const char *message;
+    uint64_t hash;
+  } knownValues[] = {
+    {"", 0x93228a4de0eec5a2ull},
+    {"a", 0xc5bac3db178713c4ull},
+    {"abc", 0xa97f2f7b1d9b3314ull},
+    {"message digest", 0x786d1f1df3801df4ull},
+    {"abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87ull},
+    {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb9e734f117cfaf70ull},
+    {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x6cc5eab49a92d617ull},
+  };
+  for (uint64_t i = 0; i < sizeof(knownValues) / sizeof(knownValues[0]); ++i) {
+    CHECK(ASHashBytes64(knownValues[i].message, std::strlen(knownValues[i].message), i) == knownValues[i].hash);
+  }
+  return true;
+}
+
+/**
+ * Hashes @c count keys with @c hash, and checks that no two of them collide in 64 bits and that their low 16 bits,
+ * which pick the bucket in a hash table, are spread evenly. Chi-squared over 65536 buckets has a standard deviation
+ * of about 362; allow five of them.
+ */
+template <typename Hash>
+bool checkDistribution(std::size_t count, const Hash &hash)
+{
+  const std::size_t bucketCount = 1 << 16;
+  std::vector<uint32_t> buckets(bucketCount);
+  std::unordered_set<uint64_t> seen;
+  seen.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const uint64_t h = hash(i);
+    CHECK(seen.insert(h).second);
+    buckets[h & (bucketCount - 1)]++;
+  }
+  const double expected = double(count) / bucketCount;
+  double chiSquared = 0;
+  for (uint32_t n : buckets) {
+    chiSquared += (n - expected) * (n - expected) / expected;
+  }
+  CHECK(std::fabs(chiSquared - (bucketCount - 1)) < 5 * std::sqrt(2.0 * (bucketCount - 1)));
+  return true;
+}
+
+bool checkCollisions()
+{
+  const std::size_t count = 1 << 20;
+
+  // Consecutive integers, as indexes and small counts are.
+  if (!checkDistribution(count, [](std::size_t i) {
+    const uint64_t key = i;
+    return ASHashBytes64(&key, sizeof(key), 0);
+  })) {
+    return false;
+  }
+
+  // Short strings that differ in one or two characters, as attribute names and URLs do.
+  if (!checkDistribution(count, [](std::size_t i) {
+    const std::string key = "https://example.com/image/" + std::to_string(i) + ".jpg";
+    return ASHashBytes64(key.data(), key.size(), 0);
+  })) {
+    return false;
+  }
+
+  // Sizes on a grid, combined field by field as the image and text caches do.
+  if (!checkDistribution(count, [](std::size_t i) {
+    ASHashState state = ASHashStateMake(0);
+    ASHashCombineFloat(&state, double(i % 1024));
+    ASHashCombineFloat(&state, double(i / 1024) * 0.5);
+    return ASHashStateFinish64(state);
+  })) {
+    return false;
+  }
+
+  // Equal values hash equally.
+  ASHashState zero = ASHashStateMake(7), negativeZero = ASHashStateMake(7);
+  ASHashCombineFloat(&zero, 0.0);
+  ASHashCombineFloat(&negativeZero, -0.0);
+  CHECK(ASHashStateFinish64(zero) == ASHashStateFinish64(negativeZero));
+  return true;
+}
+
+int popcount(uint64_t x)
+{
+  int count = 0;
+  for (; x != 0; x &= x - 1) {
+    count++;
+  }
+  return count;
+}
+
+bool checkAvalanche()
+{
+  // Flip each bit of 1000 keys of each length; on average half of the 64 output bits should change.
+  for (std::size_t length : {8, 24, 100}) {
+    std::vector<uint8_t> key(length);
+    uint64_t flipped = 0, trials = 0;
+    for (uint64_t k = 0; k < 1000; ++k) {
+      for (std::size_t j = 0; j < length; ++j) {
+        key[j] = uint8_t((k * 131 + j * 7) >> (j % 3));
+      }
+      const uint64_t base = ASHashBytes64(key.data(), length, 0);
+      for (std::size_t bit = 0; bit < length * 8; ++bit) {
+        key[bit / 8] ^= uint8_t(1 << (bit % 8));
+        flipped += popcount(base ^ ASHashBytes64(key.data(), length, 0));
+        key[bit / 8] ^= uint8_t(1 << (bit % 8));
+        trials++;
+      }
+    }
+    const double average = double(flipped) / trials;
+    CHECK(average > 31.5 && average < 32.5);
+  }
+  return true;
+}
+
+/// Written with every timing loop's checksum, so that the compiler cannot drop the hashing.
+volatile uint64_t sink;
+
+// The hash before: CoreFoundation's ELF hash, one byte at a time into 32 bits.
+uint64_t elfHash(const void *bytes, std::size_t length)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(bytes);
+  uint32_t hash = 0;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash = (hash << 4) + p[i];
+    const uint32_t high = hash & 0xF0000000;
+    if (high != 0) {
+      hash ^= high >> 24;
+    }
+    hash &= ~high;
+  }
+  return hash;
+}
+
+template <typename Hash>
+double run(std::size_t length, const Hash &hash)
+{
+  std::vector<uint8_t> bytes(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    bytes[i] = uint8_t(i * 31);
+  }
+  const std::size_t iterations = (64 << 20) / length;
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    bytes[0] = uint8_t(i);
+    checksum += hash(bytes.data(), length);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  sink = checksum;
+  return iterations * length / elapsed.count();
+}
+
+double runCombine()
+{
+  const std::size_t iterations = 20000000;
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    ASHashState state = ASHashStateMake(i);
+    ASHashCombine(&state, i * 3);
+    ASHashCombineFloat(&state, double(i) * 0.5);
+    ASHashCombineFloat(&state, 100.0);
+    ASHashCombinePointer(&state, &checksum);
+    checksum += ASHashStateFinish64(state);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  sink = checksum;
+  return elapsed.count() * 1e9 / iterations;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkKnownValues, checkCollisions, checkAvalanche}, status)) {
+    return status;
+  }
+
+  std::printf("%8s %16s %16s\n", "bytes", "ELF MB/s", "wyhash MB/s");
+  for (std::size_t length : {8, 16, 64, 256, 4096}) {
+    const double elfRate = run(length, elfHash);
+    const double wyRate = run(length, [](const void *bytes, std::size_t length) {
+      return ASHashBytes64(bytes, length, 0);
+    });
+    std::printf("%8zu %16.0f %16.0f\n", length, elfRate / 1e6, wyRate / 1e6);
+  }
+  std::printf("combine 4 fields: %.1f ns\n", runCombine());
+  return 0;
+}
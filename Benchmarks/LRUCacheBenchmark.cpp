@@ -0,0 +1,171 @@
+//
+//  LRUCacheBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Looks up a working set from 1, 4 and 16 threads through AS::LRUCache with one shard and with sixteen, and reports
+// lookups per second and the hit rate. With --check, only verifies the eviction and cost accounting of AS::LRUCache.
+
+#include "ASLRUCache.h"
+#include "BenchmarkSupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool checkEviction()
+{
+  // One shard, so that eviction order is global.
+  AS::LRUCache<int, std::string> cache(100, 1);
+  CHECK(cache.insert(1, "a", 40) == "a");
+  CHECK(cache.insert(2, "b", 40) == "b");
+  std::string value;
+  CHECK(cache.find(1, value) && value == "a"); // 1 is now the most recently used
+  CHECK(cache.insert(3, "c", 40) == "c");      // pushes out 2
+  CHECK(!cache.find(2, value));
+  CHECK(cache.find(1, value) && cache.find(3, value));
+
+  // The value already cached wins.
+  CHECK(cache.insert(3, "d", 40) == "c");
+
+  auto metrics = cache.metrics();
+  CHECK(metrics.entryCount == 2 && metrics.cost == 80);
+  CHECK(metrics.hitCount == 3 && metrics.missCount == 1 && metrics.evictionCount == 1);
+
+  cache.setCostLimit(50);
+  metrics = cache.metrics();
+  CHECK(metrics.entryCount == 1 && metrics.cost == 40);
+  CHECK(cache.find(3, value) && value == "c");
+
+  cache.removeAll();
+  metrics = cache.metrics();
+  CHECK(metrics.entryCount == 0 && metrics.cost == 0);
+  return true;
+}
+
+bool checkOversized()
+{
+  AS::LRUCache<int, std::string> cache(16 * 100);
+  CHECK(cache.shardCostLimit() == 100);
+  for (int i = 0; i < 64; ++i) {
+    cache.insert(i, "small", 10);
+  }
+  const auto before = cache.metrics();
+
+  // Too big for a shard: returned, not kept, and nothing else is pushed out.
+  CHECK(cache.insert(1000, "big", 101) == "big");
+  std::string value;
+  CHECK(!cache.lookup(1000, value));
+  const auto after = cache.metrics();
+  CHECK(after.entryCount == before.entryCount && after.cost == before.cost);
+  CHECK(after.evictionCount == before.evictionCount);
+
+  // An entry that grows past the share is dropped too.
+  cache.update(2000, [](std::string &v, std::size_t &cost, bool inserted) {
+    v = "grows";
+    cost = 50;
+    (void)inserted;
+  });
+  CHECK(cache.lookup(2000, value) && value == "grows");
+  bool updatedExisting = false;
+  cache.update(2000, [&](std::string &v, std::size_t &cost, bool inserted) {
+    updatedExisting = !inserted;
+    v += "!";
+    cost = 200;
+  });
+  CHECK(updatedExisting);
+  CHECK(!cache.lookup(2000, value));
+  CHECK(cache.metrics().cost == before.cost);
+  CHECK(cache.metrics().evictionCount == before.evictionCount + 1);
+  return true;
+}
+
+bool checkConcurrent()
+{
+  AS::LRUCache<uint64_t, std::shared_ptr<uint64_t>> cache(16 * 64 * 8);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 random(t);
+      for (int i = 0; i < 50000; ++i) {
+        const uint64_t key = random() % 1024;
+        std::shared_ptr<uint64_t> value;
+        if (!cache.find(key, value)) {
+          value = cache.insert(key, std::make_shared<uint64_t>(key), 8);
+        }
+        if (*value != key) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(!failed);
+  const auto metrics = cache.metrics();
+  CHECK(metrics.cost <= metrics.costLimit && metrics.cost == metrics.entryCount * 8);
+  CHECK(metrics.hitCount + metrics.missCount == 8 * 50000);
+  return true;
+}
+
+double run(std::size_t shardCount, std::size_t threadCount, double &hitRate)
+{
+  // Costs of 1 to 64, limit for about three quarters of the working set.
+  const uint64_t keyCount = 20000;
+  AS::LRUCache<uint64_t, std::shared_ptr<std::string>> cache(keyCount * 32 * 3 / 4, shardCount);
+  const std::size_t lookupsPerThread = 400000;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 random(t);
+      // Skewed towards low keys, as scrolling back and forth is.
+      std::geometric_distribution<uint64_t> distribution(4.0 / keyCount);
+      for (std::size_t i = 0; i < lookupsPerThread; ++i) {
+        const uint64_t key = distribution(random) % keyCount;
+        std::shared_ptr<std::string> value;
+        if (!cache.find(key, value)) {
+          cache.insert(key, std::make_shared<std::string>(16, 'x'), 1 + key % 64);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const auto metrics = cache.metrics();
+  hitRate = double(metrics.hitCount) / double(metrics.hitCount + metrics.missCount);
+  return threadCount * lookupsPerThread / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkEviction, checkOversized, checkConcurrent}, status)) {
+    return status;
+  }
+
+  std::printf("%8s %8s %16s %8s\n", "shards", "threads", "lookups/s", "hits");
+  for (std::size_t shardCount : {1, 16}) {
+    for (std::size_t threadCount : {1, 4, 16}) {
+      double hitRate = 0;
+      const double rate = run(shardCount, threadCount, hitRate);
+      std::printf("%8zu %8zu %16.0f %7.1f%%\n", shardCount, threadCount, rate, hitRate * 100);
+    }
+  }
+  return 0;
+}
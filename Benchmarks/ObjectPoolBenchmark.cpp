@@ -0,0 +1,282 @@
+//
+//  ObjectPoolBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Measures a set of strings at several widths from 1, 4 and 16 threads, with stand-in framesetters that are slow to
+// create, through per-string AS::ObjectPools and through the cache it replaced, which kept one framesetter per string
+// and marked it busy in a set under a mutex. Reports measurements per second and how often a framesetter was reused.
+// With --check, only verifies the checkout, depth and budget accounting of AS::ObjectPool and that no object is
+// checked out by two threads at once.
+
+#include "ASObjectPool.h"
+#include "BenchmarkSupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Object
+{
+  Object() : users(0) {}
+
+  std::atomic<int> users;
+};
+
+bool checkCheckOut()
+{
+  AS::PoolBudget budget(1000);
+  AS::ObjectPool<Object *> pool(budget, 100);
+  CHECK(pool.checkOut() == nullptr);
+
+  Object objects[5];
+  CHECK(pool.checkIn(&objects[0]));
+  CHECK(budget.cost() == 100);
+  CHECK(pool.checkOut() == &objects[0]);
+  CHECK(budget.cost() == 0);
+
+  // Four slots; the fifth object is handed back and costs nothing.
+  for (int i = 0; i < 4; ++i) {
+    CHECK(pool.checkIn(&objects[i]));
+  }
+  CHECK(!pool.checkIn(&objects[4]));
+  CHECK(budget.cost() == 400);
+
+  std::set<Object *> drained;
+  pool.drain([&](Object *object) {
+    drained.insert(object);
+  });
+  CHECK(drained.size() == 4 && drained.count(&objects[4]) == 0);
+  CHECK(budget.cost() == 0 && pool.checkOut() == nullptr);
+  return true;
+}
+
+bool checkBudget()
+{
+  // Two pools that together may keep two objects.
+  AS::PoolBudget budget(250);
+  AS::ObjectPool<Object *> first(budget, 100), second(budget, 100);
+  Object a, b, c;
+  CHECK(first.checkIn(&a));
+  CHECK(second.checkIn(&b));
+  CHECK(!first.checkIn(&c));
+  CHECK(budget.cost() == 200);
+
+  // Checking one out makes room again.
+  CHECK(second.checkOut() == &b);
+  CHECK(first.checkIn(&c));
+  CHECK(budget.cost() == 200);
+  first.drain([](Object *) {});
+  CHECK(budget.cost() == 0);
+  return true;
+}
+
+bool checkConcurrent()
+{
+  AS::PoolBudget budget(100 * 6);
+  std::vector<std::unique_ptr<AS::ObjectPool<Object *>>> pools;
+  for (int i = 0; i < 4; ++i) {
+    pools.emplace_back(new AS::ObjectPool<Object *>(budget, 100));
+  }
+  std::atomic<int> created(0), destroyed(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 random(t);
+      for (int i = 0; i < 100000; ++i) {
+        auto &pool = *pools[random() % pools.size()];
+        Object *object = pool.checkOut();
+        if (object == nullptr) {
+          object = new Object();
+          created++;
+        }
+        if (object->users.fetch_add(1) != 0) {
+          failed = true;
+        }
+        object->users.fetch_sub(1);
+        if (!pool.checkIn(object)) {
+          delete object;
+          destroyed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(!failed);
+  CHECK(budget.cost() <= 100 * 6);
+  for (auto &pool : pools) {
+    pool->drain([&](Object *object) {
+      delete object;
+      destroyed++;
+    });
+  }
+  CHECK(created == destroyed);
+  CHECK(budget.cost() == 0);
+  return true;
+}
+
+// Stand-in for CoreText work: creating a framesetter typesets the whole string, creating a frame only breaks lines.
+void spin(int iterations, std::atomic<uint64_t> &checksum)
+{
+  uint64_t x = iterations;
+  for (int i = 0; i < iterations; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  checksum.fetch_add(x & 1, std::memory_order_relaxed);
+}
+
+const int kCreateWork = 4000;
+const int kFrameWork = 1000;
+
+// The cache before: one framesetter per string, marked busy in a set under a mutex. A thread that finds it busy
+// creates its own and drops it afterwards.
+class BusySetCache
+{
+public:
+  explicit BusySetCache(std::size_t stringCount) : _framesetters(stringCount, nullptr) {}
+
+  ~BusySetCache()
+  {
+    for (Object *object : _framesetters) {
+      delete object;
+    }
+  }
+
+  bool measure(std::size_t string, std::atomic<uint64_t> &checksum)
+  {
+    Object *framesetter = nullptr;
+    bool haveCached = false, useCached = false;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      framesetter = _framesetters[string];
+      haveCached = (framesetter != nullptr);
+      if (haveCached && _busy.insert(framesetter).second) {
+        useCached = true;
+      }
+    }
+    if (!useCached) {
+      framesetter = new Object();
+      spin(kCreateWork, checksum);
+    }
+    spin(kFrameWork, checksum);
+    if (useCached) {
+      std::lock_guard<std::mutex> l(_mutex);
+      _busy.erase(framesetter);
+    } else if (!haveCached) {
+      std::lock_guard<std::mutex> l(_mutex);
+      if (_framesetters[string] == nullptr) {
+        _framesetters[string] = framesetter;
+        framesetter = nullptr;
+      }
+    }
+    if (!useCached) {
+      delete framesetter;
+    }
+    return useCached;
+  }
+
+private:
+  std::mutex _mutex;
+  std::vector<Object *> _framesetters;
+  std::set<Object *> _busy;
+};
+
+class PooledCache
+{
+public:
+  explicit PooledCache(std::size_t stringCount) : _budget(16 * 1024 * 1024)
+  {
+    for (std::size_t i = 0; i < stringCount; ++i) {
+      _pools.emplace_back(new AS::ObjectPool<Object *>(_budget, 1024 + 200 * 64));
+    }
+  }
+
+  ~PooledCache()
+  {
+    for (auto &pool : _pools) {
+      pool->drain([](Object *object) {
+        delete object;
+      });
+    }
+  }
+
+  bool measure(std::size_t string, std::atomic<uint64_t> &checksum)
+  {
+    auto &pool = *_pools[string];
+    Object *framesetter = pool.checkOut();
+    const bool reused = (framesetter != nullptr);
+    if (!reused) {
+      framesetter = new Object();
+      spin(kCreateWork, checksum);
+    }
+    spin(kFrameWork, checksum);
+    if (!pool.checkIn(framesetter)) {
+      delete framesetter;
+    }
+    return reused;
+  }
+
+private:
+  AS::PoolBudget _budget;
+  std::vector<std::unique_ptr<AS::ObjectPool<Object *>>> _pools;
+};
+
+template <typename Cache>
+double run(std::size_t threadCount, double &hitRate)
+{
+  // A screenful of strings, each measured at a few widths at once as an adaptive grid does.
+  const std::size_t stringCount = 16, measurementsPerThread = 20000;
+  Cache cache(stringCount);
+  std::atomic<uint64_t> hits(0), checksum(0);
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 random(t);
+      uint64_t threadHits = 0;
+      for (std::size_t i = 0; i < measurementsPerThread; ++i) {
+        threadHits += cache.measure(random() % stringCount, checksum);
+      }
+      hits.fetch_add(threadHits);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  hitRate = double(hits) / (threadCount * measurementsPerThread);
+  return threadCount * measurementsPerThread / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkCheckOut, checkBudget, checkConcurrent}, status)) {
+    return status;
+  }
+
+  std::printf("%8s %16s %8s %16s %8s\n", "threads", "busy-set meas/s", "hits", "pooled meas/s", "hits");
+  for (std::size_t threadCount : {1, 4, 16}) {
+    double busySetHitRate = 0, pooledHitRate = 0;
+    const double busySetRate = run<BusySetCache>(threadCount, busySetHitRate);
+    const double pooledRate = run<PooledCache>(threadCount, pooledHitRate);
+    std::printf("%8zu %16.0f %7.1f%% %16.0f %7.1f%%\n", threadCount, busySetRate, busySetHitRate * 100, pooledRate,
+                pooledHitRate * 100);
+  }
+  return 0;
+}
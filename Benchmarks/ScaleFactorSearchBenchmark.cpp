@@ -0,0 +1,127 @@
+//
+//  ScaleFactorSearchBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Picks a font scale factor out of 4 to 40 with AS::FirstFittingScaleFactor and with the scan it replaced, which tried
+// each factor in turn, against a stand-in text layout whose cost grows with the text. Reports trial layouts and
+// measurements per second. With --check, only verifies that both pick the same factor for every cutoff and that the
+// search stays within its trial bound.
+
+#include "ASScaleFactorSearch.h"
+#include "BenchmarkSupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+/// The scale of 1 first, then @c count factors from 0.95 down to 0.5, as ASTextKitFontSizeAdjuster sorts them.
+std::vector<double> scaleFactors(std::size_t count)
+{
+  std::vector<double> factors = {1};
+  for (std::size_t i = 0; i < count; ++i) {
+    factors.push_back(0.95 - 0.45 * i / (count > 1 ? count - 1 : 1));
+  }
+  return factors;
+}
+
+// The adjuster before: each factor in turn until one fits, or the last.
+template <typename Fits>
+std::size_t scan(const std::vector<double> &factors, const Fits &fits)
+{
+  for (std::size_t i = 0; i < factors.size(); ++i) {
+    if (fits(factors[i])) {
+      return i;
+    }
+  }
+  return factors.size() - 1;
+}
+
+bool checkMatchesScan()
+{
+  for (std::size_t count = 1; count <= 40; ++count) {
+    const std::vector<double> factors = scaleFactors(count);
+    const std::size_t bound = 1 + std::size_t(std::ceil(std::log2(double(count))));
+    // Every cutoff between two factors, above the largest and below the smallest.
+    for (std::size_t cutoff = 0; cutoff <= factors.size(); ++cutoff) {
+      const double largestFitting = cutoff < factors.size() ? factors[cutoff] : 0;
+      std::size_t trials = 0;
+      const auto fits = [&](double scale) {
+        trials++;
+        return scale <= largestFitting;
+      };
+      const std::size_t searched = AS::FirstFittingScaleFactor(factors, fits);
+      CHECK(searched == scan(factors, [&](double scale) { return scale <= largestFitting; }));
+      CHECK(trials <= bound);
+      if (cutoff == 0) {
+        CHECK(trials == 1);
+      }
+    }
+  }
+  return true;
+}
+
+// Stand-in for laying out a trial string: line breaking touches every glyph.
+bool layOut(double scale, double largestFitting, std::size_t glyphCount, std::atomic<uint64_t> &checksum)
+{
+  uint64_t x = glyphCount;
+  for (std::size_t i = 0; i < glyphCount * 8; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  checksum.fetch_add(x & 1, std::memory_order_relaxed);
+  return scale <= largestFitting;
+}
+
+template <typename Search>
+double run(std::size_t factorCount, const Search &search, double &trialsPerMeasurement)
+{
+  const std::vector<double> factors = scaleFactors(factorCount);
+  const std::size_t measurements = 20000, glyphCount = 120;
+  std::mt19937 random(1);
+  std::atomic<uint64_t> checksum(0);
+  uint64_t trials = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < measurements; ++i) {
+    // Headlines that mostly need a little shrinking.
+    const double largestFitting = 0.5 + 0.5 * std::sqrt(double(random() % 1000) / 1000);
+    search(factors, [&](double scale) {
+      trials++;
+      return layOut(scale, largestFitting, glyphCount, checksum);
+    });
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  trialsPerMeasurement = double(trials) / measurements;
+  return measurements / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkMatchesScan}, status)) {
+    return status;
+  }
+
+  std::printf("%8s %12s %14s %12s %14s\n", "factors", "scan trials", "scan meas/s", "search trials", "search meas/s");
+  for (std::size_t factorCount : {4, 10, 20, 40}) {
+    double scanTrials = 0, searchTrials = 0;
+    const double scanRate = run(factorCount, [](const std::vector<double> &factors, const std::function<bool(double)> &fits) {
+      return scan(factors, fits);
+    }, scanTrials);
+    const double searchRate = run(factorCount, [](const std::vector<double> &factors, const std::function<bool(double)> &fits) {
+      return AS::FirstFittingScaleFactor(factors, fits);
+    }, searchTrials);
+    std::printf("%8zu %12.1f %14.0f %12.1f %14.0f\n", factorCount, scanTrials, scanRate, searchTrials, searchRate);
+  }
+  return 0;
+}
@@ -0,0 +1,195 @@
+//
+//  SegmentedQueueBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Pushes values from 1, 4, 16 and 64 producer threads while one consumer drains them, as threads enqueue into an
+// ASRunLoopQueue that the main thread processes, through AS::SegmentedQueue and through a mutex-protected deque, and
+// reports values per second. With --check, only verifies the ordering, growth and segment reclamation of
+// AS::SegmentedQueue under concurrent producers.
+
+#include "ASSegmentedQueue.h"
+#include "BenchmarkSupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Value
+{
+  Value() : producer(0), sequence(0) {}
+  Value(uint32_t producer, uint32_t sequence) : producer(producer), sequence(sequence) {}
+
+  uint32_t producer;
+  uint32_t sequence;
+};
+
+class MutexQueue
+{
+public:
+  void push(Value &&value)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _values.push_back(value);
+  }
+
+  bool pop(Value &value)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_values.empty()) {
+      return false;
+    }
+    value = _values.front();
+    _values.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex _mutex;
+  std::deque<Value> _values;
+};
+
+template <std::size_t SegmentSize>
+class SegmentedQueue
+{
+public:
+  void push(Value &&value)
+  {
+    _queue.push(std::move(value));
+  }
+
+  bool pop(Value &value)
+  {
+    Value *front = _queue.front();
+    if (front == nullptr) {
+      return false;
+    }
+    value = *front;
+    _queue.pop();
+    return true;
+  }
+
+  AS::SegmentedQueue<Value, SegmentSize> _queue;
+};
+
+bool checkSingleThreaded()
+{
+  // Small segments, so that a few thousand values go through many of them.
+  AS::SegmentedQueue<std::unique_ptr<int>, 4> queue;
+  CHECK(queue.front() == nullptr);
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 1000; i++) {
+      queue.push(std::unique_ptr<int>(new int(i)));
+    }
+    CHECK(queue.segmentCount() >= 250);
+    for (int i = 0; i < 1000; i++) {
+      std::unique_ptr<int> *front = queue.front();
+      CHECK(front != nullptr && **front == i);
+      queue.pop();
+    }
+    CHECK(queue.front() == nullptr);
+    // Emptied segments are freed once no push is under way; the one being filled stays.
+    CHECK(queue.segmentCount() == 1);
+  }
+  return true;
+}
+
+bool checkConcurrent()
+{
+  // Values of each producer come out in the order it pushed them, none are lost or repeated, and segments don't
+  // pile up while the consumer keeps up.
+  const uint32_t producerCount = 8, perProducer = 200000;
+  SegmentedQueue<16> queue;
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < producerCount; p++) {
+    producers.emplace_back([&, p] {
+      for (uint32_t i = 0; i < perProducer; i++) {
+        queue.push(Value(p, i));
+      }
+    });
+  }
+  std::vector<uint32_t> next(producerCount, 0);
+  uint64_t received = 0;
+  bool ordered = true;
+  Value value;
+  while (received < uint64_t(producerCount) * perProducer) {
+    if (!queue.pop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ordered = ordered && value.producer < producerCount && value.sequence == next[value.producer];
+    next[value.producer] = value.sequence + 1;
+    received++;
+  }
+  for (auto &thread : producers) {
+    thread.join();
+  }
+  CHECK(ordered);
+  CHECK(!queue.pop(value));
+  for (uint32_t p = 0; p < producerCount; p++) {
+    CHECK(next[p] == perProducer);
+  }
+  CHECK(queue._queue.segmentCount() == 1);
+  return true;
+}
+
+template <typename Queue>
+double run(std::size_t producerCount, std::size_t valueCount)
+{
+  Queue queue;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  const std::size_t perProducer = valueCount / producerCount;
+  for (std::size_t p = 0; p < producerCount; p++) {
+    producers.emplace_back([&, p] {
+      for (std::size_t i = 0; i < perProducer; i++) {
+        queue.push(Value((uint32_t)p, (uint32_t)i));
+      }
+    });
+  }
+  std::size_t received = 0;
+  Value value;
+  while (received < perProducer * producerCount) {
+    if (queue.pop(value)) {
+      received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto &thread : producers) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return received / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkSingleThreaded, checkConcurrent}, status)) {
+    return status;
+  }
+
+  const std::size_t valueCount = 4000000;
+  std::printf("%zu values, 1 consumer\n", valueCount);
+  std::printf("%10s %16s %16s\n", "producers", "mutex values/s", "segmented/s");
+  for (std::size_t producerCount : {1, 4, 16, 64}) {
+    const double mutexRate = run<MutexQueue>(producerCount, valueCount);
+    const double segmentedRate = run<SegmentedQueue<1024>>(producerCount, valueCount);
+    std::printf("%10zu %16.0f %16.0f\n", producerCount, mutexRate, segmentedRate);
+  }
+  return 0;
+}
@@ -0,0 +1,325 @@
+//
+//  StackLayoutBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Lays out a list of cells with the stack layout core: a vertical stack whose children are each measured by laying out
+// a horizontal stack of four, one of them flexible, and a wrapping horizontal stack of the same cells. Reports layouts
+// per second and heap allocations per layout. With --check, only verifies flexing, wrapping, alignment and spacing
+// against hand-computed frames, that layouts after the first allocate nothing, and that an AS::IntervalIndex keyed by
+// line finds the items of wrapped lines with mixed alignSelf that a range reaches, as collection flow layouts use it.
+
+#include "ASIntervalIndex.h"
+#include "ASStackLayoutCore.h"
+#include "BenchmarkSupport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Every heap allocation in the process goes through here, so the checks can count those a layout makes.
+static std::atomic<std::size_t> allocationCount(0);
+
+void *operator new(std::size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+using namespace AS::StackLayout;
+
+ChildStyle defaultChildStyle()
+{
+  return {0, 0, {Dimension::Unit::Auto, 0}, AlignSelf::Auto, 0, 0, 0, 0, 0, INFINITY};
+}
+
+Style horizontalStyle(FlexWrap flexWrap)
+{
+  return {Direction::Horizontal, 0, JustifyContent::Start, AlignItems::Start, flexWrap, AlignContent::Start, 0};
+}
+
+// Children of a fixed intrinsic size, which they keep unless the size range says otherwise.
+class FixedMeasurer
+{
+public:
+  explicit FixedMeasurer(const std::vector<Size> &sizes) : _sizes(sizes) {}
+
+  Size measure(std::size_t index, const SizeRange &sizeRange, const Size &)
+  {
+    return clamp(sizeRange, _sizes[index]);
+  }
+
+  Size placeholder(std::size_t)
+  {
+    return {0, 0};
+  }
+
+  template <typename Work>
+  void apply(std::size_t count, const Work &work)
+  {
+    for (std::size_t i = 0; i < count; i++) {
+      work(i);
+    }
+  }
+
+private:
+  const std::vector<Size> &_sizes;
+};
+
+Size layOut(const std::vector<ChildStyle> &children,
+            const std::vector<Size> &sizes,
+            const Style &style,
+            const SizeRange &sizeRange,
+            UnpositionedLayout &layout)
+{
+  FixedMeasurer measurer(sizes);
+  computeUnpositioned(children, style, sizeRange, measurer, layout);
+  return computePositioned(layout, children, style, sizeRange, 2);
+}
+
+bool checkFlexGrow()
+{
+  std::vector<ChildStyle> children(3, defaultChildStyle());
+  children[1].flexGrow = 1;
+  const std::vector<Size> sizes = {{50, 10}, {50, 10}, {50, 10}};
+  UnpositionedLayout layout;
+  const Size size = layOut(children, sizes, horizontalStyle(FlexWrap::NoWrap), {{200, 0}, {200, INFINITY}}, layout);
+  CHECK(size.width == 200 && size.height == 10);
+  CHECK(layout.items[1].size.width == 100);
+  CHECK(layout.items[0].position.x == 0 && layout.items[1].position.x == 50 && layout.items[2].position.x == 150);
+  return true;
+}
+
+bool checkWrap()
+{
+  std::vector<ChildStyle> children(5, defaultChildStyle());
+  const std::vector<Size> sizes(5, Size{40, 10});
+  Style style = horizontalStyle(FlexWrap::Wrap);
+  style.spacing = 10;
+  UnpositionedLayout layout;
+  const Size size = layOut(children, sizes, style, {{0, 0}, {100, INFINITY}}, layout);
+  CHECK(layout.lines.size() == 3);
+  CHECK(layout.lines[0].begin == 0 && layout.lines[0].end == 2 && layout.lines[2].begin == 4);
+  CHECK(layout.items[1].position.x == 50 && layout.items[1].position.y == 0);
+  CHECK(layout.items[2].position.x == 0 && layout.items[2].position.y == 10);
+  CHECK(layout.items[4].position.y == 20);
+  CHECK(size.width == 90 && size.height == 30);
+  return true;
+}
+
+bool checkAlignmentAndSpacing()
+{
+  std::vector<ChildStyle> children(3, defaultChildStyle());
+  children[0].alignSelf = AlignSelf::Center;
+  children[1].spacingBefore = 5;
+  children[1].spacingAfter = 7;
+  children[2].alignSelf = AlignSelf::Stretch;
+  const std::vector<Size> sizes = {{10, 10}, {10, 30}, {10, 4}};
+  UnpositionedLayout layout;
+  const Size size = layOut(children, sizes, horizontalStyle(FlexWrap::NoWrap), {{0, 0}, {INFINITY, INFINITY}}, layout);
+  CHECK(layout.items[0].position.y == 10);
+  CHECK(layout.items[1].position.x == 15);
+  CHECK(layout.items[2].position.x == 32 && layout.items[2].size.height == 30);
+  CHECK(size.width == 42 && size.height == 30);
+  return true;
+}
+
+bool checkIntervalIndexWithMixedAlignSelf()
+{
+  const AlignSelf alignments[] = {AlignSelf::Start, AlignSelf::Center, AlignSelf::End, AlignSelf::Stretch};
+  std::vector<ChildStyle> children(60, defaultChildStyle());
+  std::vector<Size> sizes;
+  for (std::size_t i = 0; i < children.size(); i++) {
+    children[i].alignSelf = alignments[(i * 7) % 4];
+    sizes.push_back({Float(20 + (i * 13) % 30), Float(5 + (i * 11) % 40)});
+  }
+  UnpositionedLayout layout;
+  const Size size = layOut(children, sizes, horizontalStyle(FlexWrap::Wrap), {{0, 0}, {100, INFINITY}}, layout);
+  CHECK(layout.lines.size() > 10);
+
+  // Appended in index order, keyed by where their line starts, as ASCollectionLayoutState appends flow items.
+  std::vector<Float> starts(children.size()), ends(children.size());
+  AS::IntervalIndex<Float> index;
+  Float lineOrigin = 0;
+  bool startsDecrease = false;
+  for (const Line &line : layout.lines) {
+    for (std::size_t i = line.begin; i < line.end; i++) {
+      const Item &item = layout.items[i];
+      CHECK(item.index == i);
+      starts[i] = item.position.y;
+      ends[i] = item.position.y + item.size.height;
+      CHECK(starts[i] >= lineOrigin);
+      startsDecrease = startsDecrease || (i > 0 && starts[i] < starts[i - 1]);
+      index.append(lineOrigin, ends[i]);
+    }
+    lineOrigin += line.crossSize;
+  }
+  // Otherwise the items could have been searched by where they start.
+  CHECK(startsDecrease);
+
+  for (Float rangeStart = -10; rangeStart < size.height + 10; rangeStart += 3) {
+    for (Float length : {Float(0), Float(1), Float(7), Float(50)}) {
+      const Float rangeEnd = rangeStart + length;
+      std::size_t first, last;
+      index.range(rangeStart, rangeEnd, first, last);
+      for (std::size_t i = 0; i < children.size(); i++) {
+        if (starts[i] <= rangeEnd && ends[i] >= rangeStart) {
+          CHECK(first <= i && i < last);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// A cell: a thumbnail, a title that takes the remaining width, a badge and a button.
+class CellMeasurer
+{
+public:
+  CellMeasurer() : _children(4, defaultChildStyle()), _sizes{{40, 40}, {600, 18}, {16, 16}, {24, 24}}
+  {
+    _children[1].flexShrink = 1;
+    _children[1].spacingBefore = 8;
+    _children[2].alignSelf = AlignSelf::Center;
+    _children[3].alignSelf = AlignSelf::Center;
+  }
+
+  Size measure(std::size_t, const SizeRange &sizeRange, const Size &)
+  {
+    // A nested layout, as a cell node laying out its own stack spec would do, on a scratch layout of its own.
+    ScratchLease<UnpositionedLayout> layout;
+    FixedMeasurer measurer(_sizes);
+    const Style style = horizontalStyle(FlexWrap::NoWrap);
+    const SizeRange cellRange = {{sizeRange.min.width, 0}, {sizeRange.max.width, INFINITY}};
+    computeUnpositioned(_children, style, cellRange, measurer, *layout);
+    return computePositioned(*layout, _children, style, cellRange, 2);
+  }
+
+  Size placeholder(std::size_t)
+  {
+    return {0, 0};
+  }
+
+  template <typename Work>
+  void apply(std::size_t count, const Work &work)
+  {
+    for (std::size_t i = 0; i < count; i++) {
+      work(i);
+    }
+  }
+
+private:
+  std::vector<ChildStyle> _children;
+  std::vector<Size> _sizes;
+};
+
+/// Lays out @c children of cells once, into a scratch layout, and returns the height.
+Size layOutCells(const std::vector<ChildStyle> &children, const Style &style, const SizeRange &sizeRange, CellMeasurer &measurer)
+{
+  ScratchLease<UnpositionedLayout> layout;
+  computeUnpositioned(children, style, sizeRange, measurer, *layout);
+  return computePositioned(*layout, children, style, sizeRange, 2);
+}
+
+std::vector<ChildStyle> cellChildren(std::size_t cellCount)
+{
+  std::vector<ChildStyle> children(cellCount, defaultChildStyle());
+  for (auto &child : children) {
+    child.alignSelf = AlignSelf::Stretch;
+  }
+  return children;
+}
+
+const Style listStyle = {Direction::Vertical, 0, JustifyContent::Start, AlignItems::Stretch, FlexWrap::NoWrap, AlignContent::Start, 0};
+const SizeRange listRange = {{320, 0}, {320, INFINITY}};
+const SizeRange gridRange = {{1024, 0}, {1024, INFINITY}};
+
+Style gridStyle()
+{
+  Style grid = horizontalStyle(FlexWrap::Wrap);
+  grid.spacing = 8;
+  grid.lineSpacing = 8;
+  return grid;
+}
+
+bool checkNoAllocations()
+{
+  // The first layouts grow the scratch buffers; later ones, even of fewer or differently wrapped cells, reuse them.
+  const std::vector<ChildStyle> children = cellChildren(100);
+  const std::vector<ChildStyle> fewerChildren = cellChildren(10);
+  CellMeasurer measurer;
+  const Style grid = gridStyle();
+  const std::size_t warmUpStart = allocationCount.load();
+  layOutCells(children, listStyle, listRange, measurer);
+  layOutCells(children, grid, gridRange, measurer);
+  CHECK(allocationCount.load() > warmUpStart);
+
+  const std::size_t before = allocationCount.load();
+  layOutCells(children, listStyle, listRange, measurer);
+  layOutCells(children, grid, gridRange, measurer);
+  layOutCells(fewerChildren, grid, gridRange, measurer);
+  CHECK(allocationCount.load() == before);
+  return true;
+}
+
+double run(const Style &style, const SizeRange &sizeRange, std::size_t cellCount, std::size_t iterations, double &checksum, double &allocationsPerLayout)
+{
+  const std::vector<ChildStyle> children = cellChildren(cellCount);
+  CellMeasurer measurer;
+  // Grows the scratch buffers to this many cells first, which few iterations of large layouts would not amortize.
+  checksum += layOutCells(children, style, sizeRange, measurer).height;
+  const std::size_t allocationsBefore = allocationCount.load();
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; i++) {
+    checksum += layOutCells(children, style, sizeRange, measurer).height;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  allocationsPerLayout = double(allocationCount.load() - allocationsBefore) / iterations;
+  return iterations / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkFlexGrow, checkWrap, checkAlignmentAndSpacing,
+                                        checkIntervalIndexWithMixedAlignSelf, checkNoAllocations}, status)) {
+    return status;
+  }
+
+  const Style grid = gridStyle();
+  double checksum = 0;
+  std::printf("%8s %16s %14s %16s %14s\n", "cells", "list layouts/s", "allocs/layout", "wrap layouts/s", "allocs/layout");
+  for (std::size_t cellCount : {10, 100, 1000, 10000, 100000}) {
+    const std::size_t iterations = std::max<std::size_t>(2, 200000 / cellCount);
+    double listAllocations = 0, gridAllocations = 0;
+    const double listRate = run(listStyle, listRange, cellCount, iterations, checksum, listAllocations);
+    const double gridRate = run(grid, gridRange, cellCount, iterations, checksum, gridAllocations);
+    std::printf("%8zu %16.0f %14.2f %16.0f %14.2f\n", cellCount, listRate, listAllocations, gridRate, gridAllocations);
+  }
+  return checksum > 0 ? 0 : 1;
+}
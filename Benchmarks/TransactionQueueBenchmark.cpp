@@ -0,0 +1,348 @@
+//
+//  TransactionQueueBenchmark.cpp
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+// Schedules operations from 1, 4, 16 and 64 producer threads while a fixed set of workers drains them, through
+// AS::AsyncTransactionDeques, through the single-mutex queue it replaced and through owner-first work stealing, and
+// reports operations per second.
+// With --check, only verifies the ordering and worker guarantees of AS::AsyncTransactionDeques.
+
+#include "ASAsyncTransactionDeques.h"
+#include "BenchmarkSupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Operation
+{
+  std::atomic<int> *_pendingOperations; // stands in for the group
+  long _priority;
+  uint64_t _sequence;
+  uint64_t _tag;
+};
+
+// The queue before work stealing: one mutex for every queue and group, operations in a list indexed by priority.
+class MutexQueue
+{
+public:
+  void push(Operation operation)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    ++_pendingOperations; // enter group
+    _operationQueue.push_back(operation);
+    _operationPriorityMap[operation._priority].push_back(--_operationQueue.end());
+  }
+
+  bool pop(Operation &operation, bool respectPriority)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_operationQueue.empty()) {
+      return false;
+    }
+    std::list<Operation>::iterator queueIterator;
+    std::map<long, std::list<std::list<Operation>::iterator>>::iterator mapIterator;
+    if (respectPriority) {
+      mapIterator = --_operationPriorityMap.end();
+      queueIterator = *mapIterator->second.begin();
+    } else {
+      queueIterator = _operationQueue.begin();
+      mapIterator = _operationPriorityMap.find(queueIterator->_priority);
+    }
+    operation = *queueIterator;
+    _operationQueue.erase(queueIterator);
+    mapIterator->second.pop_front();
+    if (mapIterator->second.empty()) {
+      _operationPriorityMap.erase(mapIterator);
+    }
+    return true;
+  }
+
+  void leave()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    --_pendingOperations;
+  }
+
+private:
+  std::mutex _mutex;
+  std::list<Operation> _operationQueue;
+  std::map<long, std::list<std::list<Operation>::iterator>> _operationPriorityMap;
+  int _pendingOperations = 0;
+};
+
+class DequeQueue
+{
+public:
+  explicit DequeQueue(std::size_t workerCount) : _deques(workerCount), _pendingOperations(0) {}
+
+  void push(Operation operation)
+  {
+    _pendingOperations.fetch_add(1); // enter group
+    _deques.push(std::move(operation));
+  }
+
+  bool pop(Operation &operation, std::size_t home)
+  {
+    return _deques.pop(operation, home, home > 0);
+  }
+
+  void leave()
+  {
+    _pendingOperations.fetch_sub(1);
+  }
+
+private:
+  AS::AsyncTransactionDeques<Operation> _deques;
+  std::atomic<int> _pendingOperations;
+};
+
+// Owner-first work stealing, for comparison: a worker pops its own deque newest first, and steals the oldest operation
+// from another only when its own is empty. It ignores priority, so it is the cost AsyncTransactionDeques would save by
+// giving up single-queue order.
+class StealingQueue
+{
+public:
+  explicit StealingQueue(std::size_t workerCount) : _deques(workerCount), _nextDeque(0), _pendingOperations(0) {}
+
+  void push(Operation operation)
+  {
+    _pendingOperations.fetch_add(1); // enter group
+    Deque &deque = _deques[_nextDeque.fetch_add(1, std::memory_order_relaxed) % _deques.size()];
+    std::lock_guard<std::mutex> l(deque.mutex);
+    deque.operations.push_back(operation);
+  }
+
+  bool pop(Operation &operation, std::size_t home)
+  {
+    for (std::size_t i = 0; i < _deques.size(); i++) {
+      Deque &deque = _deques[(home + i) % _deques.size()];
+      std::lock_guard<std::mutex> l(deque.mutex);
+      if (deque.operations.empty()) {
+        continue;
+      }
+      if (i == 0) {
+        operation = deque.operations.back();
+        deque.operations.pop_back();
+      } else {
+        operation = deque.operations.front();
+        deque.operations.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void leave()
+  {
+    _pendingOperations.fetch_sub(1);
+  }
+
+private:
+  struct Deque
+  {
+    std::mutex mutex;
+    std::deque<Operation> operations;
+  };
+
+  std::vector<Deque> _deques;
+  std::atomic<std::size_t> _nextDeque;
+  std::atomic<int> _pendingOperations;
+};
+
+inline void doWork(uint64_t tag, std::atomic<uint64_t> &checksum)
+{
+  // A few hundred nanoseconds of stand-in display work.
+  uint64_t x = tag;
+  for (int i = 0; i < 64; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  checksum.fetch_add(x & 1, std::memory_order_relaxed);
+}
+
+template <typename Queue, typename Pop>
+double run(Queue &queue, const Pop &pop, std::size_t producerCount, std::size_t workerCount, std::size_t operationCount)
+{
+  std::atomic<std::size_t> remaining(operationCount);
+  std::atomic<uint64_t> checksum(0);
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (std::size_t w = 0; w < workerCount; w++) {
+    workers.emplace_back([&, w] {
+      Operation operation;
+      while (remaining.load(std::memory_order_relaxed) > 0) {
+        if (pop(queue, operation, w)) {
+          doWork(operation._tag, checksum);
+          queue.leave();
+          remaining.fetch_sub(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> producers;
+  const std::size_t perProducer = operationCount / producerCount;
+  for (std::size_t p = 0; p < producerCount; p++) {
+    producers.emplace_back([&, p] {
+      const std::size_t count = (p + 1 == producerCount) ? operationCount - perProducer * p : perProducer;
+      for (std::size_t i = 0; i < count; i++) {
+        Operation operation;
+        operation._pendingOperations = nullptr;
+        operation._priority = (long)(i % 3); // a few distinct priorities, as in practice
+        operation._sequence = 0;
+        operation._tag = p * operationCount + i;
+        queue.push(operation);
+      }
+    });
+  }
+
+  for (auto &thread : producers) {
+    thread.join();
+  }
+  for (auto &thread : workers) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return operationCount / elapsed.count();
+}
+
+bool checkOrdering()
+{
+  // Pushes spread across four deques, then workers with different homes take them in single-queue order.
+  AS::AsyncTransactionDeques<Operation> deques(4);
+  const long priorities[] = {0, 2, 1, 2, 0, 1, 0, 2, 1, 1, 0, 2};
+  for (long priority : priorities) {
+    Operation operation;
+    operation._priority = priority;
+    operation._tag = 0;
+    deques.push(std::move(operation));
+  }
+  Operation operation;
+  long lastPriority = 3;
+  uint64_t lastSequence = 0;
+  std::size_t popped = 0;
+  while (deques.pop(operation, popped % 4, true)) {
+    CHECK(operation._priority <= lastPriority);
+    CHECK(operation._priority < lastPriority || operation._sequence > lastSequence || popped == 0);
+    lastPriority = operation._priority;
+    lastSequence = operation._sequence;
+    popped++;
+  }
+  CHECK(popped == sizeof(priorities) / sizeof(priorities[0]));
+  CHECK(!deques.hasOperations());
+
+  for (long priority : priorities) {
+    Operation next;
+    next._priority = priority;
+    deques.push(std::move(next));
+  }
+  uint64_t expectedSequence = popped;
+  while (deques.pop(operation, expectedSequence % 4, false)) {
+    CHECK(operation._sequence == expectedSequence);
+    expectedSequence++;
+  }
+  CHECK(expectedSequence == 2 * popped);
+  return true;
+}
+
+bool checkWorkers()
+{
+  AS::AsyncTransactionDeques<Operation> deques(4);
+  std::size_t a, b, c, d;
+  CHECK(deques.acquireWorker(3, a) && a == 0);
+  CHECK(deques.acquireWorker(3, b) && b == 1);
+  CHECK(deques.acquireWorker(3, c) && c == 2);
+  CHECK(!deques.acquireWorker(3, d));
+  // A worker that comes after one retired gets the free home, not that of a running worker.
+  deques.releaseWorker(a);
+  CHECK(deques.acquireWorker(3, d) && d == 0);
+  deques.releaseWorker(b);
+  CHECK(deques.acquireWorker(4, d) && d == 1);
+  CHECK(deques.acquireWorker(4, d) && d == 3);
+  return true;
+}
+
+bool checkConcurrent()
+{
+  const std::size_t producerCount = 8, workerCount = 4, perProducer = 20000;
+  AS::AsyncTransactionDeques<Operation> deques(workerCount);
+  std::vector<std::vector<uint64_t>> seen(workerCount);
+  std::atomic<std::size_t> remaining(producerCount * perProducer);
+  std::vector<std::thread> threads;
+  for (std::size_t w = 0; w < workerCount; w++) {
+    threads.emplace_back([&, w] {
+      Operation operation;
+      while (remaining.load() > 0) {
+        if (deques.pop(operation, w, w > 0)) {
+          seen[w].push_back(operation._tag);
+          remaining.fetch_sub(1);
+        }
+      }
+    });
+  }
+  for (std::size_t p = 0; p < producerCount; p++) {
+    threads.emplace_back([&, p] {
+      for (std::size_t i = 0; i < perProducer; i++) {
+        Operation operation;
+        operation._priority = (long)(i % 5);
+        operation._tag = p * perProducer + i;
+        deques.push(std::move(operation));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::set<uint64_t> tags;
+  for (const auto &worker : seen) {
+    tags.insert(worker.begin(), worker.end());
+  }
+  CHECK(tags.size() == producerCount * perProducer);
+  CHECK(!deques.hasOperations());
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int status;
+  if (Benchmark::runChecks(argc, argv, {checkOrdering, checkWorkers, checkConcurrent}, status)) {
+    return status;
+  }
+
+  const std::size_t workerCount = std::max(2u, std::thread::hardware_concurrency());
+  const std::size_t operationCount = 400000;
+  std::printf("%zu workers, %zu operations\n", workerCount, operationCount);
+  std::printf("%10s %16s %16s %16s\n", "producers", "mutex ops/s", "deques ops/s", "stealing ops/s");
+  for (std::size_t producerCount : {1, 4, 16, 64}) {
+    MutexQueue mutexQueue;
+    const double mutexRate = run(mutexQueue, [](MutexQueue &q, Operation &o, std::size_t w) {
+      return q.pop(o, w > 0);
+    }, producerCount, workerCount, operationCount);
+    DequeQueue dequeQueue(workerCount);
+    const double dequeRate = run(dequeQueue, [](DequeQueue &q, Operation &o, std::size_t w) {
+      return q.pop(o, w);
+    }, producerCount, workerCount, operationCount);
+    StealingQueue stealingQueue(workerCount);
+    const double stealingRate = run(stealingQueue, [](StealingQueue &q, Operation &o, std::size_t w) {
+      return q.pop(o, w);
+    }, producerCount, workerCount, operationCount);
+    std::printf("%10zu %16.0f %16.0f %16.0f\n", producerCount, mutexRate, dequeRate, stealingRate);
+  }
+  return 0;
+}
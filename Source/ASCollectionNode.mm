@@ -914,13 +914,13 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
 - (NSInteger)numberOfItemsInSection:(NSInteger)section
 {
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap numberOfItemsInSection:section];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates numberOfItemsInSection:section];
 }
 
 - (NSInteger)numberOfSections
 {
   [self reloadDataInitiallyIfNeeded];
-  return self.dataController.pendingMap.numberOfSections;
+  return self.dataController.pendingMapSubmittingCoalescedUpdates.numberOfSections;
 }
 
 - (NSArray<__kindof ASCellNode *> *)visibleNodes
@@ -932,18 +932,18 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
 - (ASCellNode *)nodeForItemAtIndexPath:(NSIndexPath *)indexPath
 {
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap elementForItemAtIndexPath:indexPath].node;
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates elementForItemAtIndexPath:indexPath].node;
 }
 
 - (id)nodeModelForItemAtIndexPath:(NSIndexPath *)indexPath
 {
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap elementForItemAtIndexPath:indexPath].nodeModel;
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates elementForItemAtIndexPath:indexPath].nodeModel;
 }
 
 - (NSIndexPath *)indexPathForNode:(ASCellNode *)cellNode
 {
-  return [self.dataController.pendingMap indexPathForElement:cellNode.collectionElement];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates indexPathForElement:cellNode.collectionElement];
 }
 
 - (NSArray<NSIndexPath *> *)indexPathsForVisibleItems
@@ -986,7 +986,7 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
 - (id<ASSectionContext>)contextForSection:(NSInteger)section
 {
   ASDisplayNodeAssertMainThread();
-  return [self.dataController.pendingMap contextForSection:section];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates contextForSection:section];
 }
 
 #pragma mark - Editing
@@ -764,7 +764,12 @@ static NSString * const kReuseIdentifier = @"_ASCollectionReuseIdentifier";
 
 - (NSArray<NSIndexPath *> *)convertIndexPathsToCollectionNode:(NSArray<NSIndexPath *> *)indexPaths
 {
-  return ASArrayByFlatMapping(indexPaths, NSIndexPath *viewIndexPath, [self convertIndexPathToCollectionNode:viewIndexPath]);
+  if (indexPaths == nil) {
+    return nil;
+  }
+
+  NSArray<NSIndexPath *> *validIndexPaths = ASArrayByFlatMapping(indexPaths, NSIndexPath *viewIndexPath, [self validateIndexPath:viewIndexPath]);
+  return [_dataController.pendingMap convertIndexPaths:validIndexPaths fromMap:_dataController.visibleMap];
 }
 
 - (ASCellNode *)supplementaryNodeForElementKind:(NSString *)elementKind atIndexPath:(NSIndexPath *)indexPath
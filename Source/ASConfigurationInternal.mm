@@ -31,6 +31,7 @@ NS_INLINE ASConfigurationManager *ASConfigurationManagerGet() {
 + (ASConfiguration *)defaultConfiguration NS_RETURNS_RETAINED
 {
   ASConfiguration *config = [[ASConfiguration alloc] init];
+  config.experimentalFeatures = ASExperimentalFramesetterCache;
   // TODO(wsdwsd0829): Fix #788 before enabling it.
   // config.experimentalFeatures = ASExperimentalInterfaceStateCoalescing;
   return config;
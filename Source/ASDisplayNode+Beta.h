@@ -27,7 +27,8 @@ ASDK_EXTERN void ASPerformBlockOnBackgroundThread(void (^block)(void)); // DISPA
  */
 typedef NS_OPTIONS(unsigned char, ASDisplayNodePerformanceMeasurementOptions) {
   ASDisplayNodePerformanceMeasurementOptionLayoutSpec = 1 << 0,
-  ASDisplayNodePerformanceMeasurementOptionLayoutComputation = 1 << 1
+  ASDisplayNodePerformanceMeasurementOptionLayoutComputation = 1 << 1,
+  ASDisplayNodePerformanceMeasurementOptionLayoutCache = 1 << 2
 };
 
 typedef struct {
@@ -35,6 +36,8 @@ typedef struct {
   NSInteger layoutSpecNumberOfPasses;
   CFTimeInterval layoutComputationTotalTime;
   NSInteger layoutComputationNumberOfPasses;
+  NSInteger layoutCacheHitCount;   // -layoutThatFits:parentSize: calls answered with an existing layout
+  NSInteger layoutCacheMissCount;  // -layoutThatFits:parentSize: calls that had to calculate a layout
 } ASDisplayNodePerformanceMeasurements;
 
 @interface ASDisplayNode (Beta)
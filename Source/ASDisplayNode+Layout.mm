@@ -7,6 +7,7 @@
 //  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
 //
 
+#import "ASArrayDiff.h"
 #import "ASAvailability.h"
 #import "ASCollections.h"
 #import "ASDisplayNodeExtras.h"
@@ -16,7 +17,6 @@
 #import "ASLayout.h"
 #import "ASLayoutElementStylePrivate.h"
 #import "ASDisplayNode+Yoga.h"
-#import "NSArray+Diffing.h"
 
 using AS::MutexLocker;
 
@@ -98,13 +98,38 @@ using AS::MutexLocker;
 
   ASLayout *layout = nil;
   NSUInteger version = _layoutVersion;
+  BOOL measureLayoutCache = _measurementOptions & ASDisplayNodePerformanceMeasurementOptionLayoutCache;
   if (_calculatedDisplayNodeLayout.isValid(constrainedSize, parentSize, version)) {
     ASDisplayNodeAssertNotNil(_calculatedDisplayNodeLayout.layout, @"-[ASDisplayNode layoutThatFits:parentSize:] _calculatedDisplayNodeLayout.layout should not be nil! %@", self);
     layout = _calculatedDisplayNodeLayout.layout;
+    if (measureLayoutCache) {
+      _layoutCacheHitCount++;
+    }
   } else if (_pendingDisplayNodeLayout.isValid(constrainedSize, parentSize, version)) {
     ASDisplayNodeAssertNotNil(_pendingDisplayNodeLayout.layout, @"-[ASDisplayNode layoutThatFits:parentSize:] _pendingDisplayNodeLayout.layout should not be nil! %@", self);
     layout = _pendingDisplayNodeLayout.layout;
+    if (measureLayoutCache) {
+      _layoutCacheHitCount++;
+    }
+  } else if (_layoutCache && (layout = _layoutCache->layout(constrainedSize, parentSize, version))) {
+    // Measured at this size range earlier in the pass. Make it pending again, keeping the one it replaces around.
+    as_log_verbose(ASLayoutLog(), "Reused cached layout for %@ in %s", self, sel_getName(_cmd));
+    if (_pendingDisplayNodeLayout.isValid(version)) {
+      _layoutCache->add(_pendingDisplayNodeLayout, version);
+    }
+    _pendingDisplayNodeLayout = ASDisplayNodeLayout(layout, constrainedSize, parentSize, version);
+    if (measureLayoutCache) {
+      _layoutCacheHitCount++;
+    }
   } else {
+    // Keep a still valid pending layout for another size range around, as the caller is likely to come back for it.
+    if (_pendingDisplayNodeLayout.isValid(version)) {
+      if (!_layoutCache) {
+        _layoutCache.reset(new ASDisplayNodeLayoutCache());
+      }
+      _layoutCache->add(_pendingDisplayNodeLayout, version);
+    }
+    
     // Create a pending display node layout for the layout pass
     layout = [self calculateLayoutThatFits:constrainedSize
                           restrictedToSize:self.style.size
@@ -112,6 +137,9 @@ using AS::MutexLocker;
     as_log_verbose(ASLayoutLog(), "Established pending layout for %@ in %s", self, sel_getName(_cmd));
     _pendingDisplayNodeLayout = ASDisplayNodeLayout(layout, constrainedSize, parentSize,version);
     ASDisplayNodeAssertNotNil(layout, @"-[ASDisplayNode layoutThatFits:parentSize:] newly calculated layout should not be nil! %@", self);
+    if (measureLayoutCache) {
+      _layoutCacheMissCount++;
+    }
   }
   
   return layout ?: [ASLayout layoutWithLayoutElement:self size:{0, 0}];
@@ -258,13 +286,69 @@ ASLayoutElementStyleExtensibilityForwarding
   
   if (supernode) {
     // Threading model requires that we unlock before calling a method on our parent.
-    [supernode _u_setNeedsLayoutFromAbove];
+    [supernode _u_setNeedsLayoutForSubnodeSizeChange];
   } else {
     // Let the root node method know that the size was invalidated
     [self _rootNodeDidInvalidateSize];
   }
 }
 
+// A node whose size is fixed by its own style is a relayout boundary: it keeps its size whatever its subnodes do, so it
+// only needs to lay itself out again and its supernodes keep their layouts.
+- (void)_u_setNeedsLayoutForSubnodeSizeChange
+{
+  ASDisplayNodeAssertThreadAffinity(self);
+  DISABLED_ASAssertUnlocked(__instanceLock__);
+
+  __instanceLock__.lock();
+  BOOL isRelayoutBoundary = [self _locked_isRelayoutBoundary];
+  __instanceLock__.unlock();
+
+  if (isRelayoutBoundary) {
+    as_log_verbose(ASLayoutLog(), "Stopped escalating layout at relayout boundary %@", self);
+    [self setNeedsLayout];
+  } else {
+    [self _u_setNeedsLayoutFromAbove];
+  }
+}
+
+/**
+ * Whether a style dimension is fixed in points, either directly or by equal minimum and maximum. Returns the size in
+ * @c value if so.
+ */
+static BOOL ASDimensionIsFixedInPoints(ASDimension dimension, ASDimension minDimension, ASDimension maxDimension, CGFloat *value)
+{
+  if (dimension.unit == ASDimensionUnitPoints) {
+    *value = dimension.value;
+    return YES;
+  }
+  if (minDimension.unit == ASDimensionUnitPoints && maxDimension.unit == ASDimensionUnitPoints
+      && minDimension.value == maxDimension.value) {
+    *value = minDimension.value;
+    return YES;
+  }
+  return NO;
+}
+
+- (BOOL)_locked_isRelayoutBoundary
+{
+  DISABLED_ASAssertLocked(__instanceLock__);
+  // The root has to report size changes to its container itself, and an unloaded node has no layout pass of its own.
+  if (_supernode == nil || _calculatedDisplayNodeLayout.layout == nil || !_loaded(self)) {
+    return NO;
+  }
+  // An exact size range is not enough: a stack hands its children exact ranges that come from their own earlier
+  // measurement when it stretches, grows or shrinks them, so their content still decides their size. Only a width and
+  // height fixed in points by the style, which the node was laid out at, keep its size independent of its content.
+  ASLayoutElementStyle *style = [self _locked_style];
+  CGSize fixedSize;
+  if (!ASDimensionIsFixedInPoints(style.width, style.minWidth, style.maxWidth, &fixedSize.width)
+      || !ASDimensionIsFixedInPoints(style.height, style.minHeight, style.maxHeight, &fixedSize.height)) {
+    return NO;
+  }
+  return CGSizeEqualToSize(_calculatedDisplayNodeLayout.layout.size, fixedSize);
+}
+
 // TODO It would be easier to work with if we could `ASAssertUnlocked` here, but we
 // cannot due to locking to root in `_u_measureNodeWithBoundsIfNecessary`.
 - (void)_rootNodeDidInvalidateSize
@@ -989,20 +1073,28 @@ ASLayoutElementStyleExtensibilityForwarding
     }
   }
 
-  NSArray<ASDisplayNode *> *layoutNodes = ASArrayByFlatMapping(sublayouts, ASLayout *layout, (ASDisplayNode *)layout.layoutElement);
-  NSIndexSet *insertions, *deletions;
-  [_subnodes asdk_diffWithArray:layoutNodes insertions:&insertions deletions:&deletions];
-  if (insertions.count > 0) {
+  // Nodes are compared by identity, so diff their pointers.
+  std::vector<AS::Diff::Key> subnodeKeys, layoutKeys;
+  subnodeKeys.reserve(_subnodes.count);
+  layoutKeys.reserve(AS_ARRAY_SIZE(cSublayouts));
+  for (ASDisplayNode *subnode in _subnodes) {
+    subnodeKeys.push_back((uintptr_t)subnode);
+  }
+  for (NSUInteger i = 0; i < AS_ARRAY_SIZE(cSublayouts); i++) {
+    layoutKeys.push_back((uintptr_t)cSublayouts[i].layoutElement);
+  }
+  AS::Diff::Result diff;
+  AS::Diff::compute(subnodeKeys.data(), subnodeKeys.size(), layoutKeys.data(), layoutKeys.size(), AS::Diff::Moves::None, diff);
+  if (!diff.insertions.empty()) {
+    NSArray<ASDisplayNode *> *layoutNodes = ASArrayByFlatMapping(sublayouts, ASLayout *layout, (ASDisplayNode *)layout.layoutElement);
     NSLog(@"Warning: node's layout includes subnode that has not been added: node = %@, subnodes = %@, subnodes in layout = %@", self, _subnodes, layoutNodes);
   }
 
   // Remove any nodes that are in the tree but should not be.
   // Go in reverse order so we don't shift our indexes.
-  if (deletions) {
-    for (NSUInteger i = deletions.lastIndex; i != NSNotFound; i = [deletions indexLessThanIndex:i]) {
-      NSLog(@"Automatically removing orphaned subnode %@, from parent %@", _subnodes[i], self);
-      [_subnodes[i] removeFromSupernode];
-    }
+  for (auto it = diff.deletions.rbegin(); it != diff.deletions.rend(); it++) {
+    NSLog(@"Automatically removing orphaned subnode %@, from parent %@", _subnodes[*it], self);
+    [_subnodes[*it] removeFromSupernode];
   }
 }
 
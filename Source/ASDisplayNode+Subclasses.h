@@ -226,6 +226,9 @@ AS_CATEGORY_IMPLEMENTABLE
  * @param isRasterizing YES if the layer is being rasterized into another layer, in which case drawRect: probably wants
  * to avoid doing things like filling its bounds with a zero-alpha color to clear the backing store.
  *
+ * @discussion When the node displays tiled, this is called once per tile, with the context clipped to the tile. Use
+ * CGContextGetClipBoundingBox to find the part of the bounds being drawn and skip content outside it.
+ *
  * @note Called on the display queue and/or main queue (MUST BE THREAD SAFE)
  */
 + (void)drawRect:(CGRect)bounds withParameters:(nullable id)parameters
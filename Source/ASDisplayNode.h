@@ -470,6 +470,25 @@ ASDK_EXTERN NSInteger const ASDefaultDrawingPriority;
  */
 @property NSInteger drawingPriority;
 
+/**
+ * @abstract Whether the node draws its contents as tiles of displayTileSize rather than as one bitmap.
+ *
+ * @discussion For very tall or wide nodes, such as long articles. Tiles are drawn asynchronously, those in the visible
+ * rect first, and each is shown as soon as it is drawn, so the visible part does not wait for the rest. Under memory
+ * pressure, tiles outside the visible rect are released and drawn again when they scroll into view.
+ *
+ * Applies to nodes that draw with +drawRect:withParameters:isCancelled:isRasterizing:, larger than one tile, that
+ * display asynchronously and do not rasterize their subtree or precomposite rounded corners. Other nodes, including
+ * those returning an image from +displayWithParameters:isCancelled:, display as one bitmap. The context modifier
+ * blocks are called once per tile. Takes effect at the next display. Defaults to NO.
+ */
+@property BOOL displaysTiled;
+
+/**
+ * @abstract The size, in points, of the tiles drawn when displaysTiled is YES. Defaults to 512 by 512.
+ */
+@property CGSize displayTileSize;
+
 /** @name Hit Testing */
 
 
@@ -18,6 +18,7 @@
 #import "_ASAsyncTransactionContainer+Private.h"
 #import "_ASCoreAnimationExtras.h"
 #import "_ASDisplayLayer.h"
+#import "_ASDisplayTiles.h"
 #import "_ASDisplayView.h"
 #import "_ASPendingState.h"
 #import "_ASScopeTimer.h"
@@ -299,6 +300,7 @@ __attribute__((destructor)) static void ASLoadFrameworkInitializerOnDestructor(v
 
   _contentsScaleForDisplay = ASScreenScale();
   _drawingPriority = ASDefaultTransactionPriority;
+  _displayTileSize = CGSizeMake(512, 512);
   _maskedCorners = kASCACornerAllCorners;
   
   _primitiveTraitCollection = ASPrimitiveTraitCollectionMakeDefault();
@@ -931,6 +933,31 @@ static inline BOOL NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
   _flags.placeholderEnabled = flag;
 }
 
+- (BOOL)displaysTiled
+{
+  MutexLocker l(__instanceLock__);
+  return _flags.displaysTiled;
+}
+
+- (void)setDisplaysTiled:(BOOL)flag
+{
+  MutexLocker l(__instanceLock__);
+  _flags.displaysTiled = flag;
+}
+
+- (CGSize)displayTileSize
+{
+  MutexLocker l(__instanceLock__);
+  return _displayTileSize;
+}
+
+- (void)setDisplayTileSize:(CGSize)displayTileSize
+{
+  ASDisplayNodeAssert(displayTileSize.width > 0 && displayTileSize.height > 0, @"Display tiles must not be empty");
+  MutexLocker l(__instanceLock__);
+  _displayTileSize = displayTileSize;
+}
+
 - (void)__setNodeController:(ASNodeController *)controller
 {
   // See docs for why we don't lock.
@@ -999,6 +1026,9 @@ static inline BOOL NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
   _layoutVersion++;
   
   _unflattenedLayout = nil;
+  if (_layoutCache) {
+    _layoutCache->removeAll();
+  }
 
 #if YOGA
   [self invalidateCalculatedYogaLayout];
@@ -3154,6 +3184,11 @@ ASDISPLAYNODE_INLINE BOOL subtreeIsRasterized(ASDisplayNode *node) {
   [self enumerateInterfaceStateDelegates:^(id<ASInterfaceStateDelegate> del) {
     [del didEnterVisibleState];
   }];
+
+  // Tiles released under memory pressure while the node was off-screen are drawn again.
+  if (_displayTiles.hasEvictedTiles) {
+    [self _displayEvictedTiles];
+  }
   
 #if AS_ENABLE_TIPS
   [ASTipsController.shared nodeDidAppear:self];
@@ -3273,6 +3308,7 @@ ASDISPLAYNODE_INLINE BOOL subtreeIsRasterized(ASDisplayNode *node) {
   
   _placeholderLayer.contents = nil;
   _placeholderImage = nil;
+  [_displayTiles removeAllTiles];
 }
 
 - (void)recursivelyClearContents
@@ -3488,7 +3524,7 @@ ASDISPLAYNODE_INLINE BOOL subtreeIsRasterized(ASDisplayNode *node) {
 - (ASDisplayNodePerformanceMeasurements)performanceMeasurements
 {
   MutexLocker l(__instanceLock__);
-  ASDisplayNodePerformanceMeasurements measurements = { .layoutSpecNumberOfPasses = -1, .layoutSpecTotalTime = NAN, .layoutComputationNumberOfPasses = -1, .layoutComputationTotalTime = NAN };
+  ASDisplayNodePerformanceMeasurements measurements = { .layoutSpecNumberOfPasses = -1, .layoutSpecTotalTime = NAN, .layoutComputationNumberOfPasses = -1, .layoutComputationTotalTime = NAN, .layoutCacheHitCount = -1, .layoutCacheMissCount = -1 };
   if (_measurementOptions & ASDisplayNodePerformanceMeasurementOptionLayoutSpec) {
     measurements.layoutSpecNumberOfPasses = _layoutSpecNumberOfPasses;
     measurements.layoutSpecTotalTime = _layoutSpecTotalTime;
@@ -3497,6 +3533,10 @@ ASDISPLAYNODE_INLINE BOOL subtreeIsRasterized(ASDisplayNode *node) {
     measurements.layoutComputationNumberOfPasses = _layoutComputationNumberOfPasses;
     measurements.layoutComputationTotalTime = _layoutComputationTotalTime;
   }
+  if (_measurementOptions & ASDisplayNodePerformanceMeasurementOptionLayoutCache) {
+    measurements.layoutCacheHitCount = _layoutCacheHitCount;
+    measurements.layoutCacheMissCount = _layoutCacheMissCount;
+  }
   return measurements;
 }
 
@@ -27,15 +27,8 @@ void ASPerformMainThreadDeallocation(id _Nullable __strong * _Nonnull objectPtr)
   });
 
   if (objectPtr != NULL && *objectPtr != nil) {
-    // TODO: If ASRunLoopQueue supported an "unsafe_unretained" mode, we could
-    // transfer the caller's +1 into it and save the retain/release pair.
-    
-    // Lock queue while enqueuing and releasing, so that there's no risk
-    // that the queue will release before we get a chance to release.
-    [queue lock];
-    [queue enqueue:*objectPtr];   // Retain, +1
-    *objectPtr = nil;             // Release, +0
-    [queue unlock];               // (After queue drains), release, -1
+    // The queue takes over the caller's +1, so it holds the last reference without a lock or a retain/release pair.
+    [queue enqueueTransferringObject:objectPtr];
   }
 }
 
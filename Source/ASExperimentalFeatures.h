@@ -32,7 +32,12 @@ typedef NS_OPTIONS(NSUInteger, ASExperimentalFeatures) {
   ASExperimentalMainThreadOnlyDataController = 1 << 11,                     // exp_main_thread_only_data_controller
   ASExperimentalRangeUpdateOnChangesetUpdate = 1 << 12,                     // exp_range_update_on_changeset_update
   ASExperimentalNoTextRendererCache = 1 << 13,                              // exp_no_text_renderer_cache
-  ASExperimentalLockTextRendererCache = 1 << 14,                            // exp_lock_text_renderer_cache
+  ASExperimentalLockTextRendererCache = 1 << 14,                            // exp_lock_text_renderer_cache (no-op, the renderer cache is always locked)
+  // Holds back batch updates while an earlier one is being prepared.
+  // ASCollectionNode and ASTableNode queries like -nodeForItemAtIndexPath: and -indexPathForNode: latch them first;
+  // ASCollectionView and ASTableView index path conversions still see the data as of the last latched update.
+  // A reload goes out right away and drops the batches it replaces, and updates land within a main thread budget.
+  ASExperimentalCoalesceDataControllerUpdates = 1 << 15,                    // exp_coalesce_data_controller_updates
   ASExperimentalFeatureAll = 0xFFFFFFFF
 };
 
@@ -26,7 +26,8 @@ NSArray<NSString *> *ASExperimentalFeaturesGetNames(ASExperimentalFeatures flags
                                       @"exp_main_thread_only_data_controller",
                                       @"exp_range_update_on_changeset_update",
                                       @"exp_no_text_renderer_cache",
-                                      @"exp_lock_text_renderer_cache"]));
+                                      @"exp_lock_text_renderer_cache",
+                                      @"exp_coalesce_data_controller_updates"]));
 
   if (flags == ASExperimentalFeatureAll) {
     return allNames;
@@ -23,6 +23,18 @@ NS_ASSUME_NONNULL_BEGIN
  */
 typedef NSImage * _Nullable (^asimagenode_modification_block_t)(NSImage *image, ASPrimitiveTraitCollection traitCollection);
 
+/**
+ * Counters for the contents cache shared by all image nodes.
+ */
+typedef struct {
+  /// Requests answered from the cache.
+  uint64_t hitCount;
+  /// Bitmaps rendered on a cache miss.
+  uint64_t renderCount;
+  /// Requests that waited for another request rendering the same contents, instead of rendering again.
+  uint64_t deduplicatedRenderCount;
+} ASImageNodeContentsCacheMetrics;
+
 /**
  * @abstract Draws images.
  * @discussion Supports cropping, tinting, and arbitrary image modification blocks.
@@ -121,6 +133,11 @@ typedef NSImage * _Nullable (^asimagenode_modification_block_t)(NSImage *image,
  */
 - (void)setNeedsDisplayWithCompletion:(nullable void (^)(BOOL canceled))displayCompletionBlock;
 
+/**
+ * @abstract Returns the current counters of the contents cache shared by all image nodes.
+ */
++ (ASImageNodeContentsCacheMetrics)contentsCacheMetrics;
+
 #if TARGET_OS_TV
 /** 
  * A bool to track if the current appearance of the node
@@ -110,31 +110,112 @@ typedef void (^ASImageNodeDrawParametersBlock)(ASWeakMapEntry *entry);
 
 - (NSUInteger)hash
 {
-#pragma clang diagnostic push
-#pragma clang diagnostic warning "-Wpadded"
-  struct {
-    NSUInteger imageHash;
-    CGSize backingSize;
-    CGRect imageDrawRect;
-    NSInteger isOpaque;
-    NSUInteger backgroundColorHash;
-    NSUInteger tintColorHash;
-    void *willDisplayNodeContentWithRenderingContext;
-    void *didDisplayNodeContentWithRenderingContext;
-    void *imageModificationBlock;
-#pragma clang diagnostic pop
-  } data = {
-    _image.hash,
-    _backingSize,
-    _imageDrawRect,
-    _isOpaque,
-    _backgroundColor.hash,
-    _tintColor.hash,
-    (void *)_willDisplayNodeContentWithRenderingContext,
-    (void *)_didDisplayNodeContentWithRenderingContext,
-    (void *)_imageModificationBlock
-  };
-  return ASHashBytes(&data, sizeof(data));
+  // Hash field by field: the rects and sizes are compared with CGRectEqualToRect / CGSizeEqualToSize,
+  // which treat -0.0 and 0.0 as equal, so their raw bytes must not be hashed.
+  ASHashState state = ASHashStateMake(0);
+  ASHashCombine(&state, _image.hash);
+  ASHashCombineSize(&state, _backingSize);
+  ASHashCombineRect(&state, _imageDrawRect);
+  ASHashCombine(&state, _isOpaque);
+  ASHashCombine(&state, _backgroundColor.hash);
+  ASHashCombine(&state, _tintColor.hash);
+  ASHashCombinePointer(&state, (void *)_willDisplayNodeContentWithRenderingContext);
+  ASHashCombinePointer(&state, (void *)_didDisplayNodeContentWithRenderingContext);
+  ASHashCombinePointer(&state, (void *)_imageModificationBlock);
+  return ASHashStateFinish(state);
+}
+
+@end
+
+/**
+ * A render of image node contents that requests for the same key can wait on.
+ */
+@interface ASImageNodeContentsRender : NSObject
+
+/**
+ * Registers a request, returning the stored cancellation block that identifies it.
+ */
+- (asdisplaynode_iscancelled_block_t)addRequest:(asdisplaynode_iscancelled_block_t)isCancelled;
+
+/**
+ * Drops cancelled requests, waking their waiters so they can leave, and returns YES if none are left.
+ */
+- (BOOL)allRequestsCancelled;
+
+/**
+ * Blocks until the render finishes, or until the request is found cancelled, in which case this returns NO. The
+ * render checks its requests as it goes, so a cancelled waiter is woken by the render's next check at the latest.
+ */
+- (BOOL)waitForEntry:(ASWeakMapEntry **)entry request:(asdisplaynode_iscancelled_block_t)request;
+
+- (void)finishWithEntry:(ASWeakMapEntry *)entry;
+
+@end
+
+@implementation ASImageNodeContentsRender {
+  NSCondition *_condition;
+  NSMutableArray<asdisplaynode_iscancelled_block_t> *_requests;
+  ASWeakMapEntry *_entry;
+  BOOL _finished;
+}
+
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _condition = [[NSCondition alloc] init];
+    _requests = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+- (asdisplaynode_iscancelled_block_t)addRequest:(asdisplaynode_iscancelled_block_t)isCancelled
+{
+  asdisplaynode_iscancelled_block_t request = [isCancelled copy];
+  [_condition lock];
+  [_requests addObject:request];
+  [_condition unlock];
+  return request;
+}
+
+- (BOOL)allRequestsCancelled
+{
+  [_condition lock];
+  NSIndexSet *cancelled = [_requests indexesOfObjectsPassingTest:^BOOL(asdisplaynode_iscancelled_block_t request, NSUInteger idx, BOOL *stop) {
+    return request();
+  }];
+  if (cancelled.count > 0) {
+    [_requests removeObjectsAtIndexes:cancelled];
+    [_condition broadcast];
+  }
+  BOOL result = (_requests.count == 0);
+  [_condition unlock];
+  return result;
+}
+
+- (BOOL)waitForEntry:(ASWeakMapEntry **)entry request:(asdisplaynode_iscancelled_block_t)request
+{
+  [_condition lock];
+  while (!_finished) {
+    if (request()) {
+      [_requests removeObjectIdenticalTo:request];
+      [_condition unlock];
+      return NO;
+    }
+    [_condition wait];
+  }
+  *entry = _entry;
+  [_condition unlock];
+  return YES;
+}
+
+- (void)finishWithEntry:(ASWeakMapEntry *)entry
+{
+  [_condition lock];
+  _entry = entry;
+  _finished = YES;
+  [_requests removeAllObjects];
+  [_condition broadcast];
+  [_condition unlock];
 }
 
 @end
@@ -453,6 +534,20 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
 }
 
 static ASWeakMap<ASImageNodeContentsKey *, NSImage *> *cache = nil;
+// Renders in progress, so that requests for the same key wait for them instead of rendering again.
+static NSMapTable<ASImageNodeContentsKey *, ASImageNodeContentsRender *> *inFlightRenders = nil;
+static std::atomic<uint64_t> cacheHitCount;
+static std::atomic<uint64_t> cacheRenderCount;
+static std::atomic<uint64_t> cacheDeduplicatedRenderCount;
+
++ (ASImageNodeContentsCacheMetrics)contentsCacheMetrics
+{
+  return {
+    .hitCount = cacheHitCount.load(std::memory_order_relaxed),
+    .renderCount = cacheRenderCount.load(std::memory_order_relaxed),
+    .deduplicatedRenderCount = cacheDeduplicatedRenderCount.load(std::memory_order_relaxed),
+  };
+}
 
 + (ASWeakMapEntry *)contentsForkey:(ASImageNodeContentsKey *)key drawParameters:(id)drawParameters isCancelled:(asdisplaynode_iscancelled_block_t)isCancelled
 {
@@ -462,26 +557,59 @@ static ASWeakMap<ASImageNodeContentsKey *, NSImage *> *cache = nil;
     cacheLock = new AS::Mutex();
   });
 
-  {
-    AS::MutexLocker l(*cacheLock);
-    if (!cache) {
-      cache = [[ASWeakMap alloc] init];
+  while (true) {
+    ASImageNodeContentsRender *render;
+    asdisplaynode_iscancelled_block_t request;
+    BOOL isRendering = NO;
+    {
+      AS::MutexLocker l(*cacheLock);
+      if (!cache) {
+        cache = [[ASWeakMap alloc] init];
+        inFlightRenders = [NSMapTable strongToStrongObjectsMapTable];
+      }
+      ASWeakMapEntry *entry = [cache entryForKey:key];
+      if (entry != nil) {
+        cacheHitCount.fetch_add(1, std::memory_order_relaxed);
+        return entry;
+      }
+
+      render = [inFlightRenders objectForKey:key];
+      if (render == nil) {
+        render = [[ASImageNodeContentsRender alloc] init];
+        [inFlightRenders setObject:render forKey:key];
+        isRendering = YES;
+      }
+      request = [render addRequest:isCancelled];
+    }
+
+    if (isRendering) {
+      // cache miss. Only give up once every request waiting on this render has been cancelled.
+      cacheRenderCount.fetch_add(1, std::memory_order_relaxed);
+      NSImage *contents = [self createContentsForkey:key drawParameters:drawParameters isCancelled:^BOOL{
+        return [render allRequestsCancelled];
+      }];
+
+      ASWeakMapEntry *entry = nil;
+      {
+        AS::MutexLocker l(*cacheLock);
+        if (contents != nil) {
+          entry = [cache setObject:contents forKey:key];
+        }
+        [inFlightRenders removeObjectForKey:key];
+      }
+      [render finishWithEntry:entry];
+      return entry; // If nil, we were cancelled
+    }
+
+    ASWeakMapEntry *entry;
+    if (![render waitForEntry:&entry request:request]) {
+      return nil; // We were cancelled
     }
-    ASWeakMapEntry *entry = [cache entryForKey:key];
     if (entry != nil) {
+      cacheDeduplicatedRenderCount.fetch_add(1, std::memory_order_relaxed);
       return entry;
     }
-  }
-
-  // cache miss
-  NSImage *contents = [self createContentsForkey:key drawParameters:drawParameters isCancelled:isCancelled];
-  if (contents == nil) { // If nil, we were cancelled
-    return nil;
-  }
-
-  {
-    AS::MutexLocker l(*cacheLock);
-    return [cache setObject:contents forKey:key];
+    // The render was abandoned by everyone else but we still want the contents, so go again.
   }
 }
 
@@ -806,7 +934,7 @@ static ASWeakMap<ASImageNodeContentsKey *, NSImage *> *cache = nil;
 asimagenode_modification_block_t ASImageNodeRoundBorderModificationBlock(CGFloat borderWidth, NSColor *borderColor)
 {
   return ^(NSImage *originalImage, ASPrimitiveTraitCollection traitCollection) {
-    return ASGraphicsCreateImage(traitCollection, originalImage.size, NO, 1, originalImage, nil, ^{
+    return ASGraphicsCreateImage(traitCollection, originalImage.size, NO, 0, originalImage, nil, ^{
       NSBezierPath *roundOutline = [NSBezierPath bezierPathWithOvalInRect:NSMakeRect(0, 0, originalImage.size.width, originalImage.size.height)];
 
       // Make the image round
@@ -828,7 +956,7 @@ asimagenode_modification_block_t ASImageNodeRoundBorderModificationBlock(CGFloat
 asimagenode_modification_block_t ASImageNodeTintColorModificationBlock(NSColor *color)
 {
   return ^(NSImage *originalImage, ASPrimitiveTraitCollection traitCollection) {
-    NSImage *modifiedImage = ASGraphicsCreateImage(traitCollection, originalImage.size, NO, 1, originalImage, nil, ^{
+    NSImage *modifiedImage = ASGraphicsCreateImage(traitCollection, originalImage.size, NO, 0, originalImage, nil, ^{
       // Set color and render template
       [color setFill];
       BOOL isTemplateImage = [originalImage isTemplate];
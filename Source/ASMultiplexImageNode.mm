@@ -13,6 +13,7 @@
 #import <AssetsLibrary/AssetsLibrary.h>
 #endif
 
+#import "ASDecodedImageCache.h"
 #import "ASDisplayNodeExtras.h"
 #import "ASDisplayNode+Subclasses.h"
 #import "ASDisplayNode+FrameworkPrivate.h"
@@ -58,6 +59,7 @@ typedef void(^ASMultiplexImageLoadCompletionBlock)(NSImage *image, id imageIdent
     unsigned int downloaderImplementsSetProgress:1;
     unsigned int downloaderImplementsSetPriority:1;
     unsigned int downloaderImplementsDownloadWithPriority:1;
+    unsigned int downloaderImplementsDownloadWithPixelSize:1;
   } _downloaderFlags;
 
   __weak id<ASMultiplexImageNodeDelegate> _delegate;
@@ -177,6 +179,7 @@ typedef void(^ASMultiplexImageLoadCompletionBlock)(NSImage *image, id imageIdent
   _downloaderFlags.downloaderImplementsSetProgress = [downloader respondsToSelector:@selector(setProgressImageBlock:callbackQueue:withDownloadIdentifier:)];
   _downloaderFlags.downloaderImplementsSetPriority = [downloader respondsToSelector:@selector(setPriority:withDownloadIdentifier:)];
   _downloaderFlags.downloaderImplementsDownloadWithPriority = [downloader respondsToSelector:@selector(downloadImageWithURL:shouldRetry:priority:callbackQueue:downloadProgress:completion:)];
+  _downloaderFlags.downloaderImplementsDownloadWithPixelSize = [downloader respondsToSelector:@selector(downloadImageWithURL:pixelSize:shouldRetry:priority:callbackQueue:downloadProgress:completion:)];
 
   _cacheSupportsClearing = [cache respondsToSelector:@selector(clearFetchedImageFromCacheWithURL:)];
   
@@ -639,7 +642,17 @@ typedef void(^ASMultiplexImageLoadCompletionBlock)(NSImage *image, id imageIdent
 #endif
   
   // Otherwise, it's a web URL that we can download.
-  // First, check the cache.
+  // An image decoded for this URL and size, e.g. before the node was scrolled away, needs no cache or download.
+  const CGSize pixelSize = ASDecodedImagePixelSize(self.bounds.size, self.contentsScaleForDisplay);
+  if (!CGSizeEqualToSize(pixelSize, CGSizeZero)) {
+    if (NSImage *decodedImage = [ASDecodedImageCache.sharedCache imageForURL:nextImageURL pixelSize:pixelSize]) {
+      as_log_verbose(ASImageLoadingLog(), "Acquired decoded image for %@ id: %@ img: %@", self, nextImageIdentifier, decodedImage);
+      finishedLoadingBlock(decodedImage, nextImageIdentifier, nil);
+      return;
+    }
+  }
+
+  // Then, check the cache.
   [self _fetchImageWithIdentifierFromCache:nextImageIdentifier URL:nextImageURL completion:^(NSImage *imageFromCache) {
     __typeof__(self) strongSelf = weakSelf;
     if (!strongSelf)
@@ -852,7 +865,18 @@ typedef void(^ASMultiplexImageLoadCompletionBlock)(NSImage *image, id imageIdent
     dispatch_queue_t callbackQueue = dispatch_get_main_queue();
 
     id downloadIdentifier;
-    if (strongSelf->_downloaderFlags.downloaderImplementsDownloadWithPriority) {
+    if (strongSelf->_downloaderFlags.downloaderImplementsDownloadWithPixelSize) {
+      // Let the downloader decode no more pixels than we display.
+      ASImageDownloaderPriority priority = ASImageDownloaderPriorityWithInterfaceState(strongSelf.interfaceState);
+      CGSize pixelSize = ASDecodedImagePixelSize(strongSelf.bounds.size, strongSelf.contentsScaleForDisplay);
+      downloadIdentifier = [strongSelf->_downloader downloadImageWithURL:imageURL
+                                                               pixelSize:pixelSize
+                                                             shouldRetry:[self shouldRetryImageDownload]
+                                                                priority:priority
+                                                           callbackQueue:callbackQueue
+                                                        downloadProgress:downloadProgressBlock
+                                                              completion:completion];
+    } else if (strongSelf->_downloaderFlags.downloaderImplementsDownloadWithPriority) {
       /*
         Decide a priority based on the current interface state of this node.
         It can happen that this method was called when the node entered preload state
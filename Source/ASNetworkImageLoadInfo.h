@@ -19,6 +19,12 @@ typedef NS_ENUM(NSInteger, ASNetworkImageSourceType) {
   ASNetworkImageSourceDownload,
 };
 
+/**
+ * A downloader that decodes images may put the time it took, in seconds, as an NSNumber under this key of the
+ * userInfo dictionary it passes to its completion. ASBasicImageDownloader does.
+ */
+ASDK_EXTERN NSString *const ASNetworkImageLoadInfoDecodeDurationKey;
+
 AS_SUBCLASSING_RESTRICTED
 @interface ASNetworkImageLoadInfo : NSObject <NSCopying>
 
@@ -34,6 +40,12 @@ AS_SUBCLASSING_RESTRICTED
 /// The userInfo object provided by the downloader, if one was provided.
 @property (nullable, readonly) id userInfo;
 
+/**
+ * The time spent decoding the image before it was delivered, in seconds, or 0 if it was not decoded up front.
+ * Read from the @c ASNetworkImageLoadInfoDecodeDurationKey entry of userInfo.
+ */
+@property (readonly) NSTimeInterval decodeDuration;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -8,6 +8,8 @@
 
 #import "ASNetworkImageLoadInfo.h"
 
+NSString *const ASNetworkImageLoadInfoDecodeDurationKey = @"ASNetworkImageLoadInfoDecodeDuration";
+
 @implementation ASNetworkImageLoadInfo
 
 - (instancetype)initWithURL:(NSURL *)url sourceType:(ASNetworkImageSourceType)sourceType downloadIdentifier:(id)downloadIdentifier userInfo:(id)userInfo
@@ -17,6 +19,9 @@
     _sourceType = sourceType;
     _downloadIdentifier = downloadIdentifier;
     _userInfo = userInfo;
+    if ([userInfo isKindOfClass:[NSDictionary class]]) {
+      _decodeDuration = [userInfo[ASNetworkImageLoadInfoDecodeDurationKey] doubleValue];
+    }
   }
   return self;
 }
@@ -10,6 +10,7 @@
 #import "ASNetworkImageNode.h"
 
 #import "ASBasicImageDownloader.h"
+#import "ASDecodedImageCache.h"
 #import "ASDisplayNodeExtras.h"
 #import "ASDisplayNodeInternal.h"
 #import "ASDisplayNode+Subclasses.h"
@@ -24,6 +25,9 @@
 #import "ASPINRemoteImageDownloader.h"
 #endif
 
+/// How long the pixel size must stay the same, e.g. at the end of a live resize, before the image is loaded again.
+static const NSTimeInterval kASNetworkImageNodePixelSizeReloadDelay = 0.3;
+
 @interface ASNetworkImageNode ()
 {
   // Only access any of these while locked.
@@ -34,6 +38,12 @@
 
   NSInteger _cacheSentinel;
   id _downloadIdentifier;
+  // The pixel size the loaded image was decoded for, or CGSizeZero if it is full size.
+  CGSize _loadedPixelSize;
+
+  // Main thread only. When the pending check for a grown pixel size runs, and whether one is scheduled.
+  CFTimeInterval _pixelSizeReloadTime;
+  BOOL _pixelSizeReloadScheduled;
   // The download identifier that we have set a progress block on, if any.
   id _downloadIdentifierForProgressBlock;
 
@@ -65,6 +75,7 @@
       unsigned int downloaderImplementsAnimatedImage:1;
       unsigned int downloaderImplementsCancelWithResume:1;
       unsigned int downloaderImplementsDownloadWithPriority:1;
+      unsigned int downloaderImplementsDownloadWithPixelSize:1;
 
       unsigned int cacheSupportsClearing:1;
       unsigned int cacheSupportsSynchronousFetch:1;
@@ -97,6 +108,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
   _networkImageNodeFlags.downloaderImplementsAnimatedImage = [downloader respondsToSelector:@selector(animatedImageWithData:)];
   _networkImageNodeFlags.downloaderImplementsCancelWithResume = [downloader respondsToSelector:@selector(cancelImageDownloadWithResumePossibilityForIdentifier:)];
   _networkImageNodeFlags.downloaderImplementsDownloadWithPriority = [downloader respondsToSelector:@selector(downloadImageWithURL:shouldRetry:priority:callbackQueue:downloadProgress:completion:)];
+  _networkImageNodeFlags.downloaderImplementsDownloadWithPixelSize = [downloader respondsToSelector:@selector(downloadImageWithURL:pixelSize:shouldRetry:priority:callbackQueue:downloadProgress:completion:)];
 
   _networkImageNodeFlags.cacheSupportsClearing = [cache respondsToSelector:@selector(clearFetchedImageFromCacheWithURL:)];
   _networkImageNodeFlags.cacheSupportsSynchronousFetch = [cache respondsToSelector:@selector(synchronouslyFetchedCachedImageWithURL:)];
@@ -209,6 +221,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
     [self _setDownloadProgress:0.0];
     
     _networkImageNodeFlags.imageLoaded = NO;
+    _loadedPixelSize = CGSizeZero;
     
     _URL = URL;
     
@@ -580,6 +593,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
   [self _locked__setImage:_defaultImage];
 
   _networkImageNodeFlags.imageLoaded = NO;
+  _loadedPixelSize = CGSizeZero;
 
   if (_networkImageNodeFlags.cacheSupportsClearing) {
     if (_URL != nil) {
@@ -623,6 +637,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
     id downloadIdentifier;
     BOOL cancelAndReattempt = NO;
     ASInterfaceState interfaceState;
+    CGSize pixelSize;
 
     // Below, to avoid performance issues, we're calling downloadImageWithURL without holding the lock. This is a bit ugly because
     // We need to reobtain the lock after and ensure that the task we've kicked off still matches our URL. If not, we need to cancel
@@ -631,6 +646,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
       ASLockScopeSelf();
       url = self->_URL;
       interfaceState = self->_interfaceState;
+      pixelSize = ASDecodedImagePixelSize(self.bounds.size, self.contentsScaleForDisplay);
     }
 
     dispatch_queue_t callbackQueue = [self callbackQueue];
@@ -647,7 +663,18 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
       }
     };
 
-    if (self->_networkImageNodeFlags.downloaderImplementsDownloadWithPriority) {
+    if (self->_networkImageNodeFlags.downloaderImplementsDownloadWithPixelSize) {
+      // Let the downloader decode no more pixels than we display.
+      ASImageDownloaderPriority priority = ASImageDownloaderPriorityWithInterfaceState(interfaceState);
+
+      downloadIdentifier = [self->_downloader downloadImageWithURL:url
+                                                         pixelSize:pixelSize
+                                                       shouldRetry:[self shouldRetryImageDownload]
+                                                          priority:priority
+                                                     callbackQueue:callbackQueue
+                                                  downloadProgress:downloadProgress
+                                                        completion:completion];
+    } else if (self->_networkImageNodeFlags.downloaderImplementsDownloadWithPriority) {
       /*
         Decide a priority based on the current interface state of this node.
         It can happen that this method was called when the node entered preload state
@@ -719,6 +746,7 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
     BOOL isImageLoaded = _networkImageNodeFlags.imageLoaded;
     __block NSURL *URL = _URL;
     id currentDownloadIdentifier = _downloadIdentifier;
+    const CGSize pixelSize = ASDecodedImagePixelSize(self.bounds.size, self.contentsScaleForDisplay);
   [self unlock];
   
   if (!isImageLoaded && URL != nil && currentDownloadIdentifier == nil) {
@@ -796,6 +824,14 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
           }
           
           as_log_verbose(ASImageLoadingLog(), "Downloaded image for %@ img: %@ url: %@", self, [imageContainer asdk_image], URL);
+
+          // Keep only as many pixels as we display, and share them with other nodes showing this URL at this size.
+          NSImage *decodedImage = nil;
+          if (!CGSizeEqualToSize(pixelSize, CGSizeZero) && [imageContainer asdk_animatedImageData] == nil) {
+            if (NSImage *image = [imageContainer asdk_image]) {
+              decodedImage = [ASDecodedImageCache.sharedCache imageForURL:URL pixelSize:pixelSize downsamplingImage:image];
+            }
+          }
           
           // Grab the lock for the rest of the block
           ASLockScope(strongSelf);
@@ -821,8 +857,11 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
               id animatedImage = [strongSelf->_downloader animatedImageWithData:animatedImageData];
               [strongSelf _locked_setAnimatedImage:animatedImage];
             } else {
-              newImage = [imageContainer asdk_image];
+              newImage = decodedImage ?: [imageContainer asdk_image];
               [strongSelf _locked__setImage:newImage];
+              // An image smaller than the pixel size holds all of its source, and there is nothing more to load.
+              const BOOL isFullSize = (decodedImage == nil || ASDecodedImageIsFullSize(decodedImage, pixelSize));
+              strongSelf->_loadedPixelSize = (isFullSize ? CGSizeZero : pixelSize);
             }
             strongSelf->_networkImageNodeFlags.imageLoaded = YES;
           }
@@ -863,9 +902,18 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
         });
       };
 
+      // An image decoded for this URL and size, e.g. before the node was scrolled away, needs no cache or download.
+      NSImage *decodedImage = nil;
+      if (!CGSizeEqualToSize(pixelSize, CGSizeZero)) {
+        decodedImage = [ASDecodedImageCache.sharedCache imageForURL:URL pixelSize:pixelSize];
+      }
+
       // As the _cache and _downloader is only set once in the intializer we don't have to use a
       // lock in here
-      if (_cache != nil) {
+      if (decodedImage != nil) {
+        as_log_verbose(ASImageLoadingLog(), "Found decoded image for %@ img: %@ url: %@", self, decodedImage, URL);
+        finished(decodedImage, nil, nil, ASNetworkImageSourceAsynchronousCache, nil);
+      } else if (_cache != nil) {
         NSInteger cacheSentinel = ASLockedSelf(++_cacheSentinel);
 
         as_log_verbose(ASImageLoadingLog(), "Decaching image for %@ url: %@", self, URL);
@@ -913,8 +961,93 @@ static std::atomic_bool _useMainThreadDelegateCallbacks(true);
   }
 }
 
+/**
+ * Whether the node has grown, or moved to a screen with a higher backing scale, past the pixel bucket the loaded image
+ * was decoded for. Never for images loaded at full size, which have no more pixels to give.
+ */
+- (BOOL)_locked_pixelSizeGrew
+{
+  DISABLED_ASAssertLocked(__instanceLock__);
+  if (!_networkImageNodeFlags.imageLoaded || CGSizeEqualToSize(_loadedPixelSize, CGSizeZero)
+      || !ASInterfaceStateIncludesPreload(_interfaceState)) {
+    return NO;
+  }
+  const CGSize pixelSize = ASDecodedImagePixelSize(self.bounds.size, self.contentsScaleForDisplay);
+  return pixelSize.width > _loadedPixelSize.width || pixelSize.height > _loadedPixelSize.height;
+}
+
+/**
+ * Images are decoded for the pixel size the node has when loading starts. Once the node has grown past it and kept
+ * its size for kASNetworkImageNodePixelSizeReloadDelay, loads the image again at the new size. The current image
+ * stays until then.
+ */
+- (void)_setNeedsReloadIfPixelSizeGrew
+{
+  ASDisplayNodeAssertMainThread();
+  if (!ASLockedSelf([self _locked_pixelSizeGrew])) {
+    return;
+  }
+
+  // Each call pushes the reload back, and the one scheduled block waits out the delay.
+  _pixelSizeReloadTime = CACurrentMediaTime() + kASNetworkImageNodePixelSizeReloadDelay;
+  if (_pixelSizeReloadScheduled) {
+    return;
+  }
+  _pixelSizeReloadScheduled = YES;
+  [self _schedulePixelSizeReloadAfter:kASNetworkImageNodePixelSizeReloadDelay];
+}
+
+- (void)_schedulePixelSizeReloadAfter:(NSTimeInterval)delay
+{
+  __weak __typeof__(self) weakSelf = self;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+    __typeof__(self) strongSelf = weakSelf;
+    if (strongSelf == nil) {
+      return;
+    }
+    const NSTimeInterval remaining = strongSelf->_pixelSizeReloadTime - CACurrentMediaTime();
+    if (remaining > 0) {
+      [strongSelf _schedulePixelSizeReloadAfter:remaining];
+      return;
+    }
+    strongSelf->_pixelSizeReloadScheduled = NO;
+    [strongSelf _reloadImageIfPixelSizeGrew];
+  });
+}
+
+- (void)_reloadImageIfPixelSizeGrew
+{
+  ASDisplayNodeAssertMainThread();
+
+  {
+    ASLockScopeSelf();
+    if (![self _locked_pixelSizeGrew]) {
+      return;
+    }
+    as_log_verbose(ASImageLoadingLog(), "Reloading image for %@ at %@ pixels, was %@ url: %@", self, NSStringFromSize(ASDecodedImagePixelSize(self.bounds.size, self.contentsScaleForDisplay)), NSStringFromSize(_loadedPixelSize), _URL);
+    _networkImageNodeFlags.imageLoaded = NO;
+    _loadedPixelSize = CGSizeZero;
+  }
+
+  [self _lazilyLoadImageIfNecessary];
+}
+
 #pragma mark - ASDisplayNode+Subclasses
 
+- (void)layout
+{
+  [super layout];
+  [self _setNeedsReloadIfPixelSizeGrew];
+}
+
+- (void)setContentsScaleForDisplay:(CGFloat)contentsScaleForDisplay
+{
+  [super setContentsScaleForDisplay:contentsScaleForDisplay];
+  ASPerformBlockOnMainThread(^{
+    [self _setNeedsReloadIfPixelSizeGrew];
+  });
+}
+
 - (void)displayDidFinish
 {
   [super displayDidFinish];
@@ -40,6 +40,13 @@ AS_SUBCLASSING_RESTRICTED
 
 - (void)enqueue:(ObjectType)object;
 
+/**
+ * Enqueues the object @c objectPtr points to, taking over the caller's reference and setting @c *objectPtr to nil.
+ * There is no retain, release or lock, so the queue always releases the object last. Only for queues that retain their
+ * objects. Exclusive membership is not checked: an object enqueued this way twice is processed twice.
+ */
+- (void)enqueueTransferringObject:(id _Nullable __strong * _Nonnull)objectPtr;
+
 @property (readonly) BOOL isEmpty;
 
 @property (nonatomic) NSUInteger batchSize;           // Default == 1.
@@ -11,8 +11,11 @@
 #import "ASConfigurationInternal.h"
 #import "ASLog.h"
 #import "ASRunLoopQueue.h"
+#import "ASSegmentedQueue.h"
 #import "ASThread.h"
 #import "ASSignpost.h"
+#import <atomic>
+#import <utility>
 #import <vector>
 
 #define ASRunLoopQueueLoggingEnabled 0
@@ -43,11 +46,58 @@ static void runLoopSourceCallback(void *info) {
 
 #pragma mark - ASRunLoopQueue
 
+namespace AS {
+
+/**
+ * Queued object storage that is __strong or __weak depending on the queue, like the NSPointerArray it replaces.
+ * isMember records whether the object was added to the membership set, so the consumer knows to remove it again.
+ */
+struct RunLoopQueueEntry {
+  __strong id strongObject;
+  __weak id weakObject;
+  bool isMember;
+
+  void store(id object, bool retainsObject, bool member)
+  {
+    if (retainsObject) {
+      strongObject = object;
+    } else {
+      weakObject = object;
+    }
+    isMember = member;
+  }
+
+  /// Returns nil if the object was weak and has been deallocated.
+  id object() const
+  {
+    return strongObject ?: weakObject;
+  }
+};
+
+} // namespace AS
+
+// Membership for exclusive queues is split into shards by pointer so that producers rarely contend.
+static constexpr NSUInteger kASRunLoopQueueMembershipShardCount = 16;
+
 @interface ASRunLoopQueue () {
   CFRunLoopRef _runLoop;
   CFRunLoopSourceRef _runLoopSource;
   CFRunLoopObserverRef _runLoopObserver;
-  NSPointerArray *_internalQueue; // Use NSPointerArray so we can decide __strong or __weak per-instance.
+  BOOL _retainsObjects;
+
+  // Objects are enqueued without locking, into a queue that grows a segment at a time.
+  AS::SegmentedQueue<AS::RunLoopQueueEntry> _queue;
+  // Number of enqueued objects that haven't been dequeued yet, including weak ones that have since been deallocated.
+  // Counted before they are pushed, so it is never lower than the number of objects in the queue.
+  std::atomic<NSUInteger> _count;
+
+  // Objects currently in the queue, used when ensuring exclusive membership. Object pointer personality; weak for
+  // queues that don't retain their objects so that deallocated objects drop out.
+  NSHashTable *_members[kASRunLoopQueueMembershipShardCount];
+  AS::Mutex _memberLocks[kASRunLoopQueueMembershipShardCount];
+
+  // Taken by the consumer while dequeuing. Also exposed through ASLocking so that a producer can keep the queue from
+  // releasing an object while it still holds its own reference.
   AS::RecursiveMutex _internalQueueLock;
 
   // In order to not pollute the top-level activities, each queue has 1 root activity.
@@ -68,8 +118,13 @@ static void runLoopSourceCallback(void *info) {
 {
   if (self = [super init]) {
     _runLoop = runloop;
-    NSPointerFunctionsOptions options = retainsObjects ? NSPointerFunctionsStrongMemory : NSPointerFunctionsWeakMemory;
-    _internalQueue = [[NSPointerArray alloc] initWithOptions:options];
+    _retainsObjects = retainsObjects;
+    // The queue itself holds strong queues' objects, so their membership doesn't need to retain them again.
+    NSPointerFunctionsOptions memberOptions = (retainsObjects ? NSPointerFunctionsOpaqueMemory : NSPointerFunctionsWeakMemory) | NSPointerFunctionsObjectPointerPersonality;
+    for (NSUInteger i = 0; i < kASRunLoopQueueMembershipShardCount; i++) {
+      _members[i] = [[NSHashTable alloc] initWithOptions:memberOptions capacity:0];
+    }
+    _count = 0;
     _queueConsumer = handlerBlock;
     _batchSize = 1;
     _ensureExclusiveMembership = YES;
@@ -128,68 +183,57 @@ static void runLoopSourceCallback(void *info) {
 #if ASRunLoopQueueLoggingEnabled
 - (void)checkRunLoop
 {
-    NSLog(@"<%@> - Jobs: %ld", self, _internalQueue.count);
+    NSLog(@"<%@> - Jobs: %ld", self, (long)_count.load());
 }
 #endif
 
 - (void)processQueue
 {
+  // Early-exit if the queue is empty.
+  if (_count.load() == 0) {
+    return;
+  }
+
   BOOL hasExecutionBlock = (_queueConsumer != nil);
 
   // If we have an execution block, this vector will be populated, otherwise remains empty.
   // This is to avoid needlessly retaining/releasing the objects if we don't have a block.
   std::vector<id> itemsToProcess;
 
+  ASSignpostStart(RunLoopQueueBatch, self, "%s", object_getClassName(self));
+
   BOOL isQueueDrained = NO;
   {
     MutexLocker l(_internalQueueLock);
 
-    NSInteger internalQueueCount = _internalQueue.count;
-    // Early-exit if the queue is empty.
-    if (internalQueueCount == 0) {
-      return;
-    }
-
-    ASSignpostStart(RunLoopQueueBatch, self, "%s", object_getClassName(self));
-
-    // Snatch the next batch of items.
-    NSInteger maxCountToProcess = MIN(internalQueueCount, self.batchSize);
-
-    /**
-     * For each item in the next batch, if it's non-nil then NULL it out
-     * and if we have an execution block then add it in.
-     * This could be written a bunch of different ways but
-     * this particular one nicely balances readability, safety, and efficiency.
-     */
+    // Snatch the next batch of items. Objects that have been deallocated while queued don't count towards the batch.
+    const NSInteger maxCountToProcess = self.batchSize;
     NSInteger foundItemCount = 0;
-    for (NSInteger i = 0; i < internalQueueCount && foundItemCount < maxCountToProcess; i++) {
-      /**
-       * It is safe to use unsafe_unretained here. If the queue is weak, the
-       * object will be added to the autorelease pool. If the queue is strong,
-       * it will retain the object until we transfer it (retain it) in itemsToProcess.
-       */
-      unowned id ptr = (__bridge id)[_internalQueue pointerAtIndex:i];
-      if (ptr != nil) {
-        foundItemCount++;
-        if (hasExecutionBlock) {
-          itemsToProcess.push_back(ptr);
-        }
-        [_internalQueue replacePointerAtIndex:i withPointer:NULL];
+    while (foundItemCount < maxCountToProcess) {
+      AS::RunLoopQueueEntry *entry = _queue.front();
+      if (entry == nullptr) {
+        break;
+      }
+      // The queue holds the last strong reference to the object if it retains it, so it is released right here, on
+      // the run loop thread, unless we hand it to the execution block.
+      id object = entry->object();
+      // Leave the membership set before leaving the queue. An object enqueued again in between is then queued twice
+      // rather than dropped while its earlier entry is on its way out.
+      if (object != nil && entry->isMember) {
+        [self _removeMember:object];
+      }
+      _queue.pop();
+      _count.fetch_sub(1);
+      if (object == nil) {
+        continue;
+      }
+      foundItemCount++;
+      if (hasExecutionBlock) {
+        itemsToProcess.push_back(object);
       }
     }
 
-    if (foundItemCount == 0) {
-      // If _internalQueue holds weak references, and all of them just become NULL, then the array
-      // is never marked as needsCompletion, and compact will return early, not removing the NULL's.
-      // Inserting a NULL here ensures the compaction will take place.
-      // See http://www.openradar.me/15396578 and https://stackoverflow.com/a/40274426/1136669
-      [_internalQueue addPointer:NULL];
-    }
-
-    [_internalQueue compact];
-    if (_internalQueue.count == 0) {
-      isQueueDrained = YES;
-    }
+    isQueueDrained = (_count.load() == 0);
   }
 
   // itemsToProcess will be empty if _queueConsumer == nil so no need to check again.
@@ -216,39 +260,69 @@ static void runLoopSourceCallback(void *info) {
   ASSignpostEnd(RunLoopQueueBatch, self, "count: %d", (int)count);
 }
 
+/// Returns NO if the object was already a member.
+- (BOOL)_addMember:(id)object
+{
+  const NSUInteger shard = ((uintptr_t)(__bridge void *)object >> 4) % kASRunLoopQueueMembershipShardCount;
+  MutexLocker l(_memberLocks[shard]);
+  if ([_members[shard] containsObject:object]) {
+    return NO;
+  }
+  [_members[shard] addObject:object];
+  return YES;
+}
+
+- (void)_removeMember:(id)object
+{
+  const NSUInteger shard = ((uintptr_t)(__bridge void *)object >> 4) % kASRunLoopQueueMembershipShardCount;
+  MutexLocker l(_memberLocks[shard]);
+  [_members[shard] removeObject:object];
+}
+
 - (void)enqueue:(id)object
 {
   if (!object) {
     return;
   }
   
-  MutexLocker l(_internalQueueLock);
+  const bool member = _ensureExclusiveMembership;
+  if (member && ![self _addMember:object]) {
+    return;
+  }
 
-  // Check if the object exists.
-  BOOL foundObject = NO;
-    
-  if (_ensureExclusiveMembership) {
-    for (id currentObject in _internalQueue) {
-      if (currentObject == object) {
-        foundObject = YES;
-        break;
-      }
-    }
+  const BOOL wasEmpty = (_count.fetch_add(1) == 0);
+  AS::RunLoopQueueEntry entry;
+  entry.store(object, _retainsObjects, member);
+  _queue.push(std::move(entry));
+
+  if (wasEmpty) {
+    CFRunLoopSourceSignal(_runLoopSource);
+    CFRunLoopWakeUp(_runLoop);
   }
+}
 
-  if (!foundObject) {
-    [_internalQueue addPointer:(__bridge void *)object];
-    if (_internalQueue.count == 1) {
-      CFRunLoopSourceSignal(_runLoopSource);
-      CFRunLoopWakeUp(_runLoop);
-    }
+- (void)enqueueTransferringObject:(id __strong *)objectPtr
+{
+  ASDisplayNodeAssert(_retainsObjects, @"Only queues that retain their objects can take over a reference: %@", self);
+  if (*objectPtr == nil) {
+    return;
+  }
+
+  const BOOL wasEmpty = (_count.fetch_add(1) == 0);
+  AS::RunLoopQueueEntry entry;
+  entry.strongObject = std::move(*objectPtr); // Moves the +1 and leaves *objectPtr nil.
+  entry.isMember = false;
+  _queue.push(std::move(entry));
+
+  if (wasEmpty) {
+    CFRunLoopSourceSignal(_runLoopSource);
+    CFRunLoopWakeUp(_runLoop);
   }
 }
 
 - (BOOL)isEmpty
 {
-  MutexLocker l(_internalQueueLock);
-  return _internalQueue.count == 0;
+  return _count.load() == 0;
 }
 
 ASSynthesizeLockingMethodsWithMutex(_internalQueueLock)
@@ -647,14 +647,14 @@ ASLayoutElementCollectionTableSetTraitCollection(_environmentStateLock)
 {
   ASDisplayNodeAssertMainThread();
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap numberOfItemsInSection:section];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates numberOfItemsInSection:section];
 }
 
 - (NSInteger)numberOfSections
 {
   ASDisplayNodeAssertMainThread();
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap numberOfSections];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates numberOfSections];
 }
 
 - (NSArray<__kindof ASCellNode *> *)visibleNodes
@@ -665,13 +665,13 @@ ASLayoutElementCollectionTableSetTraitCollection(_environmentStateLock)
 
 - (NSIndexPath *)indexPathForNode:(ASCellNode *)cellNode
 {
-  return [self.dataController.pendingMap indexPathForElement:cellNode.collectionElement];
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates indexPathForElement:cellNode.collectionElement];
 }
 
 - (ASCellNode *)nodeForRowAtIndexPath:(NSIndexPath *)indexPath
 {
   [self reloadDataInitiallyIfNeeded];
-  return [self.dataController.pendingMap elementForItemAtIndexPath:indexPath].node;
+  return [self.dataController.pendingMapSubmittingCoalescedUpdates elementForItemAtIndexPath:indexPath].node;
 }
 
 - (CGRect)rectForRowAtIndexPath:(NSIndexPath *)indexPath
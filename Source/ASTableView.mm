@@ -622,15 +622,8 @@ static NSString * const kCellReuseIdentifier = @"_ASTableViewCell";
     return nil;
   }
 
-  NSMutableArray<NSIndexPath *> *indexPathsArray = [NSMutableArray new];
-
-  for (NSIndexPath *indexPathInView in indexPaths) {
-    NSIndexPath *indexPath = [self convertIndexPathToTableNode:indexPathInView];
-    if (indexPath != nil) {
-      [indexPathsArray addObject:indexPath];
-    }
-  }
-  return indexPathsArray;
+  NSArray<NSIndexPath *> *validIndexPaths = ASArrayByFlatMapping(indexPaths, NSIndexPath *indexPathInView, [self validateIndexPath:indexPathInView]);
+  return [_dataController.pendingMap convertIndexPaths:validIndexPaths fromMap:_dataController.visibleMap];
 }
 
 - (NSIndexPath *)indexPathForNode:(ASCellNode *)cellNode
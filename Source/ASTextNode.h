@@ -22,6 +22,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * Occupancy and counters of the renderer cache shared by all text nodes.
+ */
+typedef struct {
+  uint64_t hitCount;
+  uint64_t missCount;
+  uint64_t evictionCount;
+  NSUInteger entryCount;
+  /// The estimated memory held by the cached renderers, in bytes.
+  NSUInteger cost;
+  NSUInteger costLimit;
+} ASTextNodeRendererCacheMetrics;
+
 /**
  @abstract Draws interactive rich text.
  @discussion Backed by TextKit.
@@ -230,6 +243,18 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) BOOL textColorFollowsTintColor;
 
+/**
+ @abstract Sets the estimated memory, in bytes, that the renderer cache shared by all text nodes may hold.
+ @discussion Defaults to 4 MB. Least recently used renderers are evicted to stay under the limit. The cache is split
+ into 16 shards, each with an even share of the limit, and renderers for text too long to fit a share are not cached.
+ */
++ (void)setRendererCacheCostLimit:(NSUInteger)costLimit;
+
+/**
+ @abstract Returns the current occupancy and counters of the renderer cache shared by all text nodes.
+ */
++ (ASTextNodeRendererCacheMetrics)rendererCacheMetrics;
+
 @end
 
 @interface ASTextNode (Unavailable)
@@ -25,7 +25,10 @@
 #import "ASDisplayNodeInternal.h"
 #import "ASGraphicsContext.h"
 #import "ASHighlightOverlayLayer.h"
+#import "ASLRUCache.h"
+#import "ASMemoryPressure.h"
 
+#import "ASTextKitContext.h"
 #import "ASTextKitCoreTextAdditions.h"
 #import "ASTextKitRenderer+Positioning.h"
 #import "ASTextKitShadower.h"
@@ -50,101 +53,123 @@ static NSString *ASTextNodeTruncationTokenAttributeName = @"ASTextNodeTruncation
 
 #pragma mark - ASTextKitRenderer
 
-@interface ASTextNodeRendererKey : NSObject
-- (instancetype)initWithTextKitAttributes:(const ASTextKitAttributes &)attributes constrainedSize:(const CGSize)constrainedSize;
-@end
+namespace AS {
 
-@implementation ASTextNodeRendererKey {
-  ASTextKitAttributes _attributes;
-  CGSize _constrainedSize;
-}
+/**
+ * The renderer cache shared by all text nodes, bounded by the estimated memory of its renderers.
+ *
+ * Keys carry the hash of their attributes, which text nodes compute once per set of attributes, so lookups do not
+ * message the attributes' objects. A renderer that would take more than a shard's share of the cost limit is
+ * returned without being cached.
+ */
+class TextRendererCache {
+public:
+  static TextRendererCache &shared()
+  {
+    static TextRendererCache *cache = new TextRendererCache();
+    return *cache;
+  }
 
-- (instancetype)initWithTextKitAttributes:(const ASTextKitAttributes &)attributes constrainedSize:(const CGSize)constrainedSize
-{
-  if (self = [super init]) {
-    _attributes = attributes;
-    _constrainedSize = constrainedSize;
+  TextRendererCache() : _cache(4 * 1024 * 1024)
+  {
+    // NSCache used to drop its contents under memory pressure; keep doing that.
+    ASAddMemoryPressureHandler(^{
+      TextRendererCache::shared().removeAll();
+    });
   }
-  return self;
-}
 
-- (NSUInteger)hash
-{
-#pragma clang diagnostic push
-#pragma clang diagnostic warning "-Wpadded"
-  struct {
-    size_t attributesHash;
+  ASTextKitRenderer *renderer(const ASTextKitAttributes &attributes, size_t attributesHash, CGSize constrainedSize)
+  {
+    const Key key(attributes, attributesHash, constrainedSize);
+    ASTextKitRenderer *renderer = nil;
+    if (_cache.find(key, renderer)) {
+      return renderer;
+    }
+    renderer = [[ASTextKitRenderer alloc] initWithTextKitAttributes:attributes constrainedSize:constrainedSize];
+    // If another thread got here first, share its renderer.
+    return _cache.insert(key, renderer, Cost(renderer));
+  }
+
+  void setCostLimit(size_t costLimit)
+  {
+    _cache.setCostLimit(costLimit);
+  }
+
+  void removeAll()
+  {
+    _cache.removeAll();
+  }
+
+  ASTextNodeRendererCacheMetrics metrics()
+  {
+    const auto metrics = _cache.metrics();
+    return {
+      .hitCount = metrics.hitCount,
+      .missCount = metrics.missCount,
+      .evictionCount = metrics.evictionCount,
+      .entryCount = metrics.entryCount,
+      .cost = metrics.cost,
+      .costLimit = metrics.costLimit,
+    };
+  }
+
+private:
+  struct Key {
+    ASTextKitAttributes attributes;
     CGSize constrainedSize;
-#pragma clang diagnostic pop
-  } data = {
-    _attributes.hash(),
-    _constrainedSize
+    size_t hash;
+
+    Key(const ASTextKitAttributes &attributes, size_t attributesHash, CGSize constrainedSize)
+      : attributes(attributes), constrainedSize(constrainedSize)
+    {
+      ASHashState state = ASHashStateMake(attributesHash);
+      ASHashCombineSize(&state, constrainedSize);
+      hash = ASHashStateFinish(state);
+    }
+
+    bool operator==(const Key &other) const
+    {
+      return hash == other.hash
+          && CGSizeEqualToSize(constrainedSize, other.constrainedSize)
+          && attributes == other.attributes;
+    }
+
+    struct Hash {
+      size_t operator()(const Key &key) const { return key.hash; }
+    };
   };
-  return ASHashBytes(&data, sizeof(data));
-}
 
-- (BOOL)isEqual:(ASTextNodeRendererKey *)object
-{
-  if (self == object) {
-    return YES;
-  }
-  if (!object) {
-    return NO;
+  /**
+   * Estimated bytes held by a renderer, which lays out its text when it is created: its TextKit components, the
+   * characters of its text storage after truncation, and each glyph laid out with its properties, character index and
+   * location. Renderers measured with string drawing lay out no glyphs.
+   */
+  static size_t Cost(ASTextKitRenderer *renderer)
+  {
+    __block size_t cost = 2048;
+    [renderer.context performBlockWithLockedTextKitComponents:^(NSLayoutManager *layoutManager, NSTextStorage *textStorage, NSTextContainer *textContainer) {
+      cost += textStorage.length * sizeof(unichar) + layoutManager.firstUnlaidGlyphIndex * 16;
+    }];
+    return cost;
   }
-  // NOTE: Skip the class check for this specialized, internal Key object.
-  
-  return _attributes == object->_attributes && CGSizeEqualToSize(_constrainedSize, object->_constrainedSize);
-}
 
-@end
+  LRUCache<Key, ASTextKitRenderer *, Key::Hash> _cache;
+};
 
-static NSCache *sharedRendererCache()
-{ 
- static dispatch_once_t onceToken;
- static NSCache *__rendererCache = nil;
- dispatch_once(&onceToken, ^{
-   __rendererCache = [[NSCache alloc] init];
-   __rendererCache.countLimit = 500; // 500 renders cache
- });
- return __rendererCache;
-}
+} // namespace AS
 
 /**
  The concept here is that neither the node nor layout should ever have a strong reference to the renderer object.
  This is to reduce memory load when loading thousands and thousands of text nodes into memory at once. Instead
  we maintain a LRU renderer cache that is queried via a unique key based on text kit attributes and constrained size. 
  */
-
-static ASTextKitRenderer *_rendererForAttributes(ASTextKitAttributes attributes, CGSize constrainedSize)
-{
-  NSCache *cache = sharedRendererCache();
-  
-  ASTextNodeRendererKey *key = [[ASTextNodeRendererKey alloc] initWithTextKitAttributes:attributes constrainedSize:constrainedSize];
-
-  ASTextKitRenderer *renderer = [cache objectForKey:key];
-  if (renderer == nil) {
-    renderer = [[ASTextKitRenderer alloc] initWithTextKitAttributes:attributes constrainedSize:constrainedSize];
-    [cache setObject:renderer forKey:key];
-  }
-  
-  return renderer;
-}
-
-static AS::RecursiveMutex __sharedRendererCacheInstanceLock__;
-
-static ASTextKitRenderer *rendererForAttributes(ASTextKitAttributes attributes, CGSize constrainedSize)
+static ASTextKitRenderer *rendererForAttributes(ASTextKitAttributes attributes, size_t attributesHash, CGSize constrainedSize)
 {
   BOOL neverCache = ASActivateExperimentalFeature(ASExperimentalNoTextRendererCache);
   if (neverCache) {
     return [[ASTextKitRenderer alloc] initWithTextKitAttributes:attributes constrainedSize:constrainedSize];
   }
-  
-  BOOL lockCache = ASActivateExperimentalFeature(ASExperimentalLockTextRendererCache);
-  if (lockCache) {
-    AS::MutexLocker l(__sharedRendererCacheInstanceLock__);
-    return _rendererForAttributes(attributes, constrainedSize);
-  }
-  return _rendererForAttributes(attributes, constrainedSize);
+  return AS::TextRendererCache::shared().renderer(attributes, attributesHash, constrainedSize);
 }
 
 #pragma mark - ASTextNodeDrawParameter
@@ -152,6 +177,7 @@ static ASTextKitRenderer *rendererForAttributes(ASTextKitAttributes attributes,
 @interface ASTextNodeDrawParameter : NSObject {
 @package
   ASTextKitAttributes _rendererAttributes;
+  size_t _rendererAttributesHash;
   NSColor *_backgroundColor;
   NSEdgeInsets _textContainerInsets;
   CGFloat _contentScale;
@@ -166,6 +192,7 @@ static ASTextKitRenderer *rendererForAttributes(ASTextKitAttributes attributes,
 @implementation ASTextNodeDrawParameter
 
 - (instancetype)initWithRendererAttributes:(ASTextKitAttributes)rendererAttributes
+                            attributesHash:(size_t)attributesHash
                            backgroundColor:(/*nullable*/ NSColor *)backgroundColor
                        textContainerInsets:(NSEdgeInsets)textContainerInsets
                               contentScale:(CGFloat)contentScale
@@ -178,6 +205,7 @@ willDisplayNodeContentWithRenderingContext:(ASDisplayNodeContextModifier)willDis
   self = [super init];
   if (self != nil) {
     _rendererAttributes = rendererAttributes;
+    _rendererAttributesHash = attributesHash;
     _backgroundColor = backgroundColor;
     _textContainerInsets = textContainerInsets;
     _contentScale = contentScale;
@@ -193,7 +221,7 @@ willDisplayNodeContentWithRenderingContext:(ASDisplayNodeContextModifier)willDis
 - (ASTextKitRenderer *)rendererForBounds:(CGRect)bounds
 {
   CGRect rect = NSEdgeInsetsInsetRect(bounds, _textContainerInsets);
-  return rendererForAttributes(_rendererAttributes, rect.size);
+  return rendererForAttributes(_rendererAttributes, _rendererAttributesHash, rect.size);
 }
 
 static inline CGRect NSEdgeInsetsInsetRect(CGRect rect, NSEdgeInsets insets) {
@@ -226,6 +254,11 @@ static inline CGRect NSEdgeInsetsInsetRect(CGRect rect, NSEdgeInsets insets) {
 
   NSArray *_exclusionPaths;
 
+  // The attributes last hashed for a renderer lookup, and their hash.
+  ASTextKitAttributes _hashedRendererAttributes;
+  size_t _rendererAttributesHash;
+  BOOL _rendererAttributesHashIsValid;
+
   NSAttributedString *_attributedText;
   NSAttributedString *_truncationAttributedText;
   NSAttributedString *_additionalTruncationMessage;
@@ -399,7 +432,8 @@ static NSArray *DefaultLinkAttributeNames() {
 {
   DISABLED_ASAssertLocked(__instanceLock__);
   bounds = NSEdgeInsetsInsetRect(bounds, _textContainerInset);
-  return rendererForAttributes([self _locked_rendererAttributes], bounds.size);
+  const ASTextKitAttributes attributes = [self _locked_rendererAttributes];
+  return rendererForAttributes(attributes, [self _locked_hashForRendererAttributes:attributes], bounds.size);
 }
 
 - (ASTextKitAttributes)_locked_rendererAttributes
@@ -421,6 +455,18 @@ static NSArray *DefaultLinkAttributeNames() {
   };
 }
 
+- (size_t)_locked_hashForRendererAttributes:(const ASTextKitAttributes &)attributes
+{
+  DISABLED_ASAssertLocked(__instanceLock__);
+  // The attributes are rebuilt for every renderer lookup, but their objects rarely change.
+  if (!_rendererAttributesHashIsValid || !attributes.isIdenticalTo(_hashedRendererAttributes)) {
+    _hashedRendererAttributes = attributes;
+    _rendererAttributesHash = attributes.hash();
+    _rendererAttributesHashIsValid = YES;
+  }
+  return _rendererAttributesHash;
+}
+
 - (NSString *)defaultAccessibilityLabel
 {
   ASLockScopeSelf();
@@ -593,7 +639,9 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
   } else {
     _cachedTintColor = nil;
   }
-  return [[ASTextNodeDrawParameter alloc] initWithRendererAttributes:[self _locked_rendererAttributes]
+  const ASTextKitAttributes rendererAttributes = [self _locked_rendererAttributes];
+  return [[ASTextNodeDrawParameter alloc] initWithRendererAttributes:rendererAttributes
+                                                      attributesHash:[self _locked_hashForRendererAttributes:rendererAttributes]
                                                      backgroundColor:self.backgroundColor
                                                  textContainerInsets:_textContainerInset
                                                         contentScale:_contentsScaleForDisplay
@@ -1529,6 +1577,16 @@ static NSAttributedString *DefaultTruncationAttributedString()
 }
 #endif
 
++ (void)setRendererCacheCostLimit:(NSUInteger)costLimit
+{
+  AS::TextRendererCache::shared().setCostLimit(costLimit);
+}
+
++ (ASTextNodeRendererCacheMetrics)rendererCacheMetrics
+{
+  return AS::TextRendererCache::shared().metrics();
+}
+
 // All direct descendants of ASTextNode get their superclass replaced by ASTextNode2.
 + (void)initialize
 {
@@ -14,6 +14,18 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * Counters for the text layout cache shared by all text nodes.
+ */
+typedef struct {
+  uint64_t hitCount;
+  uint64_t missCount;
+  uint64_t evictionCount;
+  NSUInteger entryCount;
+  /// An estimate of the memory held by the cached texts and layouts.
+  NSUInteger byteCount;
+} ASTextNodeLayoutCacheMetrics;
+
 /**
  @abstract Draws interactive rich text.
  @discussion Backed by the code in TextExperiment folder, on top of CoreText.
@@ -228,6 +240,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 + (void)enableDebugging;
 
+/**
+ @abstract Returns the current counters of the layout cache shared by all text nodes.
+ */
++ (ASTextNodeLayoutCacheMetrics)layoutCacheMetrics;
+
 #pragma mark - Layout and Sizing
 
 @property (nullable, nonatomic) id<ASTextLinePositionModifier> textContainerLinePositionModifier;
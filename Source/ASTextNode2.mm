@@ -10,7 +10,8 @@
 #import "ASTextNode.h"  // Definition of ASTextNodeDelegate
 
 #import <tgmath.h>
-#import <deque>
+#import <algorithm>
+#import <vector>
 
 #import "_ASDisplayLayer.h"
 #import "ASDisplayNode+FrameworkPrivate.h"
@@ -18,21 +19,15 @@
 #import "ASDisplayNodeExtras.h"
 #import "ASDisplayNodeInternal.h"
 #import "ASHighlightOverlayLayer.h"
+#import "ASLRUCache.h"
+#import "ASMemoryPressure.h"
 
 #import "ASTextKitRenderer+Positioning.h"
 #import "ASEqualityHelpers.h"
+#import "ASHashing.h"
 
 #import "ASTextLayout.h"
 
-@interface ASTextCacheValue : NSObject {
-  @package
-  AS::Mutex _m;
-  std::deque<std::tuple<CGSize, ASTextLayout *>> _layouts;
-}
-@end
-@implementation ASTextCacheValue
-@end
-
 /**
  * If set, we will record all values set to attributedText into an array
  * and once we get 2000, we'll write them all out into a plist file.
@@ -51,92 +46,251 @@ static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeIns
 }
 
 /**
- * If it can't find a compatible layout, this method creates one.
- *
- * NOTE: Be careful to copy `text` if needed.
+ * Whether a layout computed for @c constrainedSize in @c layout.container can be used for @c container.
  */
-static NS_RETURNS_RETAINED ASTextLayout *ASTextNodeCompatibleLayoutWithContainerAndText(ASTextContainer *container, NSAttributedString *text)  {
-  static dispatch_once_t onceToken;
-  static AS::Mutex *layoutCacheLock;
-  static NSCache<NSAttributedString *, ASTextCacheValue *> *textLayoutCache;
-  dispatch_once(&onceToken, ^{
-    layoutCacheLock = new AS::Mutex();
-    textLayoutCache = [[NSCache alloc] init];
-  });
+static BOOL ASTextLayoutIsCompatible(ASTextLayout *layout, CGSize constrainedSize, ASTextContainer *container)
+{
+  CGRect containerBounds = (CGRect){ .size = container.size };
+  CGSize layoutSize = layout.textBoundingSize;
+  // 1. CoreText can return frames that are narrower than the constrained width, for obvious reasons.
+  // 2. CoreText can return frames that are slightly wider than the constrained width, for some reason.
+  //    We have to trust that somehow it's OK to try and draw within our size constraint, despite the return value.
+  // 3. Thus, those two values (constrained width & returned width) form a range, where
+  //    intermediate values in that range will be snapped. Thus, we can use a given layout as long as our
+  //    width is in that range, between the min and max of those two values.
+  CGRect minRect = CGRectMake(0, 0, MIN(layoutSize.width, constrainedSize.width), MIN(layoutSize.height, constrainedSize.height));
+  if (!CGRectContainsRect(containerBounds, minRect)) {
+    return NO;
+  }
+  CGRect maxRect = CGRectMake(0, 0, MAX(layoutSize.width, constrainedSize.width), MAX(layoutSize.height, constrainedSize.height));
+  if (!CGRectContainsRect(maxRect, containerBounds)) {
+    return NO;
+  }
+  if (!CGSizeEqualToSize(container.size, constrainedSize)) {
+    return NO;
+  }
 
-  layoutCacheLock->lock();
+  // Now check container params.
+  ASTextContainer *otherContainer = layout.container;
+  return NSEdgeInsetsEqualToEdgeInsets(container.insets, otherContainer.insets)
+      && ASObjectIsEqual(container.exclusionPaths, otherContainer.exclusionPaths)
+      && container.maximumNumberOfRows == otherContainer.maximumNumberOfRows
+      && container.truncationType == otherContainer.truncationType
+      && ASObjectIsEqual(container.truncationToken, otherContainer.truncationToken);
+}
 
-  ASTextCacheValue *cacheValue = [textLayoutCache objectForKey:text];
-  if (cacheValue == nil) {
-    cacheValue = [[ASTextCacheValue alloc] init];
-    [textLayoutCache setObject:cacheValue forKey:[text copy]];
+/**
+ * A 64-bit fingerprint of the characters and attributes of @c text. One pass over the text; attribute dictionaries
+ * are hashed by their contents, since -[NSDictionary hash] is only the count. Nodes keep it with the text they lay
+ * out, so that it is computed once per text rather than once per layout.
+ */
+static uint64_t ASTextHash(NSAttributedString *text)
+{
+  NSString *string = text.string;
+  const NSUInteger length = string.length;
+  __block ASHashState state = ASHashStateMake(length);
+
+  unichar buffer[256];
+  for (NSUInteger location = 0; location < length; location += AS_ARRAY_SIZE(buffer)) {
+    const NSRange range = NSMakeRange(location, MIN(AS_ARRAY_SIZE(buffer), length - location));
+    [string getCharacters:buffer range:range];
+    ASHashCombine(&state, ASHashBytes64(buffer, range.length * sizeof(unichar), location));
   }
 
-  // Lock the cache item for the rest of the method. Only after acquiring can we release the NSCache.
-  AS::MutexLocker lock(cacheValue->_m);
-  layoutCacheLock->unlock();
+  [text enumerateAttributesInRange:NSMakeRange(0, length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey, id> *attributes, NSRange range, BOOL *stop) {
+    // Sum the attributes so the dictionary's enumeration order does not matter.
+    __block uint64_t attributesHash = 0;
+    [attributes enumerateKeysAndObjectsUsingBlock:^(NSAttributedStringKey key, id value, BOOL *stopAttributes) {
+      ASHashState attribute = ASHashStateMake(key.hash);
+      ASHashCombine(&attribute, [value hash]);
+      attributesHash += ASHashStateFinish(attribute);
+    }];
+    ASHashCombine(&state, range.location);
+    ASHashCombine(&state, attributesHash);
+  }];
+  return ASHashStateFinish(state);
+}
 
-  CGRect containerBounds = (CGRect){ .size = container.size };
+/**
+ * The layout cache key: @c textHash, from ASTextHash, combined with the container parameters that
+ * ASTextLayoutIsCompatible compares exactly.
+ */
+static uint64_t ASTextLayoutCacheKey(ASTextContainer *container, uint64_t textHash)
+{
+  ASHashState state = ASHashStateMake(textHash);
+  const NSEdgeInsets insets = container.insets;
+  ASHashCombineFloat(&state, insets.top);
+  ASHashCombineFloat(&state, insets.left);
+  ASHashCombineFloat(&state, insets.bottom);
+  ASHashCombineFloat(&state, insets.right);
+  ASHashCombine(&state, container.exclusionPaths.hash);
+  ASHashCombine(&state, container.maximumNumberOfRows);
+  ASHashCombine(&state, container.truncationType);
+  ASHashCombine(&state, container.truncationToken.hash);
+  return ASHashStateFinish(state);
+}
+
+namespace AS {
+
+/**
+ * The text layout cache shared by all text nodes.
+ *
+ * Entries are found by ASTextLayoutCacheKey, which is computed before any lock is taken, and confirmed by comparing
+ * the text: by identity first, then by hash, and only when the hashes match by contents. Each entry keeps its most
+ * recently used layouts of that text at a few sizes.
+ */
+class TextLayoutCache {
+public:
+  static TextLayoutCache &shared()
   {
-    for (const auto &t : cacheValue->_layouts) {
-      CGSize constrainedSize = std::get<0>(t);
-      ASTextLayout *layout = std::get<1>(t);
-
-      CGSize layoutSize = layout.textBoundingSize;
-      // 1. CoreText can return frames that are narrower than the constrained width, for obvious reasons.
-      // 2. CoreText can return frames that are slightly wider than the constrained width, for some reason.
-      //    We have to trust that somehow it's OK to try and draw within our size constraint, despite the return value.
-      // 3. Thus, those two values (constrained width & returned width) form a range, where
-      //    intermediate values in that range will be snapped. Thus, we can use a given layout as long as our
-      //    width is in that range, between the min and max of those two values.
-      CGRect minRect = CGRectMake(0, 0, MIN(layoutSize.width, constrainedSize.width), MIN(layoutSize.height, constrainedSize.height));
-      if (!CGRectContainsRect(containerBounds, minRect)) {
-        continue;
-      }
-      CGRect maxRect = CGRectMake(0, 0, MAX(layoutSize.width, constrainedSize.width), MAX(layoutSize.height, constrainedSize.height));
-      if (!CGRectContainsRect(maxRect, containerBounds)) {
-        continue;
-      }
-      if (!CGSizeEqualToSize(container.size, constrainedSize)) {
-        continue;
-      }
+    static TextLayoutCache *cache = new TextLayoutCache();
+    return *cache;
+  }
 
-      // Now check container params.
-      ASTextContainer *otherContainer = layout.container;
-      if (!NSEdgeInsetsEqualToEdgeInsets(container.insets, otherContainer.insets)) {
-        continue;
-      }
-      if (!ASObjectIsEqual(container.exclusionPaths, otherContainer.exclusionPaths)) {
-        continue;
-      }
-      if (container.maximumNumberOfRows != otherContainer.maximumNumberOfRows) {
-        continue;
-      }
-      if (container.truncationType != otherContainer.truncationType) {
-        continue;
+  TextLayoutCache() : _cache(8 * 1024 * 1024)
+  {
+    // NSCache used to drop its contents under memory pressure; keep doing that.
+    ASAddMemoryPressureHandler(^{
+      TextLayoutCache::shared().removeAll();
+    });
+  }
+
+  /// @c textHash must be ASTextHash(text).
+  ASTextLayout *layout(ASTextContainer *container, NSAttributedString *text, uint64_t textHash)
+  {
+    const uint64_t key = ASTextLayoutCacheKey(container, textHash);
+
+    Entry cached;
+    BOOL textMatches = NO;
+    if (ASTextLayout *hit = find(key, container, text, textHash, cached, textMatches)) {
+      return hit;
+    }
+
+    // Lay out each key on one thread at a time, so that threads missing it together wait for one layout.
+    MutexLocker l(_missLocks[key % kMissLockCount]);
+    if (ASTextLayout *hit = find(key, container, text, textHash, cached, textMatches)) {
+      return hit;
+    }
+
+    _cache.countLookup(false);
+    ASTextLayout *layout = [ASTextLayout layoutWithContainer:container text:text];
+    if (layout == nil) {
+      return nil;
+    }
+
+    // Replaced texts and layouts are released after the lock is dropped.
+    Entry replaced;
+    _cache.update(key, [&](Entry &entry, size_t &cost, bool inserted) {
+      if (inserted || !textMatches || entry.text != cached.text) {
+        // A different text with the same key, or the entry was replaced meanwhile. Start over.
+        std::swap(entry, replaced);
+        entry.text = textMatches ? cached.text : [text copy];
+        entry.textHash = textHash;
       }
-      if (!ASObjectIsEqual(container.truncationToken, otherContainer.truncationToken)) {
-        continue;
+      entry.layouts.insert(entry.layouts.begin(), std::make_pair(container.size, layout));
+      if (entry.layouts.size() > kLayoutsPerEntry) {
+        entry.layouts.pop_back();
       }
-      // TODO: When we get a cache hit, move this entry to the front (LRU).
-      return layout;
-    }
+      cost = Cost(entry);
+    });
+    return layout;
+  }
+
+  void removeAll()
+  {
+    _cache.removeAll();
+  }
+
+  ASTextNodeLayoutCacheMetrics metrics()
+  {
+    const auto metrics = _cache.metrics();
+    return {
+      .hitCount = metrics.hitCount,
+      .missCount = metrics.missCount,
+      .evictionCount = metrics.evictionCount,
+      .entryCount = metrics.entryCount,
+      .byteCount = metrics.cost,
+    };
   }
 
-  // Cache Miss. Compute the text layout.
-  ASTextLayout *layout = [ASTextLayout layoutWithContainer:container text:text];
+private:
+  typedef std::vector<std::pair<CGSize, ASTextLayout *>> Layouts;
+
+  struct Entry {
+    NSAttributedString *text;
+    uint64_t textHash;
+    Layouts layouts; // Most recently used first.
+  };
 
-  // Store the result in the cache.
+  static constexpr size_t kLayoutsPerEntry = 4;
+  static constexpr size_t kMissLockCount = 64;
+
+  /**
+   * Estimated bytes held by the entry: the text, plus each layout's lines and glyph runs.
+   */
+  static size_t Cost(const Entry &entry)
   {
-    // This is a critical section. However we also must hold the lock until this point, in case
-    // another thread requests this cache item while a layout is being calculated, so they don't race.
-    cacheValue->_layouts.push_front(std::make_tuple(container.size, layout));
-    if (cacheValue->_layouts.size() > 3) {
-      cacheValue->_layouts.pop_back();
+    const size_t length = entry.text.length;
+    return sizeof(Entry) + length * sizeof(unichar) + entry.layouts.size() * (512 + length * 8);
+  }
+
+  /**
+   * Returns a compatible cached layout, counting the hit, or nil. Leaves the entry for @c key in @c cached, and whether
+   * its text is @c text in @c textMatches.
+   */
+  ASTextLayout *find(uint64_t key, ASTextContainer *container, NSAttributedString *text, uint64_t textHash, Entry &cached,
+                     BOOL &textMatches)
+  {
+    // Copy out the candidates, then compare without holding the shard lock.
+    const bool found = _cache.lookup(key, cached);
+    textMatches = found && (cached.text == text
+                            || (cached.textHash == textHash && [cached.text isEqualToAttributedString:text]));
+    if (textMatches) {
+      for (const auto &candidate : cached.layouts) {
+        if (ASTextLayoutIsCompatible(candidate.second, candidate.first, container)) {
+          _cache.countLookup(true);
+          promote(key, cached, candidate.second);
+          return candidate.second;
+        }
+      }
     }
+    return nil;
+  }
+
+  /**
+   * Marks the entry for @c key most recently used, and moves @c layout to the front of it. Puts back @c cached if the
+   * entry was evicted since it was looked up.
+   */
+  void promote(uint64_t key, const Entry &cached, ASTextLayout *layout)
+  {
+    _cache.update(key, [&](Entry &entry, size_t &cost, bool inserted) {
+      if (inserted) {
+        entry = cached;
+        cost = Cost(entry);
+      }
+      auto &layouts = entry.layouts;
+      const auto match = std::find_if(layouts.begin(), layouts.end(), [&](const std::pair<CGSize, ASTextLayout *> &e) {
+        return e.second == layout;
+      });
+      if (match != layouts.end()) {
+        std::rotate(layouts.begin(), match, match + 1);
+      }
+    });
   }
 
-  return layout;
+  LRUCache<uint64_t, Entry> _cache;
+  Mutex _missLocks[kMissLockCount];
+};
+
+} // namespace AS
+
+/**
+ * If it can't find a compatible layout, this method creates one.
+ *
+ * NOTE: The cache copies `text` if it needs to keep it. `textHash` must be ASTextHash(text).
+ */
+static NS_RETURNS_RETAINED ASTextLayout *ASTextNodeCompatibleLayoutWithContainerAndText(ASTextContainer *container, NSAttributedString *text, uint64_t textHash)  {
+  return AS::TextLayoutCache::shared().layout(container, text, textHash);
 }
 
 static const NSTimeInterval ASTextNodeHighlightFadeOutDuration = 0.15;
@@ -164,6 +318,11 @@ static NSString *ASTextNodeTruncationTokenAttributeName = @"ASTextNodeTruncation
   CGFloat _shadowRadius;
   
   NSAttributedString *_attributedText;
+  uint64_t _attributedTextHash;
+  BOOL _attributedTextHashIsValid;
+  // _attributedText prepared for layout, by isForIntrinsicSize, and their hashes. Nil until needed.
+  NSAttributedString *_preparedTexts[2];
+  uint64_t _preparedTextHashes[2];
   NSAttributedString *_truncationAttributedText;
   NSAttributedString *_additionalTruncationMessage;
   NSArray<NSNumber *> *_pointSizeScaleFactors;
@@ -360,9 +519,9 @@ static NSArray *DefaultLinkAttributeNames() {
   // it may provide a text that is longer than the width and require a wordWrapping line break mode and looking for the height to be calculated.
   BOOL isCalculatingIntrinsicSize = (_textContainer.size.width >= ASTextContainerMaxSize.width) || (_textContainer.size.height >= ASTextContainerMaxSize.height);
 
-  NSMutableAttributedString *mutableText = [_attributedText mutableCopy];
-  [self prepareAttributedString:mutableText isForIntrinsicSize:isCalculatingIntrinsicSize];
-  ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(_textContainer, mutableText);
+  uint64_t textHash;
+  NSAttributedString *text = [self _locked_preparedTextForIntrinsicSize:isCalculatingIntrinsicSize hash:&textHash];
+  ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(_textContainer, text, textHash);
   if (layout.truncatedLine != nil && layout.truncatedLine.size.width > layout.textBoundingSize.width) {
     return (CGSize) {MIN(constrainedSize.width, layout.truncatedLine.size.width), layout.textBoundingSize.height};
   }
@@ -408,6 +567,9 @@ static NSArray *DefaultLinkAttributeNames() {
     return;
   }
 
+  _attributedTextHashIsValid = NO;
+  [self _locked_invalidatePreparedTexts];
+
   // Since truncation text matches style of attributedText, invalidate it now.
   [self _locked_invalidateTruncationText];
 
@@ -521,12 +683,45 @@ static NSArray *DefaultLinkAttributeNames() {
   }
 }
 
+/**
+ * The text after prepareAttributedString:, and its ASTextHash. It is kept until the text, truncation mode or shadow
+ * changes, so that layouts of the same text find their cache entry by identity instead of comparing contents.
+ */
+- (NSAttributedString *)_locked_preparedTextForIntrinsicSize:(BOOL)isForIntrinsicSize hash:(uint64_t *)hash
+{
+  const NSUInteger i = isForIntrinsicSize ? 1 : 0;
+  if (_preparedTexts[i] == nil) {
+    NSMutableAttributedString *mutableText = [_attributedText mutableCopy] ?: [[NSMutableAttributedString alloc] init];
+    [self prepareAttributedString:mutableText isForIntrinsicSize:isForIntrinsicSize];
+    _preparedTexts[i] = [mutableText copy];
+    _preparedTextHashes[i] = ASTextHash(_preparedTexts[i]);
+  }
+  *hash = _preparedTextHashes[i];
+  return _preparedTexts[i];
+}
+
+- (void)_locked_invalidatePreparedTexts
+{
+  _preparedTexts[0] = nil;
+  _preparedTexts[1] = nil;
+}
+
+- (uint64_t)_locked_attributedTextHash
+{
+  if (!_attributedTextHashIsValid) {
+    _attributedTextHash = ASTextHash(_attributedText);
+    _attributedTextHashIsValid = YES;
+  }
+  return _attributedTextHash;
+}
+
 #pragma mark - Drawing
 
 - (NSObject *)drawParametersForAsyncLayer:(_ASDisplayLayer *)layer
 {
   ASTextContainer *copiedContainer;
-  NSMutableAttributedString *mutableText;
+  NSAttributedString *text;
+  uint64_t textHash;
   BOOL needsTintColor;
   id bgColor;
   {
@@ -538,31 +733,33 @@ static NSArray *DefaultLinkAttributeNames() {
     copiedContainer = [_textContainer copy];
     copiedContainer.size = self.bounds.size;
     [copiedContainer makeImmutable];
-    mutableText = [_attributedText mutableCopy] ?: [[NSMutableAttributedString alloc] init];
-
-    [self prepareAttributedString:mutableText isForIntrinsicSize:NO];
-    needsTintColor = self.textColorFollowsTintColor && mutableText.length > 0;
+    text = [self _locked_preparedTextForIntrinsicSize:NO hash:&textHash];
+    needsTintColor = self.textColorFollowsTintColor && text.length > 0;
     bgColor = self.backgroundColor ?: [NSNull null];
   }
   
   // After all other attributes are set, apply tint color if needed and foreground color is not already specified
   if (needsTintColor) {
     // Apply tint color if specified and if foreground color is undefined for attributedString
-    NSRange limit = NSMakeRange(0, mutableText.length);
+    NSRange limit = NSMakeRange(0, text.length);
     // Look for previous attributes that define foreground color
-    NSColor *attributeValue = (NSColor *)[mutableText attribute:NSForegroundColorAttributeName atIndex:limit.location effectiveRange:NULL];
+    NSColor *attributeValue = (NSColor *)[text attribute:NSForegroundColorAttributeName atIndex:limit.location effectiveRange:NULL];
     
     // we need to unlock before accessing tintColor
     NSColor *tintColor = self.tintColor;
     if (attributeValue == nil && tintColor) {
       // None are found, apply tint color if available. Fallback to "black" text color
+      NSMutableAttributedString *mutableText = [text mutableCopy];
       [mutableText addAttributes:@{ NSForegroundColorAttributeName : tintColor } range:limit];
+      text = mutableText;
+      textHash = ASTextHash(text);
     }
   }
 
   return @{
     @"container": copiedContainer,
-    @"text": mutableText,
+    @"text": text,
+    @"textHash": @(textHash),
     @"bgColor": bgColor
   };
 }
@@ -571,8 +768,9 @@ static NSArray *DefaultLinkAttributeNames() {
 {
   ASTextContainer *container = layoutDict[@"container"];
       NSAttributedString *text = layoutDict[@"text"];
+      const uint64_t textHash = [layoutDict[@"textHash"] unsignedLongLongValue];
       NSColor *bgColor = layoutDict[@"bgColor"];
-      ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(container, text);
+      ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(container, text, textHash);
       
       if (isCancelledBlock()) {
           return;
@@ -660,7 +858,7 @@ static NSArray *DefaultLinkAttributeNames() {
   // See discussion in https://github.com/TextureGroup/Texture/pull/396
   ASTextContainer *containerCopy = [_textContainer copy];
   containerCopy.size = self.calculatedSize;
-  ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(containerCopy, _attributedText);
+  ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(containerCopy, _attributedText, [self _locked_attributedTextHash]);
 
   if ([self _locked_pointInsideAdditionalTruncationMessage:point withLayout:layout]) {
     if (inAdditionalTruncationMessageOut != NULL) {
@@ -918,7 +1116,7 @@ static NSArray *DefaultLinkAttributeNames() {
         // See discussion in https://github.com/TextureGroup/Texture/pull/396
         ASTextContainer *textContainerCopy = [_textContainer copy];
         textContainerCopy.size = self.calculatedSize;
-        ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(textContainerCopy, _attributedText);
+        ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(textContainerCopy, _attributedText, [self _locked_attributedTextHash]);
 
         NSArray<ASTextSelectionRect *> *highlightRects = [layout selectionRectsWithoutStartAndEndForRange:[ASTextRange rangeWithRange:highlightRange]];
         NSMutableArray *converted = [NSMutableArray arrayWithCapacity:highlightRects.count];
@@ -1098,7 +1296,7 @@ static CGRect ASTextNodeAdjustRenderRectForShadowPadding(CGRect rendererRect, NS
       // See discussion in https://github.com/TextureGroup/Texture/pull/396
       ASTextContainer *containerCopy = [_textContainer copy];
       containerCopy.size = self.calculatedSize;
-      ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(containerCopy, _attributedText);
+      ASTextLayout *layout = ASTextNodeCompatibleLayoutWithContainerAndText(containerCopy, _attributedText, [self _locked_attributedTextHash]);
       visibleRange = layout.visibleRange;
     }
     NSRange truncationMessageRange = [self _additionalTruncationMessageRangeWithVisibleRange:visibleRange];
@@ -1225,6 +1423,7 @@ static CGRect ASTextNodeAdjustRenderRectForShadowPadding(CGRect rendererRect, NS
   if (_shadowColor != shadowColor && CGColorEqualToColor(shadowColor, _shadowColor) == NO) {
     CGColorRelease(_shadowColor);
     _shadowColor = CGColorRetain(shadowColor);
+    [self _locked_invalidatePreparedTexts];
     [self setNeedsDisplay];
   }
 }
@@ -1238,6 +1437,7 @@ static CGRect ASTextNodeAdjustRenderRectForShadowPadding(CGRect rendererRect, NS
 {
   ASLockScopeSelf();
   if (ASCompareAssignCustom(_shadowOffset, shadowOffset, CGSizeEqualToSize)) {
+    [self _locked_invalidatePreparedTexts];
     [self setNeedsDisplay];
   }
 }
@@ -1251,6 +1451,7 @@ static CGRect ASTextNodeAdjustRenderRectForShadowPadding(CGRect rendererRect, NS
 {
   ASLockScopeSelf();
   if (ASCompareAssign(_shadowOpacity, shadowOpacity)) {
+    [self _locked_invalidatePreparedTexts];
     [self setNeedsDisplay];
   }
 }
@@ -1264,6 +1465,7 @@ static CGRect ASTextNodeAdjustRenderRectForShadowPadding(CGRect rendererRect, NS
 {
   ASLockScopeSelf();
   if (ASCompareAssign(_shadowRadius, shadowRadius)) {
+    [self _locked_invalidatePreparedTexts];
     [self setNeedsDisplay];
   }
 }
@@ -1359,6 +1561,7 @@ static NSAttributedString *DefaultTruncationAttributedString()
     }
     
     _textContainer.truncationType = truncationType;
+    [self _locked_invalidatePreparedTexts];
     
     [self setNeedsDisplay];
   }
@@ -1378,7 +1581,7 @@ static NSAttributedString *DefaultTruncationAttributedString()
 {
   ASTextContainer *container = [_textContainer copy];
   container.size = size;
-  return ASTextNodeCompatibleLayoutWithContainerAndText(container, _attributedText);
+  return ASTextNodeCompatibleLayoutWithContainerAndText(container, _attributedText, [self _locked_attributedTextHash]);
 }
 
 - (NSUInteger)maximumNumberOfLines
@@ -1512,6 +1715,11 @@ static NSAttributedString *DefaultTruncationAttributedString()
 }
 #endif
 
++ (ASTextNodeLayoutCacheMetrics)layoutCacheMetrics
+{
+  return AS::TextLayoutCache::shared().metrics();
+}
+
 + (void)enableDebugging
 {
   ASTextDebugOption *debugOption = [[ASTextDebugOption alloc] init];
@@ -35,6 +35,7 @@
 
 #import "ASImageProtocols.h"
 #import "ASBasicImageDownloader.h"
+#import "ASDecodedImageCache.h"
 #import "ASPINRemoteImageDownloader.h"
 #import "ASMultiplexImageNode.h"
 #import "ASNetworkImageLoadInfo.h"
@@ -23,6 +23,7 @@ typedef NS_ENUM(uint32_t, ASSignpostName) {
   // Misc
   ASSignpostDeallocQueueDrain = 375,      // One chunk of dealloc queue work. arg0 is count.
   ASSignpostOrientationChange,            // From WillChangeStatusBarOrientation to animation end.
+  ASSignpostMainSerialQueueDrain,         // One drain of ASMainSerialQueue. arg0 is count.
 };
 
 #ifdef PROFILE
@@ -18,7 +18,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * A shared image downloader which can be used by @c ASNetworkImageNodes and @c ASMultiplexImageNodes.
- * The userInfo provided by this downloader is `nil`.
+ * The userInfo provided by this downloader is `nil`, or a dictionary with @c ASNetworkImageLoadInfoDecodeDurationKey
+ * if the image was decoded before delivery.
  *
  * This is a very basic image downloader. It does not support caching, retrying, progressive downloading and likely
  * isn't something you should use in production. If you'd like something production ready, see @c ASPINRemoteImageDownloader
@@ -28,6 +29,20 @@ NS_ASSUME_NONNULL_BEGIN
 @property (class, readonly) ASBasicImageDownloader *sharedImageDownloader;
 + (ASBasicImageDownloader *)sharedImageDownloader NS_RETURNS_RETAINED;
 
+/**
+ * Whether finished downloads are decoded in the background before their completions are called, so the first draw
+ * does not decode them, often on the main thread. Decodes run a few at a time, highest download priority first.
+ * Images requested with a pixel size are always decoded at that size, the same way. Defaults to NO.
+ */
+@property BOOL shouldPredecodeImages;
+
+/**
+ * The number of downloads that may run at once. Further downloads wait, and start highest priority first, so images
+ * becoming visible overtake those being preloaded. A download is cancelled once every request for its URL has been.
+ * Defaults to 6.
+ */
+@property NSUInteger maximumConcurrentDownloads;
+
 + (instancetype)new __attribute__((unavailable("+[ASBasicImageDownloader sharedImageDownloader] must be used.")));
 - (instancetype)init __attribute__((unavailable("+[ASBasicImageDownloader sharedImageDownloader] must be used.")));
 
@@ -9,10 +9,15 @@
 
 #import "ASBasicImageDownloader.h"
 
+#import <QuartzCore/QuartzCore.h>
 #import <objc/runtime.h>
+#import <vector>
 
 #import "ASBasicImageDownloaderInternal.h"
+#import "ASDecodedImageCache.h"
+#import "ASDownloadScheduler.h"
 #import "ASImageContainerProtocolCategories.h"
+#import "ASNetworkImageLoadInfo.h"
 #import "ASThread.h"
 
 using AS::MutexLocker;
@@ -25,6 +30,7 @@ using AS::MutexLocker;
 NSString * const kASBasicImageDownloaderContextCallbackQueue = @"kASBasicImageDownloaderContextCallbackQueue";
 NSString * const kASBasicImageDownloaderContextProgressBlock = @"kASBasicImageDownloaderContextProgressBlock";
 NSString * const kASBasicImageDownloaderContextCompletionBlock = @"kASBasicImageDownloaderContextCompletionBlock";
+NSString * const kASBasicImageDownloaderContextPixelSize = @"kASBasicImageDownloaderContextPixelSize";
 
 static inline float NSURLSessionTaskPriorityWithImageDownloaderPriority(ASImageDownloaderPriority priority) {
   switch (priority) {
@@ -39,13 +45,94 @@ static inline float NSURLSessionTaskPriorityWithImageDownloaderPriority(ASImageD
   }
 }
 
+#pragma mark -
+/**
+ * One caller's interest in a URL, returned as its download identifier. Requests for the same URL share a context,
+ * and the context's download is cancelled once every request for it has been cancelled.
+ */
+@interface ASBasicImageDownloaderRequest : NSObject
+{
+  AS::Mutex _lock;
+  BOOL _cancelled;
+  ASBasicImageDownloaderContext *_context;
+}
+
+- (instancetype)initWithCallbackData:(NSDictionary *)callbackData priority:(ASImageDownloaderPriority)priority;
+
+@property (nonatomic, readonly) NSDictionary *callbackData;
+
+/// Atomic, as it is set by the caller while the context reads it.
+@property ASImageDownloaderPriority priority;
+
+/// The context the request is attached to, or nil until it is attached.
+@property (nonatomic, readonly) ASBasicImageDownloaderContext *context;
+
+/// Marks the request as cancelled and returns its context, if it has been attached to one.
+- (ASBasicImageDownloaderContext *)cancel;
+
+/// Attaches the request to @c context, unless it has been cancelled. Called by the context, under its lock.
+- (BOOL)attachToContext:(ASBasicImageDownloaderContext *)context;
+
+@end
+
+@implementation ASBasicImageDownloaderRequest
+
+- (instancetype)initWithCallbackData:(NSDictionary *)callbackData priority:(ASImageDownloaderPriority)priority
+{
+  if (self = [super init]) {
+    _callbackData = callbackData;
+    _priority = priority;
+  }
+  return self;
+}
+
+- (ASBasicImageDownloaderContext *)context
+{
+  MutexLocker l(_lock);
+  return _context;
+}
+
+- (ASBasicImageDownloaderContext *)cancel
+{
+  MutexLocker l(_lock);
+  _cancelled = YES;
+  return _context;
+}
+
+- (BOOL)attachToContext:(ASBasicImageDownloaderContext *)context
+{
+  MutexLocker l(_lock);
+  if (_cancelled) {
+    return NO;
+  }
+  _context = context;
+  return YES;
+}
+
+@end
+
+
+#pragma mark -
 @interface ASBasicImageDownloaderContext ()
 {
   BOOL _invalid;
+  BOOL _downloaded;
   AS::RecursiveMutex __instanceLock__;
 }
 
-@property (nonatomic) NSMutableArray *callbackDatas;
+@property (nonatomic) NSMutableArray<ASBasicImageDownloaderRequest *> *requests;
+
+/// The highest priority of the requests for this URL.
+@property (nonatomic, readonly) ASImageDownloaderPriority priority;
+
+/// Whether the context has requests and has not been cancelled or completed.
+@property (nonatomic, readonly, getter=isActive) BOOL active;
+
+/// Whether any request asks for the image at a pixel size, which is always decoded before completing.
+@property (nonatomic, readonly) BOOL hasRequestsWithPixelSize;
+
+/// Marks the download finished, so that no new session task is started while the data is being decoded.
+- (void)markDownloaded;
 
 @end
 
@@ -77,11 +164,24 @@ static NSMutableDictionary *currentRequests = nil;
   return context;
 }
 
-+ (void)cancelContextWithURL:(NSURL *)URL
++ (ASBasicImageDownloaderContext *)contextForURL:(NSURL *)URL addingRequest:(ASBasicImageDownloaderRequest *)request
+{
+  // A context that was cancelled or completed since it was looked up no longer takes requests; it is removed from
+  // the current requests, and the next lookup creates a new one.
+  while (true) {
+    ASBasicImageDownloaderContext *context = [self contextForURL:URL];
+    if ([context addRequest:request]) {
+      return context;
+    }
+    [self removeContext:context];
+  }
+}
+
++ (void)removeContext:(ASBasicImageDownloaderContext *)context
 {
   MutexLocker l(*self.currentRequestLock);
-  if (currentRequests) {
-    [currentRequests removeObjectForKey:URL];
+  if (currentRequests[context.URL] == context) {
+    [currentRequests removeObjectForKey:context.URL];
   }
 }
 
@@ -89,7 +189,7 @@ static NSMutableDictionary *currentRequests = nil;
 {
   if (self = [super init]) {
     _URL = URL;
-    _callbackDatas = [NSMutableArray array];
+    _requests = [NSMutableArray array];
   }
   return self;
 }
@@ -105,7 +205,8 @@ static NSMutableDictionary *currentRequests = nil;
   }
 
   _invalid = YES;
-  [self.class cancelContextWithURL:self.URL];
+  [self.requests removeAllObjects];
+  [self.class removeContext:self];
 }
 
 - (BOOL)isCancelled
@@ -114,16 +215,72 @@ static NSMutableDictionary *currentRequests = nil;
   return _invalid;
 }
 
-- (void)addCallbackData:(NSDictionary *)callbackData
+- (BOOL)isActive
 {
   MutexLocker l(__instanceLock__);
-  [self.callbackDatas addObject:callbackData];
+  return !_invalid && self.requests.count > 0;
+}
+
+/**
+ * Adds the request, unless it was cancelled before it got here. Returns NO if the context no longer takes requests.
+ */
+- (BOOL)addRequest:(ASBasicImageDownloaderRequest *)request
+{
+  MutexLocker l(__instanceLock__);
+  if (_invalid) {
+    return NO;
+  }
+  if ([request attachToContext:self]) {
+    [self.requests addObject:request];
+    [self _locked_updateTaskPriority];
+  }
+  return YES;
+}
+
+/**
+ * Removes a cancelled request, cancelling the download if no request is left. Returns whether it was cancelled.
+ */
+- (BOOL)removeRequest:(ASBasicImageDownloaderRequest *)request
+{
+  MutexLocker l(__instanceLock__);
+  if (_invalid) {
+    return NO;
+  }
+  [self.requests removeObjectIdenticalTo:request];
+  if (self.requests.count > 0) {
+    [self _locked_updateTaskPriority];
+    return NO;
+  }
+  [self cancel];
+  return YES;
+}
+
+- (ASImageDownloaderPriority)priority
+{
+  MutexLocker l(__instanceLock__);
+  ASImageDownloaderPriority priority = ASImageDownloaderPriorityPreload;
+  for (ASBasicImageDownloaderRequest *request in self.requests) {
+    priority = MAX(priority, request.priority);
+  }
+  return priority;
+}
+
+- (void)requestPriorityDidChange
+{
+  MutexLocker l(__instanceLock__);
+  [self _locked_updateTaskPriority];
+}
+
+- (void)_locked_updateTaskPriority
+{
+  self.sessionTask.priority = NSURLSessionTaskPriorityWithImageDownloaderPriority(self.priority);
 }
 
 - (void)performProgressBlocks:(CGFloat)progress
 {
   MutexLocker l(__instanceLock__);
-  for (NSDictionary *callbackData in self.callbackDatas) {
+  for (ASBasicImageDownloaderRequest *request in self.requests) {
+    NSDictionary *callbackData = request.callbackData;
     ASImageDownloaderProgress progressBlock = callbackData[kASBasicImageDownloaderContextProgressBlock];
     dispatch_queue_t callbackQueue = callbackData[kASBasicImageDownloaderContextCallbackQueue];
 
@@ -135,22 +292,79 @@ static NSMutableDictionary *currentRequests = nil;
   }
 }
 
-- (void)completeWithImage:(NSImage *)image error:(NSError *)error
+- (BOOL)hasRequestsWithPixelSize
+{
+  MutexLocker l(__instanceLock__);
+  for (ASBasicImageDownloaderRequest *request in self.requests) {
+    if (!CGSizeEqualToSize([request.callbackData[kASBasicImageDownloaderContextPixelSize] sizeValue], CGSizeZero)) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+- (void)markDownloaded
 {
   MutexLocker l(__instanceLock__);
-  for (NSDictionary *callbackData in self.callbackDatas) {
+  _downloaded = YES;
+}
+
+- (void)completeWithData:(NSData *)data error:(NSError *)error predecode:(BOOL)predecode
+{
+  // Take the requests and retire the context under the lock, then decode without it, so that cancelling or adding
+  // requests does not wait for decoding. Requests made from now on download the URL again.
+  NSArray<ASBasicImageDownloaderRequest *> *requests;
+  {
+    MutexLocker l(__instanceLock__);
+    if (_invalid) {
+      return;
+    }
+    requests = [self.requests copy];
+    _invalid = YES;
+    self.sessionTask = nil;
+    [self.requests removeAllObjects];
+    [self.class removeContext:self];
+  }
+
+  // Each size asked for is decoded once, into the shared decoded image cache. Callbacks without a size share the
+  // full image, which is decoded now only when predecoding.
+  NSImage *fullImage = nil;
+  NSTimeInterval fullImageDecodeDuration = 0;
+  for (ASBasicImageDownloaderRequest *request in requests) {
+    NSDictionary *callbackData = request.callbackData;
     ASImageDownloaderCompletion completionBlock = callbackData[kASBasicImageDownloaderContextCompletionBlock];
     dispatch_queue_t callbackQueue = callbackData[kASBasicImageDownloaderContextCallbackQueue];
+    const CGSize pixelSize = [callbackData[kASBasicImageDownloaderContextPixelSize] sizeValue];
+
+    NSImage *image = nil;
+    NSTimeInterval decodeDuration = 0;
+    if (data == nil) {
+      // Failed; pass the error on.
+    } else if (!CGSizeEqualToSize(pixelSize, CGSizeZero)) {
+      const CFTimeInterval start = CACurrentMediaTime();
+      image = [ASDecodedImageCache.sharedCache imageForURL:self.URL pixelSize:pixelSize decodingData:data];
+      decodeDuration = CACurrentMediaTime() - start;
+    } else {
+      if (fullImage == nil && predecode) {
+        const CFTimeInterval start = CACurrentMediaTime();
+        fullImage = ASDecodedImageCreate(data, CGSizeZero);
+        fullImageDecodeDuration = CACurrentMediaTime() - start;
+      }
+      if (fullImage == nil) {
+        fullImage = [[NSImage alloc] initWithData:data];
+        fullImageDecodeDuration = 0;
+      }
+      image = fullImage;
+      decodeDuration = fullImageDecodeDuration;
+    }
+    NSDictionary *userInfo = (decodeDuration > 0 ? @{ ASNetworkImageLoadInfoDecodeDurationKey : @(decodeDuration) } : nil);
 
     if (completionBlock) {
       dispatch_async(callbackQueue, ^{
-        completionBlock(image, error, nil, nil);
+        completionBlock(image, error, nil, userInfo);
       });
     }
   }
-
-  self.sessionTask = nil;
-  [self.callbackDatas removeAllObjects];
 }
 
 - (NSURLSessionTask *)createSessionTaskIfNecessaryWithBlock:(NSURLSessionTask *(^)())creationBlock {
@@ -161,7 +375,7 @@ static NSMutableDictionary *currentRequests = nil;
       return nil;
     }
 
-    if (self.sessionTask && (self.sessionTask.state == NSURLSessionTaskStateRunning)) {
+    if (_downloaded || self.sessionTask != nil) {
       return nil;
     }
   }
@@ -175,11 +389,12 @@ static NSMutableDictionary *currentRequests = nil;
       return nil;
     }
 
-    if (self.sessionTask && (self.sessionTask.state == NSURLSessionTaskStateRunning)) {
+    if (_downloaded || self.sessionTask != nil) {
       return nil;
     }
 
     self.sessionTask = newTask;
+    newTask.priority = NSURLSessionTaskPriorityWithImageDownloaderPriority(self.priority);
     
     return self.sessionTask;
   }
@@ -213,11 +428,80 @@ static const void *ContextKey() {
 @end
 
 
+#pragma mark -
+/**
+ * Runs finished downloads' decodes a few at a time in the background. The next decode is always one for the URL
+ * with the highest current priority, so images becoming visible overtake those being preloaded.
+ */
+class ASBasicImageDecodeQueue
+{
+public:
+  static ASBasicImageDecodeQueue &shared()
+  {
+    static ASBasicImageDecodeQueue *queue = new ASBasicImageDecodeQueue();
+    return *queue;
+  }
+
+  void enqueue(ASBasicImageDownloaderContext *context, dispatch_block_t work)
+  {
+    {
+      MutexLocker l(_lock);
+      _pending.push_back({context, work});
+      if (_runningCount == kMaxConcurrentDecodes) {
+        return;
+      }
+      _runningCount++;
+    }
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+      drain();
+    });
+  }
+
+private:
+  struct Decode {
+    ASBasicImageDownloaderContext *context;
+    dispatch_block_t work;
+  };
+
+  static constexpr NSUInteger kMaxConcurrentDecodes = 2;
+
+  void drain()
+  {
+    while (true) {
+      dispatch_block_t work;
+      {
+        MutexLocker l(_lock);
+        if (_pending.empty()) {
+          _runningCount--;
+          return;
+        }
+        // Priorities change while decodes wait, so pick at dequeue time. The queue is short; oldest wins ties.
+        auto next = _pending.begin();
+        for (auto it = next + 1; it != _pending.end(); ++it) {
+          if (it->context.priority > next->context.priority) {
+            next = it;
+          }
+        }
+        work = next->work;
+        _pending.erase(next);
+      }
+      work();
+    }
+  }
+
+  AS::Mutex _lock;
+  std::vector<Decode> _pending;
+  NSUInteger _runningCount = 0;
+};
+
+
 #pragma mark -
 @interface ASBasicImageDownloader () <NSURLSessionDownloadDelegate>
 {
   NSOperationQueue *_sessionDelegateQueue;
   NSURLSession *_session;
+
+  AS::DownloadScheduler<ASBasicImageDownloaderContext *> _scheduler;
 }
 
 @end
@@ -273,46 +557,119 @@ static const void *ContextKey() {
                    downloadProgress:(ASImageDownloaderProgress)downloadProgress
                          completion:(ASImageDownloaderCompletion)completion
 {
-  ASBasicImageDownloaderContext *context = [ASBasicImageDownloaderContext contextForURL:URL];
+  return [self downloadImageWithURL:URL
+                          pixelSize:CGSizeZero
+                        shouldRetry:shouldRetry
+                           priority:priority
+                      callbackQueue:callbackQueue
+                   downloadProgress:downloadProgress
+                         completion:completion];
+}
+
+- (nullable id)downloadImageWithURL:(NSURL *)URL
+                          pixelSize:(CGSize)pixelSize
+                        shouldRetry:(BOOL)shouldRetry
+                           priority:(ASImageDownloaderPriority)priority
+                      callbackQueue:(dispatch_queue_t)callbackQueue
+                   downloadProgress:(ASImageDownloaderProgress)downloadProgress
+                         completion:(ASImageDownloaderCompletion)completion
+{
+  // associate metadata with it
+  const auto callbackData = [[NSMutableDictionary alloc] init];
+  callbackData[kASBasicImageDownloaderContextCallbackQueue] = callbackQueue ? : dispatch_get_main_queue();
+  callbackData[kASBasicImageDownloaderContextPixelSize] = [NSValue valueWithSize:pixelSize];
+
+  if (downloadProgress) {
+    callbackData[kASBasicImageDownloaderContextProgressBlock] = [downloadProgress copy];
+  }
+
+  if (completion) {
+    callbackData[kASBasicImageDownloaderContextCompletionBlock] = [completion copy];
+  }
+
+  ASBasicImageDownloaderRequest *request = [[ASBasicImageDownloaderRequest alloc] initWithCallbackData:[callbackData copy] priority:priority];
 
   // NSURLSessionDownloadTask will do file I/O to create a temp directory. If called on the main thread this will
   // cause significant performance issues.
   dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-    // associate metadata with it
-    const auto callbackData = [[NSMutableDictionary alloc] init];
-    callbackData[kASBasicImageDownloaderContextCallbackQueue] = callbackQueue ? : dispatch_get_main_queue();
+    ASBasicImageDownloaderContext *context = [ASBasicImageDownloaderContext contextForURL:URL addingRequest:request];
+    [self _scheduleContext:context];
+  });
 
-    if (downloadProgress) {
-      callbackData[kASBasicImageDownloaderContextProgressBlock] = [downloadProgress copy];
-    }
+  return request;
+}
 
-    if (completion) {
-      callbackData[kASBasicImageDownloaderContextCompletionBlock] = [completion copy];
-    }
+- (void)cancelImageDownloadForIdentifier:(id)downloadIdentifier
+{
+  ASDisplayNodeAssert([downloadIdentifier isKindOfClass:ASBasicImageDownloaderRequest.class], @"unexpected downloadIdentifier");
+  ASBasicImageDownloaderRequest *request = (ASBasicImageDownloaderRequest *)downloadIdentifier;
 
-    [context addCallbackData:[[NSDictionary alloc] initWithDictionary:callbackData]];
+  // A request cancelled before it is attached is never added to a context.
+  ASBasicImageDownloaderContext *context = [request cancel];
+  if ([context removeRequest:request]) {
+    _scheduler.remove(context);
+  }
+}
+
+- (void)setPriority:(ASImageDownloaderPriority)priority withDownloadIdentifier:(id)downloadIdentifier
+{
+  ASDisplayNodeAssert([downloadIdentifier isKindOfClass:ASBasicImageDownloaderRequest.class], @"unexpected downloadIdentifier");
+  ASBasicImageDownloaderRequest *request = (ASBasicImageDownloaderRequest *)downloadIdentifier;
+
+  request.priority = priority;
+  [request.context requestPriorityDidChange];
+}
+
+
+#pragma mark Scheduling.
+
+- (NSUInteger)maximumConcurrentDownloads
+{
+  return _scheduler.maximumRunning();
+}
 
+- (void)setMaximumConcurrentDownloads:(NSUInteger)maximumConcurrentDownloads
+{
+  _scheduler.setMaximumRunning(maximumConcurrentDownloads);
+  [self _startPendingDownloads];
+}
+
+- (void)_scheduleContext:(ASBasicImageDownloaderContext *)context
+{
+  if (_scheduler.schedule(context)) {
+    [self _startPendingDownloads];
+  }
+}
+
+/**
+ * Starts the pending downloads with the highest priorities until @c maximumConcurrentDownloads are running.
+ */
+- (void)_startPendingDownloads
+{
+  ASBasicImageDownloaderContext *context;
+  while (_scheduler.startNext(context, [](ASBasicImageDownloaderContext *c) {
+    return c.priority;
+  }, [](ASBasicImageDownloaderContext *c) {
+    return (bool)c.isActive;
+  })) {
     // Create new task if necessary
-    NSURLSessionDownloadTask *task = (NSURLSessionDownloadTask *)[context createSessionTaskIfNecessaryWithBlock:^(){return [self->_session downloadTaskWithURL:URL];}];
+    NSURLSessionDownloadTask *task = (NSURLSessionDownloadTask *)[context createSessionTaskIfNecessaryWithBlock:^(){return [self->_session downloadTaskWithURL:context.URL];}];
 
     if (task) {
-      task.priority = NSURLSessionTaskPriorityWithImageDownloaderPriority(priority);
       task.originalRequest.asyncdisplaykit_context = context;
 
       // start downloading
       [task resume];
+    } else {
+      _scheduler.finish(context);
     }
-  });
-
-  return context;
+  }
 }
 
-- (void)cancelImageDownloadForIdentifier:(id)downloadIdentifier
+- (void)_downloadDidFinishForContext:(ASBasicImageDownloaderContext *)context
 {
-  ASDisplayNodeAssert([downloadIdentifier isKindOfClass:ASBasicImageDownloaderContext.class], @"unexpected downloadIdentifier");
-  ASBasicImageDownloaderContext *context = (ASBasicImageDownloaderContext *)downloadIdentifier;
-
-  [context cancel];
+  _scheduler.finish(context);
+  [self _startPendingDownloads];
 }
 
 
@@ -337,8 +694,23 @@ static const void *ContextKey() {
   }
 
   if (context) {
-    NSImage *image = [[NSImage alloc] initWithData:[NSData dataWithContentsOfURL:location]];
-    [context completeWithImage:image error:nil];
+    // The context may wait for its decode after the download is finished with the scheduler. Until it completes, it
+    // must not be started again.
+    [context markDownloaded];
+    NSData *data = [NSData dataWithContentsOfURL:location];
+    const BOOL predecode = self.shouldPredecodeImages;
+    // Decoding at a pixel size happens whether or not we predecode, and must not hold up the session's delegate queue
+    // either.
+    if (data != nil && (predecode || context.hasRequestsWithPixelSize)) {
+      // The file at location is deleted when this method returns, so the data is read here.
+      ASBasicImageDecodeQueue::shared().enqueue(context, ^{
+        if (![context isCancelled]) {
+          [context completeWithData:data error:nil predecode:predecode];
+        }
+      });
+    } else {
+      [context completeWithData:data error:nil predecode:NO];
+    }
   }
 }
 
@@ -348,7 +720,10 @@ static const void *ContextKey() {
 {
   ASBasicImageDownloaderContext *context = task.originalRequest.asyncdisplaykit_context;
   if (context && error) {
-    [context completeWithImage:nil error:error];
+    [context completeWithData:nil error:error predecode:NO];
+  }
+  if (context) {
+    [self _downloadDidFinishForContext:context];
   }
 }
 
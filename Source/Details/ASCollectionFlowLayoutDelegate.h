@@ -15,9 +15,12 @@ AS_SUBCLASSING_RESTRICTED
 
 /**
  * A thread-safe, high performant layout delegate that arranges items into a flow layout. 
- * It uses a concurrent and multi-line ASStackLayoutSpec under the hood. Thus, per-child flex properties (i.e alignSelf, 
- * flexShrink, flexGrow, etc - see @ASStackLayoutElement) can be set directly on cell nodes to be used
- * to calculate the final collection layout.
+ * Items are placed like the children of a multi-line horizontal ASStackLayoutSpec that aligns everything to the start.
+ * Only the first viewport is laid out up front. The rest is measured concurrently, in chunks, as the collection scrolls
+ * towards it, and cell nodes are allocated as their chunk is. Each chunk goes through the stack layout, so per-child
+ * properties such as flexGrow, alignSelf and spacingBefore apply as they would to the stack's children. The one
+ * difference: a stack with exactly one child that can both grow and shrink sizes that child in a single pass, and a
+ * chunk does so when it has exactly one, even if the collection has more.
  */
 @interface ASCollectionFlowLayoutDelegate : NSObject <ASCollectionLayoutDelegate>
 
@@ -9,15 +9,9 @@
 
 #import "ASCollectionFlowLayoutDelegate.h"
 
-#import "ASCellNode+Internal.h"
-#import "ASCollectionLayoutState.h"
-#import "ASCollectionElement.h"
 #import "ASCollectionLayoutContext.h"
 #import "ASCollectionLayoutDefines.h"
-#import "ASCollections.h"
-#import "ASElementMap.h"
-#import "ASLayout.h"
-#import "ASStackLayoutSpec.h"
+#import "ASCollectionLayoutState+Private.h"
 
 @implementation ASCollectionFlowLayoutDelegate {
   ASScrollDirection _scrollableDirections;
@@ -51,28 +45,9 @@
 
 + (ASCollectionLayoutState *)calculateLayoutWithContext:(ASCollectionLayoutContext *)context
 {
-  ASElementMap *elements = context.elements;
-  NSArray<ASCellNode *> *children = ASArrayByFlatMapping(elements.itemElements, ASCollectionElement *element, element.node);
-  if (children.count == 0) {
-    return [[ASCollectionLayoutState alloc] initWithContext:context];
-  }
-  
-  ASStackLayoutSpec *stackSpec = [ASStackLayoutSpec stackLayoutSpecWithDirection:ASStackLayoutDirectionHorizontal
-                                                                         spacing:0
-                                                                  justifyContent:ASStackLayoutJustifyContentStart
-                                                                      alignItems:ASStackLayoutAlignItemsStart
-                                                                        flexWrap:ASStackLayoutFlexWrapWrap
-                                                                    alignContent:ASStackLayoutAlignContentStart
-                                                                        children:children];
-  stackSpec.concurrent = YES;
-
+  // Items are laid out as the collection scrolls to them, so the first frame does not wait for all of them.
   ASSizeRange sizeRange = ASSizeRangeForCollectionLayoutThatFitsViewportSize(context.viewportSize, context.scrollableDirections);
-  ASLayout *layout = [stackSpec layoutThatFits:sizeRange];
-
-  return [[ASCollectionLayoutState alloc] initWithContext:context layout:layout getElementBlock:^ASCollectionElement * _Nullable(ASLayout * _Nonnull sublayout) {
-    ASCellNode *node = ASDynamicCast(sublayout.layoutElement, ASCellNode);
-    return node ? node.collectionElement : nil;
-  }];
+  return [[ASCollectionLayoutState alloc] initWithContext:context flowLayoutSizeRange:sizeRange];
 }
 
 @end
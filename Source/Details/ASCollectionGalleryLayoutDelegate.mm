@@ -9,17 +9,9 @@
 #import "ASCollectionGalleryLayoutDelegate.h"
 
 #import "_ASCollectionGalleryLayoutInfo.h"
-#import "_ASCollectionGalleryLayoutItem.h"
-#import "ASCellNode.h"
-#import "ASCollectionElement.h"
-#import "ASCollections.h"
 #import "ASCollectionLayoutContext.h"
-#import "ASCollectionLayoutDefines.h"
-#import "ASCollectionLayoutState.h"
+#import "ASCollectionLayoutState+Private.h"
 #import "ASElementMap.h"
-#import "ASLayout.h"
-#import "ASInsetLayoutSpec.h"
-#import "ASStackLayoutSpec.h"
 
 #pragma mark - ASCollectionGalleryLayoutDelegate
 
@@ -87,57 +79,20 @@
 
 + (ASCollectionLayoutState *)calculateLayoutWithContext:(ASCollectionLayoutContext *)context
 {
-  ASElementMap *elements = context.elements;
-  CGSize pageSize = context.viewportSize;
-  ASScrollDirection scrollableDirections = context.scrollableDirections;
-
   _ASCollectionGalleryLayoutInfo *info = ASDynamicCast(context.additionalInfo, _ASCollectionGalleryLayoutInfo);
   CGSize itemSize = info.itemSize;
-  if (info == nil || CGSizeEqualToSize(CGSizeZero, itemSize)) {
-    return [[ASCollectionLayoutState alloc] initWithContext:context];
-  }
-
-  NSArray<_ASGalleryLayoutItem *> *children = ASArrayByFlatMapping(elements.itemElements,
-                                                                   ASCollectionElement *element,
-                                                                   [[_ASGalleryLayoutItem alloc] initWithItemSize:itemSize collectionElement:element]);
-  if (children.count == 0) {
+  if (info == nil || itemSize.width <= 0 || itemSize.height <= 0) {
     return [[ASCollectionLayoutState alloc] initWithContext:context];
   }
 
-  // Use a stack spec to calculate layout content size and frames of all elements without actually measuring each element
-  ASStackLayoutDirection stackDirection = ASScrollDirectionContainsVerticalDirection(scrollableDirections)
-                                              ? ASStackLayoutDirectionHorizontal
-                                              : ASStackLayoutDirectionVertical;
-  ASStackLayoutSpec *stackSpec = [ASStackLayoutSpec stackLayoutSpecWithDirection:stackDirection
-                                                                         spacing:info.minimumInteritemSpacing
-                                                                  justifyContent:ASStackLayoutJustifyContentStart
-                                                                      alignItems:ASStackLayoutAlignItemsStart
-                                                                        flexWrap:ASStackLayoutFlexWrapWrap
-                                                                    alignContent:ASStackLayoutAlignContentStart
-                                                                     lineSpacing:info.minimumLineSpacing
-                                                                        children:children];
-  stackSpec.concurrent = YES;
-
-  ASLayoutSpec *finalSpec = stackSpec;
-  NSEdgeInsets sectionInset = info.sectionInset;
-  if (NSEdgeInsetsEqualToEdgeInsets(sectionInset, NSEdgeInsetsZero) == NO) {
-    finalSpec = [ASInsetLayoutSpec insetLayoutSpecWithInsets:sectionInset child:stackSpec];
-  }
-
-  ASLayout *layout = [finalSpec layoutThatFits:ASSizeRangeForCollectionLayoutThatFitsViewportSize(pageSize, scrollableDirections)];
-
-  return [[ASCollectionLayoutState alloc] initWithContext:context layout:layout getElementBlock:^ASCollectionElement * _Nullable(ASLayout * _Nonnull sublayout) {
-    _ASGalleryLayoutItem *item = ASDynamicCast(sublayout.layoutElement, _ASGalleryLayoutItem);
-    return item ? item.collectionElement : nil;
+  // Every item has the same size, so the layout of a wrapping stack of them is known in closed form. The state
+  // computes frames from item indexes, and never lays out or stores all of the items.
+  return [[ASCollectionLayoutState alloc] initWithContext:context gridGeometry:{
+    .itemSize = itemSize,
+    .lineSpacing = info.minimumLineSpacing,
+    .interitemSpacing = info.minimumInteritemSpacing,
+    .sectionInset = info.sectionInset,
   }];
 }
 
-static inline bool NSEdgeInsetsEqualToEdgeInsets(NSEdgeInsets insets1, NSEdgeInsets insets2)
-{
-  return (insets1.top == insets2.top &&
-          insets1.left == insets2.left &&
-          insets1.bottom == insets2.bottom &&
-          insets1.right == insets2.right);
-}
-
 @end
@@ -7,18 +7,260 @@
 //
 
 #import "ASCollectionLayoutState.h"
+#import "ASCollectionLayoutState+Private.h"
 
+#import "ASAssert.h"
 #import "ASCellNode.h"
 #import "ASCollectionElement.h"
 #import "ASCollectionLayoutContext.h"
+#import "ASCollections.h"
+#import "ASDispatch.h"
 #import "ASDisplayNode+Subclasses.h"
 #import "ASElementMap.h"
+#import "ASIntervalIndex.h"
 #import "ASLayout.h"
+#import "ASLayoutElementStylePrivate.h"
 #import "ASLayoutSpecUtilities.h"
-#import "ASPageTable.h"
+#import "ASStackPositionedLayout.h"
+#import "ASStackUnpositionedLayout.h"
 #import "ASThread.h"
 
+#import <algorithm>
 #import <queue>
+#import <vector>
+
+/// The number of flow layout items measured together, on as many threads as there are cores.
+static const NSUInteger kASCollectionFlowLayoutChunkItemCount = 32;
+
+namespace {
+
+/**
+ * Frames of items of one size that flow in lines, computed from their index. The math works in line space, where
+ * u runs along a line and v across lines, so that both scroll directions share it.
+ */
+struct ASCollectionGridLayout {
+  BOOL vertical; // Scrolls vertically, so lines are rows.
+  NSUInteger itemCount;
+  NSUInteger itemsPerLine;
+  NSUInteger lineCount;
+  CGSize itemSize;
+  CGFloat uStart, vStart;
+  CGFloat uStride, vStride; // An item and the spacing after it.
+  CGSize contentSize;
+
+  static ASCollectionGridLayout make(const ASCollectionLayoutGridGeometry &geometry, CGSize viewportSize, BOOL vertical, NSUInteger itemCount)
+  {
+    const CGSize itemSize = geometry.itemSize;
+    const NSEdgeInsets inset = geometry.sectionInset;
+    const CGFloat uSize = vertical ? itemSize.width : itemSize.height;
+    const CGFloat vSize = vertical ? itemSize.height : itemSize.width;
+    const CGFloat uStart = vertical ? inset.left : inset.top;
+    const CGFloat uEnd = vertical ? inset.right : inset.bottom;
+    const CGFloat vStart = vertical ? inset.top : inset.left;
+    const CGFloat vEnd = vertical ? inset.bottom : inset.right;
+    const CGFloat lineLength = vertical ? viewportSize.width : viewportSize.height;
+
+    // As many items as fit in a line, like a wrapping stack, but always at least one. The tolerance keeps items that
+    // exactly fill a line from wrapping on rounding errors. Spacing that cancels out the item size, or more, never
+    // fills a line, so all items go in one.
+    const CGFloat uStride = uSize + geometry.interitemSpacing;
+    const CGFloat vStride = vSize + geometry.lineSpacing;
+    const CGFloat fittingCount = (uStride > 0 ? floor((lineLength - uStart - uEnd + geometry.interitemSpacing + 0.001) / uStride) : CGFLOAT_MAX);
+    const NSUInteger itemsPerLine = (fittingCount < 1 ? 1 : (fittingCount < itemCount ? (NSUInteger)fittingCount : MAX(itemCount, 1)));
+    const NSUInteger lineCount = (itemCount + itemsPerLine - 1) / itemsPerLine;
+
+    // Lines that overlap by more than their size would give less than the first line needs.
+    const CGFloat vLines = (lineCount > 0 ? MAX(vSize, lineCount * vSize + (lineCount - 1) * geometry.lineSpacing) : 0);
+    const CGFloat vExtent = vStart + vLines + vEnd;
+    return {
+      .vertical = vertical,
+      .itemCount = itemCount,
+      .itemsPerLine = itemsPerLine,
+      .lineCount = lineCount,
+      .itemSize = itemSize,
+      .uStart = uStart,
+      .vStart = vStart,
+      .uStride = uStride,
+      .vStride = vStride,
+      .contentSize = vertical ? CGSizeMake(lineLength, vExtent) : CGSizeMake(vExtent, lineLength),
+    };
+  }
+
+  CGRect frameForIndex(NSUInteger index) const
+  {
+    const CGFloat u = uStart + (index % itemsPerLine) * uStride;
+    const CGFloat v = vStart + (index / itemsPerLine) * vStride;
+    return vertical ? CGRect{{u, v}, itemSize} : CGRect{{v, u}, itemSize};
+  }
+
+  /// Calls @c body with the index and frame of each item that intersects @c rect, visiting only those lines and
+  /// positions that can.
+  template <typename Body>
+  void enumerateItemsInRect(CGRect rect, Body body) const
+  {
+    if (itemCount == 0 || CGRectIsNull(rect) || CGRectIsEmpty(rect)) {
+      return;
+    }
+    const CGFloat uMin = vertical ? CGRectGetMinX(rect) : CGRectGetMinY(rect);
+    const CGFloat uMax = vertical ? CGRectGetMaxX(rect) : CGRectGetMaxY(rect);
+    const CGFloat vMin = vertical ? CGRectGetMinY(rect) : CGRectGetMinX(rect);
+    const CGFloat vMax = vertical ? CGRectGetMaxY(rect) : CGRectGetMaxX(rect);
+
+    // The slots of the items that can reach from @c min to @c max. With negative spacing items overlap, so one that
+    // starts before @c min can still reach past it. Items that do not advance, because the spacing cancels out their
+    // size, are all visited.
+    const auto slotRange = [](CGFloat min, CGFloat max, CGFloat size, CGFloat stride, NSUInteger count, NSUInteger &first, NSUInteger &last) {
+      const auto clampedSlot = [&](CGFloat offset) -> NSUInteger {
+        const CGFloat slot = floor(offset / stride);
+        return slot < 0 ? 0 : (slot < count ? (NSUInteger)slot : count - 1);
+      };
+      first = (stride > 0 ? clampedSlot(min - size) : 0);
+      last = (stride > 0 ? clampedSlot(max) : count - 1);
+    };
+    NSUInteger firstLine, lastLine, firstPosition, lastPosition;
+    slotRange(vMin - vStart, vMax - vStart, vertical ? itemSize.height : itemSize.width, vStride, lineCount, firstLine, lastLine);
+    slotRange(uMin - uStart, uMax - uStart, vertical ? itemSize.width : itemSize.height, uStride, itemsPerLine, firstPosition, lastPosition);
+
+    for (NSUInteger line = firstLine; line <= lastLine; line++) {
+      for (NSUInteger position = firstPosition; position <= lastPosition; position++) {
+        const NSUInteger index = line * itemsPerLine + position;
+        if (index >= itemCount) {
+          return;
+        }
+        const CGRect frame = frameForIndex(index);
+        if (CGRectIntersectsRect(rect, frame)) {
+          body(index, frame);
+        }
+      }
+    }
+  }
+};
+
+/**
+ * Layout attributes in the order they start along the scrollable direction, searched with an AS::IntervalIndex. Each
+ * frame is then only checked across the scrollable direction.
+ */
+struct ASCollectionLayoutIntervalIndex {
+  BOOL vertical;
+  std::vector<NSCollectionViewLayoutAttributes *> attributes;
+  std::vector<CGRect> frames;
+  AS::IntervalIndex<CGFloat> intervals;
+
+  CGFloat start(CGRect frame) const { return vertical ? CGRectGetMinY(frame) : CGRectGetMinX(frame); }
+  CGFloat end(CGRect frame) const { return vertical ? CGRectGetMaxY(frame) : CGRectGetMaxX(frame); }
+
+  /// Builds the index from the attributes in @c table. Fills @c unmeasured with whether the element of the attributes
+  /// at each position still needs to be measured to fit them.
+  void build(NSMapTable<ASCollectionElement *, NSCollectionViewLayoutAttributes *> *table, BOOL scrollsVertically, std::vector<bool> &unmeasured)
+  {
+    struct Entry {
+      CGRect frame;
+      NSCollectionViewLayoutAttributes *attrs;
+      bool unmeasured;
+    };
+    vertical = scrollsVertically;
+    std::vector<Entry> entries;
+    entries.reserve(table.count);
+    for (ASCollectionElement *element in table) {
+      NSCollectionViewLayoutAttributes *attrs = [table objectForKey:element];
+      const CGRect frame = attrs.frame;
+      ASCellNode *node = element.nodeIfAllocated;
+      entries.push_back({frame, attrs, node == nil || CGSizeEqualToSize(node.calculatedSize, frame.size) == NO});
+    }
+    std::stable_sort(entries.begin(), entries.end(), [&](const Entry &a, const Entry &b) {
+      return start(a.frame) < start(b.frame);
+    });
+
+    reserve(entries.size());
+    unmeasured.reserve(entries.size());
+    for (const Entry &entry : entries) {
+      append(entry.attrs, entry.frame, start(entry.frame));
+      unmeasured.push_back(entry.unmeasured);
+    }
+  }
+
+  void reserve(size_t count)
+  {
+    attributes.reserve(count);
+    frames.reserve(count);
+    intervals.reserve(count);
+  }
+
+  /// Adds attributes whose frame starts no earlier along the scrollable direction than @c key, which is no smaller than
+  /// the key of any attributes already in the index.
+  void append(NSCollectionViewLayoutAttributes *attrs, CGRect frame, CGFloat key)
+  {
+    attributes.push_back(attrs);
+    frames.push_back(frame);
+    intervals.append(key, end(frame));
+  }
+
+  /// Calls @c body with the position of each frame that intersects @c rect, in the order they were appended.
+  template <typename Body>
+  void enumerateIndexesInRect(CGRect rect, Body body) const
+  {
+    if (frames.empty() || CGRectIsNull(rect) || CGRectIsEmpty(rect)) {
+      return;
+    }
+    size_t first, last;
+    intervals.range(start(rect), end(rect), first, last);
+    for (auto i = first; i < last; i++) {
+      if (CGRectIntersectsRect(rect, frames[i])) {
+        body((NSUInteger)i);
+      }
+    }
+  }
+
+  /// Appends the attributes whose frames intersect @c rect to @c buffer, in the order they were appended.
+  void getAttributesInRect(CGRect rect, std::vector<NSCollectionViewLayoutAttributes *> &buffer) const
+  {
+    enumerateIndexesInRect(rect, [&](NSUInteger i) {
+      buffer.push_back(attributes[i]);
+    });
+  }
+};
+
+} // namespace
+
+/**
+ * All the layout attributes of a grid layout, created as they are asked for.
+ */
+@interface _ASCollectionGridLayoutAttributesArray : NSArray<NSCollectionViewLayoutAttributes *>
+- (instancetype)initWithLayoutState:(ASCollectionLayoutState *)layoutState count:(NSUInteger)count;
+@end
+
+@interface ASCollectionLayoutState ()
+- (NSCollectionViewLayoutAttributes *)_gridLayoutAttributesForIndex:(NSUInteger)index;
+@end
+
+@implementation _ASCollectionGridLayoutAttributesArray {
+  ASCollectionLayoutState *_layoutState;
+  NSUInteger _count;
+}
+
+- (instancetype)initWithLayoutState:(ASCollectionLayoutState *)layoutState count:(NSUInteger)count
+{
+  if (self = [super init]) {
+    _layoutState = layoutState;
+    _count = count;
+  }
+  return self;
+}
+
+- (NSUInteger)count
+{
+  return _count;
+}
+
+- (NSCollectionViewLayoutAttributes *)objectAtIndex:(NSUInteger)index
+{
+  if (index >= _count) {
+    [NSException raise:NSRangeException format:@"Index %lu beyond bounds [0 .. %lu]", (unsigned long)index, (unsigned long)_count];
+  }
+  return [_layoutState _gridLayoutAttributesForIndex:index];
+}
+
+@end
 
 @implementation NSMapTable (ASCollectionLayoutConvenience)
 
@@ -34,8 +276,35 @@
   CGSize _contentSize;
   ASCollectionLayoutContext *_context;
   NSMapTable<ASCollectionElement *, NSCollectionViewLayoutAttributes *> *_elementToLayoutAttributesTable;
-  ASPageToLayoutAttributesTable *_pageToLayoutAttributesTable;
-  ASPageToLayoutAttributesTable *_unmeasuredPageToLayoutAttributesTable;
+  ASCollectionLayoutIntervalIndex _index;
+  std::vector<bool> _unmeasured; // Whether the attributes at each position of the index still await measurement.
+  NSUInteger _unmeasuredCount;
+
+  // Grid and flow layouts know their items by their index among all items.
+  std::vector<NSUInteger> _sectionStartIndexes; // The index of each section's first item among all items.
+
+  // Grid layouts compute item frames instead of storing them, and create the attributes of an item the first time it
+  // is asked for. _gridAttributes is sized then too, and guarded by __instanceLock__.
+  BOOL _isGrid;
+  ASCollectionGridLayout _grid;
+  std::vector<NSCollectionViewLayoutAttributes *> _gridAttributes;
+  std::vector<bool> _gridHandedOutForMeasurement; // Whether each item has been checked for measurement. Sized likewise.
+
+  // Flow layouts append their items to the index in chunks, as far as they are asked for. The index, the content size
+  // and the flow extents are then guarded by __instanceLock__.
+  BOOL _isFlow;
+  AS::Mutex _flowLock; // Serializes laying out chunks. Taken before __instanceLock__.
+  NSArray<ASCollectionElement *> *_flowElements;
+  ASSizeRange _flowSizeRange;
+  BOOL _isFlowSingleLine; // Lines are as long as they need to be, so every item is in the first one.
+  NSUInteger _flowPlacedCount; // Guarded by _flowLock, as are the two below.
+  CGFloat _flowOrigin; // Where the next line starts, or the next item if the layout is a single line.
+  CGFloat _flowBreadth; // The longest line so far, or the thickness of the line if the layout is a single line.
+  CGFloat _flowSettledExtent; // _flowOrigin as last published, or CGFLOAT_MAX once every item is placed.
+  CGFloat _flowTargetExtent; // How far to lay out in the background.
+  BOOL _isLayingOutFlowInBackground;
+  BOOL _isContentSizeDidChangeScheduled;
+  void (^_contentSizeDidChangeBlock)(void); // Main thread only.
 }
 
 - (instancetype)initWithContext:(ASCollectionLayoutContext *)context
@@ -95,6 +364,40 @@ elementToLayoutAttributesTable:[NSMapTable elementToLayoutAttributesTable]];
   return [self initWithContext:context contentSize:layout.size elementToLayoutAttributesTable:table];
 }
 
+- (instancetype)initWithContext:(ASCollectionLayoutContext *)context gridGeometry:(ASCollectionLayoutGridGeometry)geometry
+{
+  self = [self initWithContext:context];
+  if (self) {
+    const NSUInteger itemCount = [self _recordSectionStartIndexes];
+    const BOOL vertical = ASScrollDirectionContainsVerticalDirection(context.scrollableDirections);
+    _isGrid = YES;
+    _grid = ASCollectionGridLayout::make(geometry, context.viewportSize, vertical, itemCount);
+    _contentSize = (itemCount > 0 ? _grid.contentSize : CGSizeZero);
+  }
+  return self;
+}
+
+- (instancetype)initWithContext:(ASCollectionLayoutContext *)context flowLayoutSizeRange:(ASSizeRange)sizeRange
+{
+  self = [self initWithContext:context];
+  if (self) {
+    _isFlow = YES;
+    _flowElements = context.elements.itemElements;
+    [self _recordSectionStartIndexes];
+    _flowSizeRange = sizeRange;
+    _isFlowSingleLine = isinf(sizeRange.max.width);
+    _flowSettledExtent = (_flowElements.count == 0 ? CGFLOAT_MAX : 0);
+    _index.vertical = !_isFlowSingleLine;
+    _index.reserve(_flowElements.count);
+
+    // Lay out the first viewport now, and the rest when it is asked for.
+    const CGPoint offset = context.initialContentOffset;
+    const CGSize viewportSize = context.viewportSize;
+    [self _layOutFlowItemsThroughExtent:(_index.vertical ? offset.y + viewportSize.height : offset.x + viewportSize.width)];
+  }
+  return self;
+}
+
 - (instancetype)initWithContext:(ASCollectionLayoutContext *)context
                     contentSize:(CGSize)contentSize
  elementToLayoutAttributesTable:(NSMapTable *)table
@@ -104,9 +407,8 @@ elementToLayoutAttributesTable:[NSMapTable elementToLayoutAttributesTable]];
     _context = context;
     _contentSize = contentSize;
     _elementToLayoutAttributesTable = [table copy]; // Copy the given table to make sure clients can't mutate it after this point.
-    CGSize pageSize = context.viewportSize;
-    _pageToLayoutAttributesTable = [ASPageTable pageTableWithLayoutAttributes:table.objectEnumerator contentSize:contentSize pageSize:pageSize];
-    _unmeasuredPageToLayoutAttributesTable = [ASCollectionLayoutState _unmeasuredLayoutAttributesTableFromTable:table contentSize:contentSize pageSize:pageSize];
+    _index.build(table, ASScrollDirectionContainsVerticalDirection(context.scrollableDirections), _unmeasured);
+    _unmeasuredCount = std::count(_unmeasured.begin(), _unmeasured.end(), true);
   }
   return self;
 }
@@ -118,16 +420,57 @@ elementToLayoutAttributesTable:[NSMapTable elementToLayoutAttributesTable]];
 
 - (CGSize)contentSize
 {
+  if (_isFlow) {
+    AS::MutexLocker l(__instanceLock__);
+    return _contentSize;
+  }
   return _contentSize;
 }
 
+- (void (^)(void))contentSizeDidChangeBlock
+{
+  ASDisplayNodeAssertMainThread();
+  return _contentSizeDidChangeBlock;
+}
+
+- (void)setContentSizeDidChangeBlock:(void (^)(void))contentSizeDidChangeBlock
+{
+  ASDisplayNodeAssertMainThread();
+  _contentSizeDidChangeBlock = [contentSizeDidChangeBlock copy];
+}
+
 - (NSArray<NSCollectionViewLayoutAttributes *> *)allLayoutAttributes
 {
+  if (_isGrid) {
+    return [[_ASCollectionGridLayoutAttributesArray alloc] initWithLayoutState:self count:_grid.itemCount];
+  }
+  if (_isFlow) {
+    [self _layOutFlowItemsThroughIndex:_flowElements.count - 1];
+    AS::MutexLocker l(__instanceLock__);
+    NSMutableArray<NSCollectionViewLayoutAttributes *> *result = [[NSMutableArray alloc] initWithCapacity:_index.attributes.size()];
+    for (NSCollectionViewLayoutAttributes *attrs : _index.attributes) {
+      [result addObject:attrs];
+    }
+    return result;
+  }
   return [_elementToLayoutAttributesTable.objectEnumerator allObjects];
 }
 
 - (NSCollectionViewLayoutAttributes *)layoutAttributesForItemAtIndexPath:(NSIndexPath *)indexPath
 {
+  if (_isGrid) {
+    NSUInteger index = [self _itemIndexForIndexPath:indexPath];
+    return (index == NSNotFound ? nil : [self _gridLayoutAttributesForIndex:index]);
+  }
+  if (_isFlow) {
+    NSUInteger index = [self _itemIndexForIndexPath:indexPath];
+    if (index == NSNotFound) {
+      return nil;
+    }
+    [self _layOutFlowItemsThroughIndex:index];
+    AS::MutexLocker l(__instanceLock__);
+    return _index.attributes[index];
+  }
   ASCollectionElement *element = [_context.elements elementForItemAtIndexPath:indexPath];
   return [_elementToLayoutAttributesTable objectForKey:element];
 }
@@ -141,113 +484,337 @@ elementToLayoutAttributesTable:[NSMapTable elementToLayoutAttributesTable]];
 
 - (NSCollectionViewLayoutAttributes *)layoutAttributesForElement:(ASCollectionElement *)element
 {
+  if ((_isGrid || _isFlow) && element.supplementaryElementKind == nil) {
+    NSIndexPath *indexPath = [_context.elements indexPathForElement:element];
+    return (indexPath ? [self layoutAttributesForItemAtIndexPath:indexPath] : nil);
+  }
   return [_elementToLayoutAttributesTable objectForKey:element];
 }
 
 - (NSArray<NSCollectionViewLayoutAttributes *> *)layoutAttributesForElementsInRect:(CGRect)rect
 {
-  CGSize pageSize = _context.viewportSize;
-  NSPointerArray *pages = ASPageCoordinatesForPagesThatIntersectRect(rect, _contentSize, pageSize);
-  if (pages.count == 0) {
-    return @[];
+  // Gather the attributes in a buffer and make the array AppKit gets from it in one go.
+  std::vector<NSCollectionViewLayoutAttributes *> result;
+  if (_isGrid) {
+    AS::MutexLocker l(__instanceLock__);
+    _grid.enumerateItemsInRect(rect, [&](NSUInteger index, CGRect frame) {
+      result.push_back([self _locked_gridLayoutAttributesForIndex:index frame:frame]);
+    });
+  } else if (_isFlow) {
+    [self _layOutFlowItemsThroughExtent:_index.end(rect)];
+    AS::MutexLocker l(__instanceLock__);
+    _index.getAttributesInRect(rect, result);
+  } else {
+    _index.getAttributesInRect(rect, result);
   }
+  return [NSArray arrayByTransferring:result.data() count:result.size()];
+}
 
-  // Use a set here because some items may span multiple pages
-  const auto result = [[NSMutableSet<NSCollectionViewLayoutAttributes *> alloc] init];
-  for (id pagePtr in pages) {
-    ASPageCoordinate page = (ASPageCoordinate)pagePtr;
-    NSArray<NSCollectionViewLayoutAttributes *> *allAttrs = [_pageToLayoutAttributesTable objectForPage:page];
-    if (allAttrs.count > 0) {
-      CGRect pageRect = ASPageCoordinateGetPageRect(page, pageSize);
+- (NSArray<NSCollectionViewLayoutAttributes *> *)getAndRemoveUnmeasuredLayoutAttributesInRect:(CGRect)rect
+{
+  if (_isGrid) {
+    return [self _getAndRemoveUnmeasuredGridLayoutAttributesInRect:rect];
+  }
+  if (_isFlow) {
+    // Flow items are measured as they are laid out, so measuring ahead means laying out ahead.
+    if (!CGRectIsNull(rect) && !CGRectIsEmpty(rect)) {
+      [self _scheduleFlowLayoutThroughExtent:_index.end(rect)];
+    }
+    return nil;
+  }
 
-      if (CGRectContainsRect(rect, pageRect)) {
-        [result addObjectsFromArray:allAttrs];
-      } else {
-        for (NSCollectionViewLayoutAttributes *attrs in allAttrs) {
-          if (CGRectIntersectsRect(rect, attrs.frame)) {
-            [result addObject:attrs];
-          }
-        }
-      }
+  std::vector<NSCollectionViewLayoutAttributes *> result;
+  {
+    AS::MutexLocker l(__instanceLock__);
+    if (_unmeasuredCount == 0) {
+      return nil;
     }
+    _index.enumerateIndexesInRect(rect, [&](NSUInteger i) {
+      if (!_unmeasured[i]) {
+        return;
+      }
+      _unmeasured[i] = false;
+      _unmeasuredCount--;
+      result.push_back(_index.attributes[i]);
+    });
   }
+  return (result.empty() ? nil : [NSArray arrayByTransferring:result.data() count:result.size()]);
+}
+
+#pragma mark - Private methods
 
-  return [result allObjects];
+/**
+ * Records where each section starts among all items, and returns the number of items.
+ */
+- (NSUInteger)_recordSectionStartIndexes
+{
+  ASElementMap *elements = _context.elements;
+  NSUInteger itemCount = 0;
+  const NSInteger sectionCount = elements.numberOfSections;
+  _sectionStartIndexes.reserve(sectionCount);
+  for (NSInteger section = 0; section < sectionCount; section++) {
+    _sectionStartIndexes.push_back(itemCount);
+    itemCount += [elements numberOfItemsInSection:section];
+  }
+  return itemCount;
 }
 
-- (ASPageToLayoutAttributesTable *)getAndRemoveUnmeasuredLayoutAttributesPageTableInRect:(CGRect)rect
+- (NSUInteger)_itemIndexForIndexPath:(NSIndexPath *)indexPath
 {
-  CGSize pageSize = _context.viewportSize;
-  CGSize contentSize = _contentSize;
+  const NSInteger section = indexPath.section;
+  const NSInteger item = indexPath.item;
+  if (section < 0 || section >= (NSInteger)_sectionStartIndexes.size() || item < 0
+      || item >= [_context.elements numberOfItemsInSection:section]) {
+    return NSNotFound;
+  }
+  return _sectionStartIndexes[section] + item;
+}
 
+- (NSIndexPath *)_itemIndexPathForIndex:(NSUInteger)index
+{
+  // The last section starting at or before the index. Empty sections share their start with the next one.
+  const auto it = std::upper_bound(_sectionStartIndexes.begin(), _sectionStartIndexes.end(), index) - 1;
+  return [NSIndexPath indexPathForItem:(index - *it) inSection:(it - _sectionStartIndexes.begin())];
+}
+
+- (NSCollectionViewLayoutAttributes *)_itemLayoutAttributesForIndex:(NSUInteger)index frame:(CGRect)frame
+{
+  NSCollectionViewLayoutAttributes *attrs = [NSCollectionViewLayoutAttributes layoutAttributesForItemWithIndexPath:[self _itemIndexPathForIndex:index]];
+  attrs.frame = frame;
+  return attrs;
+}
+
+- (NSCollectionViewLayoutAttributes *)_gridLayoutAttributesForIndex:(NSUInteger)index
+{
   AS::MutexLocker l(__instanceLock__);
-  if (_unmeasuredPageToLayoutAttributesTable.count == 0 || CGRectIsNull(rect) || CGRectIsEmpty(rect) || CGSizeEqualToSize(CGSizeZero, contentSize) || CGSizeEqualToSize(CGSizeZero, pageSize)) {
-    return nil;
+  return [self _locked_gridLayoutAttributesForIndex:index frame:_grid.frameForIndex(index)];
+}
+
+- (NSCollectionViewLayoutAttributes *)_locked_gridLayoutAttributesForIndex:(NSUInteger)index frame:(CGRect)frame
+{
+  if (_gridAttributes.empty()) {
+    _gridAttributes.resize(_grid.itemCount);
   }
+  NSCollectionViewLayoutAttributes *attrs = _gridAttributes[index];
+  if (attrs == nil) {
+    attrs = [self _itemLayoutAttributesForIndex:index frame:frame];
+    _gridAttributes[index] = attrs;
+  }
+  return attrs;
+}
 
-  // Step 1: Determine all the pages that intersect the specified rect
-  NSPointerArray *pagesInRect = ASPageCoordinatesForPagesThatIntersectRect(rect, contentSize, pageSize);
-  if (pagesInRect.count == 0) {
+/**
+ * The grid version of -getAndRemoveUnmeasuredLayoutAttributesInRect:. Whether an item is measured is checked
+ * when it is first asked for, and each item is handed out once.
+ */
+- (NSArray<NSCollectionViewLayoutAttributes *> *)_getAndRemoveUnmeasuredGridLayoutAttributesInRect:(CGRect)rect
+{
+  if (CGSizeEqualToSize(CGSizeZero, _contentSize)) {
     return nil;
   }
 
-  // Step 2: Filter out attributes in these pages that intersect the specified rect.
-  ASPageToLayoutAttributesTable *result = nil;
-  for (id pagePtr in pagesInRect) {
-    ASPageCoordinate page = (ASPageCoordinate)pagePtr;
-    NSMutableArray *attrsInPage = [_unmeasuredPageToLayoutAttributesTable objectForPage:page];
-    if (attrsInPage.count == 0) {
-      continue;
+  ASElementMap *elements = _context.elements;
+  const CGSize itemSize = _grid.itemSize;
+  std::vector<NSCollectionViewLayoutAttributes *> unmeasuredAttrs;
+  {
+    AS::MutexLocker l(__instanceLock__);
+    if (_gridHandedOutForMeasurement.empty()) {
+      _gridHandedOutForMeasurement.resize(_grid.itemCount, false);
     }
+    _grid.enumerateItemsInRect(rect, [&](NSUInteger index, CGRect frame) {
+      if (_gridHandedOutForMeasurement[index]) {
+        return;
+      }
+      _gridHandedOutForMeasurement[index] = true;
 
-    NSMutableArray *intersectingAttrsInPage = nil;
-    CGRect pageRect = ASPageCoordinateGetPageRect(page, pageSize);
-    if (CGRectContainsRect(rect, pageRect)) {
-      // This page fits well within the specified rect. Simply return all of its attributes.
-      intersectingAttrsInPage = attrsInPage;
-    } else {
-      // The page intersects the specified rect. Some attributes in this page are returned, some are not.
-      for (NSCollectionViewLayoutAttributes *attrs in attrsInPage) {
-        if (CGRectIntersectsRect(rect, attrs.frame)) {
-          if (intersectingAttrsInPage == nil) {
-            intersectingAttrsInPage = [[NSMutableArray alloc] init];
-          }
-          [intersectingAttrsInPage addObject:attrs];
-        }
+      NSIndexPath *indexPath = [self _itemIndexPathForIndex:index];
+      ASCellNode *node = [elements elementForItemAtIndexPath:indexPath].nodeIfAllocated;
+      if (node != nil && CGSizeEqualToSize(node.calculatedSize, itemSize)) {
+        return;
       }
+      unmeasuredAttrs.push_back([self _locked_gridLayoutAttributesForIndex:index frame:frame]);
+    });
+  }
+
+  return (unmeasuredAttrs.empty() ? nil : [NSArray arrayByTransferring:unmeasuredAttrs.data() count:unmeasuredAttrs.size()]);
+}
+
+#pragma mark Flow layout
+
+/**
+ * Lays out flow items until every item that starts at or before @c extent along the scrollable direction is known.
+ */
+- (void)_layOutFlowItemsThroughExtent:(CGFloat)extent
+{
+  AS::MutexLocker l(_flowLock);
+  while (_flowPlacedCount < _flowElements.count && _flowOrigin <= extent) {
+    [self _layOutNextFlowChunk];
+  }
+}
+
+- (void)_layOutFlowItemsThroughIndex:(NSUInteger)index
+{
+  AS::MutexLocker l(_flowLock);
+  while (_flowPlacedCount < _flowElements.count && _flowPlacedCount <= index) {
+    [self _layOutNextFlowChunk];
+  }
+}
+
+/**
+ * Lays out the next chunk of flow items with the stack layout that would lay out all of them, so that each item's
+ * stack properties such as flexGrow, alignSelf and spacingBefore apply, and publishes them to the index.
+ * Must be called with _flowLock held.
+ *
+ * Lines that align to the start do not affect one another, so a line comes out of a chunk as it would out of all the
+ * items. The last line of a chunk may still take items of the next one, so it is laid out again with the next chunk
+ * instead. In a single line, items only depend on the line's thickness, which is that of the layout when it is fixed;
+ * when it is not, every item is laid out at once.
+ */
+- (void)_layOutNextFlowChunk
+{
+  NSArray<ASCollectionElement *> *elements = _flowElements;
+  const NSUInteger first = _flowPlacedCount;
+  const NSUInteger totalCount = elements.count;
+  if (first == totalCount) {
+    return;
+  }
+
+  const ASSizeRange sizeRange = _flowSizeRange;
+  const BOOL isSingleLine = _isFlowSingleLine;
+  const BOOL layOutAtOnce = (isSingleLine && sizeRange.min.height != sizeRange.max.height);
+  const ASStackLayoutSpecStyle style = {.direction = ASStackLayoutDirectionHorizontal, .spacing = 0, .justifyContent = ASStackLayoutJustifyContentStart, .alignItems = ASStackLayoutAlignItemsStart, .flexWrap = ASStackLayoutFlexWrapWrap, .alignContent = ASStackLayoutAlignContentStart, .lineSpacing = 0};
+
+  AS::StackLayout::ScratchLease<ASStackUnpositionedLayout> stack;
+  NSUInteger count = 0;
+  BOOL isLastChunk;
+  do {
+    // Only the nodes of this chunk are allocated. Items carried over are measured again, from their layout cache.
+    const NSUInteger chunkFirst = first + count;
+    const NSUInteger chunkCount = (layOutAtOnce ? totalCount - chunkFirst : MIN(kASCollectionFlowLayoutChunkItemCount, totalCount - chunkFirst));
+    std::vector<ASCellNode *> nodes(chunkCount);
+    ASCellNode * __strong *nodesPtr = nodes.data();
+    ASDispatchApply(chunkCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), 0, ^(size_t i) {
+      nodesPtr[i] = elements[chunkFirst + i].node;
+    });
+    for (ASCellNode *node : nodes) {
+      ASLayoutElementStyle *nodeStyle = node.style;
+      stack->children.push_back({node, nodeStyle, nodeStyle.size});
     }
+    count += chunkCount;
+    isLastChunk = (first + count == totalCount);
+    stack->compute(style, sizeRange, YES);
+  } while (!isLastChunk && !isSingleLine && stack->layout.lines.size() < 2);
+  ASStackPositionedLayout::compute(*stack, style, sizeRange);
+
+  const auto &lines = stack->layout.lines;
+  const std::size_t lineCount = (isLastChunk || isSingleLine ? lines.size() : lines.size() - 1);
+  const NSUInteger placedCount = lines[lineCount - 1].end; // Items are in index order.
+  const CGPoint origin = (isSingleLine ? CGPointMake(_flowOrigin, 0) : CGPointMake(0, _flowOrigin));
+  NSMutableArray<NSCollectionViewLayoutAttributes *> *attributes = [[NSMutableArray alloc] initWithCapacity:placedCount];
+  // Within a wrapped line, items aligned to its center or end start after items aligned to its start, so they are
+  // searched by where their line starts. In a single line, items start in index order.
+  std::vector<CGFloat> keys(placedCount);
+  for (std::size_t i = 0; i < lineCount; i++) {
+    const auto &line = lines[i];
+    for (std::size_t j = line.begin; j < line.end; j++) {
+      ASLayout *layout = stack->layouts[j];
+      const CGRect frame = {origin + layout.position, layout.size};
+      [attributes addObject:[self _itemLayoutAttributesForIndex:(first + j) frame:frame]];
+      keys[j] = (isSingleLine ? CGRectGetMinX(frame) : _flowOrigin);
+    }
+    _flowOrigin += (isSingleLine ? line.stackDimensionSum : line.crossSize);
+    _flowBreadth = MAX(_flowBreadth, (isSingleLine ? line.crossSize : line.stackDimensionSum));
+  }
+  _flowPlacedCount = first + placedCount;
+
+  // Until every item is placed, the content is assumed to go on as it has so far.
+  const BOOL isComplete = (_flowPlacedCount == totalCount);
+  CGSize contentSize = (isSingleLine ? CGSizeMake(_flowOrigin, _flowBreadth) : CGSizeMake(_flowBreadth, _flowOrigin));
+  if (!isComplete) {
+    const CGFloat scale = (CGFloat)totalCount / _flowPlacedCount;
+    if (isSingleLine) {
+      contentSize.width = ceil(contentSize.width * scale);
+    } else {
+      contentSize.height = ceil(contentSize.height * scale);
+    }
+  }
+  contentSize = ASSizeRangeClamp(sizeRange, contentSize);
+
+  BOOL scheduleContentSizeDidChange = NO;
+  {
+    AS::MutexLocker l(__instanceLock__);
+    for (NSUInteger i = 0; i < placedCount; i++) {
+      NSCollectionViewLayoutAttributes *attrs = attributes[i];
+      _index.append(attrs, attrs.frame, keys[i]);
+    }
+    _flowSettledExtent = (isComplete ? CGFLOAT_MAX : _flowOrigin);
+    if (!CGSizeEqualToSize(_contentSize, contentSize)) {
+      _contentSize = contentSize;
+      scheduleContentSizeDidChange = !_isContentSizeDidChangeScheduled;
+      _isContentSizeDidChangeScheduled = YES;
+    }
+  }
 
-    if (intersectingAttrsInPage.count > 0) {
-      if (attrsInPage.count == intersectingAttrsInPage.count) {
-        [_unmeasuredPageToLayoutAttributesTable removeObjectForPage:page];
-      } else {
-        [attrsInPage removeObjectsInArray:intersectingAttrsInPage];
+  // However many chunks change the content size in the meantime, the block is called once per run loop turn.
+  if (scheduleContentSizeDidChange) {
+    __weak ASCollectionLayoutState *weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+      ASCollectionLayoutState *strongSelf = weakSelf;
+      if (strongSelf == nil) {
+        return;
       }
-      if (result == nil) {
-        result = [ASPageTable pageTableForStrongObjectPointers];
+      {
+        AS::MutexLocker l(strongSelf->__instanceLock__);
+        strongSelf->_isContentSizeDidChangeScheduled = NO;
       }
-      [result setObject:intersectingAttrsInPage forPage:page];
+      void (^block)(void) = strongSelf->_contentSizeDidChangeBlock;
+      if (block) {
+        block();
+      }
+    });
+  }
+}
+
+/**
+ * Lays out flow items through @c extent on a background queue, a chunk at a time, unless they already are.
+ */
+- (void)_scheduleFlowLayoutThroughExtent:(CGFloat)extent
+{
+  {
+    AS::MutexLocker l(__instanceLock__);
+    _flowTargetExtent = MAX(_flowTargetExtent, extent);
+    if (_flowSettledExtent > _flowTargetExtent || _isLayingOutFlowInBackground) {
+      return;
     }
+    _isLayingOutFlowInBackground = YES;
   }
 
-  return result;
+  __weak ASCollectionLayoutState *weakSelf = self;
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    while (ASCollectionLayoutState *strongSelf = weakSelf) {
+      if (![strongSelf _layOutFlowChunkTowardsTargetExtent]) {
+        break;
+      }
+    }
+  });
 }
 
-#pragma mark - Private methods
-
-+ (ASPageToLayoutAttributesTable *)_unmeasuredLayoutAttributesTableFromTable:(NSMapTable<ASCollectionElement *, NSCollectionViewLayoutAttributes *> *)table
-                                                                 contentSize:(CGSize)contentSize
-                                                                    pageSize:(CGSize)pageSize
+/**
+ * Lays out the next chunk if the background target has not been reached. Returns NO, and lets the next request
+ * schedule again, once it has.
+ */
+- (BOOL)_layOutFlowChunkTowardsTargetExtent
 {
-  NSMutableArray<NSCollectionViewLayoutAttributes *> *unmeasuredAttrs = [[NSMutableArray alloc] init];
-  for (ASCollectionElement *element in table) {
-    NSCollectionViewLayoutAttributes *attrs = [table objectForKey:element];
-    if (element.nodeIfAllocated == nil || CGSizeEqualToSize(element.nodeIfAllocated.calculatedSize, attrs.frame.size) == NO) {
-      [unmeasuredAttrs addObject:attrs];
+  {
+    AS::MutexLocker l(__instanceLock__);
+    if (_flowSettledExtent > _flowTargetExtent) {
+      _isLayingOutFlowInBackground = NO;
+      return NO;
     }
   }
-
-  return [ASPageTable pageTableWithLayoutAttributes:unmeasuredAttrs contentSize:contentSize pageSize:pageSize];
+  AS::MutexLocker l(_flowLock);
+  [self _layOutNextFlowChunk];
+  return YES;
 }
 
 @end
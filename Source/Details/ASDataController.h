@@ -183,6 +183,14 @@ ASDK_EXTERN NSString * const ASCollectionInvalidUpdateException;
  */
 @property (copy, readonly) ASElementMap *pendingMap;
 
+/**
+ * Latches change sets held back by @c ASExperimentalCoalesceDataControllerUpdates, then returns @c pendingMap. Public
+ * APIs that answer in the data source's index space use this, so that they see updates made just before.
+ *
+ * Off the main thread, this returns @c pendingMap as is.
+ */
+- (ASElementMap *)pendingMapSubmittingCoalescedUpdates;
+
 /**
  Data source for fetching data info.
  */
@@ -30,12 +30,17 @@
 #import "ASDisplayNode+Subclasses.h"
 #import "NSIndexSet+ASHelpers.h"
 
+#import <algorithm>
+
 //#define LOG(...) NSLog(__VA_ARGS__)
 #define LOG(...)
 
 const static char * kASDataControllerEditingQueueKey = "kASDataControllerEditingQueueKey";
 const static char * kASDataControllerEditingQueueContext = "kASDataControllerEditingQueueContext";
 
+/// Half of a 60Hz frame, leaving the other half to layout and rendering.
+static const CFTimeInterval kASDataControllerMainThreadFrameBudget = 1.0 / 120.0;
+
 NSString * const ASDataControllerRowNodeKind = @"_ASDataControllerRowNodeKind";
 NSString * const ASCollectionInvalidUpdateException = @"ASCollectionInvalidUpdateException";
 
@@ -43,6 +48,8 @@ typedef dispatch_block_t ASDataControllerCompletionBlock;
 
 typedef void (^ASDataControllerSynchronizationBlock)();
 
+typedef std::pair<ASMainSerialQueueCancellationToken *, _ASHierarchyChangeSet *> ASDataControllerBatch;
+
 @interface ASDataController () {
   id<ASDataControllerLayoutDelegate> _layoutDelegate;
 
@@ -56,6 +63,11 @@ typedef void (^ASDataControllerSynchronizationBlock)();
   dispatch_queue_t _editingTransactionQueue;  // Serial background queue.  Dispatches concurrent layout and manages _editingNodes.
   dispatch_group_t _editingTransactionGroup;  // Group of all edit transaction blocks. Useful for waiting.
   std::atomic<int> _editingTransactionGroupCount;
+
+  // Main thread only. Batches submitted whose delegate is not informed yet, oldest first, with the tokens that drop
+  // their step 4 once a reload supersedes them.
+  std::vector<ASDataControllerBatch> _batchesInPreparation;
+  _ASHierarchyChangeSet *_coalescedChangeSet;  // Main thread only. Change sets held back while a batch is prepared.
   
   BOOL _initialReloadDataHasBeenCalled;
 
@@ -101,6 +113,10 @@ typedef void (^ASDataControllerSynchronizationBlock)();
   _nextSectionID = 0;
   
   _mainSerialQueue = [[ASMainSerialQueue alloc] init];
+  if (ASActivateExperimentalFeature(ASExperimentalCoalesceDataControllerUpdates)) {
+    // Each batch informs the delegate in a block of its own, so batches can land on separate run loop turns.
+    _mainSerialQueue.frameBudget = kASDataControllerMainThreadFrameBudget;
+  }
 
   _synchronized = YES;
   _onDidFinishSynchronizingBlocks = [[NSMutableSet alloc] init];
@@ -491,6 +507,11 @@ typedef void (^ASDataControllerSynchronizationBlock)();
 
 - (void)waitUntilAllUpdatesAreProcessed
 {
+  // Submit coalesced change sets now rather than when the batch in flight lands, since that happens while the main
+  // serial queue drains below, after the wait. The pending map already reflects the batch in flight, so they can
+  // follow it right away, and one wait covers both.
+  [self _submitCoalescedChangeSet];
+
   // Schedule block in main serial queue to wait until all operations are finished that are
   // where scheduled while waiting for the _editingTransactionQueue to finish
   [self _scheduleBlockOnMainSerialQueue:^{ }];
@@ -499,7 +520,7 @@ typedef void (^ASDataControllerSynchronizationBlock)();
 - (BOOL)isProcessingUpdates
 {
   ASDisplayNodeAssertMainThread();
-  return _mainSerialQueue.numberOfScheduledBlocks > 0 || _editingTransactionGroupCount > 0;
+  return _mainSerialQueue.numberOfScheduledBlocks > 0 || _editingTransactionGroupCount > 0 || _coalescedChangeSet != nil;
 }
 
 - (void)onDidFinishProcessingUpdates:(void (^)())completion
@@ -568,7 +589,8 @@ typedef void (^ASDataControllerSynchronizationBlock)();
     os_log_debug(ASCollectionLog(), "performBatchUpdates %@ %@", ASViewToDisplayNode(ASDynamicCast(self.dataSource, NSView)), changeSet);
   }
 
-  if (!ASActivateExperimentalFeature(ASExperimentalOptimizeDataControllerPipeline)) {
+  BOOL coalesces = ASActivateExperimentalFeature(ASExperimentalCoalesceDataControllerUpdates);
+  if (!coalesces && !ASActivateExperimentalFeature(ASExperimentalOptimizeDataControllerPipeline)) {
     NSTimeInterval transactionQueueFlushDuration = 0.0f;
     {
       AS::ScopeTimer t(transactionQueueFlushDuration);
@@ -601,6 +623,51 @@ typedef void (^ASDataControllerSynchronizationBlock)();
     }
   }
 
+  // While a batch is being prepared, hold change sets back and merge them, so that they are latched and laid out
+  // together once it lands. The data source's counts already reflect each of them, so merging picks up where
+  // the last one left off.
+  if (coalesces && (!_batchesInPreparation.empty() || _coalescedChangeSet != nil)) {
+    os_log_debug(ASCollectionLog(), "Coalescing update %@", changeSet);
+    if (_coalescedChangeSet == nil) {
+      _coalescedChangeSet = changeSet;
+    } else {
+      _coalescedChangeSet = [_ASHierarchyChangeSet changeSetByMergingChangeSet:_coalescedChangeSet withLaterChangeSet:changeSet];
+    }
+    // A reload doesn't wait, it goes out now and replaces the batches still in preparation.
+    if (!changeSet.includesReloadData) {
+      return;
+    }
+    changeSet = _coalescedChangeSet;
+    _coalescedChangeSet = nil;
+  }
+
+  [self _submitChangeSet:changeSet];
+}
+
+- (ASElementMap *)pendingMapSubmittingCoalescedUpdates
+{
+  if (ASDisplayNodeThreadIsMain()) {
+    [self _submitCoalescedChangeSet];
+  }
+  return self.pendingMap;
+}
+
+- (void)_submitCoalescedChangeSet
+{
+  ASDisplayNodeAssertMainThread();
+  _ASHierarchyChangeSet *changeSet = _coalescedChangeSet;
+  _coalescedChangeSet = nil;
+  if (changeSet != nil) {
+    [self _submitChangeSet:changeSet];
+  }
+}
+
+/**
+ * Latches the data of a completed change set into a new pending map and prepares its nodes, then informs the delegate.
+ */
+- (void)_submitChangeSet:(_ASHierarchyChangeSet *)changeSet
+{
+  ASDisplayNodeAssertMainThread();
   BOOL canDelegate = (self.layoutDelegate != nil);
   ASElementMap *newMap;
   ASCollectionLayoutContext *layoutContext;
@@ -626,6 +693,11 @@ typedef void (^ASDataControllerSynchronizationBlock)();
     }
     self.pendingMap = newMap;
 
+    // A reload replaces every map still in preparation, so the delegate doesn't need to hear about them.
+    if (changeSet.includesReloadData && ASActivateExperimentalFeature(ASExperimentalCoalesceDataControllerUpdates)) {
+      [self _cancelBatchesInPreparation];
+    }
+
     // Step 2: Ask layout delegate for contexts
     if (canDelegate) {
       layoutContext = [self.layoutDelegate layoutContextWithElements:newMap];
@@ -675,18 +747,25 @@ typedef void (^ASDataControllerSynchronizationBlock)();
     step3(YES);
   }
 
+  ASMainSerialQueueCancellationToken *token = [[ASMainSerialQueueCancellationToken alloc] init];
+  _batchesInPreparation.emplace_back(token, changeSet);
   ++_editingTransactionGroupCount;
   dispatch_group_async(_editingTransactionGroup, _editingTransactionQueue, ^{
     __block __unused os_activity_scope_state_s preparationScope = {}; // unused if deployment target < iOS10
     as_activity_scope_enter(as_activity_create("Prepare nodes for collection update", AS_ACTIVITY_CURRENT, OS_ACTIVITY_FLAG_DEFAULT), &preparationScope);
 
-    if (!mainThreadOnly) {
+    // No need to lay out a map that a reload has already replaced.
+    if (!mainThreadOnly && !token.isCancelled) {
       step3(NO);
     }
 
     // Step 4: Inform the delegate on main thread
     [self->_mainSerialQueue performBlockOnMainThread:^{
       as_activity_scope_leave(&preparationScope);
+      auto &batches = self->_batchesInPreparation;
+      batches.erase(std::find_if(batches.begin(), batches.end(), [&](const ASDataControllerBatch &batch) {
+        return batch.first == token;
+      }));
       [self->_delegate dataController:self updateWithChangeSet:changeSet updates:^{
         // Step 5: Deploy the new data as "completed"
         //
@@ -697,7 +776,10 @@ typedef void (^ASDataControllerSynchronizationBlock)();
         // (https://github.com/TextureGroup/Texture/issues/378)
         self.visibleMap = newMap;
       }];
-    }];
+      if (batches.empty()) {
+        [self _submitCoalescedChangeSet];
+      }
+    } cancellationToken:token];
     --self->_editingTransactionGroupCount;
   });
 
@@ -713,6 +795,22 @@ typedef void (^ASDataControllerSynchronizationBlock)();
   }
 }
 
+/**
+ * Drops step 4 of every batch still in preparation. Their change sets complete unfinished, and the delegate never
+ * sees their maps.
+ */
+- (void)_cancelBatchesInPreparation
+{
+  ASDisplayNodeAssertMainThread();
+  auto batches = std::move(_batchesInPreparation);
+  _batchesInPreparation.clear();
+  for (const auto &batch : batches) {
+    os_log_debug(ASCollectionLog(), "Cancelling superseded update %@", batch.second);
+    [batch.first cancel];
+    [batch.second executeCompletionHandlerWithFinished:NO];
+  }
+}
+
 /**
  * Update sections based on the given change set.
  */
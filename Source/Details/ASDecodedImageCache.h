@@ -0,0 +1,110 @@
+//
+//  ASDecodedImageCache.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import <AppKit/AppKit.h>
+#import "ASBaseDefines.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Occupancy and counters of an ASDecodedImageCache.
+ */
+typedef struct {
+  uint64_t hitCount;
+  uint64_t missCount;
+  uint64_t evictionCount;
+  NSUInteger entryCount;
+  /// The memory held by the cached bitmaps, in bytes.
+  NSUInteger byteCount;
+} ASDecodedImageCacheMetrics;
+
+/**
+ * Rounds @c pixels up to a multiple of a quarter of the largest power of two not above it, so that a bucket is at
+ * most 25% larger than the sizes in it.
+ */
+ASDISPLAYNODE_INLINE CGFloat ASDecodedImagePixelBucket(CGFloat pixels)
+{
+  const CGFloat step = MAX(1, exp2(floor(log2(pixels))) / 4);
+  return ceil(pixels / step) * step;
+}
+
+/**
+ * The size in pixels that an image must have to fill @c boundsSize at @c scale, or CGSizeZero if either is empty.
+ * Rounded up to buckets, so that nodes of about the same size share decoded images, and small changes in size don't
+ * need a new one.
+ */
+ASDISPLAYNODE_INLINE CGSize ASDecodedImagePixelSize(CGSize boundsSize, CGFloat scale)
+{
+  if (boundsSize.width <= 0 || boundsSize.height <= 0 || scale <= 0) {
+    return CGSizeZero;
+  }
+  return CGSizeMake(ASDecodedImagePixelBucket(ceil(boundsSize.width * scale)),
+                    ASDecodedImagePixelBucket(ceil(boundsSize.height * scale)));
+}
+
+/**
+ * Whether @c image, decoded for @c pixelSize, has fewer pixels than that size needs. Images are only ever decoded
+ * smaller than their source, so it then holds every pixel of its source, and decoding for a larger size won't help.
+ */
+ASDK_EXTERN BOOL ASDecodedImageIsFullSize(NSImage *image, CGSize pixelSize);
+
+/**
+ * Decodes the image in @c data now, rather than when it is first drawn, no larger than needed to fill @c pixelSize.
+ * Pass CGSizeZero to decode at full size. The image has the point size of the full image. Does not use the cache.
+ */
+ASDK_EXTERN NSImage * _Nullable ASDecodedImageCreate(NSData *data, CGSize pixelSize);
+
+/**
+ * @abstract A process-wide cache of decoded images, keyed by URL and the pixel size they were decoded for.
+ *
+ * @discussion Images are decoded no larger than needed to fill the pixel size, so no full-resolution bitmap is kept.
+ * A decoded image keeps the point size of the original, so it lays out the same and only draws with fewer pixels.
+ * Least recently used images are evicted to stay under @c byteLimit, and everything is evicted on memory pressure.
+ * The cache is split into four shards, each with its own lock and a quarter of @c byteLimit. An image over a quarter
+ * of @c byteLimit is decoded but not cached.
+ *
+ * @c ASBasicImageDownloader decodes downloads straight into the shared cache, and @c ASNetworkImageNode and
+ * @c ASMultiplexImageNode look images up here before loading them again.
+ */
+@interface ASDecodedImageCache : NSObject
+
+@property (class, readonly) ASDecodedImageCache *sharedCache;
++ (ASDecodedImageCache *)sharedCache NS_RETURNS_RETAINED;
+
+/**
+ * The memory, in bytes, that the decoded bitmaps may hold. Defaults to 64 MB.
+ */
+@property NSUInteger byteLimit;
+
+@property (readonly) ASDecodedImageCacheMetrics metrics;
+
+/**
+ * Returns the image decoded for the URL at the pixel size, if it is cached.
+ */
+- (nullable NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize;
+
+/**
+ * Returns the image decoded for the URL at the pixel size, decoding it from encoded data if it is not cached.
+ * Data that ImageIO cannot decode at a size, such as PDF or EPS, is read by NSImage instead and not cached. Returns nil
+ * if NSImage cannot read it either.
+ */
+- (nullable NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize decodingData:(NSData *)data;
+
+/**
+ * Returns the image decoded for the URL at the pixel size, drawing a smaller copy of @c image if it is not cached.
+ * For images that arrive already decoded, e.g. from another downloader.
+ */
+- (NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize downsamplingImage:(NSImage *)image;
+
+- (void)removeAllImages;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
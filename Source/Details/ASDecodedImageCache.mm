@@ -0,0 +1,275 @@
+//
+//  ASDecodedImageCache.mm
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import "ASDecodedImageCache.h"
+
+#import <ImageIO/ImageIO.h>
+#import <memory>
+
+#import "ASHashing.h"
+#import "ASLRUCache.h"
+#import "ASMemoryPressure.h"
+
+namespace {
+
+struct ASDecodedImageKey {
+  NSURL *URL;
+  CGSize pixelSize;
+
+  bool operator==(const ASDecodedImageKey &other) const
+  {
+    return CGSizeEqualToSize(pixelSize, other.pixelSize) && [URL isEqual:other.URL];
+  }
+
+  struct Hash {
+    size_t operator()(const ASDecodedImageKey &key) const
+    {
+      ASHashState state = ASHashStateMake(key.URL.hash);
+      ASHashCombineSize(&state, key.pixelSize);
+      return ASHashStateFinish(state);
+    }
+  };
+};
+
+} // namespace
+
+/**
+ * The factor, at most 1, by which an image of @c imageSize pixels must be scaled to cover @c pixelSize. Covering
+ * leaves enough pixels for every scaling content mode, including aspect fill.
+ */
+static CGFloat ASDecodedImageScale(CGSize imageSize, CGSize pixelSize)
+{
+  if (imageSize.width <= 0 || imageSize.height <= 0) {
+    return 1;
+  }
+  return MIN(1, MAX(pixelSize.width / imageSize.width, pixelSize.height / imageSize.height));
+}
+
+static size_t ASDecodedImageCost(CGImageRef image)
+{
+  return CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+}
+
+/**
+ * Decodes the first image in @c data no larger than needed to cover @c pixelSize, or at full size if it is
+ * CGSizeZero. @c pointSize receives the size NSImage would have given the full image.
+ */
+static CGImageRef ASDecodedImageCreateCGImage(NSData *data, CGSize pixelSize, NSSize *pointSize) CF_RETURNS_RETAINED
+{
+  CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+  if (source == NULL) {
+    return NULL;
+  }
+
+  NSDictionary *properties = (__bridge_transfer NSDictionary *)CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+  CGSize imageSize = CGSizeMake([properties[(id)kCGImagePropertyPixelWidth] doubleValue],
+                                [properties[(id)kCGImagePropertyPixelHeight] doubleValue]);
+  CGSize dpi = CGSizeMake([properties[(id)kCGImagePropertyDPIWidth] doubleValue],
+                          [properties[(id)kCGImagePropertyDPIHeight] doubleValue]);
+  // Orientations 5 through 8 are rotated by 90 degrees, and the thumbnail is created with the rotation applied.
+  if ([properties[(id)kCGImagePropertyOrientation] integerValue] >= 5) {
+    imageSize = CGSizeMake(imageSize.height, imageSize.width);
+    dpi = CGSizeMake(dpi.height, dpi.width);
+  }
+
+  // ImageIO decodes straight to the thumbnail size, without a full-resolution bitmap in between.
+  NSMutableDictionary *options = [@{
+    (id)kCGImageSourceCreateThumbnailFromImageAlways : @YES,
+    (id)kCGImageSourceCreateThumbnailWithTransform : @YES,
+    (id)kCGImageSourceShouldCacheImmediately : @YES,
+  } mutableCopy];
+  if (imageSize.width > 0 && imageSize.height > 0 && pixelSize.width > 0 && pixelSize.height > 0) {
+    const CGFloat scale = ASDecodedImageScale(imageSize, pixelSize);
+    options[(id)kCGImageSourceThumbnailMaxPixelSize] = @(ceil(MAX(imageSize.width, imageSize.height) * scale));
+  }
+  CGImageRef decodedImage = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+  CFRelease(source);
+  if (decodedImage == NULL) {
+    return NULL;
+  }
+
+  // Keep the point size NSImage would have given the full image, so that layout does not change.
+  if (imageSize.width <= 0 || imageSize.height <= 0) {
+    imageSize = CGSizeMake(CGImageGetWidth(decodedImage), CGImageGetHeight(decodedImage));
+  }
+  *pointSize = NSMakeSize(dpi.width > 0 ? imageSize.width * 72 / dpi.width : imageSize.width,
+                         dpi.height > 0 ? imageSize.height * 72 / dpi.height : imageSize.height);
+  return decodedImage;
+}
+
+/**
+ * Decodes @c data as ASDecodedImageCreate does. @c cost receives the bytes of the decoded bitmap, or 0 if the image was
+ * left to NSImage.
+ */
+static NSImage *ASDecodedImageCreateWithCost(NSData *data, CGSize pixelSize, size_t *cost)
+{
+  NSSize pointSize;
+  CGImageRef decodedImage = ASDecodedImageCreateCGImage(data, pixelSize, &pointSize);
+  if (decodedImage == NULL) {
+    // ImageIO cannot make thumbnails of everything NSImage reads, such as PDF and EPS. Those are left to NSImage, which
+    // draws them at any size, and are not cached.
+    *cost = 0;
+    return [[NSImage alloc] initWithData:data];
+  }
+  NSImage *image = [[NSImage alloc] initWithCGImage:decodedImage size:pointSize];
+  *cost = ASDecodedImageCost(decodedImage);
+  CGImageRelease(decodedImage);
+  return image;
+}
+
+NSImage *ASDecodedImageCreate(NSData *data, CGSize pixelSize)
+{
+  size_t cost;
+  return ASDecodedImageCreateWithCost(data, pixelSize, &cost);
+}
+
+BOOL ASDecodedImageIsFullSize(NSImage *image, CGSize pixelSize)
+{
+  CGImageRef decodedImage = [image CGImageForProposedRect:NULL context:nil hints:nil];
+  if (decodedImage == NULL) {
+    return NO;
+  }
+  // Allow a pixel for the rounding of the side that did not decide the scale.
+  return CGImageGetWidth(decodedImage) + 1 < pixelSize.width || CGImageGetHeight(decodedImage) + 1 < pixelSize.height;
+}
+
+@implementation ASDecodedImageCache
+{
+  std::unique_ptr<AS::LRUCache<ASDecodedImageKey, NSImage *, ASDecodedImageKey::Hash>> _cache;
+}
+
++ (ASDecodedImageCache *)sharedCache
+{
+  static ASDecodedImageCache *sharedCache = nil;
+  static dispatch_once_t once = 0;
+  dispatch_once(&once, ^{
+    sharedCache = [[ASDecodedImageCache alloc] _init];
+  });
+  return sharedCache;
+}
+
+- (instancetype)_init
+{
+  if (!(self = [super init])) {
+    return nil;
+  }
+
+  // Fewer shards than the text caches, so that a quarter of the limit still holds a 2048 by 2048 pixel bitmap.
+  _cache.reset(new AS::LRUCache<ASDecodedImageKey, NSImage *, ASDecodedImageKey::Hash>(64 * 1024 * 1024, 4));
+
+  __weak __typeof__(self) weakSelf = self;
+  ASAddMemoryPressureHandler(^{
+    [weakSelf removeAllImages];
+  });
+  return self;
+}
+
+#pragma mark Limits and metrics.
+
+- (NSUInteger)byteLimit
+{
+  return _cache->costLimit();
+}
+
+- (void)setByteLimit:(NSUInteger)byteLimit
+{
+  _cache->setCostLimit(byteLimit);
+}
+
+- (ASDecodedImageCacheMetrics)metrics
+{
+  const auto metrics = _cache->metrics();
+  return {
+    .hitCount = metrics.hitCount,
+    .missCount = metrics.missCount,
+    .evictionCount = metrics.evictionCount,
+    .entryCount = metrics.entryCount,
+    .byteCount = metrics.cost,
+  };
+}
+
+#pragma mark Lookup and decoding.
+
+- (NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize
+{
+  NSImage *image = nil;
+  _cache->find({URL, pixelSize}, image);
+  return image;
+}
+
+- (NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize decodingData:(NSData *)data
+{
+  if (NSImage *image = [self imageForURL:URL pixelSize:pixelSize]) {
+    return image;
+  }
+
+  size_t cost;
+  NSImage *image = ASDecodedImageCreateWithCost(data, pixelSize, &cost);
+  if (image == nil || cost == 0) {
+    return image;
+  }
+  return [self _storeImage:image cost:cost forKey:{[URL copy], pixelSize}];
+}
+
+- (NSImage *)imageForURL:(NSURL *)URL pixelSize:(CGSize)pixelSize downsamplingImage:(NSImage *)image
+{
+  if (NSImage *cachedImage = [self imageForURL:URL pixelSize:pixelSize]) {
+    return cachedImage;
+  }
+
+  CGImageRef sourceImage = [image CGImageForProposedRect:NULL context:nil hints:nil];
+  if (sourceImage == NULL) {
+    return image;
+  }
+
+  const CGSize sourceSize = CGSizeMake(CGImageGetWidth(sourceImage), CGImageGetHeight(sourceImage));
+  const CGFloat scale = ASDecodedImageScale(sourceSize, pixelSize);
+  if (scale >= 1) {
+    return [self _storeImage:image cost:ASDecodedImageCost(sourceImage) forKey:{[URL copy], pixelSize}];
+  }
+
+  const size_t width = MAX(1, (size_t)ceil(sourceSize.width * scale));
+  const size_t height = MAX(1, (size_t)ceil(sourceSize.height * scale));
+  CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+  CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+  CGColorSpaceRelease(colorSpace);
+  if (context == NULL) {
+    return image;
+  }
+  CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+  CGContextDrawImage(context, CGRectMake(0, 0, width, height), sourceImage);
+  CGImageRef downsampledImage = CGBitmapContextCreateImage(context);
+  CGContextRelease(context);
+  if (downsampledImage == NULL) {
+    return image;
+  }
+
+  NSImage *result = [[NSImage alloc] initWithCGImage:downsampledImage size:image.size];
+  const size_t cost = ASDecodedImageCost(downsampledImage);
+  CGImageRelease(downsampledImage);
+
+  return [self _storeImage:result cost:cost forKey:{[URL copy], pixelSize}];
+}
+
+- (void)removeAllImages
+{
+  _cache->removeAll();
+}
+
+#pragma mark Storage.
+
+/**
+ * Stores the image unless another thread stored one for the key first. Returns the image now in the cache, or
+ * @c image uncached if it alone is over the byte limit.
+ */
+- (NSImage *)_storeImage:(NSImage *)image cost:(size_t)cost forKey:(const ASDecodedImageKey &)key
+{
+  return _cache->insert(key, image, cost);
+}
+
+@end
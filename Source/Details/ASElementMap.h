@@ -68,6 +68,13 @@ AS_SUBCLASSING_RESTRICTED
  */
 - (nullable NSIndexPath *)convertIndexPath:(NSIndexPath *)indexPath fromMap:(ASElementMap *)map;
 
+/**
+ * Converts many index paths at once, as -convertIndexPath:fromMap: does. Index paths with no
+ * counterpart in the receiver are omitted. Only section index paths are batched: they share a
+ * single fast O(N) pass over the sections. Each item is still looked up by its element, O(1).
+ */
+- (NSArray<NSIndexPath *> *)convertIndexPaths:(NSArray<NSIndexPath *> *)indexPaths fromMap:(ASElementMap *)map;
+
 /**
  * Returns the section index into the receiver that corresponds to the same element in @c map at @c sectionIndex. Fast O(N).
  *
@@ -9,8 +9,13 @@
 
 #import "ASElementMap.h"
 #import <AppKit/AppKit.h>
+#import <algorithm>
+#import <unordered_map>
+#import <vector>
 #import "ASCollectionElement.h"
-#import "ASTwoDimensionalArrayUtils.h"
+#import "ASCollections.h"
+#import "ASElementMapStorage.h"
+#import "ASIntegerMap.h"
 #import "ASMutableElementMap.h"
 #import "ASSection.h"
 #import "ASObjectDescriptionHelpers.h"
@@ -19,17 +24,21 @@
 
 @property (nonatomic, readonly) NSArray<ASSection *> *sections;
 
-// Element -> IndexPath
-@property (nonatomic, readonly) NSMapTable<ASCollectionElement *, NSIndexPath *> *elementToIndexPathMap;
-
-// The items, in a 2D array
-@property (nonatomic, readonly) ASCollectionElementTwoDimensionalArray *sectionsOfItems;
-
 @property (nonatomic, readonly) ASSupplementaryElementDictionary *supplementaryElements;
 
 @end
 
-@implementation ASElementMap
+@implementation ASElementMap {
+  // The items of each section, shared with the maps this one was derived from where they are the same.
+  ASElementMapSections _itemSections;
+  std::shared_ptr<ASElementLineageTable> _lineages;
+  std::unordered_map<NSInteger, NSInteger> _sectionIndexesByLineage;
+
+  // One per supplementary element kind. Shared with the maps this one was derived from
+  // where the elements of the kind are the same.
+  ASSupplementaryElementIndexes _supplementaryIndexes;
+  NSUInteger _count;
+}
 
 - (instancetype)init
 {
@@ -38,29 +47,58 @@
 
 - (instancetype)initWithSections:(NSArray<ASSection *> *)sections items:(ASCollectionElementTwoDimensionalArray *)items supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
 {
-  NSCParameterAssert(items.count == sections.count);
+  ASElementMapSections itemSections;
+  itemSections.reserve(items.count);
+  auto lineages = std::make_shared<ASElementLineageTable>();
+  for (NSArray<ASCollectionElement *> *itemsInSection in items) {
+    auto section = ASElementMapSection::make();
+    section->items.reserve(itemsInSection.count);
+    for (ASCollectionElement *element in itemsInSection) {
+      section->items.push_back(element);
+    }
+    section->index();
+    lineages->addSection(*section);
+    itemSections.push_back(section);
+  }
+  return [self initWithSections:sections itemSections:itemSections lineages:lineages supplementaryElements:supplementaryElements supplementaryIndexes:ASSupplementaryElementIndexes()];
+}
+
+- (instancetype)initWithSections:(NSArray<ASSection *> *)sections
+                    itemSections:(const ASElementMapSections &)itemSections
+                        lineages:(const std::shared_ptr<ASElementLineageTable> &)lineages
+           supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
+            supplementaryIndexes:(const ASSupplementaryElementIndexes &)supplementaryIndexes
+{
+  NSCParameterAssert(itemSections.size() == sections.count);
 
   if (self = [super init]) {
     _sections = [sections copy];
-    _sectionsOfItems = [[NSArray alloc] initWithArray:items copyItems:YES];
+    _itemSections = itemSections;
+    _lineages = lineages;
+    // The dictionaries of kinds that did not change are immutable, and copying them is free.
     _supplementaryElements = [[NSDictionary alloc] initWithDictionary:supplementaryElements copyItems:YES];
 
-    // Setup our index path map
-    _elementToIndexPathMap = [NSMapTable mapTableWithKeyOptions:(NSMapTableStrongMemory | NSMapTableObjectPointerPersonality) valueOptions:NSMapTableCopyIn];
+    _sectionIndexesByLineage.reserve(_itemSections.size());
     NSInteger s = 0;
-    for (NSArray *section in _sectionsOfItems) {
-      NSInteger i = 0;
-      for (ASCollectionElement *element in section) {
-        NSIndexPath *indexPath = [NSIndexPath indexPathForItem:i inSection:s];
-        [_elementToIndexPathMap setObject:indexPath forKey:element];
-        i++;
-      }
-      s++;
+    for (const auto &section : _itemSections) {
+      ASDisplayNodeAssert(section->isIndexed, @"Sections must be indexed before they are shared.");
+      _sectionIndexesByLineage[section->lineage] = s++;
+      _count += section->items.size();
     }
-    for (NSDictionary *supplementariesForKind in [_supplementaryElements objectEnumerator]) {
-      [supplementariesForKind enumerateKeysAndObjectsUsingBlock:^(NSIndexPath *_Nonnull indexPath, ASCollectionElement * _Nonnull element, BOOL * _Nonnull stop) {
-        [_elementToIndexPathMap setObject:indexPath forKey:element];
-      }];
+
+    // Reuse the index of each kind whose elements are unchanged, and leave building the others to their first use.
+    _supplementaryIndexes.reserve(_supplementaryElements.count);
+    for (NSString *kind in _supplementaryElements) {
+      NSDictionary<NSIndexPath *, ASCollectionElement *> *supplementariesForKind = _supplementaryElements[kind];
+      const auto existing = std::find_if(supplementaryIndexes.begin(), supplementaryIndexes.end(), [&](const std::shared_ptr<ASSupplementaryElementIndex> &index) {
+        return index->elements() == supplementariesForKind;
+      });
+      if (existing != supplementaryIndexes.end()) {
+        _supplementaryIndexes.push_back(*existing);
+      } else {
+        _supplementaryIndexes.push_back(std::make_shared<ASSupplementaryElementIndex>(kind, supplementariesForKind));
+      }
+      _count += supplementariesForKind.count;
     }
   }
   return self;
@@ -68,22 +106,37 @@
 
 - (NSUInteger)count
 {
-  return _elementToIndexPathMap.count;
+  return _count;
 }
 
 - (NSArray<NSIndexPath *> *)itemIndexPaths
 {
-  return ASIndexPathsForTwoDimensionalArray(_sectionsOfItems);
+  NSMutableArray<NSIndexPath *> *result = [[NSMutableArray alloc] init];
+  NSInteger s = 0;
+  for (const auto &section : _itemSections) {
+    const NSInteger itemCount = section->items.size();
+    for (NSInteger i = 0; i < itemCount; i++) {
+      [result addObject:[NSIndexPath indexPathForItem:i inSection:s]];
+    }
+    s++;
+  }
+  return result;
 }
 
 - (NSArray<ASCollectionElement *> *)itemElements
 {
-  return ASElementsInTwoDimensionalArray(_sectionsOfItems);
+  NSMutableArray<ASCollectionElement *> *result = [[NSMutableArray alloc] init];
+  for (const auto &section : _itemSections) {
+    for (ASCollectionElement *element : section->items) {
+      [result addObject:element];
+    }
+  }
+  return result;
 }
 
 - (NSInteger)numberOfSections
 {
-  return _sectionsOfItems.count;
+  return _itemSections.size();
 }
 
 - (NSArray<NSString *> *)supplementaryElementKinds
@@ -97,7 +150,7 @@
     return 0;
   }
 
-  return _sectionsOfItems[section].count;
+  return _itemSections[section]->items.size();
 }
 
 - (id<ASSectionContext>)contextForSection:(NSInteger)section
@@ -111,7 +164,30 @@
 
 - (nullable NSIndexPath *)indexPathForElement:(ASCollectionElement *)element
 {
-  return element ? [_elementToIndexPathMap objectForKey:element] : nil;
+  if (element == nil) {
+    return nil;
+  }
+  NSString *kind = element.supplementaryElementKind;
+  if (kind != nil) {
+    for (const auto &index : _supplementaryIndexes) {
+      if ([index->kind() isEqualToString:kind]) {
+        return index->indexPathForElement(element);
+      }
+    }
+    return nil;
+  }
+
+  // The lineage finds the section, and the section confirms the item is still there.
+  const NSInteger lineage = _lineages->lineageForElement(element);
+  if (lineage == NSNotFound) {
+    return nil;
+  }
+  const auto sectionIndex = _sectionIndexesByLineage.find(lineage);
+  if (sectionIndex == _sectionIndexesByLineage.end()) {
+    return nil;
+  }
+  const NSInteger item = _itemSections[sectionIndex->second]->itemIndexes.find(element);
+  return (item != NSNotFound ? [NSIndexPath indexPathForItem:item inSection:sectionIndex->second] : nil);
 }
 
 - (nullable NSIndexPath *)indexPathForElementIfCell:(ASCollectionElement *)element
@@ -130,7 +206,7 @@
     return nil;
   }
 
-  return _sectionsOfItems[section][item];
+  return _itemSections[section]->items[item];
 }
 
 - (nullable ASCollectionElement *)supplementaryElementOfKind:(NSString *)supplementaryElementKind atIndexPath:(NSIndexPath *)indexPath
@@ -168,6 +244,63 @@
   }
 }
 
+- (NSArray<NSIndexPath *> *)convertIndexPaths:(NSArray<NSIndexPath *> *)indexPaths fromMap:(ASElementMap *)map
+{
+  // Look up all section index paths together, rather than searching our sections once for each. Items can move
+  // within their sections, so they are found by element one at a time.
+  std::vector<NSInteger> sections;
+  for (NSIndexPath *indexPath in indexPaths) {
+    if (indexPath.item == NSNotFound) {
+      sections.push_back(indexPath.section);
+    }
+  }
+  if (!sections.empty()) {
+    [[self sectionMappingFromMap:map] getIntegers:sections.data() forKeys:sections.data() count:sections.size()];
+  }
+
+  NSUInteger count = indexPaths.count;
+  id buffer[count];
+  NSUInteger i = 0;
+  auto section = sections.cbegin();
+  for (NSIndexPath *indexPath in indexPaths) {
+    NSIndexPath *result;
+    if (indexPath.item == NSNotFound) {
+      const NSInteger newSection = *section++;
+      result = (newSection != NSNotFound ? [NSIndexPath indexPathWithIndex:newSection] : nil);
+    } else {
+      result = [self indexPathForElement:[map elementForItemAtIndexPath:indexPath]];
+    }
+    if ((buffer[i] = result)) {
+      i++;
+    }
+  }
+  return [NSArray arrayByTransferring:buffer count:i];
+}
+
+/**
+ * Maps each section index in @c map to the index of the same section in the receiver. O(N)
+ */
+- (ASIntegerMap *)sectionMappingFromMap:(ASElementMap *)map
+{
+  std::unordered_map<void *, NSInteger> indexesBySection;
+  indexesBySection.reserve(_sections.count);
+  NSInteger index = 0;
+  for (ASSection *section in _sections) {
+    indexesBySection.emplace((__bridge void *)section, index++);
+  }
+
+  ASIntegerMap *mapping = [[ASIntegerMap alloc] init];
+  index = 0;
+  for (ASSection *section in map.sections) {
+    const auto it = indexesBySection.find((__bridge void *)section);
+    if (it != indexesBySection.end()) {
+      [mapping setInteger:it->second forKey:index];
+    }
+    index++;
+  }
+  return mapping;
+}
+
 - (NSInteger)convertSection:(NSInteger)sectionIndex fromMap:(ASElementMap *)map
 {
   if (![map sectionIndexIsValid:sectionIndex assert:YES]) {
@@ -190,14 +323,51 @@
 
 - (id)mutableCopyWithZone:(NSZone *)zone
 {
-  return [[ASMutableElementMap alloc] initWithSections:_sections items:_sectionsOfItems supplementaryElements:_supplementaryElements];
+  return [[ASMutableElementMap alloc] initWithSections:_sections itemSections:_itemSections lineages:_lineages supplementaryElements:_supplementaryElements supplementaryIndexes:_supplementaryIndexes];
 }
 
 #pragma mark - NSFastEnumeration
 
 - (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id  _Nullable unowned [])buffer count:(NSUInteger)len
 {
-  return [_elementToIndexPathMap countByEnumeratingWithState:state objects:buffer count:len];
+  // Items section by section, then supplementary elements kind by kind. extra[0] and extra[1] are the section and the
+  // item to continue from, and past the last section extra[3] is the kind and extra[1] counts its elements.
+  if (state->state == 0) {
+    state->state = 1;
+    state->mutationsPtr = &state->extra[2];
+    state->extra[0] = 0;
+    state->extra[1] = 0;
+    state->extra[3] = 0;
+  }
+  unsigned long &section = state->extra[0];
+  unsigned long &item = state->extra[1];
+  unsigned long &kind = state->extra[3];
+
+  NSUInteger count = 0;
+  const size_t sectionCount = _itemSections.size();
+  while (count < len && section < sectionCount) {
+    const auto &items = _itemSections[section]->items;
+    while (count < len && item < items.size()) {
+      buffer[count++] = items[item++];
+    }
+    if (item == items.size()) {
+      section++;
+      item = 0;
+    }
+  }
+  while (count < len && section == sectionCount && kind < _supplementaryIndexes.size()) {
+    NSArray<ASCollectionElement *> *supplementaryElements = _supplementaryIndexes[kind]->allElements();
+    const NSUInteger supplementaryCount = supplementaryElements.count;
+    while (count < len && item < supplementaryCount) {
+      buffer[count++] = supplementaryElements[item++];
+    }
+    if (item == supplementaryCount) {
+      kind++;
+      item = 0;
+    }
+  }
+  state->itemsPtr = buffer;
+  return count;
 }
 
 - (NSString *)smallDescription
@@ -205,8 +375,8 @@
   NSMutableArray *sectionDescriptions = [NSMutableArray array];
 
   NSUInteger i = 0;
-  for (NSArray *section in _sectionsOfItems) {
-    [sectionDescriptions addObject:[NSString stringWithFormat:@"<S%tu: %tu>", i, section.count]];
+  for (const auto &section : _itemSections) {
+    [sectionDescriptions addObject:[NSString stringWithFormat:@"<S%tu: %tu>", i, section->items.size()]];
     i++;
   }
   return ASObjectDescriptionMakeWithoutObject(@[ @{ @"itemCounts": sectionDescriptions }]);
@@ -222,7 +392,15 @@
 - (NSMutableArray<NSDictionary *> *)propertiesForDescription
 {
   NSMutableArray *result = [NSMutableArray array];
-  [result addObject:@{ @"items" : _sectionsOfItems }];
+  NSMutableArray<NSArray<ASCollectionElement *> *> *items = [NSMutableArray array];
+  for (const auto &section : _itemSections) {
+    NSMutableArray<ASCollectionElement *> *itemsInSection = [NSMutableArray array];
+    for (ASCollectionElement *element : section->items) {
+      [itemsInSection addObject:element];
+    }
+    [items addObject:itemsInSection];
+  }
+  [result addObject:@{ @"items" : items }];
   [result addObject:@{ @"supplementaryElements" : _supplementaryElements }];
   return result;
 }
@@ -234,7 +412,7 @@
  */
 - (BOOL)sectionIndexIsValid:(NSInteger)section assert:(BOOL)assert
 {
-  NSInteger sectionCount = _sectionsOfItems.count;
+  NSInteger sectionCount = _itemSections.size();
   if (section >= sectionCount || section < 0) {
     if (assert) {
       ASDisplayNodeFailAssert(@"Invalid section index %ld when there are only %ld sections!", (long)section, (long)sectionCount);
@@ -261,7 +439,7 @@
     return NO;
   }
 
-  NSInteger itemCount = _sectionsOfItems[section].count;
+  NSInteger itemCount = _itemSections[section]->items.size();
   NSInteger item = indexPath.item;
   if (item >= itemCount || item < 0) {
     if (assert) {
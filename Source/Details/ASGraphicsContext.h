@@ -36,7 +36,8 @@ ASDK_EXTERN NSImage *ASGraphicsCreateImageWithOptions(CGSize size, BOOL opaque,
 *
 * @param traitCollection Trait collection. The `work` block will be executed with this trait collection, so it will affect dynamic colors, etc.
 * @param size The size of the context.
-* @param opaque Whether the context should be opaque or not.
+* @param opaque Whether the context should be opaque or not. An opaque context is not cleared first, so @c work must
+*   fill all of it.
 * @param scale The scale of the context. 0 uses main screen scale.
 * @param sourceImage If you are planning to render a NSImage into this context, provide it here and we will use its
 *   preferred renderer format if we are using UIGraphicsImageRenderer.
@@ -52,7 +53,8 @@ ASDK_EXTERN NSImage *ASGraphicsCreateImage(ASPrimitiveTraitCollection traitColle
 *
 * @param traitCollection Trait collection. The `work` block will be executed with this trait collection, so it will affect dynamic colors, etc.
 * @param size The size of the context.
-* @param opaque Whether the context should be opaque or not.
+* @param opaque Whether the context should be opaque or not. An opaque context is not cleared first, so @c work must
+*   fill all of it.
 * @param scale The scale of the context. 0 uses main screen scale.
 * @param sourceImage If you are planning to render a NSImage into this context, provide it here and we will use its
 *   preferred renderer format if we are using UIGraphicsImageRenderer.
@@ -62,4 +64,29 @@ ASDK_EXTERN NSImage *ASGraphicsCreateImage(ASPrimitiveTraitCollection traitColle
 */
 ASDK_EXTERN NSImage *ASGraphicsCreateImageWithTraitCollectionAndOptions(ASPrimitiveTraitCollection traitCollection, CGSize size, BOOL opaque, CGFloat scale, NSImage * _Nullable sourceImage, void (NS_NOESCAPE ^work)(void)) ASDISPLAYNODE_DEPRECATED_MSG("Use ASGraphicsCreateImage instead");
 
+/**
+ * Counters of the pool of bitmap buffers that ASGraphicsCreateImage draws into.
+ */
+typedef struct {
+  /// Buffers allocated because none of the size needed was idle. Divide by the number of images drawn to get the
+  /// allocations per display pass.
+  uint64_t allocationCount;
+  /// Buffers reused from the pool.
+  uint64_t reuseCount;
+  /// The memory held by idle buffers, in bytes.
+  NSUInteger idleByteCount;
+  NSUInteger byteLimit;
+} ASGraphicsBufferPoolMetrics;
+
+/**
+ * ASGraphicsCreateImage draws into pooled buffers. An image keeps its buffer until it is released, when the buffer
+ * returns to the pool for the next image of a similar size. Idle buffers are freed on memory pressure.
+ */
+ASDK_EXTERN ASGraphicsBufferPoolMetrics ASGraphicsGetBufferPoolMetrics(void);
+
+/**
+ * Sets the memory, in bytes, that idle buffers may hold. Defaults to 32 MB.
+ */
+ASDK_EXTERN void ASGraphicsSetBufferPoolByteLimit(NSUInteger byteLimit);
+
 NS_ASSUME_NONNULL_END
@@ -11,6 +11,8 @@
 #import "ASConfigurationInternal.h"
 #import "ASInternalHelpers.h"
 #import "ASAvailability.h"
+#import "ASBufferPool.h"
+#import "ASMemoryPressure.h"
 
 #import <AppKit/AppKit.h>
 #import <objc/runtime.h>
@@ -50,6 +52,106 @@ BOOL ASActivateExperimentalFeature(int feature) {
 }
 #define ASExperimentalDrawingGlobal 0
 
+#pragma mark - Buffer Pool
+
+static AS::BufferPool &ASGraphicsBufferPool()
+{
+  static AS::BufferPool *pool = [] {
+    AS::BufferPool *created = new AS::BufferPool(32 * 1024 * 1024);
+    ASAddMemoryPressureHandler(^{
+      created->removeAllBuffers();
+    });
+    return created;
+  }();
+  return *pool;
+}
+
+static void ASGraphicsBufferRelease(void *info, const void *data, size_t size)
+{
+  ASGraphicsBufferPool().giveBack(const_cast<void *>(data), (size_t)(uintptr_t)info);
+}
+
+static CGColorSpaceRef ASGraphicsColorSpace()
+{
+  static CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+  return colorSpace;
+}
+
+ASGraphicsBufferPoolMetrics ASGraphicsGetBufferPoolMetrics(void)
+{
+  const AS::BufferPool::Metrics metrics = ASGraphicsBufferPool().metrics();
+  return {
+    .allocationCount = metrics.allocationCount,
+    .reuseCount = metrics.reuseCount,
+    .idleByteCount = metrics.idleByteCount,
+    .byteLimit = metrics.byteLimit,
+  };
+}
+
+void ASGraphicsSetBufferPoolByteLimit(NSUInteger byteLimit)
+{
+  ASGraphicsBufferPool().setByteLimit(byteLimit);
+}
+
+/**
+ * Runs @c work in a bitmap context drawn into a pooled buffer. The returned image takes the buffer, which goes back
+ * to the pool when the image is released.
+ */
+static NSImage *ASGraphicsCreatePooledImage(ASPrimitiveTraitCollection traitCollection, CGSize size, BOOL opaque, CGFloat scale, asdisplaynode_iscancelled_block_t NS_NOESCAPE isCancelled, void (NS_NOESCAPE ^work)())
+{
+  const CGFloat pixelScale = (scale > 0 ? scale : ASScreenScale());
+  const size_t width = (size_t)ceil(size.width * pixelScale);
+  const size_t height = (size_t)ceil(size.height * pixelScale);
+  // Rows aligned to 64 bytes, as Core Animation prefers.
+  const size_t bytesPerRow = ((width * 4) + 63) & ~(size_t)63;
+  const size_t byteCount = bytesPerRow * height;
+  const size_t capacity = AS::BufferPool::sizeClass(byteCount);
+  const CGBitmapInfo bitmapInfo = (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst) | kCGBitmapByteOrder32Host;
+
+  AS::BufferPool &pool = ASGraphicsBufferPool();
+  void *buffer = pool.borrow(capacity);
+  if (buffer == NULL) {
+    return nil;
+  }
+
+  CGContextRef context = CGBitmapContextCreate(buffer, width, height, 8, bytesPerRow, ASGraphicsColorSpace(), bitmapInfo);
+  if (context == NULL) {
+    pool.giveBack(buffer, capacity);
+    return nil;
+  }
+  // A buffer holds whatever was drawn in it before. Whoever asks for an opaque context draws every pixel of it.
+  if (!opaque) {
+    CGContextClearRect(context, CGRectMake(0, 0, width, height));
+  }
+  CGContextScaleCTM(context, pixelScale, pixelScale);
+
+  if (work) {
+    [NSGraphicsContext saveGraphicsState];
+    [NSGraphicsContext setCurrentContext:[NSGraphicsContext graphicsContextWithCGContext:context flipped:NO]];
+    ASPerformBlockWithAppearance(work, ASPrimitiveTraitCollectionToNSAppearance(traitCollection));
+    [NSGraphicsContext restoreGraphicsState];
+  }
+  CGContextRelease(context);
+
+  if (isCancelled && isCancelled()) {
+    pool.giveBack(buffer, capacity);
+    return nil;
+  }
+
+  // Hand the buffer to the image rather than copying it out.
+  CGDataProviderRef provider = CGDataProviderCreateWithData((void *)(uintptr_t)capacity, buffer, byteCount, ASGraphicsBufferRelease);
+  CGImageRef cgImage = CGImageCreate(width, height, 8, 32, bytesPerRow, ASGraphicsColorSpace(), bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+  CGDataProviderRelease(provider);
+  if (cgImage == NULL) {
+    return nil;
+  }
+  NSImage *image = [[NSImage alloc] initWithCGImage:cgImage size:size];
+  CGImageRelease(cgImage);
+  return image;
+}
+
+#pragma mark - Image Creation
+
 NSImage *ASGraphicsCreateImageWithOptions(CGSize size, BOOL opaque, CGFloat scale, NSImage *sourceImage,
                                           asdisplaynode_iscancelled_block_t NS_NOESCAPE isCancelled,
                                           void (^NS_NOESCAPE work)())
@@ -92,24 +194,7 @@ NSImage *ASGraphicsCreateImage(ASPrimitiveTraitCollection traitCollection, CGSiz
         return image;
     }
 
-    // "Плохая" ОС или флаг эксперимента. Используем NSImage и NSGraphicsContext напрямую.
-    NSImage *image = [[NSImage alloc] initWithSize:size];
-    [image lockFocus];
-    
-    NSGraphicsContext *nsContext = [NSGraphicsContext currentContext];
-    CGContextRef context = [nsContext CGContext];
-    
-    if (context && work) {
-        ASPerformBlockWithAppearance(work, ASPrimitiveTraitCollectionToNSAppearance(traitCollection));
-    }
-    
-    [image unlockFocus];
-    
-    if (isCancelled && isCancelled()) {
-        return nil;
-    }
-    
-    return image;
+    return ASGraphicsCreatePooledImage(traitCollection, size, opaque, scale, isCancelled, work);
 }
 
 NSImage *ASGraphicsCreateImageWithTraitCollectionAndOptions(ASPrimitiveTraitCollection traitCollection, CGSize size, BOOL opaque, CGFloat scale, NSImage * sourceImage, void (NS_NOESCAPE ^work)()) {
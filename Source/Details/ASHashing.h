@@ -8,13 +8,14 @@
 
 #import <Foundation/Foundation.h>
 #import "ASBaseDefines.h"
+#import "ASHashingCore.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
 /**
  * When std::hash is unavailable, this function will hash a bucket o' bits real fast.
- * The hashing algorithm is copied from CoreFoundation's private function CFHashBytes.
- * https://opensource.apple.com/source/CF/CF-1153.18/CFUtilities.c.auto.html
+ * It is ASHashBytes64 with a seed of 0, truncated to NSUInteger. ASHashBytes64 and the ASHashState functions for
+ * hashing field by field are in ASHashingCore.h, which this header imports.
  *
  * Simple example:
  *  CGRect myRect = { ... };
@@ -34,7 +35,26 @@ NS_ASSUME_NONNULL_BEGIN
  *   will have garbage data for their padding, which will break this hash! Either
  *   use `pragma clang diagnostic warning "-Wpadded"` around your struct definition
  *   or manually initialize the fields of your struct (`myStruct.x = 7;` etc).
+ *   Hashing field by field with ASHashState avoids the problem altogether.
  */
 ASDK_EXTERN NSUInteger ASHashBytes(void *bytes, size_t length);
 
+ASDISPLAYNODE_INLINE void ASHashCombineSize(ASHashState *state, CGSize size)
+{
+  ASHashCombineFloat(state, size.width);
+  ASHashCombineFloat(state, size.height);
+}
+
+ASDISPLAYNODE_INLINE void ASHashCombineRect(ASHashState *state, CGRect rect)
+{
+  ASHashCombineFloat(state, rect.origin.x);
+  ASHashCombineFloat(state, rect.origin.y);
+  ASHashCombineSize(state, rect.size);
+}
+
+ASDISPLAYNODE_INLINE NSUInteger ASHashStateFinish(ASHashState state)
+{
+  return (NSUInteger)ASHashStateFinish64(state);
+}
+
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,173 @@
+//
+//  ASHashingCore.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ * The hash functions behind ASHashing.h, in plain C. Import ASHashing.h rather than this header.
+ *
+ * This header must stay free of Foundation and Objective-C so that the hashes can be benchmarked and checked for
+ * collisions on their own.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The default secret of wyhash final version 4, https://github.com/wangyi-fudan/wyhash
+static const uint64_t kASHashSecret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+/**
+ * Multiplies @c a by @c b to 128 bits, leaving the low half in @c a and the high half in @c b.
+ */
+static inline void ASHashMultiply(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * Folds the 128-bit product of @c a and @c b into 64 bits. Every step of the hashes below goes through it.
+ */
+static inline uint64_t ASHashMix(uint64_t a, uint64_t b)
+{
+  ASHashMultiply(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t ASHashReadBytes8(const uint8_t *p)
+{
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline uint64_t ASHashReadBytes4(const uint8_t *p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint64_t ASHashReadBytes3(const uint8_t *p, size_t length)
+{
+  return (((uint64_t)p[0]) << 16) | (((uint64_t)p[length >> 1]) << 8) | p[length - 1];
+}
+
+/**
+ * A 64-bit hash of a bucket o' bits, in the style of wyhash: eight bytes at a time, with three independent
+ * lanes for long inputs and a full-width multiply to mix. Different seeds give independent hashes.
+ */
+static inline uint64_t ASHashBytes64(const void *bytes, size_t length, uint64_t seed)
+{
+  const uint8_t *p = (const uint8_t *)bytes;
+  seed ^= ASHashMix(seed ^ kASHashSecret[0], kASHashSecret[1]);
+  uint64_t a, b;
+  if (length <= 16) {
+    if (length >= 4) {
+      a = (ASHashReadBytes4(p) << 32) | ASHashReadBytes4(p + ((length >> 3) << 2));
+      b = (ASHashReadBytes4(p + length - 4) << 32) | ASHashReadBytes4(p + length - 4 - ((length >> 3) << 2));
+    } else if (length > 0) {
+      a = ASHashReadBytes3(p, length);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = length;
+    if (i > 48) {
+      // Three independent lanes keep the multipliers busy.
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = ASHashMix(ASHashReadBytes8(p) ^ kASHashSecret[1], ASHashReadBytes8(p + 8) ^ seed);
+        see1 = ASHashMix(ASHashReadBytes8(p + 16) ^ kASHashSecret[2], ASHashReadBytes8(p + 24) ^ see1);
+        see2 = ASHashMix(ASHashReadBytes8(p + 32) ^ kASHashSecret[3], ASHashReadBytes8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = ASHashMix(ASHashReadBytes8(p) ^ kASHashSecret[1], ASHashReadBytes8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = ASHashReadBytes8(p + i - 16);
+    b = ASHashReadBytes8(p + i - 8);
+  }
+  a ^= kASHashSecret[1];
+  b ^= seed;
+  ASHashMultiply(&a, &b);
+  return ASHashMix(a ^ kASHashSecret[0] ^ length, b ^ kASHashSecret[1]);
+}
+
+// Combining
+
+/**
+ * Hashes values one at a time, so a struct can be hashed field by field without hashing its padding.
+ *
+ * Example:
+ *  ASHashState state = ASHashStateMake(0);
+ *  ASHashCombine(&state, _image.hash);
+ *  ASHashCombineSize(&state, _bounds.size);
+ *  return ASHashStateFinish(state);
+ *
+ * Floating-point values are hashed so that values that compare equal hash equally (0.0 and -0.0).
+ */
+typedef struct {
+  uint64_t value;
+} ASHashState;
+
+static inline ASHashState ASHashStateMake(uint64_t seed)
+{
+  ASHashState state;
+  state.value = seed ^ ASHashMix(seed ^ kASHashSecret[0], kASHashSecret[1]);
+  return state;
+}
+
+static inline void ASHashCombine(ASHashState *state, uint64_t value)
+{
+  state->value = ASHashMix(state->value ^ kASHashSecret[2], value ^ kASHashSecret[1]);
+}
+
+static inline void ASHashCombinePointer(ASHashState *state, const void *pointer)
+{
+  ASHashCombine(state, (uintptr_t)pointer);
+}
+
+static inline void ASHashCombineFloat(ASHashState *state, double value)
+{
+  // Fold -0.0 into 0.0 since they compare equal.
+  value = (value == 0 ? 0 : value);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  ASHashCombine(state, bits);
+}
+
+static inline uint64_t ASHashStateFinish64(ASHashState state)
+{
+  return ASHashMix(state.value ^ kASHashSecret[3], kASHashSecret[0]);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -136,6 +136,29 @@ typedef NS_ENUM(NSUInteger, ASImageDownloaderPriority) {
                    downloadProgress:(nullable ASImageDownloaderProgress)downloadProgress
                          completion:(ASImageDownloaderCompletion)completion;
 
+/**
+ @abstract Downloads an image with the given URL, for display at the given size.
+ @param URL The URL of the image to download.
+ @param pixelSize The size in pixels the image will be displayed at, or CGSizeZero if it is not known.
+ @param shouldRetry Whether to attempt to retry downloading if the remote host is currently unreachable.
+ @param priority The priority at which the image should be downloaded.
+ @param callbackQueue The queue to call `downloadProgressBlock` and `completion` on.
+ @param downloadProgress The block to be invoked when the download of `URL` progresses.
+ @param completion The block to be invoked when the download has completed, or has failed.
+ @discussion The downloader may complete with an image decoded no larger than needed to fill `pixelSize`, such as one
+ from `ASDecodedImageCache`.
+ @note If this method is implemented, it will be called instead of the other download methods.
+ @result An opaque identifier to be used in canceling the download, via `cancelImageDownloadForIdentifier:`. You must
+ retain the identifier if you wish to use it later.
+ */
+- (nullable id)downloadImageWithURL:(NSURL *)URL
+                          pixelSize:(CGSize)pixelSize
+                        shouldRetry:(BOOL)shouldRetry
+                           priority:(ASImageDownloaderPriority)priority
+                      callbackQueue:(dispatch_queue_t)callbackQueue
+                   downloadProgress:(nullable ASImageDownloaderProgress)downloadProgress
+                         completion:(ASImageDownloaderCompletion)completion;
+
 /**
  @abstract Cancels an image download, however indicating resume data should be stored in case of redownload.
  @param downloadIdentifier The opaque download identifier object returned from
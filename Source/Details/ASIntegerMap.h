@@ -12,7 +12,10 @@
 NS_ASSUME_NONNULL_BEGIN
 
 /**
- * An objective-C wrapper for unordered_map.
+ * A map from integers to integers, tuned for the dense, monotonic maps produced by array updates.
+ *
+ * Update maps are stored as runs of consecutive keys with consecutive values, or as a flat array
+ * when the runs are short. Maps that are mutated with arbitrary keys fall back to a hash table.
  */
 AS_SUBCLASSING_RESTRICTED
 @interface ASIntegerMap : NSObject <NSCopying>
@@ -50,6 +53,17 @@ AS_SUBCLASSING_RESTRICTED
  */
 - (NSInteger)integerForKey:(NSInteger)key;
 
+/**
+ * Retrieves the integers for many keys at once. Each value is NSNotFound if its key is not found.
+ *
+ * This is equivalent to calling -integerForKey: for each key, without the per-key message send.
+ *
+ * @param values A buffer of at least @c count integers to receive the values.
+ * @param keys The keys to lookup the values for.
+ * @param count The number of keys.
+ */
+- (void)getIntegers:(NSInteger *)values forKeys:(const NSInteger *)keys count:(NSUInteger)count;
+
 /**
  * Sets the value for a given key.
  *
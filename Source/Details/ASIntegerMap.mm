@@ -8,17 +8,51 @@
 
 #import "ASIntegerMap.h"
 #import "ASAssert.h"
+#import <algorithm>
 #import <unordered_map>
+#import <utility>
+#import <vector>
 #import "ASObjectDescriptionHelpers.h"
 
+namespace AS {
+
+/**
+ * Keys [key, key + length) map to values [value, value + length).
+ */
+struct IntegerMapRun {
+  NSInteger key;
+  NSInteger value;
+  NSInteger length;
+};
+
+enum class IntegerMapStorage : uint8_t {
+  Dense,  // _dense[key] is the value for key, or NSNotFound.
+  Runs,   // _runs, sorted by key and non-overlapping.
+  Sparse, // _sparse, for arbitrary keys.
+};
+
 /**
- * This is just a friendly Objective-C interface to unordered_map<NSInteger, NSInteger>
+ * Whether a flat array of @c size entries may grow to hold @c key without wasting most of its space.
+ */
+ASDISPLAYNODE_INLINE bool IntegerMapDenseCanHoldKey(NSInteger key, size_t size)
+{
+  return key >= 0 && (size_t)key < 2 * size + 64;
+}
+
+} // namespace AS
+
+/**
+ * Update maps are dense and made of few runs, so they are stored as runs or as a flat array.
+ * Maps mutated with arbitrary keys fall back to unordered_map<NSInteger, NSInteger>.
  */
 @interface ASIntegerMap () <ASDescriptionProvider>
 @end
 
 @implementation ASIntegerMap {
-  std::unordered_map<NSInteger, NSInteger> _map;
+  AS::IntegerMapStorage _storage;
+  std::vector<NSInteger> _dense;
+  std::vector<AS::IntegerMapRun> _runs;
+  std::unordered_map<NSInteger, NSInteger> _sparse;
   BOOL _isIdentity;
   BOOL _isEmpty;
   BOOL _immutable; // identity map and empty mape are immutable.
@@ -60,45 +94,139 @@
     return ASIntegerMap.identityMap;
   }
 
-  ASIntegerMap *result = [[ASIntegerMap alloc] init];
-  // Start with the old indexes
-  NSMutableIndexSet *indexes = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, oldCount)];
-
-  // Descending order, shift deleted ranges left
-  [deletions enumerateRangesWithOptions:NSEnumerationReverse usingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-    [indexes shiftIndexesStartingAtIndex:NSMaxRange(range) by:-range.length];
+  // Collect the ranges once; the map is then built from them without visiting each index.
+  std::vector<NSRange> deletedRanges, insertedRanges;
+  const auto deletedRangesPtr = &deletedRanges;
+  const auto insertedRangesPtr = &insertedRanges;
+  [deletions enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+    deletedRangesPtr->push_back(range);
   }];
-
-  // Ascending order, shift inserted ranges right
   [insertions enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-    [indexes shiftIndexesStartingAtIndex:range.location by:range.length];
+    insertedRangesPtr->push_back(range);
   }];
 
-  __block NSInteger oldIndex = 0;
-  [indexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-    // Note we advance oldIndex unconditionally, not newIndex
-    for (NSInteger newIndex = range.location; newIndex < NSMaxRange(range); oldIndex++) {
-      if ([deletions containsIndex:oldIndex]) {
-        // index was deleted, do nothing, just let oldIndex advance.
-      } else {
-        // assign the next index for this item.
-        result->_map[oldIndex] = newIndex++;
+  // Surviving old indexes are assigned, in order, to the new indexes that were not inserted.
+  // Walk both in lockstep and emit a run each time either side hits a gap.
+  ASIntegerMap *result = [[ASIntegerMap alloc] init];
+  auto &runs = result->_runs;
+  NSInteger oldIndex = 0;
+  NSInteger newIndex = 0;
+  size_t d = 0;
+  size_t i = 0;
+  while (oldIndex < oldCount) {
+    if (d < deletedRanges.size() && (NSInteger)deletedRanges[d].location <= oldIndex) {
+      oldIndex = MAX(oldIndex, (NSInteger)NSMaxRange(deletedRanges[d++]));
+      continue;
+    }
+    if (i < insertedRanges.size() && (NSInteger)insertedRanges[i].location <= newIndex) {
+      newIndex = MAX(newIndex, (NSInteger)NSMaxRange(insertedRanges[i++]));
+      continue;
+    }
+    const NSInteger oldEnd = (d < deletedRanges.size() ? MIN((NSInteger)deletedRanges[d].location, oldCount) : oldCount);
+    const NSInteger newEnd = (i < insertedRanges.size() ? (NSInteger)insertedRanges[i].location : NSIntegerMax);
+    const NSInteger length = MIN(oldEnd - oldIndex, newEnd - newIndex);
+    runs.push_back({oldIndex, newIndex, length});
+    oldIndex += length;
+    newIndex += length;
+  }
+
+  // Many short runs are cheaper to look up as a flat array.
+  if (runs.size() * 8 > (size_t)oldCount) {
+    result->_dense.assign(oldCount, NSNotFound);
+    for (const auto &run : runs) {
+      for (NSInteger j = 0; j < run.length; j++) {
+        result->_dense[run.key + j] = run.value + j;
       }
     }
-  }];
+    runs.clear();
+    runs.shrink_to_fit();
+  } else {
+    result->_storage = AS::IntegerMapStorage::Runs;
+  }
   return result;
 }
 
-- (NSInteger)integerForKey:(NSInteger)key
+/**
+ * Looks up a key. @c hint is the run index to try first, and is updated to the run that matched,
+ * so that ascending keys are found without a search.
+ */
+ASDISPLAYNODE_INLINE NSInteger ASIntegerMapLookup(ASIntegerMap *map, NSInteger key, size_t *hint)
 {
-  if (_isIdentity) {
+  if (map->_isIdentity) {
     return key;
-  } else if (_isEmpty) {
+  } else if (map->_isEmpty) {
     return NSNotFound;
   }
 
-  const auto result = _map.find(key);
-  return result != _map.end() ? result->second : NSNotFound;
+  switch (map->_storage) {
+    case AS::IntegerMapStorage::Dense:
+      return (key >= 0 && (size_t)key < map->_dense.size()) ? map->_dense[key] : NSNotFound;
+    case AS::IntegerMapStorage::Runs: {
+      const auto &runs = map->_runs;
+      size_t index = *hint;
+      if (index >= runs.size() || key < runs[index].key || key >= runs[index].key + runs[index].length) {
+        const auto it = std::upper_bound(runs.begin(), runs.end(), key, [](NSInteger k, const AS::IntegerMapRun &run) {
+          return k < run.key;
+        });
+        if (it == runs.begin()) {
+          return NSNotFound;
+        }
+        index = (it - runs.begin()) - 1;
+        if (key >= runs[index].key + runs[index].length) {
+          return NSNotFound;
+        }
+        *hint = index;
+      }
+      return runs[index].value + (key - runs[index].key);
+    }
+    case AS::IntegerMapStorage::Sparse: {
+      const auto result = map->_sparse.find(key);
+      return result != map->_sparse.end() ? result->second : NSNotFound;
+    }
+  }
+}
+
+/**
+ * Calls @c f(key, value) for every entry. Entries are in ascending key order unless the map is sparse.
+ */
+template <typename F>
+static void ASIntegerMapEnumerate(ASIntegerMap *map, const F &f)
+{
+  switch (map->_storage) {
+    case AS::IntegerMapStorage::Dense:
+      for (size_t key = 0; key < map->_dense.size(); key++) {
+        if (map->_dense[key] != NSNotFound) {
+          f((NSInteger)key, map->_dense[key]);
+        }
+      }
+      break;
+    case AS::IntegerMapStorage::Runs:
+      for (const auto &run : map->_runs) {
+        for (NSInteger i = 0; i < run.length; i++) {
+          f(run.key + i, run.value + i);
+        }
+      }
+      break;
+    case AS::IntegerMapStorage::Sparse:
+      for (const auto &e : map->_sparse) {
+        f(e.first, e.second);
+      }
+      break;
+  }
+}
+
+- (NSInteger)integerForKey:(NSInteger)key
+{
+  size_t hint = 0;
+  return ASIntegerMapLookup(self, key, &hint);
+}
+
+- (void)getIntegers:(NSInteger *)values forKeys:(const NSInteger *)keys count:(NSUInteger)count
+{
+  size_t hint = 0;
+  for (NSUInteger i = 0; i < count; i++) {
+    values[i] = ASIntegerMapLookup(self, keys[i], &hint);
+  }
 }
 
 - (void)setInteger:(NSInteger)value forKey:(NSInteger)key
@@ -108,7 +236,34 @@
     return;
   }
 
-  _map[key] = value;
+  if (_storage == AS::IntegerMapStorage::Runs) {
+    // Expand the runs so the entry can be written in place.
+    NSInteger count = _runs.empty() ? 0 : _runs.back().key + _runs.back().length;
+    _dense.assign(count, NSNotFound);
+    ASIntegerMapEnumerate(self, [&](NSInteger k, NSInteger v) {
+      _dense[k] = v;
+    });
+    _runs.clear();
+    _storage = AS::IntegerMapStorage::Dense;
+  }
+
+  if (_storage == AS::IntegerMapStorage::Dense) {
+    if (AS::IntegerMapDenseCanHoldKey(key, _dense.size())) {
+      if ((size_t)key >= _dense.size()) {
+        _dense.resize(key + 1, NSNotFound);
+      }
+      _dense[key] = value;
+      return;
+    }
+    ASIntegerMapEnumerate(self, [&](NSInteger k, NSInteger v) {
+      _sparse[k] = v;
+    });
+    _dense.clear();
+    _dense.shrink_to_fit();
+    _storage = AS::IntegerMapStorage::Sparse;
+  }
+
+  _sparse[key] = value;
 }
 
 - (ASIntegerMap *)inverseMap
@@ -118,13 +273,71 @@
   }
 
   const auto result = [[ASIntegerMap alloc] init];
-  
-  for (const auto &e : _map) {
-    result->_map[e.second] = e.first;
+
+  switch (_storage) {
+    case AS::IntegerMapStorage::Runs: {
+      // Update maps are monotonic, so swapping each run keeps them sorted.
+      auto &runs = result->_runs;
+      runs.reserve(_runs.size());
+      for (const auto &run : _runs) {
+        runs.push_back({run.value, run.key, run.length});
+      }
+      std::sort(runs.begin(), runs.end(), [](const AS::IntegerMapRun &a, const AS::IntegerMapRun &b) {
+        return a.key < b.key;
+      });
+      result->_storage = AS::IntegerMapStorage::Runs;
+      break;
+    }
+    case AS::IntegerMapStorage::Dense: {
+      NSInteger maxValue = -1;
+      BOOL canBeDense = YES;
+      for (NSInteger value : _dense) {
+        if (value == NSNotFound) {
+          continue;
+        }
+        canBeDense = canBeDense && AS::IntegerMapDenseCanHoldKey(value, _dense.size());
+        maxValue = MAX(maxValue, value);
+      }
+      if (canBeDense) {
+        result->_dense.assign(maxValue + 1, NSNotFound);
+        for (size_t key = 0; key < _dense.size(); key++) {
+          if (_dense[key] != NSNotFound) {
+            result->_dense[_dense[key]] = key;
+          }
+        }
+        break;
+      }
+      result->_storage = AS::IntegerMapStorage::Sparse;
+      ASIntegerMapEnumerate(self, [&](NSInteger k, NSInteger v) {
+        result->_sparse[v] = k;
+      });
+      break;
+    }
+    case AS::IntegerMapStorage::Sparse:
+      result->_storage = AS::IntegerMapStorage::Sparse;
+      for (const auto &e : _sparse) {
+        result->_sparse[e.second] = e.first;
+      }
+      break;
   }
   return result;
 }
 
+/**
+ * The entries of the map sorted by key, for comparison.
+ */
+- (std::vector<std::pair<NSInteger, NSInteger>>)sortedEntries
+{
+  std::vector<std::pair<NSInteger, NSInteger>> entries;
+  ASIntegerMapEnumerate(self, [&](NSInteger k, NSInteger v) {
+    entries.emplace_back(k, v);
+  });
+  if (_storage == AS::IntegerMapStorage::Sparse) {
+    std::sort(entries.begin(), entries.end());
+  }
+  return entries;
+}
+
 #pragma mark - NSCopying
 
 - (id)copyWithZone:(NSZone *)zone
@@ -134,7 +347,10 @@
   }
 
   const auto newMap = [[ASIntegerMap allocWithZone:zone] init];
-  newMap->_map = _map;
+  newMap->_storage = _storage;
+  newMap->_dense = _dense;
+  newMap->_runs = _runs;
+  newMap->_sparse = _sparse;
   return newMap;
 }
 
@@ -151,7 +367,7 @@
   } else {
     // { 1->2 3->4 5->6 }
     NSMutableString *str = [NSMutableString string];
-    for (const auto &e : _map) {
+    for (const auto &e : [self sortedEntries]) {
       [str appendFormat:@" %ld->%ld", (long)e.first, (long)e.second];
     }
     // Remove leading space
@@ -176,7 +392,7 @@
   }
 
   if (ASIntegerMap *otherMap = ASDynamicCast(object, ASIntegerMap)) {
-    return otherMap->_map == _map;
+    return otherMap->_isIdentity == _isIdentity && otherMap->_isEmpty == _isEmpty && [otherMap sortedEntries] == [self sortedEntries];
   }
   return NO;
 }
@@ -10,10 +10,40 @@
 #import <Foundation/Foundation.h>
 #import "ASBaseDefines.h"
 
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Lets the owner of blocks scheduled on an ASMainSerialQueue drop the ones that haven't run yet, e.g. because the
+ * state they would apply has been discarded. Cancelling is thread safe and can't be undone.
+ */
+AS_SUBCLASSING_RESTRICTED
+@interface ASMainSerialQueueCancellationToken : NSObject
+
+@property (readonly, getter=isCancelled) BOOL cancelled;
+- (void)cancel;
+
+@end
+
 AS_SUBCLASSING_RESTRICTED
 @interface ASMainSerialQueue : NSObject
 
 @property (nonatomic, readonly) NSUInteger numberOfScheduledBlocks;
+
+/**
+ * Maximum time the main thread spends running blocks that were scheduled from background threads before it yields
+ * the rest to a later run loop turn. Blocks always run in order, and a call from the main thread still runs every
+ * scheduled block before returning. Defaults to 0, no limit, so that blocks scheduled together land in the same turn
+ * as they always have. ASDataController sets a budget only under ASExperimentalCoalesceDataControllerUpdates.
+ */
+@property (nonatomic) CFTimeInterval frameBudget;
+
 - (void)performBlockOnMainThread:(dispatch_block_t)block;
 
+/**
+ * Same as -performBlockOnMainThread:, but the block is skipped if the token is cancelled before the block runs.
+ */
+- (void)performBlockOnMainThread:(dispatch_block_t)block cancellationToken:(nullable ASMainSerialQueueCancellationToken *)token;
+
 @end
+
+NS_ASSUME_NONNULL_END
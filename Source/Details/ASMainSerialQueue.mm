@@ -9,66 +9,171 @@
 
 #import "ASMainSerialQueue.h"
 
+#import <QuartzCore/QuartzCore.h>
 #import "ASThread.h"
 #import "ASInternalHelpers.h"
-#import <queue>
+#import "ASSignpost.h"
+#import <atomic>
+#import <deque>
+
+static const CFTimeInterval kASMainSerialQueueDefaultFrameBudget = 0;
+
+@implementation ASMainSerialQueueCancellationToken
+{
+  std::atomic<bool> _cancelled;
+}
+
+- (BOOL)isCancelled
+{
+  return _cancelled.load();
+}
+
+- (void)cancel
+{
+  _cancelled.store(true);
+}
+
+@end
+
+struct ASMainSerialQueueEntry {
+  dispatch_block_t block;
+  ASMainSerialQueueCancellationToken *token;
+};
 
 @interface ASMainSerialQueue ()
 {
   AS::Mutex _serialQueueLock;
-  std::queue<dispatch_block_t> _blocks;
+  std::deque<ASMainSerialQueueEntry> _blocks;
+  CFTimeInterval _frameBudget;
+  // Whether a hop to the main queue is already on its way. Further blocks scheduled from background threads ride
+  // along with it instead of dispatching their own.
+  BOOL _mainQueueDrainScheduled;
 }
 
 @end
 
 @implementation ASMainSerialQueue
 
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _frameBudget = kASMainSerialQueueDefaultFrameBudget;
+  }
+  return self;
+}
+
 - (NSUInteger)numberOfScheduledBlocks
 {
   AS::MutexLocker l(_serialQueueLock);
   return _blocks.size();
 }
 
+- (CFTimeInterval)frameBudget
+{
+  AS::MutexLocker l(_serialQueueLock);
+  return _frameBudget;
+}
+
+- (void)setFrameBudget:(CFTimeInterval)frameBudget
+{
+  AS::MutexLocker l(_serialQueueLock);
+  _frameBudget = frameBudget;
+}
+
 - (void)performBlockOnMainThread:(dispatch_block_t)block
+{
+  [self performBlockOnMainThread:block cancellationToken:nil];
+}
+
+- (void)performBlockOnMainThread:(dispatch_block_t)block cancellationToken:(ASMainSerialQueueCancellationToken *)token
+{
+  if (block == nil) {
+    return;
+  }
+
+  BOOL isMainThread = ASDisplayNodeThreadIsMain();
+  {
+    AS::MutexLocker l(_serialQueueLock);
+    _blocks.push_back({block, token});
+  }
+
+  if (isMainThread) {
+    // Callers on the main thread expect everything scheduled so far to have run when this returns.
+    [self runBlocksWithBudget:0];
+  } else {
+    [self scheduleMainQueueDrain];
+  }
+}
+
+- (void)scheduleMainQueueDrain
 {
   {
     AS::MutexLocker l(_serialQueueLock);
-    _blocks.push(block);
+    if (_mainQueueDrainScheduled || _blocks.empty()) {
+      return;
+    }
+    _mainQueueDrainScheduled = YES;
   }
 
-  [self runBlocks];
+  dispatch_async(dispatch_get_main_queue(), ^{
+    CFTimeInterval budget;
+    {
+      AS::MutexLocker l(self->_serialQueueLock);
+      self->_mainQueueDrainScheduled = NO;
+      budget = self->_frameBudget;
+    }
+    if (![self runBlocksWithBudget:budget]) {
+      // Out of time for this turn, continue with the rest on the next one.
+      [self scheduleMainQueueDrain];
+    }
+  });
 }
 
-- (void)runBlocks
+/// Runs scheduled blocks in order until none are left or the budget is used up. Returns NO if blocks are left.
+- (BOOL)runBlocksWithBudget:(CFTimeInterval)budget
 {
-  dispatch_block_t mainThread = ^{
-    AS::UniqueLock l(self->_serialQueueLock);
-    do {
-      if (self->_blocks.empty()) {
-        break;
-      }
-      dispatch_block_t block = self->_blocks.front();
-      self->_blocks.pop();
-      {
-        l.unlock();
-        block();
-        l.lock();
-      }
-    } while (true);
-  };
-  
-  ASPerformBlockOnMainThread(mainThread);
+  ASDisplayNodeAssertMainThread();
+  const CFTimeInterval start = CACurrentMediaTime();
+  NSUInteger count = 0;
+  NSUInteger cancelledCount = 0;
+  BOOL drained = YES;
+  ASSignpostStart(MainSerialQueueDrain, self, "budget: %.1fms", budget * 1000);
+
+  AS::UniqueLock l(_serialQueueLock);
+  while (!_blocks.empty()) {
+    // Always make progress, even if a single block blows the budget.
+    if (budget > 0 && count > 0 && CACurrentMediaTime() - start >= budget) {
+      drained = NO;
+      break;
+    }
+    ASMainSerialQueueEntry entry = _blocks.front();
+    _blocks.pop_front();
+    if (entry.token.isCancelled) {
+      cancelledCount++;
+      continue;
+    }
+    l.unlock();
+    entry.block();
+    count++;
+    l.lock();
+  }
+  l.unlock();
+
+  ASSignpostEnd(MainSerialQueueDrain, self, "count: %lu, cancelled: %lu, duration: %.2fms", (unsigned long)count, (unsigned long)cancelledCount, (CACurrentMediaTime() - start) * 1000);
+  return drained;
 }
 
 - (NSString *)description
 {
   NSString *desc = [super description];
-  std::queue<dispatch_block_t> blocks = _blocks;
-  [desc stringByAppendingString:@" Blocks: "];
-  while (!blocks.empty()) {
-      dispatch_block_t block = blocks.front();
-      [desc stringByAppendingFormat:@"%@", block];
-      blocks.pop();
+  std::deque<ASMainSerialQueueEntry> blocks;
+  {
+    AS::MutexLocker l(_serialQueueLock);
+    blocks = _blocks;
+  }
+  desc = [desc stringByAppendingString:@" Blocks: "];
+  for (const auto &entry : blocks) {
+    desc = [desc stringByAppendingFormat:@"%@", entry.block];
   }
   return desc;
 }
@@ -67,9 +67,9 @@
 
 /**
  * @abstract Compares two arrays, providing the insertion and deletion indexes needed to transform into the target array.
- * @discussion This compares the equality of each object with `isEqual:`.
- * This diffing algorithm uses a bottom-up memoized longest common subsequence solution to identify differences.
- * It runs in O(mn) complexity.
+ * @discussion This matches objects by `hash` and confirms matches with `isEqual:`, keeping the longest run of
+ * matches that are in order. The result is a longest common subsequence when the objects are unique.
+ * It runs in O(m + n) expected time, plus O(k log k) for k matches.
  */
 - (void)asdk_diffWithArray:(NSArray *)array insertions:(NSIndexSet **)insertions deletions:(NSIndexSet **)deletions;
 
@@ -83,9 +83,8 @@
 
 /**
  * @abstract Compares two arrays, providing the insertion, deletion, and move indexes needed to transform into the target array.
- * @discussion This compares the equality of each object with `isEqual:`.
- * This diffing algorithm uses a bottom-up memoized longest common subsequence solution to identify differences.
- * It runs in O(mn) complexity.
+ * @discussion This matches objects by `hash` and confirms matches with `isEqual:`.
+ * It runs in O(m + n) expected time. To diff precomputed keys without messaging each object, use AS::Diff::compute.
  * The moves are returned in ascending order of their destination index.
  */
 - (void)asdk_diffWithArray:(NSArray *)array insertions:(NSIndexSet **)insertions deletions:(NSIndexSet **)deletions moves:(NSArray<NSIndexPath *> **)moves;
@@ -9,8 +9,9 @@
 
 #import "NSArray+Diffing.h"
 #import <AppKit/AppKit.h>
+#import "ASArrayDiff.h"
 #import "ASAssert.h"
-#import <unordered_map>
+#import <vector>
 
 @implementation NSArray (Diffing)
 
@@ -37,71 +38,82 @@ typedef BOOL (^compareBlock)(id _Nonnull lhs, id _Nonnull rhs);
 - (void)asdk_diffWithArray:(NSArray *)array insertions:(NSIndexSet **)insertions deletions:(NSIndexSet **)deletions
                      moves:(NSArray<NSIndexPath *> **)moves compareBlock:(compareBlock)comparison
 {
-  struct NSObjectHash
-  {
-    std::size_t operator()(id <NSObject> k) const { return (std::size_t) [k hash]; };
-  };
-  struct NSObjectCompare
-  {
-    bool operator()(id <NSObject> lhs, id <NSObject> rhs) const { return (bool) [lhs isEqual:rhs]; };
-  };
-  std::unordered_multimap<unowned id, NSUInteger, NSObjectHash, NSObjectCompare> potentialMoves;
-
   NSAssert(comparison != nil, @"Comparison block is required");
   NSAssert(moves == nil || comparison == [NSArray defaultCompareBlock], @"move detection requires isEqual: and hash (no custom compare)");
-  NSMutableArray<NSIndexPath *> *moveIndexPaths = nil;
-  NSMutableIndexSet *insertionIndexes = nil, *deletionIndexes = nil;
-  if (moves) {
-    moveIndexPaths = [NSMutableArray new];
+  if (comparison == [NSArray defaultCompareBlock]) {
+    [self _asdk_hashedDiffWithArray:array insertions:insertions deletions:deletions moves:moves];
+    return;
   }
+
+  // Custom comparisons cannot be hashed, so fall back to the longest common subsequence.
   NSMutableIndexSet *commonIndexes = [self _asdk_commonIndexesWithArray:array compareBlock:comparison];
 
-  if (deletions || moves) {
-    deletionIndexes = [NSMutableIndexSet indexSet];
-    NSUInteger i = 0;
-    for (id element in self) {
-      if (![commonIndexes containsIndex:i]) {
-        [deletionIndexes addIndex:i];
-      }
-      if (moves) {
-        potentialMoves.insert(std::pair<id, NSUInteger>(element, i));
-      }
-      ++i;
-    }
+  if (deletions) {
+    NSMutableIndexSet *deletionIndexes = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, self.count)];
+    [deletionIndexes removeIndexes:commonIndexes];
+    *deletions = deletionIndexes;
   }
 
-  if (insertions || moves) {
-    insertionIndexes = [NSMutableIndexSet indexSet];
+  if (insertions) {
+    NSMutableIndexSet *insertionIndexes = [NSMutableIndexSet indexSet];
     NSArray *commonObjects = [self objectsAtIndexes:commonIndexes];
     for (NSUInteger i = 0, j = 0; j < array.count; j++) {
-      auto moveFound = potentialMoves.find(array[j]);
-      NSUInteger movedFrom = NSNotFound;
-      if (moveFound != potentialMoves.end() && moveFound->second != j) {
-        movedFrom = moveFound->second;
-        potentialMoves.erase(moveFound);
-        [moveIndexPaths addObject:[NSIndexPath indexPathForItem:j inSection:movedFrom]];
-      }
-      if (i < commonObjects.count && j < array.count && comparison(commonObjects[i], array[j])) {
+      if (i < commonObjects.count && comparison(commonObjects[i], array[j])) {
         i++;
       } else {
-        if (movedFrom != NSNotFound) {
-          // moves will coalesce a delete / insert - the insert is just not done, and here we remove the delete:
-          [deletionIndexes removeIndex:movedFrom];
-          // OR a move will have come from the LCS:
-          if ([commonIndexes containsIndex:movedFrom]) {
-            [commonIndexes removeIndex:movedFrom];
-            commonObjects = [self objectsAtIndexes:commonIndexes];
-          }
-        } else {
-          [insertionIndexes addIndex:j];
-        }
+        [insertionIndexes addIndex:j];
       }
     }
+    *insertions = insertionIndexes;
+  }
+  if (moves) {
+    *moves = @[];
   }
+}
 
-  if (moves) {*moves = moveIndexPaths;}
-  if (deletions) {*deletions = deletionIndexes;}
-  if (insertions) {*insertions = insertionIndexes;}
+/**
+ * Diffs by -hash, confirming matches with -isEqual:, in linear time.
+ */
+- (void)_asdk_hashedDiffWithArray:(NSArray *)array insertions:(NSIndexSet **)insertions deletions:(NSIndexSet **)deletions
+                            moves:(NSArray<NSIndexPath *> **)moves
+{
+  const NSUInteger oldCount = self.count;
+  const NSUInteger newCount = array.count;
+  std::vector<unowned id> oldObjects(oldCount);
+  std::vector<unowned id> newObjects(newCount);
+  [self getObjects:oldObjects.data() range:NSMakeRange(0, oldCount)];
+  [array getObjects:newObjects.data() range:NSMakeRange(0, newCount)];
+
+  std::vector<AS::Diff::Key> oldKeys, newKeys;
+  oldKeys.reserve(oldCount);
+  newKeys.reserve(newCount);
+  for (unowned id object : oldObjects) {
+    oldKeys.push_back([object hash]);
+  }
+  for (unowned id object : newObjects) {
+    newKeys.push_back([object hash]);
+  }
+
+  AS::Diff::Result result;
+  AS::Diff::compute(oldKeys.data(), oldCount, newKeys.data(), newCount,
+                    moves ? AS::Diff::Moves::All : AS::Diff::Moves::None, result,
+                    [&](NSUInteger oldIndex, NSUInteger newIndex) {
+    return (bool)[oldObjects[oldIndex] isEqual:newObjects[newIndex]];
+  });
+
+  if (moves) {
+    NSMutableArray<NSIndexPath *> *moveIndexPaths = [NSMutableArray arrayWithCapacity:result.moves.size()];
+    for (const auto &move : result.moves) {
+      [moveIndexPaths addObject:[NSIndexPath indexPathForItem:move.to inSection:move.from]];
+    }
+    *moves = moveIndexPaths;
+  }
+  if (deletions) {
+    *deletions = AS::Diff::IndexSet(result.deletions);
+  }
+  if (insertions) {
+    *insertions = AS::Diff::IndexSet(result.insertions);
+  }
 }
 
 // https://github.com/raywenderlich/swift-algorithm-club/tree/master/Longest%20Common%20Subsequence is not exactly this code (obviously), but
@@ -12,8 +12,11 @@
 #import "_ASAsyncTransactionGroup.h"
 #import "ASAssert.h"
 #import "ASThread.h"
+#import "ASAsyncTransactionDeques.h"
+#import <atomic>
+#import <condition_variable>
 #import <list>
-#import <map>
+#import <vector>
 
 #ifndef __STRICT_ANSI__
   #warning "Texture must be compiled with std=c++11 to prevent layout issues. gnu++ is not supported. This is hopefully temporary."
@@ -61,7 +64,13 @@ NSInteger const ASDefaultTransactionPriority = 0;
 
 @end
 
-// Lightweight operation queue for _ASAsyncTransaction that limits number of spawned threads
+// Lightweight operation queue for _ASAsyncTransaction that limits number of spawned threads.
+//
+// Each dispatch queue owns a fixed set of work deques, one per potential worker thread (see
+// ASAsyncTransactionDeques.h). Producers spread operations across the deques round-robin and
+// workers take the next operation in priority order from whichever deque holds it, so scheduling
+// only ever contends on a single deque lock. Groups track their pending operations with atomics
+// and only lock to deliver notifications.
 class ASAsyncTransactionQueue
 {
 public:
@@ -90,6 +99,8 @@ public:
     virtual ~Group() { }; // call release() instead
   };
   
+  ASAsyncTransactionQueue() : _entries(nullptr) { }
+  
   // Create new group
   Group *createGroup();
   
@@ -108,7 +119,7 @@ private:
   public:
     GroupImpl(ASAsyncTransactionQueue &queue)
       : _pendingOperations(0)
-      , _releaseCalled(false)
+      , _referenceCount(1)
       , _queue(queue)
     {
     }
@@ -120,10 +131,13 @@ private:
     virtual void leave();
     virtual void wait();
     
-    int _pendingOperations;
+    void removeReference();
+    
+    std::atomic<int> _pendingOperations;
+    std::atomic<int> _referenceCount; // one for the owner plus one per pending operation
+    std::mutex _mutex;                // guards _notifyList and _condition
     std::list<GroupNotify> _notifyList;
     std::condition_variable _condition;
-    BOOL _releaseCalled;
     ASAsyncTransactionQueue &_queue;
   };
   
@@ -132,26 +146,42 @@ private:
     dispatch_block_t _block;
     GroupImpl *_group;
     NSInteger _priority;
+    uint64_t _sequence; // scheduling order within the dispatch queue
   };
-    
+  
   struct DispatchEntry // entry for each dispatch queue
   {
-    typedef std::list<Operation> OperationQueue;
-    typedef std::list<OperationQueue::iterator> OperationIteratorList; // each item points to operation queue
-    typedef std::map<NSInteger, OperationIteratorList> OperationPriorityMap; // sorted by priority
+    DispatchEntry(dispatch_queue_t queue, NSUInteger dequeCount) : _queue(queue), _deques(dequeCount), _next(nullptr) {}
 
-    OperationQueue _operationQueue;
-    OperationPriorityMap _operationPriorityMap;
-    int _threadCount;
-      
-    Operation popNextOperation(bool respectPriority);  // assumes locked mutex
-    void pushOperation(Operation operation);           // assumes locked mutex
+    dispatch_queue_t _queue;
+    AS::AsyncTransactionDeques<Operation> _deques;
+    DispatchEntry *_next;
   };
   
-  std::map<dispatch_queue_t, DispatchEntry> _entries;
-  std::mutex _mutex;
+  DispatchEntry &entryForQueue(dispatch_queue_t queue);
+  void spawnWorkerIfNeeded(DispatchEntry &entry);
+  void runWorker(DispatchEntry &entry, size_t home);
+  
+  // Entries are never removed: transactions only target a few long-lived queues, and keeping
+  // them lets lookups walk the list without taking a lock.
+  std::atomic<DispatchEntry *> _entries;
+  std::mutex _entriesMutex; // only taken to add the entry for a queue seen for the first time
 };
 
+static NSUInteger ASAsyncTransactionQueueMaxThreadCount()
+{
+#if ASDISPLAYNODE_DELAY_DISPLAY
+  return 1;
+#else
+  static NSUInteger maxThreads;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    maxThreads = [NSProcessInfo processInfo].activeProcessorCount * 2;
+  });
+  return maxThreads;
+#endif
+}
+
 ASAsyncTransactionQueue::Group* ASAsyncTransactionQueue::createGroup()
 {
   Group *res = new GroupImpl(*this);
@@ -160,112 +190,107 @@ ASAsyncTransactionQueue::Group* ASAsyncTransactionQueue::createGroup()
 
 void ASAsyncTransactionQueue::GroupImpl::release()
 {
-  std::lock_guard<std::mutex> l(_queue._mutex);
-  
-  if (_pendingOperations == 0)  {
+  removeReference();
+}
+
+void ASAsyncTransactionQueue::GroupImpl::removeReference()
+{
+  if (_referenceCount.fetch_sub(1) == 1) {
     delete this;
-  } else {
-    _releaseCalled = YES;
   }
 }
 
-ASAsyncTransactionQueue::Operation ASAsyncTransactionQueue::DispatchEntry::popNextOperation(bool respectPriority)
+ASAsyncTransactionQueue::DispatchEntry &ASAsyncTransactionQueue::entryForQueue(dispatch_queue_t queue)
 {
-  NSCAssert(!_operationQueue.empty() && !_operationPriorityMap.empty(), @"No scheduled operations available");
-
-  OperationQueue::iterator queueIterator;
-  OperationPriorityMap::iterator mapIterator;
-  
-  if (respectPriority) {
-    mapIterator = --_operationPriorityMap.end();  // highest priority "bucket"
-    queueIterator = *mapIterator->second.begin();
-  } else {
-    queueIterator = _operationQueue.begin();
-    mapIterator = _operationPriorityMap.find(queueIterator->_priority);
+  for (DispatchEntry *entry = _entries.load(std::memory_order_acquire); entry != nullptr; entry = entry->_next) {
+    if (entry->_queue == queue) {
+      return *entry;
+    }
   }
   
-  // no matter what, first item in "bucket" must match item in queue
-  NSCAssert(mapIterator->second.front() == queueIterator, @"Queue inconsistency");
-  
-  Operation res = *queueIterator;
-  _operationQueue.erase(queueIterator);
+  std::lock_guard<std::mutex> l(_entriesMutex);
   
-  mapIterator->second.pop_front();
-  if (mapIterator->second.empty()) {
-    _operationPriorityMap.erase(mapIterator);
+  // Someone may have added it while we were waiting for the lock.
+  DispatchEntry *head = _entries.load(std::memory_order_acquire);
+  for (DispatchEntry *entry = head; entry != nullptr; entry = entry->_next) {
+    if (entry->_queue == queue) {
+      return *entry;
+    }
   }
-
-  return res;
-}
-
-void ASAsyncTransactionQueue::DispatchEntry::pushOperation(ASAsyncTransactionQueue::Operation operation)
-{
-  _operationQueue.push_back(operation);
-
-  OperationIteratorList &list = _operationPriorityMap[operation._priority];
-  list.push_back(--_operationQueue.end());
+  
+  DispatchEntry *entry = new DispatchEntry(queue, ASAsyncTransactionQueueMaxThreadCount());
+  entry->_next = head;
+  _entries.store(entry, std::memory_order_release);
+  return *entry;
 }
 
-void ASAsyncTransactionQueue::GroupImpl::schedule(NSInteger priority, dispatch_queue_t queue, dispatch_block_t block)
+void ASAsyncTransactionQueue::spawnWorkerIfNeeded(ASAsyncTransactionQueue::DispatchEntry &entry)
 {
-  ASAsyncTransactionQueue &q = _queue;
-  std::lock_guard<std::mutex> l(q._mutex);
-  
-  DispatchEntry &entry = q._entries[queue];
-  
-  Operation operation;
-  operation._block = block;
-  operation._group = this;
-  operation._priority = priority;
-  entry.pushOperation(operation);
-  
-  ++_pendingOperations; // enter group
-  
-#if ASDISPLAYNODE_DELAY_DISPLAY
-  NSUInteger maxThreads = 1;
-#else 
-  NSUInteger maxThreads = [NSProcessInfo processInfo].activeProcessorCount * 2;
-
+  NSUInteger maxThreads = ASAsyncTransactionQueueMaxThreadCount();
+#if !ASDISPLAYNODE_DELAY_DISPLAY
   // Bit questionable maybe - we can give main thread more CPU time during tracking.
   if ([[NSRunLoop mainRunLoop].currentMode isEqualToString:NSEventTrackingRunLoopMode])
     --maxThreads;
 #endif
   
-  if (entry._threadCount < maxThreads) { // we need to spawn another thread
+  size_t home;
+  if (entry._deques.acquireWorker(maxThreads, home)) {
+    runWorker(entry, home);
+  }
+}
 
-    // first thread will take operations in queue order (regardless of priority), other threads will respect priority
-    bool respectPriority = entry._threadCount > 0;
-    ++entry._threadCount;
-    
-    dispatch_async(queue, ^{
-      std::unique_lock<std::mutex> lock(q._mutex);
+void ASAsyncTransactionQueue::runWorker(ASAsyncTransactionQueue::DispatchEntry &entry, size_t home)
+{
+  DispatchEntry *e = &entry;
+  
+  dispatch_async(entry._queue, ^{
+    size_t workerHome = home;
+    Operation operation;
+    while (true) {
+      // first thread will take operations in queue order (regardless of priority), other threads will respect priority
+      bool respectPriority = workerHome > 0;
       
       // go until there are no more pending operations
-      while (!entry._operationQueue.empty()) {
-        Operation operation = entry.popNextOperation(respectPriority);
-        lock.unlock();
+      while (e->_deques.pop(operation, workerHome, respectPriority)) {
         if (operation._block) {
           operation._block();
         }
         operation._group->leave();
-        operation._block = nil; // the block must be freed while mutex is unlocked
-        lock.lock();
+        operation._block = nil;
       }
-      --entry._threadCount;
       
-      if (entry._threadCount == 0) {
-        NSCAssert(entry._operationQueue.empty() || entry._operationPriorityMap.empty(), @"No working threads but operations are still scheduled"); // this shouldn't happen
-        q._entries.erase(queue);
+      // A producer may have pushed after our last pop while we still counted as a running worker,
+      // in which case it did not spawn a replacement. Retire first, then come back if there is
+      // still work and nobody else picked it up.
+      e->_deques.releaseWorker(workerHome);
+      if (!e->_deques.hasOperations() || !e->_deques.acquireWorker(e->_deques.count(), workerHome)) {
+        break;
       }
-    });
-  }
+    }
+  });
+}
+
+void ASAsyncTransactionQueue::GroupImpl::schedule(NSInteger priority, dispatch_queue_t queue, dispatch_block_t block)
+{
+  ASAsyncTransactionQueue &q = _queue;
+  DispatchEntry &entry = q.entryForQueue(queue);
+  
+  enter();
+  
+  Operation operation;
+  operation._block = block;
+  operation._group = this;
+  operation._priority = priority;
+  entry._deques.push(std::move(operation));
+  
+  q.spawnWorkerIfNeeded(entry);
 }
 
 void ASAsyncTransactionQueue::GroupImpl::notify(dispatch_queue_t queue, dispatch_block_t block)
 {
-  std::lock_guard<std::mutex> l(_queue._mutex);
+  std::lock_guard<std::mutex> l(_mutex);
 
-  if (_pendingOperations == 0) {
+  if (_pendingOperations.load() == 0) {
     dispatch_async(queue, block);
   } else {
     _notifyList.push_back({block, queue});
@@ -274,37 +299,37 @@ void ASAsyncTransactionQueue::GroupImpl::notify(dispatch_queue_t queue, dispatch
 
 void ASAsyncTransactionQueue::GroupImpl::enter()
 {
-  std::lock_guard<std::mutex> l(_queue._mutex);
-  ++_pendingOperations;
+  _referenceCount.fetch_add(1);
+  _pendingOperations.fetch_add(1);
 }
 
 void ASAsyncTransactionQueue::GroupImpl::leave()
 {
-  std::lock_guard<std::mutex> l(_queue._mutex);
-  --_pendingOperations;
-  
-  if (_pendingOperations == 0) {
+  if (_pendingOperations.fetch_sub(1) == 1) {
     std::list<GroupNotify> notifyList;
-    _notifyList.swap(notifyList);
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      // Someone may have entered again before we got the lock; their leave() will deliver.
+      if (_pendingOperations.load() == 0) {
+        _notifyList.swap(notifyList);
+        _condition.notify_all();
+      }
+    }
     
     for (GroupNotify & notify : notifyList) {
       dispatch_async(notify._queue, notify._block);
     }
-    
-    _condition.notify_one();
-    
-    // there was attempt to release the group before, but we still
-    // had operations scheduled so now is good time
-    if (_releaseCalled) {
-      delete this;
-    }
   }
+  
+  // there may have been an attempt to release the group before, but we still
+  // had operations scheduled so now is good time
+  removeReference();
 }
 
 void ASAsyncTransactionQueue::GroupImpl::wait()
 {
-  std::unique_lock<std::mutex> lock(_queue._mutex);
-  while (_pendingOperations > 0) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (_pendingOperations.load() > 0) {
     _condition.wait(lock);
   }
 }
@@ -133,27 +133,33 @@
  
   as_activity_scope_verbose(as_activity_create("Calculate stack layout", AS_ACTIVITY_CURRENT, OS_ACTIVITY_FLAG_DEFAULT));
   as_log_verbose(ASLayoutLog(), "Stack layout %@", self);
+  // Scratch buffers for this thread and nesting depth; they are reused by the next stack laid out here.
+  AS::StackLayout::ScratchLease<ASStackUnpositionedLayout> unpositionedLayout;
+
   // Accessing the style and size property is pretty costly we create layout spec children we use to figure
   // out the layout for each child
-  const auto stackChildren = AS::map(children, [&](const id<ASLayoutElement> child) -> ASStackLayoutSpecChild {
+  auto &stackChildren = unpositionedLayout->children;
+  stackChildren.reserve(children.count);
+  for (id<ASLayoutElement> child in children) {
     ASLayoutElementStyle *style = child.style;
-    return {child, style, style.size};
-  });
-  
+    stackChildren.push_back({child, style, style.size});
+  }
+
   const ASStackLayoutSpecStyle style = {.direction = _direction, .spacing = _spacing, .justifyContent = _justifyContent, .alignItems = _alignItems, .flexWrap = _flexWrap, .alignContent = _alignContent, .lineSpacing = _lineSpacing};
-  
-  const auto unpositionedLayout = ASStackUnpositionedLayout::compute(stackChildren, style, constrainedSize, _concurrent);
-  const auto positionedLayout = ASStackPositionedLayout::compute(unpositionedLayout, style, constrainedSize);
-  
+
+  unpositionedLayout->compute(style, constrainedSize, _concurrent);
+  const auto positionedLayout = ASStackPositionedLayout::compute(*unpositionedLayout, style, constrainedSize);
+
   if (style.direction == ASStackLayoutDirectionVertical) {
     self.style.ascender = stackChildren.front().style.ascender;
     self.style.descender = stackChildren.back().style.descender;
   }
 
-  ASLayout *rawSublayouts[positionedLayout.items.size()];
+  const auto &items = unpositionedLayout->layout.items;
+  ASLayout *rawSublayouts[items.size()];
   int i = 0;
-  for (const auto &item : positionedLayout.items) {
-    rawSublayouts[i++] = item.layout;
+  for (const auto &item : items) {
+    rawSublayouts[i++] = unpositionedLayout->layouts[item.index];
   }
 
   const auto sublayouts = [NSArray<ASLayout *> arrayByTransferring:rawSublayouts count:i];
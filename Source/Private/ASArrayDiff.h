@@ -0,0 +1,32 @@
+//
+//  ASArrayDiff.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#import <Foundation/Foundation.h>
+
+#import "ASArrayDiffCore.h"
+
+namespace AS {
+namespace Diff {
+
+/**
+ * Creates an index set from ascending indexes, adding each run of consecutive indexes as one range.
+ */
+inline NSMutableIndexSet *IndexSet(const std::vector<std::size_t> &indexes)
+{
+  NSMutableIndexSet *result = [NSMutableIndexSet indexSet];
+  for (size_t start = 0, end = 0; start < indexes.size(); start = end) {
+    for (end = start + 1; end < indexes.size() && indexes[end] == indexes[end - 1] + 1; end++) {}
+    [result addIndexesInRange:NSMakeRange(indexes[start], end - start)];
+  }
+  return result;
+}
+
+} // namespace Diff
+} // namespace AS
@@ -0,0 +1,175 @@
+//
+//  ASArrayDiffCore.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The diff behind ASArrayDiff.h. Import ASArrayDiff.h rather than this header.
+
+ This header must stay free of Foundation and Objective-C so that the diff can be checked on its own.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace AS {
+namespace Diff {
+
+/// Marks an index with no counterpart.
+static const std::size_t kNotFound = SIZE_MAX;
+
+/**
+ * Identifies an element for diffing. Equal elements must have equal keys; e.g. an object pointer or a hash.
+ */
+typedef uint64_t Key;
+
+struct Move {
+  std::size_t from;
+  std::size_t to;
+};
+
+enum class Moves {
+  /// Matches outside the longest increasing run become deletions and insertions. With unique keys, what remains
+  /// is a longest common subsequence.
+  None,
+  /// Every match whose index changed is a move, as in -asdk_diffWithArray:insertions:deletions:moves:.
+  All,
+};
+
+struct Result {
+  /// Indexes into the old array, ascending.
+  std::vector<std::size_t> deletions;
+  /// Indexes into the new array, ascending.
+  std::vector<std::size_t> insertions;
+  /// Ascending order of destination. Empty for Moves::None.
+  std::vector<Move> moves;
+
+  void clear()
+  {
+    deletions.clear();
+    insertions.clear();
+    moves.clear();
+  }
+};
+
+/**
+ * For keys that are exact identities, so matching keys need no further check.
+ */
+struct KeysAreIdentities {
+  bool operator()(std::size_t, std::size_t) const { return true; }
+};
+
+/**
+ * Diffs two key arrays in expected O(m + n) time (Heckel, "A technique for isolating differences between files").
+ *
+ * Each new key is matched with the first unmatched old index holding the same key that @c equal(oldIndex, newIndex)
+ * confirms, so duplicates pair up in order and non-unique keys such as hashes can be used. Old indexes whose keys
+ * collide without being equal are passed over, and each such candidate costs one more call to @c equal.
+ *
+ * Finding the longest increasing run of matches, for Moves::None, is O(k log k) in the number of matches k.
+ */
+template <typename Equal = KeysAreIdentities>
+void compute(const Key *oldKeys, std::size_t oldCount,
+             const Key *newKeys, std::size_t newCount,
+             Moves moves, Result &result, const Equal &equal = Equal())
+{
+  result.clear();
+
+  // For each key, the first unmatched old index; nextOld chains to the following old index with that key.
+  std::unordered_map<Key, std::size_t> firstOld;
+  firstOld.reserve(oldCount);
+  std::vector<std::size_t> nextOld(oldCount);
+  for (std::size_t i = oldCount; i-- > 0;) {
+    const auto it = firstOld.emplace(oldKeys[i], i);
+    if (it.second) {
+      nextOld[i] = kNotFound;
+    } else {
+      nextOld[i] = it.first->second;
+      it.first->second = i;
+    }
+  }
+
+  // matchedOld[j] is the old index paired with new index j, or kNotFound.
+  std::vector<std::size_t> matchedOld(newCount, kNotFound);
+  std::vector<bool> oldIsMatched(oldCount, false);
+  for (std::size_t j = 0; j < newCount; j++) {
+    const auto it = firstOld.find(newKeys[j]);
+    if (it == firstOld.end()) {
+      continue;
+    }
+    // Old indexes that share the key without being equal stay in the chain for later new indexes.
+    std::size_t *link = &it->second;
+    while (*link != kNotFound && !equal(*link, j)) {
+      link = &nextOld[*link];
+    }
+    const std::size_t i = *link;
+    if (i != kNotFound) {
+      *link = nextOld[i];
+      matchedOld[j] = i;
+      oldIsMatched[i] = true;
+    }
+  }
+
+  if (moves == Moves::All) {
+    for (std::size_t j = 0; j < newCount; j++) {
+      if (matchedOld[j] == kNotFound) {
+        result.insertions.push_back(j);
+      } else if (matchedOld[j] != j) {
+        result.moves.push_back({matchedOld[j], j});
+      }
+    }
+  } else {
+    // Patience sorting: tails[k] is the new index ending the best increasing run of length k + 1,
+    // and previous[j] links each match to its predecessor in such a run.
+    std::vector<std::size_t> tails;
+    std::vector<std::size_t> previous(newCount, kNotFound);
+    for (std::size_t j = 0; j < newCount; j++) {
+      const std::size_t i = matchedOld[j];
+      if (i == kNotFound) {
+        continue;
+      }
+      const auto pos = std::lower_bound(tails.begin(), tails.end(), i, [&](std::size_t tail, std::size_t old) {
+        return matchedOld[tail] < old;
+      });
+      if (pos != tails.begin()) {
+        previous[j] = *(pos - 1);
+      }
+      if (pos == tails.end()) {
+        tails.push_back(j);
+      } else {
+        *pos = j;
+      }
+    }
+
+    std::vector<bool> newIsInRun(newCount, false);
+    for (std::size_t j = tails.empty() ? kNotFound : tails.back(); j != kNotFound; j = previous[j]) {
+      newIsInRun[j] = true;
+    }
+    for (std::size_t j = 0; j < newCount; j++) {
+      if (newIsInRun[j]) {
+        continue;
+      }
+      result.insertions.push_back(j);
+      if (matchedOld[j] != kNotFound) {
+        oldIsMatched[matchedOld[j]] = false;
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < oldCount; i++) {
+    if (!oldIsMatched[i]) {
+      result.deletions.push_back(i);
+    }
+  }
+}
+
+} // namespace Diff
+} // namespace AS
@@ -0,0 +1,239 @@
+//
+//  ASAsyncTransactionDeques.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The operations scheduled on one dispatch queue by ASAsyncTransactionQueue, and the workers draining them.
+
+ Operations are spread across one deque per potential worker, so producers and workers rarely contend on the same
+ lock. Ordering is still that of a single queue: a worker takes the highest-priority operation across all deques,
+ oldest first within a priority, or with respectPriority off, the oldest operation regardless of priority. Each deque
+ publishes its candidates in atomics, so choosing one only locks the deque it is taken from. A worker looks at its
+ own deque first, and takes from it on ties.
+
+ This is not owner-first work stealing: every pop reads the published head of each deque. Display work scheduled at a
+ higher priority must not wait behind preloading in another worker's deque, which owner-first popping would allow.
+ The scan reads a few atomics per deque and costs little next to the work; TransactionQueueBenchmark compares it with
+ owner-first stealing.
+
+ This header must stay free of Foundation and Objective-C so that the scheduler can be benchmarked on its own.
+ Operation must be movable and default-constructible, with a _priority integer and a uint64_t _sequence.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AS {
+
+template <typename Operation>
+class AsyncTransactionDeques
+{
+public:
+  typedef decltype(Operation::_priority) Priority;
+
+  explicit AsyncTransactionDeques(std::size_t count)
+    : _deques(new Deque[count])
+    , _workerSlots(new std::atomic<bool>[count])
+    , _count(count)
+    , _nextDeque(0)
+    , _nextSequence(0)
+    , _operationCount(0)
+    , _workerCount(0)
+  {
+    for (std::size_t i = 0; i < count; ++i) {
+      _workerSlots[i].store(false);
+    }
+  }
+
+  std::size_t count() const { return _count; }
+
+  /// Whether an operation was pushed that no worker has taken yet.
+  bool hasOperations() const { return _operationCount.load() > 0; }
+
+  void push(Operation &&operation)
+  {
+    const std::size_t index = _nextDeque.fetch_add(1, std::memory_order_relaxed) % _count;
+    _deques[index].push(std::move(operation), _nextSequence);
+
+    // Published after the push so that a non-zero count always means the operation can be found.
+    _operationCount.fetch_add(1);
+  }
+
+  /// Takes the next operation, in the order described above. Returns false once there are none left.
+  bool pop(Operation &operation, std::size_t home, bool respectPriority)
+  {
+    while (_operationCount.load() > 0) {
+      Deque *best = nullptr;
+      Priority bestPriority = 0;
+      uint64_t bestSequence = 0;
+      for (std::size_t i = 0; i < _count; ++i) {
+        Deque &deque = _deques[(home + i) % _count];
+        if (deque._size.load(std::memory_order_acquire) == 0) {
+          continue;
+        }
+        const Priority priority = respectPriority ? deque._headPriority.load(std::memory_order_relaxed) : 0;
+        const uint64_t sequence = respectPriority ? deque._headSequence.load(std::memory_order_relaxed)
+                                                  : deque._oldestSequence.load(std::memory_order_relaxed);
+        if (best == nullptr || priority > bestPriority || (priority == bestPriority && sequence < bestSequence)) {
+          best = &deque;
+          bestPriority = priority;
+          bestSequence = sequence;
+        }
+      }
+      if (best != nullptr && best->pop(operation, respectPriority)) {
+        _operationCount.fetch_sub(1);
+        return true;
+      }
+      // Another worker emptied the deque since, and is about to count its pop. Let it run before looking again.
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+  /**
+   * Counts a new worker if fewer than @c limit are running, and gives it the lowest home deque no running worker
+   * has. Returns false if there are enough workers.
+   */
+  bool acquireWorker(std::size_t limit, std::size_t &home)
+  {
+    limit = std::min(limit, _count);
+    std::size_t workerCount = _workerCount.load();
+    do {
+      if (workerCount >= limit) {
+        return false;
+      }
+    } while (!_workerCount.compare_exchange_weak(workerCount, workerCount + 1));
+
+    // Slots are given back before the count drops, so there is one free for every counted worker. One may only
+    // come free behind us, while the releasing worker is between its two stores; yield to it and retry.
+    while (true) {
+      for (std::size_t i = 0; i < _count; ++i) {
+        if (!_workerSlots[i].load(std::memory_order_relaxed) && !_workerSlots[i].exchange(true)) {
+          home = i;
+          return true;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void releaseWorker(std::size_t home)
+  {
+    _workerSlots[home].store(false);
+    _workerCount.fetch_sub(1);
+  }
+
+private:
+  struct Bucket
+  {
+    Priority _priority;
+    std::deque<Operation> _operations;
+  };
+
+  class Deque
+  {
+  public:
+    Deque() : _size(0), _headPriority(0), _headSequence(0), _oldestSequence(0) {}
+
+    void push(Operation &&operation, std::atomic<uint64_t> &nextSequence)
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      // Taken under the lock so that each bucket stays sorted by sequence.
+      operation._sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+
+      auto bucket = _buckets.begin();
+      while (bucket != _buckets.end() && bucket->_priority < operation._priority) {
+        ++bucket;
+      }
+      if (bucket == _buckets.end() || bucket->_priority != operation._priority) {
+        bucket = _buckets.insert(bucket, Bucket());
+        bucket->_priority = operation._priority;
+      }
+      bucket->_operations.push_back(std::move(operation));
+      publish();
+    }
+
+    bool pop(Operation &operation, bool respectPriority)
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      Bucket *next = nullptr;
+      for (auto it = _buckets.rbegin(); it != _buckets.rend(); ++it) {
+        if (it->_operations.empty()) {
+          continue;
+        }
+        if (respectPriority) {
+          next = &*it; // highest priority "bucket"
+          break;
+        }
+        if (next == nullptr || it->_operations.front()._sequence < next->_operations.front()._sequence) {
+          next = &*it; // oldest operation regardless of priority
+        }
+      }
+      if (next == nullptr) {
+        return false;
+      }
+
+      operation = std::move(next->_operations.front());
+      next->_operations.pop_front();
+      publish();
+      return true;
+    }
+
+    std::atomic<std::size_t> _size;
+    std::atomic<Priority> _headPriority;   // of the highest-priority operation
+    std::atomic<uint64_t> _headSequence;   // of the highest-priority operation
+    std::atomic<uint64_t> _oldestSequence; // of the oldest operation
+
+  private:
+    // Assumes the lock is held.
+    void publish()
+    {
+      std::size_t size = 0;
+      const Bucket *head = nullptr;
+      uint64_t oldestSequence = std::numeric_limits<uint64_t>::max();
+      // Buckets are kept around once created since a queue only ever sees a handful of distinct priorities,
+      // which keeps pushes allocation-free in steady state.
+      for (const Bucket &bucket : _buckets) {
+        if (bucket._operations.empty()) {
+          continue;
+        }
+        size += bucket._operations.size();
+        head = &bucket; // buckets ascend by priority
+        oldestSequence = std::min(oldestSequence, bucket._operations.front()._sequence);
+      }
+      if (head != nullptr) {
+        _headPriority.store(head->_priority, std::memory_order_relaxed);
+        _headSequence.store(head->_operations.front()._sequence, std::memory_order_relaxed);
+        _oldestSequence.store(oldestSequence, std::memory_order_relaxed);
+      }
+      _size.store(size, std::memory_order_release);
+    }
+
+    std::vector<Bucket> _buckets; // sorted by ascending priority
+    std::mutex _mutex;
+  };
+
+  std::unique_ptr<Deque[]> _deques;
+  std::unique_ptr<std::atomic<bool>[]> _workerSlots; // whether a running worker has the deque as its home
+  const std::size_t _count;
+  std::atomic<std::size_t> _nextDeque;
+  std::atomic<uint64_t> _nextSequence;
+  std::atomic<std::ptrdiff_t> _operationCount; // operations pushed but not yet popped
+  std::atomic<std::size_t> _workerCount;
+};
+
+} // namespace AS
@@ -0,0 +1,144 @@
+//
+//  ASBufferPool.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ Idle bitmap buffers by size class, used by ASGraphicsCreateImage. Rendering borrows a buffer, and the image made from
+ it owns it until the image is released, when the buffer comes back here instead of being freed.
+
+ This header must stay free of Foundation and Objective-C so that the pool can be benchmarked on its own.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace AS {
+
+class BufferPool
+{
+public:
+  struct Metrics
+  {
+    uint64_t allocationCount;
+    uint64_t reuseCount;
+    std::size_t idleByteCount;
+    std::size_t byteLimit;
+  };
+
+  /// Idle buffers may hold up to @c byteLimit bytes.
+  explicit BufferPool(std::size_t byteLimit) : _idleByteCount(0), _byteLimit(byteLimit), _allocationCount(0), _reuseCount(0) {}
+
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  /// Frees the idle buffers. Borrowed ones must not be given back after this.
+  ~BufferPool()
+  {
+    removeAllBuffers();
+  }
+
+  /// The capacity of the buffer that holds @c byteCount bytes. Four classes per doubling, so at most a quarter is
+  /// wasted while nearby sizes share buffers.
+  static std::size_t sizeClass(std::size_t byteCount)
+  {
+    const std::size_t minimum = 16 * 1024;
+    if (byteCount <= minimum) {
+      return minimum;
+    }
+    const std::size_t step = (std::size_t(1) << (63 - __builtin_clzll(byteCount - 1))) / 4;
+    return (byteCount + step - 1) / step * step;
+  }
+
+  /// A buffer of @c capacity bytes, which must be a size class, or null if none could be allocated.
+  void *borrow(std::size_t capacity)
+  {
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      auto it = _idleBuffers.find(capacity);
+      if (it != _idleBuffers.end() && !it->second.empty()) {
+        void *buffer = it->second.back();
+        it->second.pop_back();
+        _idleByteCount -= capacity;
+        _reuseCount.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+      }
+    }
+    _allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(capacity);
+  }
+
+  /// Keeps @c buffer, borrowed with @c capacity, for reuse, or frees it if that would go over the limit.
+  void giveBack(void *buffer, std::size_t capacity)
+  {
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      if (_idleByteCount + capacity <= _byteLimit) {
+        _idleBuffers[capacity].push_back(buffer);
+        _idleByteCount += capacity;
+        return;
+      }
+    }
+    std::free(buffer);
+  }
+
+  void setByteLimit(std::size_t byteLimit)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _byteLimit = byteLimit;
+    trim();
+  }
+
+  /// Frees every idle buffer, as on memory pressure. The limit is unchanged.
+  void removeAllBuffers()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    const std::size_t byteLimit = _byteLimit;
+    _byteLimit = 0;
+    trim();
+    _byteLimit = byteLimit;
+  }
+
+  Metrics metrics()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return {_allocationCount.load(std::memory_order_relaxed), _reuseCount.load(std::memory_order_relaxed),
+            _idleByteCount, _byteLimit};
+  }
+
+private:
+  /// Frees idle buffers, largest first, until under the limit. Called with the mutex held.
+  void trim()
+  {
+    while (_idleByteCount > _byteLimit) {
+      auto largest = _idleBuffers.end();
+      for (auto it = _idleBuffers.begin(); it != _idleBuffers.end(); ++it) {
+        if (!it->second.empty() && (largest == _idleBuffers.end() || it->first > largest->first)) {
+          largest = it;
+        }
+      }
+      std::free(largest->second.back());
+      largest->second.pop_back();
+      _idleByteCount -= largest->first;
+    }
+  }
+
+  std::mutex _mutex;
+  std::unordered_map<std::size_t, std::vector<void *>> _idleBuffers;
+  std::size_t _idleByteCount;
+  std::size_t _byteLimit;
+  std::atomic<uint64_t> _allocationCount;
+  std::atomic<uint64_t> _reuseCount;
+};
+
+} // namespace AS
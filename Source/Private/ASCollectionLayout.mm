@@ -22,7 +22,6 @@
 #import "ASDisplayNode+FrameworkPrivate.h"
 #import "ASElementMap.h"
 #import "ASEqualityHelpers.h"
-#import "ASPageTable.h"
 
 static const ASRangeTuningParameters kASDefaultMeasureRangeTuningParameters = {
   .leadingBufferScreenfuls = 2.0,
@@ -138,6 +137,17 @@ static const ASScrollDirection kASStaticScrollDirection = (ASScrollDirectionRigh
     // A new layout is needed now. Calculate and apply it immediately
     _layout = [ASCollectionLayout calculateLayoutWithContext:context];
   }
+
+  // A progressive layout's content size changes as it lays out more items. Keep the layout, but have the collection
+  // view ask for the new size.
+  __weak __typeof__(self) weakSelf = self;
+  __weak ASCollectionLayoutState *weakLayout = _layout;
+  _layout.contentSizeDidChangeBlock = ^{
+    __typeof__(self) strongSelf = weakSelf;
+    if (strongSelf != nil && strongSelf->_layout == weakLayout) {
+      [strongSelf invalidateLayoutWithContext:[[[[strongSelf class] invalidationContextClass] alloc] init]];
+    }
+  };
 }
 
 - (void)invalidateLayout
@@ -296,39 +306,21 @@ static const ASScrollDirection kASStaticScrollDirection = (ASScrollDirectionRigh
   }
 
   // Step 2: Get layout attributes of all elements within the specified outer rect
-  ASPageToLayoutAttributesTable *attrsTable = [layout getAndRemoveUnmeasuredLayoutAttributesPageTableInRect:rect];
-  if (attrsTable.count == 0) {
+  NSArray<NSCollectionViewLayoutAttributes *> *unmeasuredAttrs = [layout getAndRemoveUnmeasuredLayoutAttributesInRect:rect];
+  if (unmeasuredAttrs.count == 0) {
     // No elements in this rect! Bail early
     return;
   }
 
   // Step 3: Split all those attributes into blocking and non-blocking buckets
-  // Use ordered sets here because some items may span multiple pages, and the sets will be accessed by indexes later on.
   ASCollectionLayoutContext *context = layout.context;
-  CGSize pageSize = context.viewportSize;
-  NSMutableOrderedSet<NSCollectionViewLayoutAttributes *> *blockingAttrs = hasBlockingRect ? [NSMutableOrderedSet orderedSet] : nil;
-  NSMutableOrderedSet<NSCollectionViewLayoutAttributes *> *nonBlockingAttrs = [NSMutableOrderedSet orderedSet];
-  for (id pagePtr in attrsTable) {
-    ASPageCoordinate page = (ASPageCoordinate)pagePtr;
-    NSArray<NSCollectionViewLayoutAttributes *> *attrsInPage = [attrsTable objectForPage:page];
-    // Calculate the page's rect but only if it's going to be used.
-    CGRect pageRect = hasBlockingRect ? ASPageCoordinateGetPageRect(page, pageSize) : CGRectZero;
-
-    if (hasBlockingRect && CGRectContainsRect(blockingRect, pageRect)) {
-      // The page fits well within the blocking rect. All attributes in this page are blocking.
-      [blockingAttrs addObjectsFromArray:attrsInPage];
-    } else if (hasBlockingRect && CGRectIntersectsRect(blockingRect, pageRect)) {
-      // The page intersects the blocking rect. Some elements in this page are blocking, some are not.
-      for (NSCollectionViewLayoutAttributes *attrs in attrsInPage) {
-        if (CGRectIntersectsRect(blockingRect, attrs.frame)) {
-          [blockingAttrs addObject:attrs];
-        } else {
-          [nonBlockingAttrs addObject:attrs];
-        }
-      }
+  NSMutableArray<NSCollectionViewLayoutAttributes *> *blockingAttrs = hasBlockingRect ? [NSMutableArray array] : nil;
+  NSMutableArray<NSCollectionViewLayoutAttributes *> *nonBlockingAttrs = [NSMutableArray array];
+  for (NSCollectionViewLayoutAttributes *attrs in unmeasuredAttrs) {
+    if (hasBlockingRect && CGRectIntersectsRect(blockingRect, attrs.frame)) {
+      [blockingAttrs addObject:attrs];
     } else {
-      // The page doesn't intersect the blocking rect. All elements in this page are non-blocking.
-      [nonBlockingAttrs addObjectsFromArray:attrsInPage];
+      [nonBlockingAttrs addObject:attrs];
     }
   }
 
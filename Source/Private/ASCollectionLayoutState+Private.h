@@ -7,18 +7,59 @@
 //
 
 #import "ASCollectionLayoutState.h"
-#import "ASPageTable.h"
+#import "ASDimension.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * The geometry of a layout whose items all have the same size and flow in lines, in index order across sections.
+ * Lines run across the scrollable direction, like rows in a vertically scrolling layout.
+ */
+typedef struct {
+  CGSize itemSize;
+  CGFloat lineSpacing;
+  CGFloat interitemSpacing;
+  NSEdgeInsets sectionInset;
+} ASCollectionLayoutGridGeometry;
+
 @interface ASCollectionLayoutState (Private)
 
 /**
- * Remove and returns layout attributes for unmeasured elements that intersect the specified rect
+ * Initializes a state that computes the frames of its items from the grid geometry, rather than storing them.
+ * Layout attributes are created only for the elements that are asked for. Supplementary elements are not supported.
+ *
+ * @param context The context used to calculate this object. Its item sizes must all be @c geometry.itemSize.
+ */
+- (instancetype)initWithContext:(ASCollectionLayoutContext *)context gridGeometry:(ASCollectionLayoutGridGeometry)geometry;
+
+/**
+ * Initializes a state that lays out the items of a flow layout progressively, with a horizontal stack that wraps its
+ * items into lines and aligns everything to the start. Supplementary elements are not supported.
+ *
+ * @discussion Only the items of the first viewport are measured and laid out here. Further items are laid out in chunks,
+ * synchronously when they are asked for and in the background when they are measured ahead of time, and their nodes
+ * are allocated as they are. Until every item is laid out, the content size is an estimate that grows or shrinks
+ * with each chunk, see @c contentSizeDidChangeBlock.
+ *
+ * @param context The context used to calculate this object.
+ *
+ * @param sizeRange The size range of the whole layout. Lines are as long as its maximum width.
+ */
+- (instancetype)initWithContext:(ASCollectionLayoutContext *)context flowLayoutSizeRange:(ASSizeRange)sizeRange;
+
+/**
+ * Called on the main thread when laying out more items changed the content size of a progressive layout, at most once
+ * per run loop turn however many chunks were laid out. Main thread only.
+ */
+@property (nullable, copy) void (^contentSizeDidChangeBlock)(void);
+
+/**
+ * Remove and returns layout attributes for unmeasured elements that intersect the specified rect, or nil if there are none.
+ * Each attributes object is returned once, in order along the scrollable direction.
  *
  * @discussion This method is atomic and thread-safe
  */
-- (nullable ASPageToLayoutAttributesTable *)getAndRemoveUnmeasuredLayoutAttributesPageTableInRect:(CGRect)rect;
+- (nullable NSArray<NSCollectionViewLayoutAttributes *> *)getAndRemoveUnmeasuredLayoutAttributesInRect:(CGRect)rect;
 
 @end
 
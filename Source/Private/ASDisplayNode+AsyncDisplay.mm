@@ -10,6 +10,7 @@
 #import "_ASCoreAnimationExtras.h"
 #import "_ASAsyncTransaction.h"
 #import "_ASDisplayLayer.h"
+#import "_ASDisplayTiles.h"
 #import "ASDisplayNodeInternal.h"
 #import "ASGraphicsContext.h"
 #import "ASInternalHelpers.h"
@@ -19,6 +20,8 @@
 
 using AS::MutexLocker;
 
+typedef NSImage * _Nullable (^asdisplaynode_tile_display_block_t)(CGRect tileRect);
+
 @interface ASDisplayNode () <_ASDisplayLayerDelegate>
 @end
 
@@ -435,6 +438,242 @@ NS_INLINE CGPathRef CGPathCreateWithNSBezierPath(NSBezierPath *bezierPath) {
     return path;
 }
 
+#pragma mark - Tiled Display
+
+- (BOOL)_locked_shouldDisplayTiled
+{
+  if (!_flags.displaysTiled || !_flags.implementsDrawRect || _flags.implementsImageDisplay || _flags.rasterizesSubtree) {
+    return NO;
+  }
+  // Precomposited corners are drawn over the whole bounds, not per tile.
+  if (_cornerRoundingType == ASCornerRoundingTypePrecomposited && _cornerRadius > 0.0) {
+    return NO;
+  }
+  CGSize boundsSize = self.bounds.size;
+  return boundsSize.width > _displayTileSize.width || boundsSize.height > _displayTileSize.height;
+}
+
+/**
+ * The nearest node, self included, that is backed by a view, whose visible rect bounds what of the node is visible.
+ */
+- (ASDisplayNode *)_displayTilesHostNode
+{
+  for (ASDisplayNode *node = self; node != nil; node = node.supernode) {
+    if (node.isNodeLoaded && !node.isLayerBacked) {
+      return node;
+    }
+  }
+  return nil;
+}
+
+- (CGRect)_displayTilesVisibleRect
+{
+  ASDisplayNodeAssertMainThread();
+  ASDisplayNode *hostNode = [self _displayTilesHostNode];
+  NSView *hostView = hostNode.view;
+  if (hostView.window == nil) {
+    return CGRectNull;
+  }
+  CGRect visibleRect = hostView.visibleRect;
+  return (hostNode == self ? visibleRect : [self convertRect:visibleRect fromNode:hostNode]);
+}
+
+/**
+ * Returns a block that draws the part of the node in a tile, with the draw parameters captured now. Like the display
+ * block, but only for nodes that implement +drawRect:withParameters:isCancelled:isRasterizing:.
+ */
+- (asdisplaynode_tile_display_block_t)_tileDisplayBlockWithIsCancelledBlock:(asdisplaynode_iscancelled_block_t)isCancelledBlock
+{
+  ASDisplayNodeAssertMainThread();
+
+  __instanceLock__.lock();
+  BOOL opaque = self.opaque;
+  CGRect bounds = self.bounds;
+  NSColor *backgroundColor = self.backgroundColor;
+  CGColorRef borderColor = self.borderColor;
+  CGFloat borderWidth = self.borderWidth;
+  CGFloat contentsScaleForDisplay = _contentsScaleForDisplay;
+  __instanceLock__.unlock();
+
+  id drawParameters = [self drawParameters];
+
+  if (CGRectIsEmpty(bounds)) {
+    return nil;
+  }
+
+  return ^NSImage *(CGRect tileRect) {
+    CHECK_CANCELLED_AND_RETURN_NIL();
+
+    return ASGraphicsCreateImage(self.primitiveTraitCollection, tileRect.size, opaque, contentsScaleForDisplay, nil, isCancelledBlock, ^{
+      CGContextRef currentContext = [[NSGraphicsContext currentContext] CGContext];
+      if (!currentContext) {
+        ASDisplayNodeAssert(NO, @"Failed to create a CGContext (size: %@)", NSStringFromSize(tileRect.size));
+        return;
+      }
+
+      // The node gets its whole bounds, as when it is not tiled, shifted so that the tile lands in the context.
+      // The clip tells it which part is being drawn, and anything it draws outside the tile is discarded.
+      CGContextTranslateCTM(currentContext, -CGRectGetMinX(tileRect), -CGRectGetMinY(tileRect));
+      CGContextClipToRect(currentContext, tileRect);
+
+      NSImage *image = nil;
+      [self __willDisplayNodeContentWithRenderingContext:currentContext drawParameters:drawParameters];
+      [self.class drawRect:bounds withParameters:drawParameters isCancelled:isCancelledBlock isRasterizing:NO];
+      [self __didDisplayNodeContentWithRenderingContext:currentContext image:&image drawParameters:drawParameters backgroundColor:backgroundColor borderWidth:borderWidth borderColor:borderColor];
+      ASDN_DELAY_FOR_DISPLAY();
+    });
+  };
+}
+
+- (void)_displayTilesOfLayer:(CALayer *)layer
+{
+  ASDisplayNodeAssertMainThread();
+
+  uint displaySentinelValue = ++_displaySentinel;
+  __weak ASDisplayNode *weakSelf = self;
+  asdisplaynode_iscancelled_block_t isCancelledBlock = ^BOOL{
+    __strong ASDisplayNode *self = weakSelf;
+    return self == nil || (displaySentinelValue != self->_displaySentinel.load());
+  };
+
+  asdisplaynode_tile_display_block_t tileDisplayBlock = [self _tileDisplayBlockWithIsCancelledBlock:isCancelledBlock];
+  if (!tileDisplayBlock) {
+    return;
+  }
+
+  __instanceLock__.lock();
+  CGRect bounds = self.bounds;
+  CGSize tileSize = _displayTileSize;
+  __instanceLock__.unlock();
+
+  if (_displayTiles == nil) {
+    _displayTiles = [[_ASDisplayTiles alloc] initWithNode:self];
+  }
+  CALayer *containerLayer = _displayTiles.containerLayer;
+  if (containerLayer.superlayer != layer) {
+    // Behind the layers of subnodes.
+    [layer insertSublayer:containerLayer atIndex:0];
+  }
+  layer.contents = nil;
+
+  std::vector<ASDisplayTile> tiles = [_displayTiles tilesForBounds:bounds tileSize:tileSize visibleRect:[self _displayTilesVisibleRect]];
+
+  [self willDisplayAsyncLayer:self.asyncLayer asynchronously:YES];
+  [self _displayTiles:tiles withBlock:tileDisplayBlock isCancelledBlock:isCancelledBlock notifyDidDisplay:YES];
+}
+
+/**
+ * Draws the tiles, in order. Visible tiles join the layer's async transaction, so they appear in the same frame as
+ * the rest of the hierarchy. Tiles outside the visible rect are drawn one after another in a single block on the
+ * display queue, and each is shown as soon as it is drawn.
+ */
+- (void)_displayTiles:(const std::vector<ASDisplayTile> &)tiles
+            withBlock:(asdisplaynode_tile_display_block_t)tileDisplayBlock
+     isCancelledBlock:(asdisplaynode_iscancelled_block_t)isCancelledBlock
+     notifyDidDisplay:(BOOL)notifyDidDisplay
+{
+  ASDisplayNodeAssertMainThread();
+
+  _ASDisplayTiles *displayTiles = _displayTiles;
+  CALayer *layer = displayTiles.containerLayer.superlayer;
+  CGFloat contentsScale = self.contentsScale;
+  NSInteger drawingPriority = self.drawingPriority;
+  CGRect visibleRect = [self _displayTilesVisibleRect];
+  dispatch_queue_t displayQueue = [_ASDisplayLayer displayQueue];
+  _ASAsyncTransaction *transaction = nil;
+
+  // Only touched on the main thread.
+  __block NSUInteger remainingTileCount = tiles.size();
+  NSMutableArray<dispatch_block_t> *offscreenBlocks = nil;
+
+  for (const ASDisplayTile &tile : tiles) {
+    ASDisplayTile blockTile = tile;
+    asyncdisplaykit_async_transaction_operation_block_t displayBlock = ^id{
+      return tileDisplayBlock(blockTile.rect);
+    };
+    asyncdisplaykit_async_transaction_operation_completion_block_t completionBlock = ^(id<NSObject> value, BOOL canceled){
+      ASDisplayNodeCAssertMainThread();
+      if (canceled || isCancelledBlock()) {
+        return;
+      }
+      [displayTiles setImage:(NSImage *)value contentsScale:contentsScale forTile:blockTile];
+      if (--remainingTileCount == 0 && notifyDidDisplay) {
+        [self didDisplayAsyncLayer:self.asyncLayer];
+      }
+    };
+
+    if (CGRectIntersectsRect(tile.rect, visibleRect)) {
+      if (transaction == nil) {
+        CALayer *containerLayer = layer.asyncdisplaykit_parentTransactionContainer ? : layer;
+        transaction = containerLayer.asyncdisplaykit_asyncTransaction;
+      }
+      [transaction addOperationWithBlock:displayBlock priority:drawingPriority queue:displayQueue completion:completionBlock];
+    } else {
+      dispatch_block_t offscreenBlock = ^{
+        id value = displayBlock();
+        dispatch_async(dispatch_get_main_queue(), ^{
+          completionBlock(value, NO);
+        });
+      };
+      if (offscreenBlocks == nil) {
+        offscreenBlocks = [[NSMutableArray alloc] init];
+      }
+      [offscreenBlocks addObject:offscreenBlock];
+    }
+  }
+
+  if (offscreenBlocks != nil) {
+    dispatch_async(displayQueue, ^{
+      for (dispatch_block_t block in offscreenBlocks) {
+        // Tiles of a cancelled display return nil right away, and their completion ignores them.
+        block();
+      }
+    });
+  }
+}
+
+- (void)_evictDisplayTilesOutsideVisibleRect
+{
+  ASDisplayNodeAssertMainThread();
+  if (_displayTiles == nil) {
+    return;
+  }
+  if ([_displayTiles evictTilesOutsideRect:[self _displayTilesVisibleRect]]) {
+    ASDisplayNode *hostNode = [self _displayTilesHostNode];
+    if (hostNode) {
+      [_displayTiles observeScrollingOfView:hostNode.view];
+    }
+  }
+}
+
+- (void)_displayEvictedTiles
+{
+  ASDisplayNodeAssertMainThread();
+
+  std::vector<ASDisplayTile> tiles = [_displayTiles takeEvictedTilesInRect:[self _displayTilesVisibleRect]];
+  if (!_displayTiles.hasEvictedTiles) {
+    [_displayTiles stopObservingScrolling];
+  }
+  if (tiles.empty()) {
+    return;
+  }
+
+  // Cancelled by the next display, like the tiles drawn by the current one.
+  uint displaySentinelValue = _displaySentinel.load();
+  __weak ASDisplayNode *weakSelf = self;
+  asdisplaynode_iscancelled_block_t isCancelledBlock = ^BOOL{
+    __strong ASDisplayNode *self = weakSelf;
+    return self == nil || (displaySentinelValue != self->_displaySentinel.load());
+  };
+
+  asdisplaynode_tile_display_block_t tileDisplayBlock = [self _tileDisplayBlockWithIsCancelledBlock:isCancelledBlock];
+  if (tileDisplayBlock) {
+    [self _displayTiles:tiles withBlock:tileDisplayBlock isCancelledBlock:isCancelledBlock notifyDidDisplay:NO];
+  }
+}
+
+#pragma mark - Display
+
 - (void)displayAsyncLayer:(_ASDisplayLayer *)asyncLayer asynchronously:(BOOL)asynchronously
 {
   ASDisplayNodeAssertMainThread();
@@ -448,9 +687,16 @@ NS_INLINE CGPathRef CGPathCreateWithNSBezierPath(NSBezierPath *bezierPath) {
   
   CALayer *layer = _layer;
   BOOL rasterizesSubtree = _flags.rasterizesSubtree;
+  BOOL displaysTiled = asynchronously && [self _locked_shouldDisplayTiled];
   
   __instanceLock__.unlock();
 
+  if (displaysTiled) {
+    [self _displayTilesOfLayer:layer];
+    return;
+  }
+  [_displayTiles removeAllTiles];
+
   // for async display, capture the current displaySentinel value to bail early when the job is executed if another is
   // enqueued
   // for sync display, do not support cancellation
@@ -262,6 +262,17 @@ __unused static NSString * _Nonnull NSStringFromASHierarchyStateChange(ASHierarc
  */
 - (void)_u_setNeedsLayoutFromAbove;
 
+/**
+ * @abstract Invoked on the supernode of a node that needs a different size. Escalates like -_u_setNeedsLayoutFromAbove
+ * unless the receiver's style fixes its width and height in points, with width and height or with equal minimum and
+ * maximum, and it was laid out at that size. In that case only the receiver is laid out again.
+ *
+ * @discussion Flexible and content-sized nodes are never boundaries, so a size change below them still escalates to
+ * the root. The root pass is incremental only at display node granularity: a node whose _layoutVersion, constrained
+ * size and parent size are unchanged reuses its cached layout, while layout specs are regenerated on every pass.
+ */
+- (void)_u_setNeedsLayoutForSubnodeSizeChange;
+
 /**
  * @abstract Subclass hook for nodes that are acting as root nodes. This method is called if one of the subnodes
  * size is invalidated and may need to result in a different size as the current calculated size.
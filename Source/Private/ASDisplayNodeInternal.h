@@ -13,6 +13,7 @@
 //
 
 #import <atomic>
+#import <memory>
 #import "ASDisplayNode.h"
 #import "ASDisplayNode+Beta.h"
 #import "ASDisplayNode+FrameworkPrivate.h"
@@ -27,6 +28,7 @@ NS_ASSUME_NONNULL_BEGIN
 @protocol _ASDisplayLayerDelegate;
 @class _ASDisplayLayer;
 @class _ASPendingState;
+@class _ASDisplayTiles;
 @class ASNodeController;
 struct ASDisplayNodeFlags;
 
@@ -91,6 +93,7 @@ static constexpr CACornerMask kASCACornerAllCorners =
     unsigned viewEverHadAGestureRecognizerAttached:1;
     unsigned layerBacked:1;
     unsigned displaysAsynchronously:1;
+    unsigned displaysTiled:1;
     unsigned rasterizesSubtree:1;
     unsigned shouldBypassEnsureDisplay:1;
     unsigned displaySuspended:1;
@@ -202,6 +205,8 @@ static constexpr CACornerMask kASCACornerAllCorners =
   /// Sentinel for layout data. Incremented when we get -setNeedsLayout / -invalidateCalculatedLayout.
   /// Starts at 1.
   std::atomic<NSUInteger> _layoutVersion;
+  /// Layouts for size ranges other than the pending one, created once the node is measured at a second size range.
+  std::unique_ptr<ASDisplayNodeLayoutCache> _layoutCache;
 
 
   // Layout Spec performance measurement
@@ -209,6 +214,8 @@ static constexpr CACornerMask kASCACornerAllCorners =
   NSInteger _layoutSpecNumberOfPasses;
   NSTimeInterval _layoutComputationTotalTime;
   NSInteger _layoutComputationNumberOfPasses;
+  NSInteger _layoutCacheHitCount;
+  NSInteger _layoutCacheMissCount;
 
 
   // View Loading
@@ -226,6 +233,10 @@ static constexpr CACornerMask kASCACornerAllCorners =
   // keeps track of nodes/subnodes that have not finished display, used with placeholders
   ASWeakSet *_pendingDisplayNodes;
 
+  // Tiled display support
+  CGSize _displayTileSize;
+  _ASDisplayTiles *_displayTiles; // Main thread only
+
 
   // Corner Radius support
   CGFloat _cornerRadius;
@@ -328,6 +339,12 @@ static constexpr CACornerMask kASCACornerAllCorners =
 /// Display the node's view/layer immediately on the current thread, bypassing the background thread rendering. Will be deprecated.
 - (void)displayImmediately;
 
+/// Releases the display tiles outside the visible rect, to be displayed again when they scroll into view.
+- (void)_evictDisplayTilesOutsideVisibleRect;
+
+/// Displays the evicted display tiles that are now in the visible rect.
+- (void)_displayEvictedTiles;
+
 /// Refreshes any precomposited or drawn clip corners, setting up state as required to transition corner config.
 - (void)updateCornerRoundingWithType:(ASCornerRoundingType)newRoundingType
                         cornerRadius:(CGFloat)newCornerRadius
@@ -13,6 +13,17 @@
 
 @class ASLayout;
 
+/*
+ * Parent sizes compare equal if every dimension is equal or undefined in both, so that layouts measured against an
+ * undefined parent dimension (see ASLayoutElementParentDimensionUndefined) can be reused. A plain CGSizeEqualToSize
+ * never matches them because NaN is unequal to itself.
+ */
+ASDISPLAYNODE_INLINE BOOL ASDisplayNodeLayoutParentSizeEqualToParentSize(CGSize lhs, CGSize rhs)
+{
+  return (lhs.width == rhs.width || (isnan(lhs.width) && isnan(rhs.width)))
+      && (lhs.height == rhs.height || (isnan(lhs.height) && isnan(rhs.height)));
+}
+
 /*
  * Represents a connection between an ASLayout and a ASDisplayNode
  * ASDisplayNode uses this to store additional information that are necessary besides the layout
@@ -52,7 +63,79 @@ struct ASDisplayNodeLayout {
    */
   BOOL isValid(ASSizeRange theConstrainedSize, CGSize theParentSize, NSUInteger versionArg) {
     return isValid(versionArg)
-    && CGSizeEqualToSize(parentSize, theParentSize)
+    && ASDisplayNodeLayoutParentSizeEqualToParentSize(parentSize, theParentSize)
     && ASSizeRangeEqualToSizeRange(constrainedSize, theConstrainedSize);
   }
 };
+
+/*
+ * A small LRU of display node layouts, keyed by constrained size, parent size and version.
+ * ASDisplayNode keeps one next to its pending layout so that a node measured at several size ranges within one
+ * layout pass (e.g. a stack child measured at its intrinsic size and again at its flexed size) doesn't recalculate
+ * a layout it already has.
+ */
+struct ASDisplayNodeLayoutCache {
+  static const NSUInteger kCapacity = 4;
+
+  ASDisplayNodeLayoutCache() : _clock(0) {
+    for (NSUInteger i = 0; i < kCapacity; i++) {
+      _lastUse[i] = 0;
+    }
+  };
+
+  /**
+   * Returns the cached layout for the given constrained size, parent size and version, or nil if there is none.
+   */
+  ASLayout *layout(ASSizeRange constrainedSize, CGSize parentSize, NSUInteger version) {
+    for (NSUInteger i = 0; i < kCapacity; i++) {
+      if (_entries[i].isValid(constrainedSize, parentSize, version)) {
+        _lastUse[i] = ++_clock;
+        return _entries[i].layout;
+      }
+    }
+    return nil;
+  }
+
+  /**
+   * Adds a display node layout. It replaces the entry for the same constrained and parent size if there is one, or
+   * else an outdated or the least recently used entry if the cache is full.
+   */
+  void add(const ASDisplayNodeLayout &displayNodeLayout, NSUInteger version) {
+    for (NSUInteger i = 0; i < kCapacity; i++) {
+      if (ASSizeRangeEqualToSizeRange(_entries[i].constrainedSize, displayNodeLayout.constrainedSize)
+          && ASDisplayNodeLayoutParentSizeEqualToParentSize(_entries[i].parentSize, displayNodeLayout.parentSize)) {
+        _entries[i] = displayNodeLayout;
+        _lastUse[i] = ++_clock;
+        return;
+      }
+    }
+
+    NSUInteger slot = 0;
+    for (NSUInteger i = 0; i < kCapacity; i++) {
+      if (!_entries[i].isValid(version)) {
+        slot = i;
+        break;
+      }
+      if (_lastUse[i] < _lastUse[slot]) {
+        slot = i;
+      }
+    }
+    _entries[slot] = displayNodeLayout;
+    _lastUse[slot] = ++_clock;
+  }
+
+  /**
+   * Drops all cached layouts.
+   */
+  void removeAll() {
+    for (NSUInteger i = 0; i < kCapacity; i++) {
+      _entries[i] = ASDisplayNodeLayout();
+      _lastUse[i] = 0;
+    }
+  }
+
+private:
+  ASDisplayNodeLayout _entries[kCapacity];
+  NSUInteger _lastUse[kCapacity];
+  NSUInteger _clock;
+};
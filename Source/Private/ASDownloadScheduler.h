@@ -0,0 +1,137 @@
+//
+//  ASDownloadScheduler.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ Decides which downloads ASBasicImageDownloader runs: at most a given number at once, and of those waiting, the one
+ with the highest priority first.
+
+ Priorities change while downloads wait, as nodes move between ranges, so the next download is picked when a slot
+ frees up rather than when it is scheduled. Waiting downloads that are no longer active, because every request for
+ them was cancelled, are dropped then without ever starting.
+
+ This header must stay free of Foundation and Objective-C so that the scheduler can be tested on its own. Download
+ must be copyable and equality-comparable; under ARC, it may be an object pointer.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace AS {
+
+template <typename Download>
+class DownloadScheduler
+{
+public:
+  explicit DownloadScheduler(std::size_t maximumRunning = 6) : _maximumRunning(std::max<std::size_t>(1, maximumRunning)) {}
+
+  DownloadScheduler(const DownloadScheduler &) = delete;
+  DownloadScheduler &operator=(const DownloadScheduler &) = delete;
+
+  std::size_t maximumRunning()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _maximumRunning;
+  }
+
+  /// Takes effect as downloads start and finish; running downloads over a lowered maximum are not stopped.
+  void setMaximumRunning(std::size_t maximumRunning)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _maximumRunning = std::max<std::size_t>(1, maximumRunning);
+  }
+
+  /// Adds @c download to those waiting, unless it is already waiting or running. Returns whether it was added.
+  bool schedule(const Download &download)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    if (contains(_pending, download) || contains(_running, download)) {
+      return false;
+    }
+    _pending.push_back(download);
+    return true;
+  }
+
+  /// Removes @c download if it is waiting.
+  void remove(const Download &download)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _pending.erase(std::remove(_pending.begin(), _pending.end(), download), _pending.end());
+  }
+
+  /**
+   * If fewer than the maximum are running, moves the waiting download with the highest priority to those running and
+   * returns true; the oldest wins ties. Returns false if none may start or none is waiting.
+   *
+   * Priority and IsActive are called with the scheduler locked, as priority(download) and isActive(download). Waiting
+   * downloads that are not active are dropped.
+   */
+  template <typename Priority, typename IsActive>
+  bool startNext(Download &download, const Priority &priority, const IsActive &isActive)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_running.size() >= _maximumRunning) {
+      return false;
+    }
+    _pending.erase(std::remove_if(_pending.begin(), _pending.end(), [&](const Download &d) {
+      return !isActive(d);
+    }), _pending.end());
+    if (_pending.empty()) {
+      return false;
+    }
+
+    auto next = _pending.begin();
+    auto nextPriority = priority(*next);
+    for (auto it = next + 1; it != _pending.end(); ++it) {
+      const auto p = priority(*it);
+      if (p > nextPriority) {
+        next = it;
+        nextPriority = p;
+      }
+    }
+    download = *next;
+    _pending.erase(next);
+    _running.push_back(download);
+    return true;
+  }
+
+  /// Frees the slot of a running download, once it finished or failed to start.
+  void finish(const Download &download)
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    _running.erase(std::remove(_running.begin(), _running.end(), download), _running.end());
+  }
+
+  std::size_t pendingCount()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _pending.size();
+  }
+
+  std::size_t runningCount()
+  {
+    std::lock_guard<std::mutex> l(_mutex);
+    return _running.size();
+  }
+
+private:
+  static bool contains(const std::vector<Download> &downloads, const Download &download)
+  {
+    return std::find(downloads.begin(), downloads.end(), download) != downloads.end();
+  }
+
+  std::mutex _mutex;
+  std::vector<Download> _pending; // Oldest first.
+  std::vector<Download> _running;
+  std::size_t _maximumRunning;
+};
+
+} // namespace AS
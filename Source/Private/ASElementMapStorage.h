@@ -0,0 +1,145 @@
+//
+//  ASElementMapStorage.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import <Foundation/Foundation.h>
+#import <memory>
+#import <vector>
+#import "ASElementMap.h"
+#import "ASThread.h"
+
+@class ASMutableElementMap;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * An open-addressing hash table from elements to integers, with linear probing. Elements are neither retained nor
+ * messaged, only compared by pointer.
+ */
+class ASElementIntegerTable {
+public:
+  ASElementIntegerTable() : _count(0) {}
+
+  /// Returns the integer for the element, or NSNotFound.
+  NSInteger find(ASCollectionElement *element) const;
+
+  /// Adds the element, or replaces its integer.
+  void set(ASCollectionElement *element, NSInteger value);
+
+  void reserve(size_t count);
+
+  size_t count() const { return _count; }
+
+private:
+  struct Slot {
+    const void *key;
+    NSInteger value;
+  };
+  std::vector<Slot> _slots; // A power of two in size, at most half full.
+  size_t _count;
+
+  size_t slotIndex(const void *key) const;
+};
+
+/**
+ * The items of one section of an element map. Maps share sections, and a mutable map copies one before changing it,
+ * so an update costs as much as the sections it changes.
+ */
+struct ASElementMapSection {
+  /// Identifies the section and its copies, which hold the same elements apart from those added and removed since.
+  NSInteger lineage;
+  std::vector<ASCollectionElement *> items;
+  /// Item -> index in @c items. Only valid once indexed, which is done before a section is shared.
+  ASElementIntegerTable itemIndexes;
+  bool isIndexed;
+
+  /// A new, empty section with a lineage of its own.
+  static std::shared_ptr<ASElementMapSection> make();
+
+  /// A copy of the section that can be changed, with the same lineage.
+  std::shared_ptr<ASElementMapSection> mutableCopy() const;
+
+  void index();
+};
+
+typedef std::vector<std::shared_ptr<ASElementMapSection>> ASElementMapSections;
+
+/**
+ * Item -> the lineage of its section, shared by an element map and the maps derived from it. Entries are only ever
+ * added, so those of removed items linger, and lookups are confirmed against the items of the section. An item stays
+ * in the section it was inserted into, since the data controller inserts new elements for items that move.
+ * Thread-safe, since maps are read on many threads while a newer one is populated.
+ */
+class ASElementLineageTable {
+public:
+  NSInteger lineageForElement(ASCollectionElement *element);
+
+  void addSection(const ASElementMapSection &section);
+
+  size_t count();
+
+private:
+  AS::Mutex _lock;
+  ASElementIntegerTable _table;
+};
+
+/**
+ * The supplementary elements of one kind, and the index path of each, built on first use. Maps with the same
+ * elements of a kind hold the same dictionary of them, and share its index. Thread-safe.
+ */
+class ASSupplementaryElementIndex {
+public:
+  ASSupplementaryElementIndex(NSString *kind, NSDictionary<NSIndexPath *, ASCollectionElement *> *elements)
+      : _kind(kind), _elements(elements), _allElements(nil), _indexPaths(nil) {}
+
+  NSString *kind() const { return _kind; }
+
+  NSDictionary<NSIndexPath *, ASCollectionElement *> *elements() const { return _elements; }
+
+  NSArray<ASCollectionElement *> *allElements();
+
+  NSIndexPath *_Nullable indexPathForElement(ASCollectionElement *element);
+
+private:
+  AS::Mutex _lock;
+  NSString *_kind;
+  NSDictionary<NSIndexPath *, ASCollectionElement *> *_elements;
+  NSArray<ASCollectionElement *> *_allElements;
+  NSMapTable<ASCollectionElement *, NSIndexPath *> *_indexPaths;
+};
+
+typedef std::vector<std::shared_ptr<ASSupplementaryElementIndex>> ASSupplementaryElementIndexes;
+
+@interface ASElementMap (Storage)
+
+/**
+ * Creates a map over sections that are all indexed and in @c lineages. The map shares them, and the indexes of the
+ * supplementary elements it has the same dictionaries of.
+ */
+- (instancetype)initWithSections:(NSArray<ASSection *> *)sections
+                    itemSections:(const ASElementMapSections &)itemSections
+                        lineages:(const std::shared_ptr<ASElementLineageTable> &)lineages
+           supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
+            supplementaryIndexes:(const ASSupplementaryElementIndexes &)supplementaryIndexes;
+
+@end
+
+@interface ASMutableElementMap (Storage)
+
+/**
+ * Creates a mutable map that shares the sections of an element map until it changes them. The supplementary indexes
+ * are handed on to the maps it copies to.
+ */
+- (instancetype)initWithSections:(NSArray<ASSection *> *)sections
+                    itemSections:(const ASElementMapSections &)itemSections
+                        lineages:(const std::shared_ptr<ASElementLineageTable> &)lineages
+           supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
+            supplementaryIndexes:(const ASSupplementaryElementIndexes &)supplementaryIndexes;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,159 @@
+//
+//  ASElementMapStorage.mm
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import "ASElementMapStorage.h"
+
+#import <atomic>
+
+#pragma mark - ASElementIntegerTable
+
+size_t ASElementIntegerTable::slotIndex(const void *key) const
+{
+  // Fibonacci hashing. Objects are 16-byte aligned, so the low bits carry nothing.
+  const uint64_t hash = ((uint64_t)(uintptr_t)key >> 4) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(hash >> 32) & (_slots.size() - 1);
+}
+
+NSInteger ASElementIntegerTable::find(ASCollectionElement *element) const
+{
+  if (_count == 0) {
+    return NSNotFound;
+  }
+  const void *key = (__bridge const void *)element;
+  const size_t mask = _slots.size() - 1;
+  for (size_t i = slotIndex(key); ; i = (i + 1) & mask) {
+    const Slot &slot = _slots[i];
+    if (slot.key == key) {
+      return slot.value;
+    }
+    if (slot.key == nullptr) {
+      return NSNotFound;
+    }
+  }
+}
+
+void ASElementIntegerTable::set(ASCollectionElement *element, NSInteger value)
+{
+  reserve(_count + 1);
+  const void *key = (__bridge const void *)element;
+  const size_t mask = _slots.size() - 1;
+  for (size_t i = slotIndex(key); ; i = (i + 1) & mask) {
+    Slot &slot = _slots[i];
+    if (slot.key == key) {
+      slot.value = value;
+      return;
+    }
+    if (slot.key == nullptr) {
+      slot = {key, value};
+      _count++;
+      return;
+    }
+  }
+}
+
+void ASElementIntegerTable::reserve(size_t count)
+{
+  size_t capacity = 16;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+  if (capacity <= _slots.size()) {
+    return;
+  }
+
+  std::vector<Slot> slots(capacity, Slot{nullptr, 0});
+  std::swap(slots, _slots);
+  const size_t mask = capacity - 1;
+  for (const Slot &slot : slots) {
+    if (slot.key != nullptr) {
+      size_t i = slotIndex(slot.key);
+      while (_slots[i].key != nullptr) {
+        i = (i + 1) & mask;
+      }
+      _slots[i] = slot;
+    }
+  }
+}
+
+#pragma mark - ASElementMapSection
+
+std::shared_ptr<ASElementMapSection> ASElementMapSection::make()
+{
+  static std::atomic<NSInteger> nextLineage(0);
+  auto section = std::make_shared<ASElementMapSection>();
+  section->lineage = nextLineage++;
+  section->isIndexed = false;
+  return section;
+}
+
+std::shared_ptr<ASElementMapSection> ASElementMapSection::mutableCopy() const
+{
+  auto section = std::make_shared<ASElementMapSection>();
+  section->lineage = lineage;
+  section->items = items;
+  section->isIndexed = false;
+  return section;
+}
+
+void ASElementMapSection::index()
+{
+  itemIndexes = ASElementIntegerTable();
+  itemIndexes.reserve(items.size());
+  NSInteger i = 0;
+  for (ASCollectionElement *element : items) {
+    itemIndexes.set(element, i++);
+  }
+  isIndexed = true;
+}
+
+#pragma mark - ASElementLineageTable
+
+NSInteger ASElementLineageTable::lineageForElement(ASCollectionElement *element)
+{
+  AS::MutexLocker l(_lock);
+  return _table.find(element);
+}
+
+void ASElementLineageTable::addSection(const ASElementMapSection &section)
+{
+  AS::MutexLocker l(_lock);
+  _table.reserve(_table.count() + section.items.size());
+  for (ASCollectionElement *element : section.items) {
+    _table.set(element, section.lineage);
+  }
+}
+
+size_t ASElementLineageTable::count()
+{
+  AS::MutexLocker l(_lock);
+  return _table.count();
+}
+
+#pragma mark - ASSupplementaryElementIndex
+
+NSArray<ASCollectionElement *> *ASSupplementaryElementIndex::allElements()
+{
+  AS::MutexLocker l(_lock);
+  if (_allElements == nil) {
+    _allElements = _elements.allValues;
+  }
+  return _allElements;
+}
+
+NSIndexPath *ASSupplementaryElementIndex::indexPathForElement(ASCollectionElement *element)
+{
+  AS::MutexLocker l(_lock);
+  if (_indexPaths == nil) {
+    NSMapTable<ASCollectionElement *, NSIndexPath *> *indexPaths = [[NSMapTable alloc] initWithKeyOptions:(NSMapTableStrongMemory | NSMapTableObjectPointerPersonality) valueOptions:NSMapTableStrongMemory capacity:_elements.count];
+    [_elements enumerateKeysAndObjectsUsingBlock:^(NSIndexPath * _Nonnull indexPath, ASCollectionElement * _Nonnull supplementaryElement, BOOL * _Nonnull stop) {
+      [indexPaths setObject:indexPath forKey:supplementaryElement];
+    }];
+    _indexPaths = indexPaths;
+  }
+  return [_indexPaths objectForKey:element];
+}
@@ -0,0 +1,61 @@
+//
+//  ASIntervalIndex.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The search ASCollectionLayoutState uses to find the layout attributes along the scrollable direction that a rect can
+ reach.
+
+ This header must stay free of Foundation and Objective-C so that the search can be checked on its own.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace AS {
+
+/**
+ * Intervals along one axis, each with a search key no greater than its start. Keys must not decrease from one
+ * interval to the next, but starts may: items aligned within a wrapped line start after the line does, in any order,
+ * so they are appended with the line's origin as their key. Along with the furthest any interval up to each position
+ * reaches, that bounds the intervals that can reach a range to one run, found with two binary searches.
+ */
+template <typename Float>
+struct IntervalIndex {
+  std::vector<Float> keys;
+  std::vector<Float> maxEnds; // The furthest end of the intervals up to and including each position.
+
+  std::size_t size() const { return keys.size(); }
+
+  void reserve(std::size_t count)
+  {
+    keys.reserve(count);
+    maxEnds.reserve(count);
+  }
+
+  /// Adds an interval ending at @c end, whose key is no smaller than that of any interval already in the index.
+  void append(Float key, Float end)
+  {
+    keys.push_back(key);
+    maxEnds.push_back(maxEnds.empty() ? end : std::max(maxEnds.back(), end));
+  }
+
+  /**
+   * Sets @c first and @c last to the run of positions whose intervals can reach from @c start to @c end. Intervals
+   * that only touch the range are included, so the caller's own intersection check has the last word.
+   */
+  void range(Float start, Float end, std::size_t &first, std::size_t &last) const
+  {
+    first = std::lower_bound(maxEnds.begin(), maxEnds.end(), start) - maxEnds.begin();
+    last = std::upper_bound(keys.begin(), keys.end(), end) - keys.begin();
+  }
+};
+
+} // namespace AS
@@ -0,0 +1,246 @@
+//
+//  ASLRUCache.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ A cache bounded by the total cost of its entries, evicting the least recently used first. The text layout, text
+ renderer and decoded image caches are all instances of it.
+
+ The cache is split into shards by key hash, each with its own lock, LRU order and share of the cost limit, so threads
+ looking up different keys rarely contend. An entry that would take more than a shard's share is not kept, since it
+ would push out everything else in the shard and then itself. Evicted values are released after the shard lock is
+ dropped, so their destructors may take other locks.
+
+ This header must stay free of Foundation and Objective-C so that the cache can be benchmarked on its own. Under ARC,
+ Value may be an object pointer.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AS {
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class LRUCache
+{
+public:
+  struct Metrics
+  {
+    uint64_t hitCount;
+    uint64_t missCount;
+    uint64_t evictionCount;
+    std::size_t entryCount;
+    std::size_t cost;
+    std::size_t costLimit;
+  };
+
+  /// Caches of a few large entries, such as images, should use fewer shards so that each share can hold them.
+  explicit LRUCache(std::size_t costLimit, std::size_t shardCount = 16)
+    : _shards(new Shard[shardCount])
+    , _shardCount(shardCount)
+    , _costLimit(costLimit)
+    , _hitCount(0)
+    , _missCount(0)
+    , _evictionCount(0)
+  {
+  }
+
+  LRUCache(const LRUCache &) = delete;
+  LRUCache &operator=(const LRUCache &) = delete;
+
+  /// Copies out the value for @c key and marks it most recently used. Does not count a hit or miss.
+  bool lookup(const Key &key, Value &value)
+  {
+    Shard &shard = shardForKey(key);
+    std::lock_guard<std::mutex> l(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    value = it->second->value;
+    return true;
+  }
+
+  /// Like lookup, and counts a hit or miss.
+  bool find(const Key &key, Value &value)
+  {
+    const bool found = lookup(key, value);
+    countLookup(found);
+    return found;
+  }
+
+  /// For callers that decide themselves whether a lookup hit, e.g. after comparing the value outside the lock.
+  void countLookup(bool hit)
+  {
+    (hit ? _hitCount : _missCount).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Stores @c value unless the cache already has a value for @c key, and returns the value now in the cache. Returns
+   * @c value itself, uncached, if its cost is over a shard's share of the limit.
+   */
+  Value insert(const Key &key, const Value &value, std::size_t cost)
+  {
+    Value result = value;
+    update(key, [&](Value &cached, std::size_t &cachedCost, bool inserted) {
+      if (inserted) {
+        cached = value;
+        cachedCost = cost;
+      } else {
+        result = cached;
+      }
+    });
+    return result;
+  }
+
+  /**
+   * Calls @c update with the shard locked, on the value for @c key and its cost, creating a default-constructed value
+   * of cost 0 if there is none; @c inserted tells which. The entry becomes the most recently used. If the cost it
+   * leaves is over a shard's share of the limit, the entry is removed, which counts as an eviction unless it was
+   * just inserted.
+   */
+  template <typename Update>
+  void update(const Key &key, const Update &update)
+  {
+    Shard &shard = shardForKey(key);
+    std::vector<Value> evicted;
+    std::lock_guard<std::mutex> l(shard.mutex);
+    auto it = shard.index.find(key);
+    const bool inserted = (it == shard.index.end());
+    if (inserted) {
+      shard.entries.push_front(Entry(key));
+      it = shard.index.emplace(key, shard.entries.begin()).first;
+    } else {
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    }
+
+    Entry &entry = *it->second;
+    const std::size_t oldCost = entry.cost;
+    update(entry.value, entry.cost, inserted);
+    shard.cost = shard.cost - oldCost + entry.cost;
+
+    if (entry.cost > shardCostLimit()) {
+      shard.cost -= entry.cost;
+      evicted.push_back(std::move(entry.value));
+      shard.entries.erase(it->second);
+      shard.index.erase(it);
+      if (!inserted) {
+        _evictionCount.fetch_add(1, std::memory_order_relaxed);
+      }
+      return;
+    }
+    trim(shard, evicted);
+  }
+
+  void setCostLimit(std::size_t costLimit)
+  {
+    _costLimit.store(costLimit, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < _shardCount; ++i) {
+      Shard &shard = _shards[i];
+      std::vector<Value> evicted;
+      std::lock_guard<std::mutex> l(shard.mutex);
+      trim(shard, evicted);
+    }
+  }
+
+  std::size_t costLimit() const { return _costLimit.load(std::memory_order_relaxed); }
+
+  /// The most an entry may cost and still be kept.
+  std::size_t shardCostLimit() const { return costLimit() / _shardCount; }
+
+  void removeAll()
+  {
+    for (std::size_t i = 0; i < _shardCount; ++i) {
+      Shard &shard = _shards[i];
+      std::list<Entry> entries;
+      std::lock_guard<std::mutex> l(shard.mutex);
+      entries.swap(shard.entries);
+      shard.index.clear();
+      shard.cost = 0;
+    }
+  }
+
+  Metrics metrics()
+  {
+    Metrics metrics = {
+      _hitCount.load(std::memory_order_relaxed),
+      _missCount.load(std::memory_order_relaxed),
+      _evictionCount.load(std::memory_order_relaxed),
+      0,
+      0,
+      costLimit(),
+    };
+    for (std::size_t i = 0; i < _shardCount; ++i) {
+      Shard &shard = _shards[i];
+      std::lock_guard<std::mutex> l(shard.mutex);
+      metrics.entryCount += shard.entries.size();
+      metrics.cost += shard.cost;
+    }
+    return metrics;
+  }
+
+private:
+  struct Entry
+  {
+    explicit Entry(const Key &key) : key(key), value(), cost(0) {}
+
+    Key key;
+    Value value;
+    std::size_t cost;
+  };
+
+  struct Shard
+  {
+    Shard() : cost(0) {}
+
+    std::mutex mutex;
+    std::list<Entry> entries; // Most recently used first.
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash, Equal> index;
+    std::size_t cost;
+  };
+
+  Shard &shardForKey(const Key &key)
+  {
+    // Fold in the high bits, since the low bits also pick the bucket within the shard's map.
+    const uint64_t hash = Hash()(key);
+    return _shards[((hash >> 32) ^ hash) % _shardCount];
+  }
+
+  // Assumes the shard lock is held.
+  void trim(Shard &shard, std::vector<Value> &evicted)
+  {
+    const std::size_t limit = shardCostLimit();
+    while (shard.cost > limit && !shard.entries.empty()) {
+      Entry &last = shard.entries.back();
+      shard.cost -= last.cost;
+      shard.index.erase(last.key);
+      evicted.push_back(std::move(last.value));
+      shard.entries.pop_back();
+      _evictionCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::unique_ptr<Shard[]> _shards;
+  const std::size_t _shardCount;
+  std::atomic<std::size_t> _costLimit;
+  std::atomic<uint64_t> _hitCount;
+  std::atomic<uint64_t> _missCount;
+  std::atomic<uint64_t> _evictionCount;
+};
+
+} // namespace AS
@@ -9,17 +9,13 @@
 
 #import "ASLayoutTransition.h"
 
-#import "NSArray+Diffing.h"
+#import "ASArrayDiff.h"
 
 #import "ASLayout.h"
 #import "ASDisplayNodeInternal.h" // Required for _removeFromSupernodeIfEqualTo:
 
 #import <queue>
 
-#if AS_IG_LIST_DIFF_KIT
-#import "ASLayout+IGListDiffKit.h"
-#endif
-
 using AS::MutexLocker;
 
 /**
@@ -159,38 +155,30 @@ static inline BOOL ASLayoutCanTransitionAsynchronous(ASLayout *layout) {
   ASLayout *pendingLayout = _pendingLayout.layout;
 
   if (previousLayout) {
-#if AS_IG_LIST_DIFF_KIT
-    // IGListDiff completes in linear time O(m+n), so use it if we have it:
-    IGListIndexSetResult *result = IGListDiff(previousLayout.sublayouts, pendingLayout.sublayouts, IGListDiffEquality);
-    _insertedSubnodePositions = findNodesInLayoutAtIndexes(pendingLayout, result.inserts, &_insertedSubnodes);
-    findNodesInLayoutAtIndexes(previousLayout, result.deletes, &_removedSubnodes);
-    for (IGListMoveIndex *move in result.moves) {
-      _subnodeMoves.emplace_back(previousLayout.sublayouts[move.from].layoutElement, move.to);
+    // Diff the layout elements by identity, the same key ASLayout (IGListDiffKit) uses as its diffIdentifier.
+    // Every element whose index changes is moved, since insertions and moves are applied at their final indexes
+    // before removals.
+    NSArray<ASLayout *> *previousSublayouts = previousLayout.sublayouts;
+    NSArray<ASLayout *> *pendingSublayouts = pendingLayout.sublayouts;
+    std::vector<AS::Diff::Key> previousKeys, pendingKeys;
+    previousKeys.reserve(previousSublayouts.count);
+    pendingKeys.reserve(pendingSublayouts.count);
+    for (ASLayout *sublayout in previousSublayouts) {
+      previousKeys.push_back((uintptr_t)sublayout.layoutElement);
     }
+    for (ASLayout *sublayout in pendingSublayouts) {
+      pendingKeys.push_back((uintptr_t)sublayout.layoutElement);
+    }
+    AS::Diff::Result diff;
+    AS::Diff::compute(previousKeys.data(), previousKeys.size(), pendingKeys.data(), pendingKeys.size(),
+                      AS::Diff::Moves::All, diff);
 
-    // Sort by ascending order of move destinations, this will allow easy loop of `insertSubnode:AtIndex` later.
-    std::sort(_subnodeMoves.begin(), _subnodeMoves.end(), [](std::pair<id<ASLayoutElement>, NSUInteger> a,
-            std::pair<ASDisplayNode *, NSUInteger> b) {
-      return a.second < b.second;
-    });
-#else
-    NSIndexSet *insertions, *deletions;
-    NSArray<NSIndexPath *> *moves;
-    NSArray<ASDisplayNode *> *previousNodes = [previousLayout.sublayouts valueForKey:@"layoutElement"];
-    NSArray<ASDisplayNode *> *pendingNodes = [pendingLayout.sublayouts valueForKey:@"layoutElement"];
-    [previousNodes asdk_diffWithArray:pendingNodes
-                                       insertions:&insertions
-                                        deletions:&deletions
-                                            moves:&moves];
-
-    _insertedSubnodePositions = findNodesInLayoutAtIndexes(pendingLayout, insertions, &_insertedSubnodes);
-    _removedSubnodes = [previousNodes objectsAtIndexes:deletions];
-    // These should arrive sorted in ascending order of move destinations.
-    for (NSIndexPath *move in moves) {
-      _subnodeMoves.emplace_back(previousLayout.sublayouts[([move indexAtPosition:0])].layoutElement,
-              [move indexAtPosition:1]);
+    _insertedSubnodePositions = findNodesInLayoutAtIndexes(pendingLayout, AS::Diff::IndexSet(diff.insertions), &_insertedSubnodes);
+    findNodesInLayoutAtIndexes(previousLayout, AS::Diff::IndexSet(diff.deletions), &_removedSubnodes);
+    // These arrive sorted in ascending order of move destinations.
+    for (const auto &move : diff.moves) {
+      _subnodeMoves.emplace_back(previousSublayouts[move.from].layoutElement, move.to);
     }
-#endif
   } else {
     NSIndexSet *indexes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, [pendingLayout.sublayouts count])];
     _insertedSubnodePositions = findNodesInLayoutAtIndexes(pendingLayout, indexes, &_insertedSubnodes);
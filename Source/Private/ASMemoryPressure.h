@@ -0,0 +1,20 @@
+//
+//  ASMemoryPressure.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import <Foundation/Foundation.h>
+#import "ASBaseDefines.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Runs @c handler on a utility queue whenever the system warns of memory pressure, for as long as the process lives.
+ * All handlers share one dispatch source. Caches use this to drop their contents, as NSCache does.
+ */
+ASDK_EXTERN void ASAddMemoryPressureHandler(dispatch_block_t handler);
+
+NS_ASSUME_NONNULL_END
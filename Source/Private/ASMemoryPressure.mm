@@ -0,0 +1,50 @@
+//
+//  ASMemoryPressure.mm
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import "ASMemoryPressure.h"
+
+#import <vector>
+
+#import "ASThread.h"
+
+using AS::MutexLocker;
+
+static AS::Mutex *ASMemoryPressureLock()
+{
+  static AS::Mutex *lock = new AS::Mutex();
+  return lock;
+}
+
+static std::vector<dispatch_block_t> &ASMemoryPressureHandlers()
+{
+  static std::vector<dispatch_block_t> *handlers = new std::vector<dispatch_block_t>();
+  return *handlers;
+}
+
+void ASAddMemoryPressureHandler(dispatch_block_t handler)
+{
+  static dispatch_source_t source;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_event_handler(source, ^{
+      std::vector<dispatch_block_t> handlers;
+      {
+        MutexLocker l(*ASMemoryPressureLock());
+        handlers = ASMemoryPressureHandlers();
+      }
+      for (dispatch_block_t h : handlers) {
+        h();
+      }
+    });
+    dispatch_resume(source);
+  });
+
+  MutexLocker l(*ASMemoryPressureLock());
+  ASMemoryPressureHandlers().push_back([handler copy]);
+}
@@ -11,31 +11,84 @@
 
 #import "ASCollectionElement.h"
 #import "ASElementMap.h"
-#import "ASTwoDimensionalArrayUtils.h"
+#import "ASElementMapStorage.h"
 
-typedef NSMutableArray<NSMutableArray<ASCollectionElement *> *> ASMutableCollectionElementTwoDimensionalArray;
+#import <algorithm>
 
-typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCollectionElement *> *> ASMutableSupplementaryElementDictionary;
+typedef NSMutableDictionary<NSString *, NSDictionary<NSIndexPath *, ASCollectionElement *> *> ASMutableSupplementaryElementDictionary;
+
+/// Lineage tables are replaced once the items of removed elements outnumber the items by this factor.
+static const size_t kASElementLineageTableMaximumGrowth = 2;
 
 @implementation ASMutableElementMap {
+  // Kind -> IndexPath -> Element. The dictionaries of kinds in _mutableSupplementaryElementKinds are ours to change,
+  // the others are shared with the map this one was copied from.
   ASMutableSupplementaryElementDictionary *_supplementaryElements;
+  NSMutableSet<NSString *> *_mutableSupplementaryElementKinds;
   NSMutableArray<ASSection *> *_sections;
-  ASMutableCollectionElementTwoDimensionalArray *_sectionsOfItems;
+  ASElementMapSections _itemSections;
+  std::shared_ptr<ASElementLineageTable> _lineages;
+  ASSupplementaryElementIndexes _supplementaryIndexes;
 }
 
 - (instancetype)initWithSections:(NSArray<ASSection *> *)sections items:(ASCollectionElementTwoDimensionalArray *)items supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
+{
+  ASElementMapSections itemSections;
+  itemSections.reserve(items.count);
+  for (NSArray<ASCollectionElement *> *itemsInSection in items) {
+    auto section = ASElementMapSection::make();
+    section->items.reserve(itemsInSection.count);
+    for (ASCollectionElement *element in itemsInSection) {
+      section->items.push_back(element);
+    }
+    itemSections.push_back(section);
+  }
+  return [self initWithSections:sections itemSections:itemSections lineages:std::make_shared<ASElementLineageTable>() supplementaryElements:supplementaryElements supplementaryIndexes:ASSupplementaryElementIndexes()];
+}
+
+- (instancetype)initWithSections:(NSArray<ASSection *> *)sections
+                    itemSections:(const ASElementMapSections &)itemSections
+                        lineages:(const std::shared_ptr<ASElementLineageTable> &)lineages
+           supplementaryElements:(ASSupplementaryElementDictionary *)supplementaryElements
+            supplementaryIndexes:(const ASSupplementaryElementIndexes &)supplementaryIndexes
 {
   if (self = [super init]) {
     _sections = [sections mutableCopy];
-    _sectionsOfItems = (ASMutableCollectionElementTwoDimensionalArray *)ASTwoDimensionalArrayDeepMutableCopy(items);
-    _supplementaryElements = [ASMutableElementMap deepMutableCopyOfElementsDictionary:supplementaryElements];
+    _itemSections = itemSections;
+    _lineages = lineages;
+    _supplementaryIndexes = supplementaryIndexes;
+    _supplementaryElements = [[NSMutableDictionary alloc] initWithCapacity:supplementaryElements.count];
+    [supplementaryElements enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull kind, NSDictionary<NSIndexPath *,ASCollectionElement *> * _Nonnull supplementariesForKind, BOOL * _Nonnull stop) {
+      _supplementaryElements[kind] = [supplementariesForKind copy];
+    }];
+    _mutableSupplementaryElementKinds = [[NSMutableSet alloc] init];
   }
   return self;
 }
 
 - (id)copyWithZone:(NSZone *)zone
 {
-  return [[ASElementMap alloc] initWithSections:_sections items:_sectionsOfItems supplementaryElements:_supplementaryElements];
+  // Index the sections that changed since this map was copied, and only those.
+  size_t itemCount = 0;
+  BOOL indexedAnySection = NO;
+  for (const auto &section : _itemSections) {
+    if (!section->isIndexed) {
+      section->index();
+      _lineages->addSection(*section);
+      indexedAnySection = YES;
+    }
+    itemCount += section->items.size();
+  }
+
+  // Older maps keep the lineage table they have, so a new one can leave out the removed items.
+  if (indexedAnySection && _lineages->count() > kASElementLineageTableMaximumGrowth * itemCount + 1024) {
+    _lineages = std::make_shared<ASElementLineageTable>();
+    for (const auto &section : _itemSections) {
+      _lineages->addSection(*section);
+    }
+  }
+
+  return [[ASElementMap alloc] initWithSections:_sections itemSections:_itemSections lineages:_lineages supplementaryElements:_supplementaryElements supplementaryIndexes:_supplementaryIndexes];
 }
 
 - (void)removeAllSections
@@ -50,7 +103,32 @@ typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCol
 
 - (void)removeItemsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths
 {
-  ASDeleteElementsInTwoDimensionalArrayAtIndexPaths(_sectionsOfItems, indexPaths);
+  // Sorted, the index paths come grouped by section, so each section is compacted once.
+  NSArray<NSIndexPath *> *sortedIndexPaths = [indexPaths sortedArrayUsingSelector:@selector(compare:)];
+  const NSUInteger count = sortedIndexPaths.count;
+  std::vector<NSInteger> removedItems;
+  for (NSUInteger i = 0; i < count;) {
+    const NSInteger section = sortedIndexPaths[i].section;
+    removedItems.clear();
+    for (; i < count && sortedIndexPaths[i].section == section; i++) {
+      removedItems.push_back(sortedIndexPaths[i].item);
+    }
+    removedItems.erase(std::unique(removedItems.begin(), removedItems.end()), removedItems.end());
+
+    // Items before the first removed one stay where they are.
+    auto &items = [self _mutableItemSectionAtIndex:section].items;
+    ASDisplayNodeAssert(removedItems.back() < (NSInteger)items.size(), @"Cannot remove items past the end of section %ld.", (long)section);
+    auto removedItem = removedItems.begin();
+    NSInteger kept = *removedItem;
+    for (NSInteger item = kept; item < (NSInteger)items.size(); item++) {
+      if (removedItem != removedItems.end() && *removedItem == item) {
+        removedItem++;
+      } else {
+        items[kept++] = std::move(items[item]);
+      }
+    }
+    items.erase(items.begin() + kept, items.end());
+  }
 }
 
 - (void)removeSectionsAtIndexes:(NSIndexSet *)indexes
@@ -60,24 +138,29 @@ typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCol
 
 - (void)removeSupplementaryElementsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths kind:(NSString *)kind
 {
-  [_supplementaryElements[kind] removeObjectsForKeys:indexPaths];
+  if (_supplementaryElements[kind] != nil) {
+    [[self _mutableSupplementaryElementsOfKind:kind] removeObjectsForKeys:indexPaths];
+  }
 }
 
 - (void)removeAllElements
 {
-  [_sectionsOfItems removeAllObjects];
+  _itemSections.clear();
   [_supplementaryElements removeAllObjects];
+  [_mutableSupplementaryElementKinds removeAllObjects];
 }
 
 - (void)removeSectionsOfItems:(NSIndexSet *)itemSections
 {
-  [_sectionsOfItems removeObjectsAtIndexes:itemSections];
+  [itemSections enumerateIndexesWithOptions:NSEnumerationReverse usingBlock:^(NSUInteger idx, BOOL * _Nonnull stop) {
+    _itemSections.erase(_itemSections.begin() + idx);
+  }];
 }
 
 - (void)insertEmptySectionsOfItemsAtIndexes:(NSIndexSet *)sections
 {
   [sections enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL * _Nonnull stop) {
-    [_sectionsOfItems insertObject:[[NSMutableArray alloc] init]  atIndex:idx];
+    _itemSections.insert(_itemSections.begin() + idx, ASElementMapSection::make());
   }];
 }
 
@@ -85,14 +168,10 @@ typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCol
 {
   NSString *kind = element.supplementaryElementKind;
   if (kind == nil) {
-    [_sectionsOfItems[indexPath.section] insertObject:element atIndex:indexPath.item];
+    auto &items = [self _mutableItemSectionAtIndex:indexPath.section].items;
+    items.insert(items.begin() + indexPath.item, element);
   } else {
-    NSMutableDictionary *supplementariesForKind = _supplementaryElements[kind];
-    if (supplementariesForKind == nil) {
-      supplementariesForKind = [[NSMutableDictionary alloc] init];
-      _supplementaryElements[kind] = supplementariesForKind;
-    }
-    supplementariesForKind[indexPath] = element;
+    [self _mutableSupplementaryElementsOfKind:kind][indexPath] = element;
   }
 }
 
@@ -104,8 +183,9 @@ typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCol
   }
 
   // For each element kind,
-  [_supplementaryElements enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSMutableDictionary<NSIndexPath *,ASCollectionElement *> * _Nonnull supps, BOOL * _Nonnull stop) {
-    
+  for (NSString *key in _supplementaryElements.allKeys) {
+    NSDictionary<NSIndexPath *,ASCollectionElement *> *supps = _supplementaryElements[key];
+
     // For each index path of that kind, move entries into a new dictionary.
     // Note: it's tempting to update the dictionary in-place but because of the likely collision between old and new index paths,
     // subtle bugs are possible. Note that this process is rare (only on section-level updates),
@@ -124,20 +204,39 @@ typedef NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, ASCol
         newSupps[newIndexPath] = obj;
       }
     }];
-    [supps setDictionary:newSupps];
-  }];
+    _supplementaryElements[key] = newSupps;
+    [_mutableSupplementaryElementKinds addObject:key];
+  }
 }
 
 #pragma mark - Helpers
 
-+ (ASMutableSupplementaryElementDictionary *)deepMutableCopyOfElementsDictionary:(ASSupplementaryElementDictionary *)originalDict
+/**
+ * Returns the section of items at the index, copying it first if another map shares it.
+ */
+- (ASElementMapSection &)_mutableItemSectionAtIndex:(NSInteger)index
 {
-  NSMutableDictionary *deepCopy = [[NSMutableDictionary alloc] initWithCapacity:originalDict.count];
-  [originalDict enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSDictionary<NSIndexPath *,ASCollectionElement *> * _Nonnull obj, BOOL * _Nonnull stop) {
-    deepCopy[key] = [obj mutableCopy];
-  }];
-  
-  return deepCopy;
+  std::shared_ptr<ASElementMapSection> &section = _itemSections[index];
+  if (section.use_count() > 1) {
+    section = section->mutableCopy();
+  } else {
+    // Only we hold it, but its index is about to go stale.
+    section->isIndexed = false;
+  }
+  return *section;
+}
+
+/**
+ * Returns the supplementary elements of the kind, copying them first if another map shares them.
+ */
+- (NSMutableDictionary<NSIndexPath *, ASCollectionElement *> *)_mutableSupplementaryElementsOfKind:(NSString *)kind
+{
+  if (![_mutableSupplementaryElementKinds containsObject:kind]) {
+    NSDictionary<NSIndexPath *, ASCollectionElement *> *supplementariesForKind = _supplementaryElements[kind];
+    _supplementaryElements[kind] = (supplementariesForKind ? [supplementariesForKind mutableCopy] : [[NSMutableDictionary alloc] init]);
+    [_mutableSupplementaryElementKinds addObject:kind];
+  }
+  return (NSMutableDictionary *)_supplementaryElements[kind];
 }
 
 @end
@@ -0,0 +1,121 @@
+//
+//  ASObjectPool.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ A small pool of idle objects that threads check out and back in without a lock, used by ASTextLayout to keep
+ framesetters per string.
+
+ Each of the Depth slots holds one idle object or null; checking out and in are atomic exchanges on the slots. Pools
+ may share a PoolBudget, which bounds the total cost of the objects idle in all of them: an object that would take the
+ budget over its limit, or that finds every slot full, is handed back to the caller to release.
+
+ This header must stay free of Foundation and Objective-C so that the pool can be benchmarked on its own. T must be a
+ pointer type; the pool never releases objects itself, see drain().
+ */
+
+#include <atomic>
+#include <cstddef>
+
+namespace AS {
+
+class PoolBudget
+{
+public:
+  explicit PoolBudget(std::size_t limit) : _cost(0), _limit(limit) {}
+
+  PoolBudget(const PoolBudget &) = delete;
+  PoolBudget &operator=(const PoolBudget &) = delete;
+
+  /// Takes @c cost out of the budget, or returns false and takes nothing if that would go over the limit.
+  bool reserve(std::size_t cost)
+  {
+    if (_cost.fetch_add(cost, std::memory_order_relaxed) + cost <= _limit) {
+      return true;
+    }
+    _cost.fetch_sub(cost, std::memory_order_relaxed);
+    return false;
+  }
+
+  void release(std::size_t cost)
+  {
+    _cost.fetch_sub(cost, std::memory_order_relaxed);
+  }
+
+  /// The cost of the objects idle in all pools, for tests.
+  std::size_t cost() const { return _cost.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<std::size_t> _cost;
+  const std::size_t _limit;
+};
+
+template <typename T, std::size_t Depth = 4>
+class ObjectPool
+{
+public:
+  /// Every object in the pool is taken to cost @c cost out of @c budget.
+  ObjectPool(PoolBudget &budget, std::size_t cost) : _budget(budget), _cost(cost)
+  {
+    for (auto &slot : _slots) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  /// An idle object that the caller now owns, or null if there is none.
+  T checkOut()
+  {
+    for (auto &slot : _slots) {
+      if (slot.load(std::memory_order_relaxed) == nullptr) {
+        continue;
+      }
+      if (T object = slot.exchange(nullptr, std::memory_order_acquire)) {
+        _budget.release(_cost);
+        return object;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Keeps @c object for the next checkOut(). Returns false, and the caller keeps @c object, if the pool or the
+  /// budget is full.
+  bool checkIn(T object)
+  {
+    if (!_budget.reserve(_cost)) {
+      return false;
+    }
+    for (auto &slot : _slots) {
+      T expected = nullptr;
+      if (slot.compare_exchange_strong(expected, object, std::memory_order_release, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    _budget.release(_cost);
+    return false;
+  }
+
+  /// Empties the pool, calling @c release on each idle object. The pool's owner calls this before destroying it.
+  template <typename Release>
+  void drain(const Release &release)
+  {
+    while (T object = checkOut()) {
+      release(object);
+    }
+  }
+
+private:
+  std::atomic<T> _slots[Depth];
+  PoolBudget &_budget;
+  const std::size_t _cost;
+};
+
+} // namespace AS
@@ -0,0 +1,48 @@
+//
+//  ASScaleFactorSearch.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The search ASTextKitFontSizeAdjuster uses to pick a font scale factor.
+
+ This header must stay free of Foundation and Objective-C so that the search can be benchmarked on its own.
+ */
+
+#include <cstddef>
+#include <vector>
+
+namespace AS {
+
+/**
+ * Returns the index of the first of @c scaleFactors for which @c fits returns true, or the last index if there is
+ * none. The first scale factor is tried on its own, so text that needs no scaling costs one trial. The rest must be
+ * sorted from largest to smallest and are binary searched: text never fits worse at a smaller scale, so once one fits
+ * every later one does.
+ *
+ * @c scaleFactors must not be empty. Fits is called as bool fits(Float scaleFactor).
+ */
+template <typename Float, typename Fits>
+std::size_t FirstFittingScaleFactor(const std::vector<Float> &scaleFactors, const Fits &fits)
+{
+  if (scaleFactors.size() == 1 || fits(scaleFactors[0])) {
+    return 0;
+  }
+  std::size_t low = 1, high = scaleFactors.size() - 1;
+  while (low < high) {
+    const std::size_t mid = low + (high - low) / 2;
+    if (fits(scaleFactors[mid])) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return low;
+}
+
+} // namespace AS
@@ -0,0 +1,155 @@
+//
+//  ASSegmentedQueue.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ An unbounded first-in first-out queue with many producers and one consumer, used by ASRunLoopQueue.
+
+ Values are stored in fixed-size segments linked in order. A producer claims a slot in the last segment with a single
+ atomic increment and publishes it through the slot's ready flag, so pushing never takes a lock or waits for the
+ consumer. The producer that finds the last segment full links a new one; the queue never runs out of room, and a
+ segment is only allocated once every SegmentSize pushes.
+
+ The consumer frees segments it has emptied once no producer is in the middle of a push, since a producer may still be
+ looking at a segment it read as the last one before another producer linked the next.
+
+ This header must stay free of Foundation and Objective-C so that the queue can be benchmarked on its own. T must be
+ default-constructible and move-assignable; under ARC, it may hold object pointers.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace AS {
+
+template <typename T, std::size_t SegmentSize = 1024>
+class SegmentedQueue
+{
+public:
+  SegmentedQueue() : _head(new Segment()), _headIndex(0), _tail(_head), _pushingCount(0), _segmentCount(1) {}
+
+  ~SegmentedQueue()
+  {
+    freeRetiredSegments();
+    for (Segment *segment = _head; segment != nullptr;) {
+      Segment *next = segment->next.load(std::memory_order_relaxed);
+      delete segment;
+      segment = next;
+    }
+  }
+
+  SegmentedQueue(const SegmentedQueue &) = delete;
+  SegmentedQueue &operator=(const SegmentedQueue &) = delete;
+
+  void push(T &&value)
+  {
+    _pushingCount.fetch_add(1);
+    Segment *segment = _tail.load();
+    while (true) {
+      const std::size_t index = segment->claimed.fetch_add(1, std::memory_order_relaxed);
+      if (index < SegmentSize) {
+        Slot &slot = segment->slots[index];
+        slot.value = std::move(value);
+        slot.ready.store(true, std::memory_order_release);
+        break;
+      }
+
+      // Full: move on to the next segment, linking one if nobody has yet.
+      Segment *next = segment->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        Segment *fresh = new Segment();
+        if (segment->next.compare_exchange_strong(next, fresh)) {
+          next = fresh;
+          _segmentCount.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          delete fresh;
+        }
+      }
+      _tail.compare_exchange_strong(segment, next);
+      segment = _tail.load();
+    }
+    _pushingCount.fetch_sub(1);
+  }
+
+  /**
+   * Consumer only. The oldest value, or null if the queue is empty or the oldest value's producer has not finished
+   * writing it yet. The value stays in the queue until pop().
+   */
+  T *front()
+  {
+    if (_headIndex == SegmentSize) {
+      Segment *next = _head->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return nullptr;
+      }
+      // Once the tail is past the segment, producers that start pushing can't reach it any more.
+      Segment *expected = _head;
+      _tail.compare_exchange_strong(expected, next);
+      _retired.push_back(_head);
+      _head = next;
+      _headIndex = 0;
+    }
+    if (!_retired.empty() && _pushingCount.load() == 0) {
+      freeRetiredSegments();
+    }
+
+    Slot &slot = _head->slots[_headIndex];
+    return slot.ready.load(std::memory_order_acquire) ? &slot.value : nullptr;
+  }
+
+  /// Consumer only. Removes the value front() returned.
+  void pop()
+  {
+    _head->slots[_headIndex].value = T();
+    _headIndex++;
+  }
+
+  /// The number of segments allocated and not yet freed, for tests.
+  std::size_t segmentCount() const { return _segmentCount.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot
+  {
+    Slot() : ready(false), value() {}
+
+    std::atomic<bool> ready;
+    T value;
+  };
+
+  struct Segment
+  {
+    Segment() : next(nullptr), claimed(0) {}
+
+    std::atomic<Segment *> next;
+    std::atomic<std::size_t> claimed; // May count past SegmentSize, by producers that found the segment full.
+    Slot slots[SegmentSize];
+  };
+
+  void freeRetiredSegments()
+  {
+    for (Segment *segment : _retired) {
+      delete segment;
+    }
+    _segmentCount.fetch_sub(_retired.size(), std::memory_order_relaxed);
+    _retired.clear();
+  }
+
+  // Consumer only.
+  Segment *_head;
+  std::size_t _headIndex;
+  std::vector<Segment *> _retired;
+
+  std::atomic<Segment *> _tail;
+  std::atomic<std::size_t> _pushingCount;
+  std::atomic<std::size_t> _segmentCount;
+};
+
+} // namespace AS
@@ -0,0 +1,1134 @@
+//
+//  ASStackLayoutCore.h
+//  Texture
+//
+//  Copyright (c) Facebook, Inc. and its affiliates.  All rights reserved.
+//  Changes after 4/13/2017 are: Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+/**
+ The flexbox algorithm behind ASStackLayoutSpec, over plain structs.
+
+ This header must stay free of Foundation, CoreGraphics and Objective-C so that the algorithm can be built and
+ profiled on its own. ASStackUnpositionedLayout and ASStackPositionedLayout wrap it for layout elements.
+
+ Children are referred to by their index in the vector of ChildStyle passed in. Measuring a child is delegated to a
+ Measurer, which must provide:
+
+   // Lays out the child at index within sizeRange and returns the resulting size.
+   Size measure(std::size_t index, const SizeRange &sizeRange, const Size &parentSize);
+
+   // Records a zero-sized result for the child at index without measuring it.
+   Size placeholder(std::size_t index);
+
+   // Calls work(i) for every i in [0, count). May run the iterations concurrently.
+   template <typename Work> void apply(std::size_t count, const Work &work);
+
+ None of the steps allocate on their own: results go into an UnpositionedLayout whose buffers can be reused through
+ ScratchLease, and flex factors and adjustments are plain functors inlined into the loops that use them.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace AS {
+namespace StackLayout {
+
+typedef double Float;
+
+struct Size {
+  Float width;
+  Float height;
+};
+
+struct Point {
+  Float x;
+  Float y;
+};
+
+struct SizeRange {
+  Size min;
+  Size max;
+};
+
+/** The threshold that determines if a violation has actually occurred. */
+constexpr Float kViolationEpsilon = 0.01;
+
+/** Passed as parent dimension when the stack has no definite size along it. */
+inline Float undefinedDimension()
+{
+  return std::numeric_limits<Float>::quiet_NaN();
+}
+
+// The enums below mirror the ones in ASStackLayoutDefines.h value for value.
+
+enum class Direction : unsigned char {
+  Vertical,
+  Horizontal,
+};
+
+enum class JustifyContent : unsigned char {
+  Start,
+  Center,
+  End,
+  SpaceBetween,
+  SpaceAround,
+};
+
+enum class AlignItems : unsigned char {
+  Start,
+  End,
+  Center,
+  Stretch,
+  BaselineFirst,
+  BaselineLast,
+  NotSet,
+};
+
+enum class AlignSelf : unsigned char {
+  Auto,
+  Start,
+  End,
+  Center,
+  Stretch,
+};
+
+enum class FlexWrap : unsigned char {
+  NoWrap,
+  Wrap,
+};
+
+enum class AlignContent : unsigned char {
+  Start,
+  Center,
+  End,
+  SpaceBetween,
+  SpaceAround,
+  Stretch,
+};
+
+struct Dimension {
+  enum class Unit : unsigned char {
+    Auto,
+    Points,
+    Fraction,
+  };
+  Unit unit;
+  Float value;
+
+  Float resolve(const Float parentSize, const Float autoSize) const
+  {
+    switch (unit) {
+      case Unit::Auto:
+        return autoSize;
+      case Unit::Points:
+        return value;
+      case Unit::Fraction:
+        return value * parentSize;
+    }
+    return autoSize;
+  }
+};
+
+struct Style {
+  Direction direction;
+  Float spacing;
+  JustifyContent justifyContent;
+  AlignItems alignItems;
+  FlexWrap flexWrap;
+  AlignContent alignContent;
+  Float lineSpacing;
+};
+
+/** The stack-related style of a single child, read once up front. */
+struct ChildStyle {
+  Float flexGrow;
+  Float flexShrink;
+  Dimension flexBasis;
+  AlignSelf alignSelf;
+  Float spacingBefore;
+  Float spacingAfter;
+  Float ascender;
+  Float descender;
+  /**
+   The child's own min and max size along the cross dimension, resolved without a parent size. Only consulted when
+   the child is stretched: a zero min or an infinite max defer to the stack's constraint.
+   */
+  Float crossMin;
+  Float crossMax;
+};
+
+struct Item {
+  /** Index of the child in the children vector. */
+  std::size_t index;
+  /** Size of the proposed layout of the child. */
+  Size size;
+  /** Position within the stack, only valid once positioned. */
+  Point position;
+};
+
+struct Line {
+  /** The range of this line's items within UnpositionedLayout::items. */
+  std::size_t begin;
+  std::size_t end;
+  /** The total size of the children in the stack dimension, including all spacing. */
+  Float stackDimensionSum;
+  /** The size in the cross dimension */
+  Float crossSize;
+  /** The baseline of the stack which baseline aligned children should align to */
+  Float baseline;
+
+  std::size_t size() const
+  {
+    return end - begin;
+  }
+};
+
+/**
+ Represents a set of stack layout children that have their final layout computed, but are not yet positioned.
+
+ Items are kept in line order in a single buffer and lines refer to ranges of it, so a layout can be recomputed into the
+ same object without allocating once its buffers have grown to size.
+ */
+struct UnpositionedLayout {
+  /** The proposed items of all lines, in line order. */
+  std::vector<Item> items;
+  /** The set of proposed lines. */
+  std::vector<Line> lines;
+  /**
+   * In a single line stack (e.g no wrap), this is the total size of the children in the stack dimension, including all spacing.
+   * In a multi-line stack, this is the largest stack dimension among lines.
+   */
+  Float stackDimensionSum;
+  Float crossDimensionSum;
+
+  void clear()
+  {
+    items.clear();
+    lines.clear();
+    stackDimensionSum = 0;
+    crossDimensionSum = 0;
+  }
+};
+
+/**
+ Hands out objects that are reused across layout passes on the same thread. Leases nest, since measuring a child may
+ lay out another stack on the same thread, and every nesting depth keeps its own object. T must provide clear(), which
+ is called when the lease ends so that pooled objects don't keep their contents alive.
+ */
+template <typename T>
+class ScratchLease
+{
+public:
+  ScratchLease() : _pool(pool())
+  {
+    if (_pool.depth == _pool.values.size()) {
+      _pool.values.emplace_back(new T());
+    }
+    _value = _pool.values[_pool.depth++].get();
+  }
+
+  ~ScratchLease()
+  {
+    _value->clear();
+    _pool.depth--;
+  }
+
+  ScratchLease(const ScratchLease &) = delete;
+  ScratchLease &operator=(const ScratchLease &) = delete;
+
+  T &operator*() const
+  {
+    return *_value;
+  }
+
+  T *operator->() const
+  {
+    return _value;
+  }
+
+private:
+  struct Pool {
+    std::vector<std::unique_ptr<T>> values;
+    std::size_t depth = 0;
+  };
+
+  static Pool &pool()
+  {
+    static thread_local Pool pool;
+    return pool;
+  }
+
+  Pool &_pool;
+  T *_value;
+};
+
+// Geometry
+
+inline Float stackDimension(const Direction direction, const Size &size)
+{
+  return (direction == Direction::Vertical) ? size.height : size.width;
+}
+
+inline Float crossDimension(const Direction direction, const Size &size)
+{
+  return (direction == Direction::Vertical) ? size.width : size.height;
+}
+
+inline Point directionPoint(const Direction direction, const Float stack, const Float cross)
+{
+  return (direction == Direction::Vertical) ? Point{cross, stack} : Point{stack, cross};
+}
+
+inline Size directionSize(const Direction direction, const Float stack, const Float cross)
+{
+  return (direction == Direction::Vertical) ? Size{cross, stack} : Size{stack, cross};
+}
+
+inline void setStackValueToPoint(const Direction direction, const Float stack, Point &point)
+{
+  (direction == Direction::Vertical) ? (point.y = stack) : (point.x = stack);
+}
+
+inline SizeRange directionSizeRange(const Direction direction,
+                                    const Float stackMin,
+                                    const Float stackMax,
+                                    const Float crossMin,
+                                    const Float crossMax)
+{
+  return {directionSize(direction, stackMin, crossMin), directionSize(direction, stackMax, crossMax)};
+}
+
+inline Point operator+(const Point &p1, const Point &p2)
+{
+  return {p1.x + p2.x, p1.y + p2.y};
+}
+
+inline Size clamp(const SizeRange &sizeRange, const Size &size)
+{
+  return {std::max(sizeRange.min.width, std::min(sizeRange.max.width, size.width)),
+          std::max(sizeRange.min.height, std::min(sizeRange.max.height, size.height))};
+}
+
+/** Same rounding as ASFloorPixelValue, with the screen scale passed in. */
+inline Float floorPixelValue(const Float f, const Float scale)
+{
+  return std::floor((f + FLT_EPSILON) * scale) / scale;
+}
+
+inline AlignItems alignment(const AlignSelf childAlignment, const AlignItems stackAlignment)
+{
+  switch (childAlignment) {
+    case AlignSelf::Center:
+      return AlignItems::Center;
+    case AlignSelf::End:
+      return AlignItems::End;
+    case AlignSelf::Start:
+      return AlignItems::Start;
+    case AlignSelf::Stretch:
+      return AlignItems::Stretch;
+    case AlignSelf::Auto:
+    default:
+      return stackAlignment;
+  }
+}
+
+inline bool isFlexibleInBothDirections(const ChildStyle &child)
+{
+  return child.flexGrow > 0 && child.flexShrink > 0;
+}
+
+inline bool itemIsBaselineAligned(const Style &style, const ChildStyle &child)
+{
+  const AlignItems alignItems = alignment(child.alignSelf, style.alignItems);
+  return alignItems == AlignItems::BaselineFirst || alignItems == AlignItems::BaselineLast;
+}
+
+inline Float baselineForItem(const Style &style, const ChildStyle &child, const Item &item)
+{
+  switch (alignment(child.alignSelf, style.alignItems)) {
+    case AlignItems::BaselineFirst:
+      return child.ascender;
+    case AlignItems::BaselineLast:
+      return crossDimension(style.direction, item.size) + child.descender;
+    default:
+      return 0;
+  }
+}
+
+// Violations
+
+/**
+ Computes the violation by comparing a stack dimension sum with the overall allowable size range for the stack.
+ Positive when the children are too short for the minimum, negative when they overflow the maximum.
+ */
+inline Float computeStackViolation(const Float stackDimensionSum, const Style &style, const SizeRange &sizeRange)
+{
+  const Float minStackDimension = stackDimension(style.direction, sizeRange.min);
+  const Float maxStackDimension = stackDimension(style.direction, sizeRange.max);
+  if (stackDimensionSum < minStackDimension) {
+    return minStackDimension - stackDimensionSum;
+  } else if (stackDimensionSum > maxStackDimension) {
+    return maxStackDimension - stackDimensionSum;
+  }
+  return 0;
+}
+
+/**
+ Computes the violation by comparing a cross dimension sum with the overall allowable size range for the stack.
+ Uses the same sign convention as computeStackViolation.
+ */
+inline Float computeCrossViolation(const Float crossDimensionSum, const Style &style, const SizeRange &sizeRange)
+{
+  const Float minCrossDimension = crossDimension(style.direction, sizeRange.min);
+  const Float maxCrossDimension = crossDimension(style.direction, sizeRange.max);
+  if (crossDimensionSum < minCrossDimension) {
+    return minCrossDimension - crossDimensionSum;
+  } else if (crossDimensionSum > maxCrossDimension) {
+    return maxCrossDimension - crossDimensionSum;
+  }
+  return 0;
+}
+
+/** Computes the consumed cross dimension length for the given lines, including line spacing. */
+inline Float computeLinesCrossDimensionSum(const std::vector<Line> &lines, const Style &style)
+{
+  // Start from default spacing between each line:
+  Float sum = lines.empty() ? 0 : style.lineSpacing * (lines.size() - 1);
+  for (const auto &line : lines) {
+    sum += line.crossSize;
+  }
+  return sum;
+}
+
+/** Computes the consumed stack dimension length for the given items, including all spacing. */
+inline Float computeItemsStackDimensionSum(const Item *items,
+                                           const std::size_t count,
+                                           const std::vector<ChildStyle> &children,
+                                           const Style &style)
+{
+  // Sum up the children's spacing, starting from default spacing between each child:
+  Float sum = count == 0 ? 0 : style.spacing * (count - 1);
+  for (std::size_t i = 0; i < count; i++) {
+    sum += children[items[i].index].spacingBefore + children[items[i].index].spacingAfter;
+  }
+
+  // Sum up the children's dimensions (including spacing) in the stack direction.
+  for (std::size_t i = 0; i < count; i++) {
+    sum += stackDimension(style.direction, items[i].size);
+  }
+  return sum;
+}
+
+// Flex Functors
+
+/** Flex factor of an item when the line is too short. */
+struct FlexGrowFactor {
+  const std::vector<ChildStyle> &children;
+
+  Float operator()(const Item &item) const
+  {
+    return children[item.index].flexGrow;
+  }
+};
+
+/** Flex factor of an item when the line overflows. */
+struct FlexShrinkFactor {
+  const std::vector<ChildStyle> &children;
+
+  Float operator()(const Item &item) const
+  {
+    return children[item.index].flexShrink;
+  }
+};
+
+template <typename Factor>
+Float sumOfFlexFactors(const Item *items, const std::size_t count, const Factor &factor)
+{
+  Float sum = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    sum += factor(items[i]);
+  }
+  return sum;
+}
+
+/**
+ Computes the flex grow adjustment for an item: the violation is distributed proportionally based on each item's flex
+ grow factor.
+ */
+struct FlexGrowAdjustment {
+  const std::vector<ChildStyle> &children;
+  const Float violation;
+  const Float flexFactorSum;
+
+  Float operator()(const Item &item) const
+  {
+    return std::floor(violation * (children[item.index].flexGrow / flexFactorSum));
+  }
+};
+
+/**
+ Computes the flex shrink adjustment for an item. Unlike the flex grow adjustment the flex shrink adjustment takes the
+ size of each item into account: items shrink proportionally to their scaled flex shrink factor.
+ */
+struct FlexShrinkAdjustment {
+  const std::vector<ChildStyle> &children;
+  const Direction direction;
+  const Float violation;
+  const Float flexFactorSum;
+  Float scaledFlexShrinkFactorSum;
+
+  FlexShrinkAdjustment(const Item *items,
+                       const std::size_t count,
+                       const std::vector<ChildStyle> &children,
+                       const Direction direction,
+                       const Float violation,
+                       const Float flexFactorSum)
+    : children(children)
+    , direction(direction)
+    , violation(violation)
+    , flexFactorSum(flexFactorSum)
+    , scaledFlexShrinkFactorSum(0)
+  {
+    for (std::size_t i = 0; i < count; i++) {
+      scaledFlexShrinkFactorSum += scaledFlexShrinkFactor(items[i]);
+    }
+  }
+
+  Float scaledFlexShrinkFactor(const Item &item) const
+  {
+    return stackDimension(direction, item.size) * (children[item.index].flexShrink / flexFactorSum);
+  }
+
+  Float operator()(const Item &item) const
+  {
+    if (scaledFlexShrinkFactorSum == 0.0) {
+      return 0.0;
+    }
+    return -std::fabs((scaledFlexShrinkFactor(item) / scaledFlexShrinkFactorSum) * violation);
+  }
+};
+
+// Unpositioned Layout
+
+/**
+ Sizes the child given the parameters specified, and returns the computed size.
+ */
+template <typename Measurer>
+Size crossChildLayout(Measurer &measurer,
+                      const std::size_t index,
+                      const ChildStyle &child,
+                      const Style &style,
+                      const Float stackMin,
+                      const Float stackMax,
+                      const Float crossMin,
+                      const Float crossMax,
+                      const Size &parentSize)
+{
+  const bool stretch = (alignment(child.alignSelf, style.alignItems) == AlignItems::Stretch);
+  // stretched children will have a cross dimension of at least crossMin, unless they explicitly define a child size
+  // that is smaller than the constraint of the parent.
+  const Float childCrossMin = stretch ? (child.crossMin != 0 ? child.crossMin : crossMin) : 0;
+  // stretched children may have a cross direction max that is smaller than the minimum size constraint of the parent.
+  const Float childCrossMax = stretch ? (child.crossMax == INFINITY ? crossMax : child.crossMax) : crossMax;
+  return measurer.measure(index,
+                          directionSizeRange(style.direction, stackMin, stackMax, childCrossMin, childCrossMax),
+                          parentSize);
+}
+
+/**
+ Stretches the items of a line along the cross axis according to their alignment. Alignment itself is done when
+ positioning.
+ */
+template <typename Measurer>
+void stretchItemsAlongCrossDimension(Item *items,
+                                     const std::size_t count,
+                                     const std::vector<ChildStyle> &children,
+                                     const Style &style,
+                                     Measurer &measurer,
+                                     const Size &parentSize,
+                                     const Float crossSize)
+{
+  measurer.apply(count, [&](std::size_t i) {
+    auto &item = items[i];
+    const ChildStyle &child = children[item.index];
+    if (alignment(child.alignSelf, style.alignItems) == AlignItems::Stretch) {
+      const Float cross = crossDimension(style.direction, item.size);
+      const Float stack = stackDimension(style.direction, item.size);
+      const Float violation = crossSize - cross;
+
+      // Only stretch if violation is positive. Compare against kViolationEpsilon here to avoid stretching against a tiny violation.
+      if (violation > kViolationEpsilon) {
+        item.size = crossChildLayout(measurer, item.index, child, style, stack, stack, crossSize, crossSize, parentSize);
+      }
+    }
+  });
+}
+
+/**
+ * Stretch lines and their items according to alignContent, alignItems and alignSelf.
+ * https://www.w3.org/TR/css-flexbox-1/#algo-line-stretch
+ * https://www.w3.org/TR/css-flexbox-1/#algo-stretch
+ */
+template <typename Measurer>
+void stretchLinesAlongCrossDimension(UnpositionedLayout &layout,
+                                     const std::vector<ChildStyle> &children,
+                                     const Style &style,
+                                     Measurer &measurer,
+                                     const SizeRange &sizeRange,
+                                     const Size &parentSize)
+{
+  auto &lines = layout.lines;
+  const std::size_t numOfLines = lines.size();
+  const Float violation = computeCrossViolation(computeLinesCrossDimensionSum(lines, style), style, sizeRange);
+  // Don't stretch if the stack is single line, because the line's cross size was clamped against the stack's constrained size.
+  const bool shouldStretchLines = (numOfLines > 1
+                                   && style.alignContent == AlignContent::Stretch
+                                   && violation > kViolationEpsilon);
+
+  const Float extraCrossSizePerLine = violation / numOfLines;
+  for (auto &line : lines) {
+    if (shouldStretchLines) {
+      line.crossSize += extraCrossSizePerLine;
+    }
+
+    stretchItemsAlongCrossDimension(&layout.items[line.begin], line.size(), children, style, measurer, parentSize, line.crossSize);
+  }
+}
+
+/**
+ * Computes cross size and baseline of each line.
+ * https://www.w3.org/TR/css-flexbox-1/#algo-cross-line
+ */
+inline void computeLinesCrossSizeAndBaseline(UnpositionedLayout &layout,
+                                             const std::vector<ChildStyle> &children,
+                                             const Style &style,
+                                             const SizeRange &sizeRange)
+{
+  auto &lines = layout.lines;
+  const bool isSingleLine = (lines.size() == 1);
+
+  const Float minCrossSize = crossDimension(style.direction, sizeRange.min);
+  const Float maxCrossSize = crossDimension(style.direction, sizeRange.max);
+  const bool definiteCrossSize = (minCrossSize == maxCrossSize);
+
+  // If the stack is single-line and has a definite cross size, the cross size of the line is the stack's definite cross size.
+  if (isSingleLine && definiteCrossSize) {
+    auto &line = lines[0];
+    line.crossSize = minCrossSize;
+
+    // We still need to determine the line's baseline
+    for (std::size_t i = line.begin; i < line.end; i++) {
+      const Item &item = layout.items[i];
+      const ChildStyle &child = children[item.index];
+      if (itemIsBaselineAligned(style, child)) {
+        line.baseline = std::max(line.baseline, baselineForItem(style, child, item));
+      }
+    }
+    return;
+  }
+
+  for (auto &line : lines) {
+    Float maxStartToBaselineDistance = 0;
+    Float maxBaselineToEndDistance = 0;
+    Float maxItemCrossSize = 0;
+
+    for (std::size_t i = line.begin; i < line.end; i++) {
+      const Item &item = layout.items[i];
+      const ChildStyle &child = children[item.index];
+      if (itemIsBaselineAligned(style, child)) {
+        // Step 1. Collect all the items whose align-self is baseline. Find the largest of the distances
+        // between each item’s baseline and its hypothetical outer cross-start edge (aka. its baseline value),
+        // and the largest of the distances between each item’s baseline and its hypothetical outer cross-end edge,
+        // and sum these two values.
+        const Float baseline = baselineForItem(style, child, item);
+        maxStartToBaselineDistance = std::max(maxStartToBaselineDistance, baseline);
+        maxBaselineToEndDistance = std::max(maxBaselineToEndDistance, crossDimension(style.direction, item.size) - baseline);
+      } else {
+        // Step 2. Among all the items not collected by the previous step, find the largest outer hypothetical cross size.
+        maxItemCrossSize = std::max(maxItemCrossSize, crossDimension(style.direction, item.size));
+      }
+    }
+
+    // Step 3. The used cross-size of the flex line is the largest of the numbers found in the previous two steps and zero.
+    line.crossSize = std::max(maxStartToBaselineDistance + maxBaselineToEndDistance, maxItemCrossSize);
+    if (isSingleLine) {
+      // If the stack is single-line, then clamp the line’s cross-size to be within the stack's min and max cross-size properties.
+      line.crossSize = std::min(std::max(minCrossSize, line.crossSize), maxCrossSize);
+    }
+
+    line.baseline = maxStartToBaselineDistance;
+  }
+}
+
+/**
+ The flexible children may have been left not laid out in the initial layout pass, so we may have to go through and size
+ these children at zero size so that the children layouts are at least present.
+ */
+template <typename Measurer>
+void layoutFlexibleChildrenAtZeroSize(Item *items,
+                                      const std::size_t count,
+                                      const std::vector<ChildStyle> &children,
+                                      const Style &style,
+                                      Measurer &measurer,
+                                      const SizeRange &sizeRange,
+                                      const Size &parentSize)
+{
+  measurer.apply(count, [&](std::size_t i) {
+    auto &item = items[i];
+    const ChildStyle &child = children[item.index];
+    if (isFlexibleInBothDirections(child)) {
+      item.size = crossChildLayout(measurer,
+                                   item.index,
+                                   child,
+                                   style,
+                                   0,
+                                   0,
+                                   crossDimension(style.direction, sizeRange.min),
+                                   crossDimension(style.direction, sizeRange.max),
+                                   parentSize);
+    }
+  });
+}
+
+/**
+ If we have a single flexible (both shrinkable and growable) child, and our allowed size range is set to a specific
+ number then we may avoid the first "intrinsic" size calculation.
+ */
+inline bool useOptimizedFlexing(const std::vector<ChildStyle> &children, const Style &style, const SizeRange &sizeRange)
+{
+  const std::size_t flexibleChildren = std::count_if(children.begin(), children.end(), isFlexibleInBothDirections);
+  return ((flexibleChildren == 1)
+          && (stackDimension(style.direction, sizeRange.min) == stackDimension(style.direction, sizeRange.max)));
+}
+
+/**
+ Re-lays out the items of one line that need a flex adjustment, as computed by the given adjustment functor.
+ */
+template <typename Measurer, typename Adjustment>
+void flexItemsInLine(Item *items,
+                     const std::size_t count,
+                     const std::vector<ChildStyle> &children,
+                     const Style &style,
+                     Measurer &measurer,
+                     const SizeRange &sizeRange,
+                     const Size &parentSize,
+                     const Float violation,
+                     const Adjustment &flexAdjustment)
+{
+  // Compute any remaining violation to the first flexible item.
+  Float remainingViolation = violation;
+  std::size_t firstFlexItem = count;
+  for (std::size_t i = 0; i < count; i++) {
+    const Float adjustment = flexAdjustment(items[i]);
+    remainingViolation -= adjustment;
+    // Items are consider inflexible if they do not need to make a flex adjustment.
+    if (adjustment != 0 && firstFlexItem == count) {
+      firstFlexItem = i;
+    }
+  }
+  if (firstFlexItem == count) {
+    return;
+  }
+
+  measurer.apply(count, [&](std::size_t i) {
+    auto &item = items[i];
+    const ChildStyle &child = children[item.index];
+    const Float currentFlexAdjustment = flexAdjustment(item);
+    // Items are consider inflexible if they do not need to make a flex adjustment.
+    if (currentFlexAdjustment != 0) {
+      const Float originalStackSize = stackDimension(style.direction, item.size);
+      // Only apply the remaining violation for the first flexible item that has a flex grow factor.
+      const Float flexedStackSize = originalStackSize + currentFlexAdjustment + (i == firstFlexItem && child.flexGrow > 0 ? remainingViolation : 0);
+      item.size = crossChildLayout(measurer,
+                                   item.index,
+                                   child,
+                                   style,
+                                   std::max(flexedStackSize, 0.0),
+                                   std::max(flexedStackSize, 0.0),
+                                   crossDimension(style.direction, sizeRange.min),
+                                   crossDimension(style.direction, sizeRange.max),
+                                   parentSize);
+    }
+  });
+}
+
+/**
+ Flexes children in the stack axis to resolve a min or max stack size violation. First, determines which children are
+ flexible (see computeStackViolation and the flex factor functors). Then computes how much to flex each flexible
+ child and performs re-layout. Note that there may still be a non-zero violation even after flexing.
+
+ The actual CSS flexbox spec describes an iterative looping algorithm here:
+ http://www.w3.org/TR/css3-flexbox/#resolve-flexible-lengths
+ */
+template <typename Measurer>
+void flexLinesAlongStackDimension(UnpositionedLayout &layout,
+                                  const std::vector<ChildStyle> &children,
+                                  const Style &style,
+                                  Measurer &measurer,
+                                  const SizeRange &sizeRange,
+                                  const Size &parentSize,
+                                  const bool useOptimizedFlexing)
+{
+  for (const auto &line : layout.lines) {
+    Item *items = &layout.items[line.begin];
+    const std::size_t count = line.size();
+    const Float violation = computeStackViolation(computeItemsStackDimensionSum(items, count, children, style), style, sizeRange);
+    // The flex factor sum is needed to determine if flexing is necessary.
+    // This value is also needed if the violation is positive and flexible items need to grow, so keep it around.
+    Float flexFactorSum = 0;
+    if (std::fabs(violation) >= kViolationEpsilon) {
+      flexFactorSum = (violation > 0
+                       ? sumOfFlexFactors(items, count, FlexGrowFactor{children})
+                       : sumOfFlexFactors(items, count, FlexShrinkFactor{children}));
+    }
+
+    // If no items are able to flex then there is nothing left to do with this line. Bail.
+    if (flexFactorSum == 0) {
+      // If optimized flexing was used then we have to clean up the unsized items and lay them out at zero size.
+      if (useOptimizedFlexing) {
+        layoutFlexibleChildrenAtZeroSize(items, count, children, style, measurer, sizeRange, parentSize);
+      }
+      continue;
+    }
+
+    if (violation > 0) {
+      flexItemsInLine(items, count, children, style, measurer, sizeRange, parentSize, violation,
+                      FlexGrowAdjustment{children, violation, flexFactorSum});
+    } else {
+      flexItemsInLine(items, count, children, style, measurer, sizeRange, parentSize, violation,
+                      FlexShrinkAdjustment(items, count, children, style.direction, violation, flexFactorSum));
+    }
+  }
+}
+
+inline void appendLine(std::vector<Line> &lines, const std::size_t begin, const std::size_t end)
+{
+  Line line = {};
+  line.begin = begin;
+  line.end = end;
+  lines.push_back(line);
+}
+
+/**
+ Splits the items into lines in place; items already are in line order so lines only record their ranges.
+ https://www.w3.org/TR/css-flexbox-1/#algo-line-break
+ */
+inline void collectChildrenIntoLines(UnpositionedLayout &layout,
+                                     const std::vector<ChildStyle> &children,
+                                     const Style &style,
+                                     const SizeRange &sizeRange)
+{
+  const auto &items = layout.items;
+
+  //TODO if infinite max stack size, fast path
+  if (style.flexWrap == FlexWrap::NoWrap) {
+    appendLine(layout.lines, 0, items.size());
+    return;
+  }
+
+  std::size_t lineBegin = 0;
+  Float lineStackDimensionSum = 0;
+  Float interitemSpacing = 0;
+
+  for (std::size_t i = 0; i < items.size(); i++) {
+    const Item &item = items[i];
+    const ChildStyle &child = children[item.index];
+    const Float itemStackDimension = stackDimension(style.direction, item.size);
+    const Float itemAndSpacingStackDimension = child.spacingBefore + itemStackDimension + child.spacingAfter;
+    const bool negativeViolationIfAddItem = (computeStackViolation(lineStackDimensionSum + interitemSpacing + itemAndSpacingStackDimension, style, sizeRange) < 0);
+    const bool breakCurrentLine = negativeViolationIfAddItem && i > lineBegin;
+
+    if (breakCurrentLine) {
+      appendLine(layout.lines, lineBegin, i);
+      lineBegin = i;
+      lineStackDimensionSum = 0;
+      interitemSpacing = 0;
+    }
+
+    lineStackDimensionSum += interitemSpacing + itemAndSpacingStackDimension;
+    interitemSpacing = style.spacing;
+  }
+
+  // Handle last line
+  appendLine(layout.lines, lineBegin, items.size());
+}
+
+/**
+ Performs the first unconstrained layout of the children, generating the unpositioned items that are then flexed and
+ stretched.
+ */
+template <typename Measurer>
+void layoutItemsAlongUnconstrainedStackDimension(std::vector<Item> &items,
+                                                 const std::vector<ChildStyle> &children,
+                                                 const Style &style,
+                                                 Measurer &measurer,
+                                                 const SizeRange &sizeRange,
+                                                 const Size &parentSize,
+                                                 const bool useOptimizedFlexing)
+{
+  const Float minCrossDimension = crossDimension(style.direction, sizeRange.min);
+  const Float maxCrossDimension = crossDimension(style.direction, sizeRange.max);
+
+  measurer.apply(items.size(), [&](std::size_t i) {
+    auto &item = items[i];
+    const ChildStyle &child = children[item.index];
+    if (useOptimizedFlexing && isFlexibleInBothDirections(child)) {
+      item.size = measurer.placeholder(item.index);
+    } else {
+      item.size = crossChildLayout(measurer,
+                                   item.index,
+                                   child,
+                                   style,
+                                   child.flexBasis.resolve(stackDimension(style.direction, parentSize), 0),
+                                   child.flexBasis.resolve(stackDimension(style.direction, parentSize), INFINITY),
+                                   minCrossDimension,
+                                   maxCrossDimension,
+                                   parentSize);
+    }
+  });
+}
+
+/**
+ Given a set of children, computes the unpositioned layouts for those children into result. Any previous contents of
+ result are replaced; its buffers are reused.
+ */
+template <typename Measurer>
+void computeUnpositioned(const std::vector<ChildStyle> &children,
+                         const Style &style,
+                         const SizeRange &sizeRange,
+                         Measurer &measurer,
+                         UnpositionedLayout &result)
+{
+  result.clear();
+  if (children.empty()) {
+    return;
+  }
+
+  // If we have a fixed size in either dimension, pass it to children so they can resolve percentages against it.
+  // Otherwise, we pass undefinedDimension() since it will depend on the content.
+  const Size parentSize = {
+    (sizeRange.min.width == sizeRange.max.width) ? sizeRange.min.width : undefinedDimension(),
+    (sizeRange.min.height == sizeRange.max.height) ? sizeRange.min.height : undefinedDimension(),
+  };
+
+  // We may be able to avoid some redundant layout passes
+  const bool optimizedFlexing = useOptimizedFlexing(children, style, sizeRange);
+
+  result.items.resize(children.size());
+  for (std::size_t i = 0; i < children.size(); i++) {
+    result.items[i].index = i;
+  }
+
+  // We do a first pass of all the children, generating an unpositioned layout for each with an unbounded range along
+  // the stack dimension.  This allows us to compute the "intrinsic" size of each child and find the available violation
+  // which determines whether we must grow or shrink the flexible children.
+  layoutItemsAlongUnconstrainedStackDimension(result.items, children, style, measurer, sizeRange, parentSize, optimizedFlexing);
+
+  // Collect items into lines (https://www.w3.org/TR/css-flexbox-1/#algo-line-break)
+  collectChildrenIntoLines(result, children, style, sizeRange);
+
+  // Resolve the flexible lengths (https://www.w3.org/TR/css-flexbox-1/#resolve-flexible-lengths)
+  flexLinesAlongStackDimension(result, children, style, measurer, sizeRange, parentSize, optimizedFlexing);
+
+  // Calculate the cross size of each flex line (https://www.w3.org/TR/css-flexbox-1/#algo-cross-line)
+  computeLinesCrossSizeAndBaseline(result, children, style, sizeRange);
+
+  // Handle 'align-content: stretch' (https://www.w3.org/TR/css-flexbox-1/#algo-line-stretch)
+  // Determine the used cross size of each item (https://www.w3.org/TR/css-flexbox-1/#algo-stretch)
+  stretchLinesAlongCrossDimension(result, children, style, measurer, sizeRange, parentSize);
+
+  // Compute stack dimension sum of each line and the whole stack
+  for (auto &line : result.lines) {
+    line.stackDimensionSum = computeItemsStackDimensionSum(&result.items[line.begin], line.size(), children, style);
+    // stackDimensionSum is the max stackDimensionSum among all lines
+    result.stackDimensionSum = std::max(line.stackDimensionSum, result.stackDimensionSum);
+  }
+  // Compute cross dimension sum of the stack.
+  result.crossDimensionSum = computeLinesCrossDimensionSum(result.lines, style);
+}
+
+// Positioned Layout
+
+inline Float crossOffsetForItem(const Item &item,
+                                const ChildStyle &child,
+                                const Style &style,
+                                const Float crossSize,
+                                const Float baseline,
+                                const Float screenScale)
+{
+  switch (alignment(child.alignSelf, style.alignItems)) {
+    case AlignItems::End:
+      return crossSize - crossDimension(style.direction, item.size);
+    case AlignItems::Center:
+      return floorPixelValue((crossSize - crossDimension(style.direction, item.size)) / 2, screenScale);
+    case AlignItems::BaselineFirst:
+    case AlignItems::BaselineLast:
+      return baseline - baselineForItem(style, child, item);
+    case AlignItems::Start:
+    case AlignItems::Stretch:
+    case AlignItems::NotSet:
+      return 0;
+  }
+  return 0;
+}
+
+inline void crossOffsetAndSpacingForEachLine(const std::size_t numOfLines,
+                                             const Float crossViolation,
+                                             AlignContent alignContent,
+                                             Float &offset,
+                                             Float &spacing)
+{
+  // Handle edge cases
+  if (alignContent == AlignContent::SpaceBetween && (crossViolation < kViolationEpsilon || numOfLines == 1)) {
+    alignContent = AlignContent::Start;
+  } else if (alignContent == AlignContent::SpaceAround && (crossViolation < kViolationEpsilon || numOfLines == 1)) {
+    alignContent = AlignContent::Center;
+  }
+
+  offset = 0;
+  spacing = 0;
+
+  switch (alignContent) {
+    case AlignContent::Center:
+      offset = crossViolation / 2;
+      break;
+    case AlignContent::End:
+      offset = crossViolation;
+      break;
+    case AlignContent::SpaceBetween:
+      // Spacing between the items, no spaces at the edges, evenly distributed
+      spacing = crossViolation / (numOfLines - 1);
+      break;
+    case AlignContent::SpaceAround: {
+      // Spacing between items are twice the spacing on the edges
+      const Float spacingUnit = crossViolation / (numOfLines * 2);
+      offset = spacingUnit;
+      spacing = spacingUnit * 2;
+      break;
+    }
+    case AlignContent::Start:
+    case AlignContent::Stretch:
+      break;
+  }
+}
+
+inline void stackOffsetAndSpacingForEachItem(const std::size_t numOfItems,
+                                             const Float stackViolation,
+                                             JustifyContent justifyContent,
+                                             Float &offset,
+                                             Float &spacing)
+{
+  // Handle edge cases
+  if (justifyContent == JustifyContent::SpaceBetween && (stackViolation < kViolationEpsilon || numOfItems == 1)) {
+    justifyContent = JustifyContent::Start;
+  } else if (justifyContent == JustifyContent::SpaceAround && (stackViolation < kViolationEpsilon || numOfItems == 1)) {
+    justifyContent = JustifyContent::Center;
+  }
+
+  offset = 0;
+  spacing = 0;
+
+  switch (justifyContent) {
+    case JustifyContent::Center:
+      offset = stackViolation / 2;
+      break;
+    case JustifyContent::End:
+      offset = stackViolation;
+      break;
+    case JustifyContent::SpaceBetween:
+      // Spacing between the items, no spaces at the edges, evenly distributed
+      spacing = stackViolation / (numOfItems - 1);
+      break;
+    case JustifyContent::SpaceAround: {
+      // Spacing between items are twice the spacing on the edges
+      const Float spacingUnit = stackViolation / (numOfItems * 2);
+      offset = spacingUnit;
+      spacing = spacingUnit * 2;
+      break;
+    }
+    case JustifyContent::Start:
+      break;
+  }
+}
+
+inline void positionItemsInLine(Item *items,
+                                const Line &line,
+                                const std::vector<ChildStyle> &children,
+                                const Style &style,
+                                const Point &startingPoint,
+                                const Float stackSpacing,
+                                const Float screenScale)
+{
+  Point p = startingPoint;
+  bool first = true;
+
+  for (std::size_t i = line.begin; i < line.end; i++) {
+    Item &item = items[i];
+    const ChildStyle &child = children[item.index];
+    p = p + directionPoint(style.direction, child.spacingBefore, 0);
+    if (!first) {
+      p = p + directionPoint(style.direction, style.spacing + stackSpacing, 0);
+    }
+    first = false;
+    item.position = p + directionPoint(style.direction, 0, crossOffsetForItem(item, child, style, line.crossSize, line.baseline, screenScale));
+
+    p = p + directionPoint(style.direction, stackDimension(style.direction, item.size) + child.spacingAfter, 0);
+  }
+}
+
+/**
+ Given an unpositioned layout, computes the positions each child should be placed at. Items are positioned in place
+ and stay in line order. Returns the final size of the stack.
+ */
+inline Size computePositioned(UnpositionedLayout &layout,
+                              const std::vector<ChildStyle> &children,
+                              const Style &style,
+                              const SizeRange &sizeRange,
+                              const Float screenScale)
+{
+  const auto &lines = layout.lines;
+  if (lines.empty()) {
+    return {0, 0};
+  }
+
+  const auto numOfLines = lines.size();
+  const auto direction = style.direction;
+  const auto crossViolation = computeCrossViolation(layout.crossDimensionSum, style, sizeRange);
+  Float crossOffset;
+  Float crossSpacing;
+  crossOffsetAndSpacingForEachLine(numOfLines, crossViolation, style.alignContent, crossOffset, crossSpacing);
+
+  Point p = directionPoint(direction, 0, crossOffset);
+  bool first = true;
+  for (const auto &line : lines) {
+    if (!first) {
+      p = p + directionPoint(direction, 0, crossSpacing + style.lineSpacing);
+    }
+    first = false;
+
+    const auto stackViolation = computeStackViolation(line.stackDimensionSum, style, sizeRange);
+    Float stackOffset;
+    Float stackSpacing;
+    stackOffsetAndSpacingForEachItem(line.size(), stackViolation, style.justifyContent, stackOffset, stackSpacing);
+
+    setStackValueToPoint(direction, stackOffset, p);
+    positionItemsInLine(layout.items.data(), line, children, style, p, stackSpacing, screenScale);
+
+    p = p + directionPoint(direction, -stackOffset, line.crossSize);
+  }
+
+  const Size finalSize = directionSize(direction, layout.stackDimensionSum, layout.crossDimensionSum);
+  return clamp(sizeRange, finalSize);
+}
+
+} // namespace StackLayout
+} // namespace AS
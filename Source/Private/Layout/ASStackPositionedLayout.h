@@ -11,14 +11,16 @@
 #import "ASDimension.h"
 #import "ASStackUnpositionedLayout.h"
 
-/** Represents a set of laid out and positioned stack layout children. */
+/** Represents a laid out and positioned stack. */
 struct ASStackPositionedLayout {
-  const std::vector<ASStackLayoutSpecItem> items;
   /** Final size of the stack */
   const CGSize size;
   
-  /** Given an unpositioned layout, computes the positions each child should be placed at. */
-  static ASStackPositionedLayout compute(const ASStackUnpositionedLayout &unpositionedLayout,
+  /**
+   Given an unpositioned layout, computes the positions each child should be placed at. The position of each layout in
+   unpositionedLayout.layouts is set in place; unpositionedLayout.layout.items lists them in line order.
+   */
+  static ASStackPositionedLayout compute(ASStackUnpositionedLayout &unpositionedLayout,
                                          const ASStackLayoutSpecStyle &style,
                                          const ASSizeRange &constrainedSize);
 };
@@ -10,6 +10,7 @@
 #import <vector>
 
 #import "ASLayout.h"
+#import "ASStackLayoutCore.h"
 #import "ASStackLayoutSpecUtilities.h"
 #import "ASStackLayoutSpec.h"
 
@@ -25,49 +26,50 @@ struct ASStackLayoutSpecChild {
   ASLayoutElementSize size;
 };
 
-struct ASStackLayoutSpecItem {
-  /** The original source child. */
-  ASStackLayoutSpecChild child;
-  /** The proposed layout or nil if no is calculated yet. */
-  ASLayout *layout;
-};
+/**
+ Represents a set of stack layout children that have their final layout computed, but are not yet positioned.
+ The flexbox algorithm itself lives in ASStackLayoutCore.h; this binds it to layout elements.
 
-struct ASStackUnpositionedLine {
-  /** The set of proposed children in this line, each contains child layout, not yet positioned. */
-  std::vector<ASStackLayoutSpecItem> items;
-  /** The total size of the children in the stack dimension, including all spacing. */
-  CGFloat stackDimensionSum;
-  /** The size in the cross dimension */
-  CGFloat crossSize;
-  /** The baseline of the stack which baseline aligned children should align to */
-  CGFloat baseline;
-};
-
-/** Represents a set of stack layout children that have their final layout computed, but are not yet positioned. */
+ Instances are meant to be leased from AS::StackLayout::ScratchLease so that the buffers below are reused from one
+ layout pass to the next instead of being reallocated.
+ */
 struct ASStackUnpositionedLayout {
-  /** The set of proposed lines, each contains child layouts, not yet positioned. */
-  const std::vector<ASStackUnpositionedLine> lines;
-  /** 
-   * In a single line stack (e.g no wrao), this is the total size of the children in the stack dimension, including all spacing.
-   * In a multi-line stack, this is the largest stack dimension among lines.
-   */
-  const CGFloat stackDimensionSum;
-  const CGFloat crossDimensionSum;
-  
-  /** Given a set of children, computes the unpositioned layouts for those children. */
-  static ASStackUnpositionedLayout compute(const std::vector<ASStackLayoutSpecChild> &children,
-                                           const ASStackLayoutSpecStyle &style,
-                                           const ASSizeRange &sizeRange,
-                                           const BOOL concurrent);
+  /** The children to lay out. Filled in by the caller before calling compute(). */
+  std::vector<ASStackLayoutSpecChild> children;
+  /** The stack style of each child, in the order the children were given. */
+  std::vector<AS::StackLayout::ChildStyle> childStyles;
+  /** The proposed layout of each child, in the order the children were given. */
+  std::vector<ASLayout *> layouts;
+  /** The set of proposed lines, referring to children by index. */
+  AS::StackLayout::UnpositionedLayout layout;
   
-  static CGFloat baselineForItem(const ASStackLayoutSpecStyle &style,
-                                 const ASStackLayoutSpecItem &l);
+  /** Computes the unpositioned layouts for children, replacing the results of any previous computation. */
+  void compute(const ASStackLayoutSpecStyle &style, const ASSizeRange &sizeRange, const BOOL concurrent);
   
-  static CGFloat computeStackViolation(const CGFloat stackDimensionSum,
-                                       const ASStackLayoutSpecStyle &style,
-                                       const ASSizeRange &sizeRange);
-
-  static CGFloat computeCrossViolation(const CGFloat crossDimensionSum,
-                                       const ASStackLayoutSpecStyle &style,
-                                       const ASSizeRange &sizeRange);
+  /** Drops the children and their layouts but keeps the buffers around for reuse. */
+  void clear();
 };
+
+/** Conversions between the Core Graphics and stack layout core types. */
+ASDISPLAYNODE_INLINE AS::StackLayout::Style ASStackLayoutCoreStyle(const ASStackLayoutSpecStyle &style)
+{
+  return {
+    .direction = (style.direction == ASStackLayoutDirectionVertical ? AS::StackLayout::Direction::Vertical : AS::StackLayout::Direction::Horizontal),
+    .spacing = style.spacing,
+    .justifyContent = (AS::StackLayout::JustifyContent)style.justifyContent,
+    .alignItems = (AS::StackLayout::AlignItems)style.alignItems,
+    .flexWrap = (AS::StackLayout::FlexWrap)style.flexWrap,
+    .alignContent = (AS::StackLayout::AlignContent)style.alignContent,
+    .lineSpacing = style.lineSpacing,
+  };
+}
+
+ASDISPLAYNODE_INLINE AS::StackLayout::Size ASStackLayoutCoreSize(CGSize size)
+{
+  return {size.width, size.height};
+}
+
+ASDISPLAYNODE_INLINE AS::StackLayout::SizeRange ASStackLayoutCoreSizeRange(ASSizeRange sizeRange)
+{
+  return {ASStackLayoutCoreSize(sizeRange.min), ASStackLayoutCoreSize(sizeRange.max)};
+}
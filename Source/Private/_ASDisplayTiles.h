@@ -0,0 +1,73 @@
+//
+//  _ASDisplayTiles.h
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import <AppKit/AppKit.h>
+#import <vector>
+
+@class ASDisplayNode;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A tile of a node's backing store, in the node's bounds coordinates.
+ */
+struct ASDisplayTile {
+  uint64_t key;
+  CGRect rect;
+};
+
+/**
+ Private header for ASDisplayNode+AsyncDisplay.mm
+
+ _ASDisplayTiles holds the tile layers of a node that displays tiled. The tile layers live in a container layer at the
+ back of the node's layer, below the layers of its subnodes. Main thread only.
+
+ On memory pressure, every node with tiles is asked to evict those outside its visible rect. Evicted tiles are
+ tracked so that they can be displayed again when they scroll back into view.
+ */
+@interface _ASDisplayTiles : NSObject
+
+- (instancetype)initWithNode:(ASDisplayNode *)node;
+
+@property (readonly) CALayer *containerLayer;
+
+/**
+ * Splits @c bounds into tiles of @c tileSize, removing all tile layers if the grid changed.
+ * Returns every tile, those intersecting @c visibleRect first, then by distance from it. An empty visible rect
+ * orders tiles from the top of the node down.
+ */
+- (std::vector<ASDisplayTile>)tilesForBounds:(CGRect)bounds tileSize:(CGSize)tileSize visibleRect:(CGRect)visibleRect;
+
+/**
+ * Shows @c image in the tile's layer, creating the layer if needed.
+ */
+- (void)setImage:(nullable NSImage *)image contentsScale:(CGFloat)contentsScale forTile:(const ASDisplayTile &)tile;
+
+/**
+ * Releases the tiles that do not intersect @c visibleRect. Returns whether any tile was evicted.
+ */
+- (BOOL)evictTilesOutsideRect:(CGRect)visibleRect;
+
+/**
+ * Returns the evicted tiles that intersect @c visibleRect, and no longer tracks them as evicted.
+ */
+- (std::vector<ASDisplayTile>)takeEvictedTilesInRect:(CGRect)visibleRect;
+
+@property (readonly) BOOL hasEvictedTiles;
+
+/**
+ * Calls -_displayEvictedTiles on the node whenever @c view's enclosing clip view scrolls, until stopped.
+ */
+- (void)observeScrollingOfView:(NSView *)view;
+- (void)stopObservingScrolling;
+
+- (void)removeAllTiles;
+
+@end
+
+NS_ASSUME_NONNULL_END
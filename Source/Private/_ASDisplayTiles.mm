@@ -0,0 +1,245 @@
+//
+//  _ASDisplayTiles.mm
+//  Texture
+//
+//  Copyright (c) Pinterest, Inc.  All rights reserved.
+//  Licensed under Apache 2.0: http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#import "_ASDisplayTiles.h"
+
+#import <algorithm>
+#import <unordered_map>
+#import <unordered_set>
+
+#import "ASAssert.h"
+#import "ASDisplayNodeInternal.h"
+#import "ASMemoryPressure.h"
+#import "NSImage+CGImageConversion.h"
+
+static inline uint64_t ASDisplayTileKey(NSUInteger column, NSUInteger row)
+{
+  return ((uint64_t)row << 32) | (uint64_t)column;
+}
+
+/// Tile layers show what they are given at once, without implicit animations.
+static NSDictionary<NSString *, id<CAAction>> *ASDisplayTileLayerActions()
+{
+  static NSDictionary *actions;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    actions = @{
+      @"contents" : [NSNull null],
+      @"bounds" : [NSNull null],
+      @"position" : [NSNull null],
+      @"sublayers" : [NSNull null],
+    };
+  });
+  return actions;
+}
+
+@interface _ASDisplayTiles ()
+@property (nonatomic, weak, readonly) ASDisplayNode *node;
+@end
+
+/**
+ * The tiles of every node that displays tiled, which evict off-screen tiles on memory pressure.
+ */
+static NSHashTable<_ASDisplayTiles *> *ASDisplayTilesRegistry()
+{
+  static NSHashTable *registry;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    registry = [NSHashTable weakObjectsHashTable];
+    ASAddMemoryPressureHandler(^{
+      // Tiles are main thread only.
+      dispatch_async(dispatch_get_main_queue(), ^{
+        for (_ASDisplayTiles *tiles in registry.allObjects) {
+          [tiles.node _evictDisplayTilesOutsideVisibleRect];
+        }
+      });
+    });
+  });
+  return registry;
+}
+
+@implementation _ASDisplayTiles
+{
+  CGRect _bounds;
+  CGSize _tileSize;
+  std::unordered_map<uint64_t, CALayer *> _tileLayers;
+  std::unordered_set<uint64_t> _evictedKeys;
+  __weak NSView *_observedClipView;
+}
+
+- (instancetype)initWithNode:(ASDisplayNode *)node
+{
+  if (self = [super init]) {
+    _node = node;
+    _bounds = CGRectNull;
+    _containerLayer = [CALayer layer];
+    _containerLayer.actions = ASDisplayTileLayerActions();
+    [ASDisplayTilesRegistry() addObject:self];
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark Grid.
+
+- (CGRect)_rectForColumn:(NSUInteger)column row:(NSUInteger)row
+{
+  const CGRect rect = CGRectMake(CGRectGetMinX(_bounds) + column * _tileSize.width,
+                                 CGRectGetMinY(_bounds) + row * _tileSize.height,
+                                 _tileSize.width, _tileSize.height);
+  return CGRectIntersection(rect, _bounds);
+}
+
+- (std::vector<ASDisplayTile>)tilesForBounds:(CGRect)bounds tileSize:(CGSize)tileSize visibleRect:(CGRect)visibleRect
+{
+  ASDisplayNodeAssertMainThread();
+  if (!CGRectEqualToRect(bounds, _bounds) || !CGSizeEqualToSize(tileSize, _tileSize)) {
+    [self removeAllTiles];
+    _bounds = bounds;
+    _tileSize = tileSize;
+  }
+  _containerLayer.frame = bounds;
+
+  const NSUInteger columns = (NSUInteger)ceil(CGRectGetWidth(bounds) / tileSize.width);
+  const NSUInteger rows = (NSUInteger)ceil(CGRectGetHeight(bounds) / tileSize.height);
+  std::vector<ASDisplayTile> tiles;
+  tiles.reserve(columns * rows);
+  for (NSUInteger row = 0; row < rows; row++) {
+    for (NSUInteger column = 0; column < columns; column++) {
+      tiles.push_back({ASDisplayTileKey(column, row), [self _rectForColumn:column row:row]});
+    }
+  }
+  _evictedKeys.clear();
+
+  // Visible tiles first, then outward from the visible rect. Without one, from the top (max Y) of the node down.
+  visibleRect = CGRectIntersection(visibleRect, bounds);
+  const BOOL hasVisibleRect = !CGRectIsEmpty(visibleRect);
+  const CGPoint focus = hasVisibleRect ? CGPointMake(CGRectGetMidX(visibleRect), CGRectGetMidY(visibleRect))
+                                       : CGPointMake(CGRectGetMidX(bounds), CGRectGetMaxY(bounds));
+  const auto distance = [&](const ASDisplayTile &tile) {
+    if (hasVisibleRect && CGRectIntersectsRect(tile.rect, visibleRect)) {
+      return (CGFloat)0;
+    }
+    const CGFloat dx = MAX(0, MAX(CGRectGetMinX(tile.rect) - focus.x, focus.x - CGRectGetMaxX(tile.rect)));
+    const CGFloat dy = MAX(0, MAX(CGRectGetMinY(tile.rect) - focus.y, focus.y - CGRectGetMaxY(tile.rect)));
+    return dx * dx + dy * dy;
+  };
+  std::stable_sort(tiles.begin(), tiles.end(), [&](const ASDisplayTile &a, const ASDisplayTile &b) {
+    return distance(a) < distance(b);
+  });
+  return tiles;
+}
+
+#pragma mark Tile layers.
+
+- (void)setImage:(NSImage *)image contentsScale:(CGFloat)contentsScale forTile:(const ASDisplayTile &)tile
+{
+  ASDisplayNodeAssertMainThread();
+  // The grid may have changed while the tile was drawn.
+  if (!CGRectContainsRect(_bounds, tile.rect)) {
+    return;
+  }
+
+  CALayer *&layer = _tileLayers[tile.key];
+  if (layer == nil) {
+    layer = [CALayer layer];
+    layer.actions = ASDisplayTileLayerActions();
+    [_containerLayer addSublayer:layer];
+  }
+  layer.frame = CGRectOffset(tile.rect, -CGRectGetMinX(_bounds), -CGRectGetMinY(_bounds));
+  layer.contentsScale = contentsScale;
+  layer.contents = (id)CFBridgingRelease([image cgImage]);
+}
+
+- (BOOL)evictTilesOutsideRect:(CGRect)visibleRect
+{
+  ASDisplayNodeAssertMainThread();
+  BOOL evicted = NO;
+  for (auto it = _tileLayers.begin(); it != _tileLayers.end();) {
+    CALayer *layer = it->second;
+    const CGRect rect = CGRectOffset(layer.frame, CGRectGetMinX(_bounds), CGRectGetMinY(_bounds));
+    if (CGRectIntersectsRect(rect, visibleRect)) {
+      ++it;
+      continue;
+    }
+    [layer removeFromSuperlayer];
+    _evictedKeys.insert(it->first);
+    it = _tileLayers.erase(it);
+    evicted = YES;
+  }
+  return evicted;
+}
+
+- (std::vector<ASDisplayTile>)takeEvictedTilesInRect:(CGRect)visibleRect
+{
+  ASDisplayNodeAssertMainThread();
+  std::vector<ASDisplayTile> tiles;
+  for (auto it = _evictedKeys.begin(); it != _evictedKeys.end();) {
+    const CGRect rect = [self _rectForColumn:(NSUInteger)(*it & 0xFFFFFFFF) row:(NSUInteger)(*it >> 32)];
+    if (CGRectIntersectsRect(rect, visibleRect)) {
+      tiles.push_back({*it, rect});
+      it = _evictedKeys.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return tiles;
+}
+
+- (BOOL)hasEvictedTiles
+{
+  return !_evictedKeys.empty();
+}
+
+- (void)removeAllTiles
+{
+  ASDisplayNodeAssertMainThread();
+  for (const auto &entry : _tileLayers) {
+    [entry.second removeFromSuperlayer];
+  }
+  _tileLayers.clear();
+  _evictedKeys.clear();
+  _bounds = CGRectNull;
+  [self stopObservingScrolling];
+}
+
+#pragma mark Scrolling.
+
+- (void)observeScrollingOfView:(NSView *)view
+{
+  NSView *clipView = view.enclosingScrollView.contentView;
+  if (clipView == nil || clipView == _observedClipView) {
+    return;
+  }
+  [self stopObservingScrolling];
+  _observedClipView = clipView;
+  [[NSNotificationCenter defaultCenter] addObserver:self
+                                           selector:@selector(_clipViewBoundsDidChange:)
+                                               name:NSViewBoundsDidChangeNotification
+                                             object:clipView];
+}
+
+- (void)stopObservingScrolling
+{
+  NSView *clipView = _observedClipView;
+  if (clipView) {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSViewBoundsDidChangeNotification object:clipView];
+  }
+  _observedClipView = nil;
+}
+
+- (void)_clipViewBoundsDidChange:(NSNotification *)notification
+{
+  [self.node _displayEvictedTiles];
+}
+
+@end
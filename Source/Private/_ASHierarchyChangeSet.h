@@ -192,6 +192,18 @@ NSString *NSStringFromASHierarchyChangeType(_ASHierarchyChangeType changeType);
 /// NOTE: Calling this method will cause the changeset to convert all reloads into delete/insert pairs.
 - (void)markCompletedWithNewItemCounts:(std::vector<NSInteger>)newItemCounts;
 
+/**
+ * Returns a completed change set that takes the data from before @c changeSet to after @c laterChangeSet, which must
+ * pick up where @c changeSet leaves off. Its completion handler runs those of both, in order.
+ *
+ * @discussion Each delete, insert and reload of either change set comes out as one change with its own animation
+ * options, less what the later change set undoes. A section reloaded by either comes out deleted and inserted once the
+ * result is processed, and if either includes reload data, so does the result.
+ *
+ * @precondition Both change sets must be completed, and their completion handlers not yet executed.
+ */
++ (_ASHierarchyChangeSet *)changeSetByMergingChangeSet:(_ASHierarchyChangeSet *)changeSet withLaterChangeSet:(_ASHierarchyChangeSet *)laterChangeSet;
+
 - (nullable NSArray <_ASHierarchySectionChange *> *)sectionChangesOfType:(_ASHierarchyChangeType)changeType;
 
 - (nullable NSArray <_ASHierarchyItemChange *> *)itemChangesOfType:(_ASHierarchyChangeType)changeType;
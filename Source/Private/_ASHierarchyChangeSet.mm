@@ -194,6 +194,148 @@ NSString *NSStringFromASHierarchyChangeType(_ASHierarchyChangeType changeType)
   [self _validateUpdate];
 }
 
++ (_ASHierarchyChangeSet *)changeSetByMergingChangeSet:(_ASHierarchyChangeSet *)first withLaterChangeSet:(_ASHierarchyChangeSet *)second
+{
+  [first _ensureCompleted];
+  [second _ensureCompleted];
+  ASDisplayNodeAssert(first->_newItemCounts == second->_oldItemCounts, @"Change set %@ does not pick up where %@ leaves off.", second, first);
+
+  _ASHierarchyChangeSet *changeSet = [[_ASHierarchyChangeSet alloc] initWithOldData:first->_oldItemCounts];
+  changeSet.animated = first.animated && second.animated;
+  changeSet.rootActivity = first.rootActivity;
+  [changeSet addCompletionHandler:^(BOOL finished) {
+    [first executeCompletionHandlerWithFinished:finished];
+    [second executeCompletionHandlerWithFinished:finished];
+  }];
+
+  if (first.includesReloadData || second.includesReloadData) {
+    [changeSet reloadData];
+    [changeSet markCompletedWithNewItemCounts:second->_newItemCounts];
+    return changeSet;
+  }
+
+  // Each change of either change set becomes one change of the result, with its own animation options. Deletes and
+  // reloads are carried back to the data before the first change set, and inserts forward to the data after the later
+  // one. Whatever the later change set undoes is left out: what the first inserts and the later deletes, changes to
+  // items of sections that are inserted or deleted as a whole, and reloads of anything deleted.
+  ASIntegerMap *firstSections = first.sectionMapping;
+  ASIntegerMap *secondSections = second.sectionMapping;
+  ASIntegerMap *firstReverseSections = first.reverseSectionMapping;
+  ASIntegerMap *secondReverseSections = second.reverseSectionMapping;
+  // Whether a section from before the first change set is kept by both.
+  BOOL (^keptByBoth)(NSInteger) = ^BOOL(NSInteger section) {
+    const NSInteger middleSection = [firstSections integerForKey:section];
+    return middleSection != NSNotFound && [secondSections integerForKey:middleSection] != NSNotFound;
+  };
+  // Whether a section from after the later change set was there before the first.
+  BOOL (^existedBeforeBoth)(NSInteger) = ^BOOL(NSInteger section) {
+    const NSInteger middleSection = [secondReverseSections integerForKey:section];
+    return middleSection != NSNotFound && [firstReverseSections integerForKey:middleSection] != NSNotFound;
+  };
+
+  for (_ASHierarchySectionChange *change in first.originalDeleteSectionChanges) {
+    [changeSet deleteSections:change.indexSet animationOptions:change.animationOptions];
+  }
+  for (_ASHierarchySectionChange *change in second.originalDeleteSectionChanges) {
+    NSIndexSet *sections = [change.indexSet as_indexesByMapping:^NSUInteger(NSUInteger section) {
+      return [firstReverseSections integerForKey:section];
+    }];
+    if (sections.count > 0) {
+      [changeSet deleteSections:sections animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchySectionChange *change in first.originalInsertSectionChanges) {
+    NSIndexSet *sections = [change.indexSet as_indexesByMapping:^NSUInteger(NSUInteger section) {
+      return [secondSections integerForKey:section];
+    }];
+    if (sections.count > 0) {
+      [changeSet insertSections:sections animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchySectionChange *change in second.originalInsertSectionChanges) {
+    [changeSet insertSections:change.indexSet animationOptions:change.animationOptions];
+  }
+
+  for (_ASHierarchyItemChange *change in first.originalDeleteItemChanges) {
+    NSArray<NSIndexPath *> *indexPaths = ASArrayByFlatMapping(change.indexPaths, NSIndexPath *indexPath, keptByBoth(indexPath.section) ? indexPath : nil);
+    if (indexPaths.count > 0) {
+      [changeSet deleteItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchyItemChange *change in second.originalDeleteItemChanges) {
+    NSArray<NSIndexPath *> *indexPaths = ASArrayByFlatMapping(change.indexPaths, NSIndexPath *indexPath, [secondSections integerForKey:indexPath.section] != NSNotFound ? [first oldIndexPathForNewIndexPath:indexPath] : nil);
+    if (indexPaths.count > 0) {
+      [changeSet deleteItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchyItemChange *change in first.originalInsertItemChanges) {
+    NSArray<NSIndexPath *> *indexPaths = ASArrayByFlatMapping(change.indexPaths, NSIndexPath *indexPath, [firstReverseSections integerForKey:indexPath.section] != NSNotFound ? [second newIndexPathForOldIndexPath:indexPath] : nil);
+    if (indexPaths.count > 0) {
+      [changeSet insertItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchyItemChange *change in second.originalInsertItemChanges) {
+    NSArray<NSIndexPath *> *indexPaths = ASArrayByFlatMapping(change.indexPaths, NSIndexPath *indexPath, existedBeforeBoth(indexPath.section) ? indexPath : nil);
+    if (indexPaths.count > 0) {
+      [changeSet insertItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+
+  // Reloads of sections and items that survive both, each reloaded once, by the first change that reloads it.
+  const auto reloadedSections = [[NSMutableIndexSet alloc] init];
+  for (_ASHierarchySectionChange *change in first.reloadSectionChanges) {
+    NSIndexSet *sections = [change.indexSet as_indexesByMapping:^NSUInteger(NSUInteger section) {
+      return (keptByBoth(section) && ![reloadedSections containsIndex:section]) ? section : NSNotFound;
+    }];
+    if (sections.count > 0) {
+      [reloadedSections addIndexes:sections];
+      [changeSet reloadSections:sections animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchySectionChange *change in second.reloadSectionChanges) {
+    // Sections the first change set inserted are inserted as they are now.
+    NSIndexSet *sections = [change.indexSet as_indexesByMapping:^NSUInteger(NSUInteger middleSection) {
+      const NSInteger section = [firstReverseSections integerForKey:middleSection];
+      return (section != NSNotFound && [secondSections integerForKey:middleSection] != NSNotFound && ![reloadedSections containsIndex:section]) ? section : NSNotFound;
+    }];
+    if (sections.count > 0) {
+      [reloadedSections addIndexes:sections];
+      [changeSet reloadSections:sections animationOptions:change.animationOptions];
+    }
+  }
+
+  const auto reloadedItems = [[NSMutableSet<NSIndexPath *> alloc] init];
+  for (_ASHierarchyItemChange *change in first.reloadItemChanges) {
+    const auto indexPaths = [[NSMutableArray<NSIndexPath *> alloc] init];
+    for (NSIndexPath *indexPath in change.indexPaths) {
+      NSIndexPath *middleIndexPath = [first newIndexPathForOldIndexPath:indexPath];
+      if (middleIndexPath != nil && [second newIndexPathForOldIndexPath:middleIndexPath] != nil && ![reloadedItems containsObject:indexPath]) {
+        [reloadedItems addObject:indexPath];
+        [indexPaths addObject:indexPath];
+      }
+    }
+    if (indexPaths.count > 0) {
+      [changeSet reloadItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+  for (_ASHierarchyItemChange *change in second.reloadItemChanges) {
+    const auto indexPaths = [[NSMutableArray<NSIndexPath *> alloc] init];
+    for (NSIndexPath *middleIndexPath in change.indexPaths) {
+      // Items the first change set inserted are inserted as they are now.
+      NSIndexPath *indexPath = [first oldIndexPathForNewIndexPath:middleIndexPath];
+      if (indexPath != nil && [second newIndexPathForOldIndexPath:middleIndexPath] != nil && ![reloadedItems containsObject:indexPath]) {
+        [reloadedItems addObject:indexPath];
+        [indexPaths addObject:indexPath];
+      }
+    }
+    if (indexPaths.count > 0) {
+      [changeSet reloadItems:indexPaths animationOptions:change.animationOptions];
+    }
+  }
+  [changeSet markCompletedWithNewItemCounts:second->_newItemCounts];
+  return changeSet;
+}
+
 - (NSArray *)sectionChangesOfType:(_ASHierarchyChangeType)changeType
 {
   [self _ensureCompleted];
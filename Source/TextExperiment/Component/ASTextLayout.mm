@@ -9,12 +9,15 @@
 
 #import "ASTextLayout.h"
 
+#import <memory>
+
 #import "ASAssert.h"
 #import "ASConfigurationInternal.h"
 #import "ASTextUtilities.h"
 #import "ASTextAttribute.h"
 #import "NSAttributedString+ASText.h"
 #import "ASInternalHelpers.h"
+#import "ASObjectPool.h"
 #import "NSValue+CGAffineTransform.h"
 
 const CGSize ASTextContainerMaxSize = (CGSize){0x100000, 0x100000};
@@ -375,6 +378,63 @@ dispatch_semaphore_signal(_lock);
 
 
 
+/**
+ * Framesetters for one string. Each slot holds an idle framesetter; checking out and in are atomic exchanges on
+ * the slots, so no lock is taken. All pools share a memory budget, and framesetters that do not fit are released.
+ */
+@interface ASTextFramesetterPool : NSObject
+
+- (instancetype)initWithLength:(NSUInteger)length;
+
+/// Returns an idle framesetter that the caller owns, or NULL if there is none.
+- (CTFramesetterRef)checkOut CF_RETURNS_RETAINED;
+
+/// Returns a framesetter to the pool, or releases it if the pool or the budget is full.
+- (void)checkIn:(CF_CONSUMED CTFramesetterRef)framesetter;
+
+@end
+
+@implementation ASTextFramesetterPool {
+  std::unique_ptr<AS::ObjectPool<CTFramesetterRef>> _pool;
+}
+
+/// Bounds the estimated bytes held by all pooled framesetters.
+static AS::PoolBudget &ASTextFramesetterPoolBudget()
+{
+  static AS::PoolBudget *budget = new AS::PoolBudget(16 * 1024 * 1024);
+  return *budget;
+}
+
+- (instancetype)initWithLength:(NSUInteger)length
+{
+  if (self = [super init]) {
+    // A framesetter keeps a typesetter with the glyph runs for the whole string.
+    _pool.reset(new AS::ObjectPool<CTFramesetterRef>(ASTextFramesetterPoolBudget(), 1024 + length * 64));
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  _pool->drain([](CTFramesetterRef framesetter) {
+    CFRelease(framesetter);
+  });
+}
+
+- (CTFramesetterRef)checkOut
+{
+  return _pool->checkOut();
+}
+
+- (void)checkIn:(CTFramesetterRef)framesetter
+{
+  if (!_pool->checkIn(framesetter)) {
+    CFRelease(framesetter);
+  }
+}
+
+@end
+
 @implementation ASTextLayout
 
 #pragma mark - Layout
@@ -517,46 +577,27 @@ dispatch_semaphore_signal(_lock);
   
   /*
    * Framesetter cache.
-   * Framesetters can only be used by one thread at a time.
-   * Create a CFSet with no callbacks (raw pointers) to keep track of which
-   * framesetters are in use on other threads. If the one for our string is already in use,
-   * just create a new one. This should be pretty rare.
+   * Framesetters can only be used by one thread at a time, so each string has a small pool of them.
+   * A thread checks one out, or creates one if the pool is empty, and checks it back in once the frame
+   * is created. When the string is measured at several widths in parallel, the pool grows to match.
    */
-  static pthread_mutex_t busyFramesettersLock = PTHREAD_MUTEX_INITIALIZER;
-  static NSCache<NSAttributedString *, id> *framesetterCache;
-  static CFMutableSetRef busyFramesetters;
+  static NSCache<NSAttributedString *, ASTextFramesetterPool *> *framesetterCache;
   static dispatch_once_t onceToken;
   dispatch_once(&onceToken, ^{
     if (ASActivateExperimentalFeature(ASExperimentalFramesetterCache)) {
       framesetterCache = [[NSCache alloc] init];
       framesetterCache.name = @"org.TextureGroup.Texture.framesetterCache";
-      busyFramesetters = CFSetCreateMutable(NULL, 0, NULL);
     }
   });
 
-  BOOL haveCached = NO, useCached = NO;
+  ASTextFramesetterPool *framesetterPool = nil;
   if (framesetterCache) {
-    // Check if there's one in the cache.
-    ctSetter = (__bridge_retained CTFramesetterRef)[framesetterCache objectForKey:text];
-
-    if (ctSetter) {
-      haveCached = YES;
-
-      // Check-and-set busy on the cached one.
-      pthread_mutex_lock(&busyFramesettersLock);
-      BOOL busy = CFSetContainsValue(busyFramesetters, ctSetter);
-      if (!busy) {
-        CFSetAddValue(busyFramesetters, ctSetter);
-        useCached = YES;
-      }
-      pthread_mutex_unlock(&busyFramesettersLock);
-
-      // Release if it was busy.
-      if (busy) {
-        CFRelease(ctSetter);
-        ctSetter = NULL;
-      }
+    framesetterPool = [framesetterCache objectForKey:text];
+    if (!framesetterPool) {
+      framesetterPool = [[ASTextFramesetterPool alloc] initWithLength:text.length];
+      [framesetterCache setObject:framesetterPool forKey:[text copy]];
     }
+    ctSetter = [framesetterPool checkOut];
   }
 
   // Create a framesetter if needed.
@@ -567,17 +608,9 @@ dispatch_semaphore_signal(_lock);
   if (!ctSetter) FAIL_AND_RETURN
   ctFrame = CTFramesetterCreateFrame(ctSetter, ASTextCFRangeFromNSRange(range), cgPath, (CFDictionaryRef)frameAttrs);
 
-  // Return to cache.
-  if (framesetterCache) {
-    if (useCached) {
-      // If reused: mark available.
-      pthread_mutex_lock(&busyFramesettersLock);
-      CFSetRemoveValue(busyFramesetters, ctSetter);
-      pthread_mutex_unlock(&busyFramesettersLock);
-    } else if (!haveCached) {
-      // If first framesetter, add to cache.
-      [framesetterCache setObject:(__bridge id)ctSetter forKey:text];
-    }
+  // Return to the pool. We keep our own reference until the end.
+  if (framesetterPool) {
+    [framesetterPool checkIn:(CTFramesetterRef)CFRetain(ctSetter)];
   }
 
   if (!ctFrame) FAIL_AND_RETURN
@@ -2702,6 +2735,8 @@ static void ASTextDrawLineStyle(CGContextRef context, CGFloat length, CGFloat li
 }
 
 static void ASTextDrawText(ASTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, BOOL (^cancel)(void)) {
+  // Lines outside the clip, such as those outside the tile of a tiled node, are skipped.
+  CGRect clipRect = CGContextGetClipBoundingBox(context);
   CGContextSaveGState(context); {
     
     CGContextTranslateCTM(context, point.x, point.y);
@@ -2715,6 +2750,10 @@ static void ASTextDrawText(ASTextLayout *layout, CGContextRef context, CGSize si
     for (NSUInteger l = 0, lMax = lines.count; l < lMax; l++) {
       ASTextLine *line = lines[l];
       if (layout.truncatedLine && layout.truncatedLine.index == line.index) line = layout.truncatedLine;
+      // Leave a line's height of room for glyphs that reach past their line.
+      CGRect lineRect = CGRectOffset(line.bounds, point.x + verticalOffset, point.y);
+      CGFloat overhang = isVertical ? line.width : line.height;
+      if (!CGRectIntersectsRect(CGRectInset(lineRect, -overhang, -overhang), clipRect)) continue;
       NSArray *lineRunRanges = line.verticalRotateRange;
       CGFloat posX = line.position.x + verticalOffset;
       CGFloat posY = size.height - line.position.y;
@@ -129,6 +129,24 @@ struct ASTextKitAttributes {
   }
 
   size_t hash() const;
+
+  /**
+   Whether both hold the same objects and values, compared by pointer, so that a hash computed for one holds for the
+   other. Cheaper than operator==, which compares objects by value.
+   */
+  bool isIdenticalTo(const ASTextKitAttributes &other) const
+  {
+    return attributedString == other.attributedString
+    && truncationAttributedString == other.truncationAttributedString
+    && avoidTailTruncationSet == other.avoidTailTruncationSet
+    && lineBreakMode == other.lineBreakMode
+    && maximumNumberOfLines == other.maximumNumberOfLines
+    && exclusionPaths == other.exclusionPaths
+    && CGSizeEqualToSize(shadowOffset, other.shadowOffset)
+    && shadowColor == other.shadowColor
+    && shadowOpacity == other.shadowOpacity
+    && shadowRadius == other.shadowRadius;
+  }
 };
 
 #endif
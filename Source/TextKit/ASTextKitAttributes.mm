@@ -18,33 +18,18 @@ NSString *const ASTextKitEntityAttributeName = @"ck_entity";
 
 size_t ASTextKitAttributes::hash() const
 {
-#pragma clang diagnostic push
-#pragma clang diagnostic warning "-Wpadded"
-  struct {
-    NSUInteger attrStringHash;
-    NSUInteger truncationStringHash;
-    NSUInteger avoidTrunactionSetHash;
-    NSLineBreakMode lineBreakMode;
-    NSUInteger maximumNumberOfLines;
-    NSUInteger exclusionPathsHash;
-    CGSize shadowOffset;
-    NSUInteger shadowColorHash;
-    CGFloat shadowOpacity;
-    CGFloat shadowRadius;
-#pragma clang diagnostic pop
-  } data = {
-    [attributedString hash],
-    [truncationAttributedString hash],
-    [avoidTailTruncationSet hash],
-    lineBreakMode,
-    maximumNumberOfLines,
-    [exclusionPaths hash],
-    shadowOffset,
-    [shadowColor hash],
-    shadowOpacity,
-    shadowRadius,
-  };
-  return ASHashBytes(&data, sizeof(data));
+  ASHashState state = ASHashStateMake(0);
+  ASHashCombine(&state, [attributedString hash]);
+  ASHashCombine(&state, [truncationAttributedString hash]);
+  ASHashCombine(&state, [avoidTailTruncationSet hash]);
+  ASHashCombine(&state, lineBreakMode);
+  ASHashCombine(&state, maximumNumberOfLines);
+  ASHashCombine(&state, [exclusionPaths hash]);
+  ASHashCombineSize(&state, shadowOffset);
+  ASHashCombine(&state, [shadowColor hash]);
+  ASHashCombineFloat(&state, shadowOpacity);
+  ASHashCombineFloat(&state, shadowRadius);
+  return ASHashStateFinish(state);
 }
 
 #endif
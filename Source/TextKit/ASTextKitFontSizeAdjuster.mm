@@ -13,18 +13,125 @@
 #if AS_ENABLE_TEXTNODE
 
 #import <tgmath.h>
+#import <algorithm>
+#import <unordered_map>
+#import <vector>
 
+#import "ASEqualityHelpers.h"
+#import "ASHashing.h"
 #import "ASLayoutManager.h"
+#import "ASScaleFactorSearch.h"
 #import "ASTextKitContext.h"
 #import "ASThread.h"
 
 //#define LOG(...) NSLog(__VA_ARGS__)
 #define LOG(...)
 
-@interface ASTextKitFontSizeAdjuster()
-@property (nonatomic, readonly) NSLayoutManager *sizingLayoutManager;
-@property (nonatomic, readonly) NSTextContainer *sizingTextContainer;
-@end
+/**
+ * TextKit objects for measuring trial strings, reused by every adjuster on the same thread.
+ */
+struct ASTextKitSizingStack {
+  NSTextStorage *textStorage;
+  NSLayoutManager *layoutManager;
+  NSTextContainer *textContainer;
+};
+
+static ASTextKitSizingStack &ASTextKitSizingStackForCurrentThread()
+{
+  static thread_local ASTextKitSizingStack stack;
+  if (stack.layoutManager == nil) {
+    stack.textStorage = [[NSTextStorage alloc] init];
+    stack.layoutManager = [[ASLayoutManager alloc] init];
+    stack.layoutManager.usesFontLeading = NO;
+
+    // The container is unbounded in height (see -measureString:lineCount:size:) so that the layout manager will compute the total
+    // number of lines and not stop counting when height runs out.
+    stack.textContainer = [[NSTextContainer alloc] initWithSize:CGSizeZero];
+    stack.textContainer.lineFragmentPadding = 0;
+
+    // use 0 regardless of what is in the attributes so that we get an accurate line count
+    stack.textContainer.maximumNumberOfLines = 0;
+
+    [stack.layoutManager addTextContainer:stack.textContainer];
+    [stack.textStorage addLayoutManager:stack.layoutManager];
+  }
+  return stack;
+}
+
+/**
+ * Everything the chosen scale factor depends on.
+ */
+struct ASTextKitFontSizeKey {
+  NSAttributedString *attributedString;
+  NSLineBreakMode lineBreakMode;
+  NSUInteger maximumNumberOfLines;
+  NSArray *exclusionPaths;
+  NSArray *pointSizeScaleFactors;
+  CGSize constrainedSize;
+
+  bool operator==(const ASTextKitFontSizeKey &other) const
+  {
+    return lineBreakMode == other.lineBreakMode
+    && maximumNumberOfLines == other.maximumNumberOfLines
+    && CGSizeEqualToSize(constrainedSize, other.constrainedSize)
+    && (pointSizeScaleFactors == other.pointSizeScaleFactors
+        || [pointSizeScaleFactors isEqualToArray:other.pointSizeScaleFactors])
+    && ASObjectIsEqual(exclusionPaths, other.exclusionPaths)
+    && ASObjectIsEqual(attributedString, other.attributedString);
+  }
+
+  struct Hash {
+    size_t operator()(const ASTextKitFontSizeKey &key) const
+    {
+      ASHashState state = ASHashStateMake(0);
+      ASHashCombine(&state, key.attributedString.hash);
+      ASHashCombine(&state, key.lineBreakMode);
+      ASHashCombine(&state, key.maximumNumberOfLines);
+      ASHashCombine(&state, key.exclusionPaths.hash);
+      ASHashCombineSize(&state, key.constrainedSize);
+      return ASHashStateFinish(state);
+    }
+  };
+};
+
+/**
+ * Scale factors already chosen, so measuring the same text at the same size again does no text layout.
+ */
+class ASTextKitFontSizeMemo {
+public:
+  bool get(const ASTextKitFontSizeKey &key, CGFloat *scaleFactor)
+  {
+    AS::MutexLocker l(_lock);
+    const auto it = _scaleFactors.find(key);
+    if (it == _scaleFactors.end()) {
+      return false;
+    }
+    *scaleFactor = it->second;
+    return true;
+  }
+
+  void set(const ASTextKitFontSizeKey &key, CGFloat scaleFactor)
+  {
+    ASTextKitFontSizeKey ownedKey = key;
+    ownedKey.attributedString = [key.attributedString copy];
+    AS::MutexLocker l(_lock);
+    // Starting over is cheaper than tracking recency, and the working set of a screen is much smaller than this.
+    if (_scaleFactors.size() >= 512) {
+      _scaleFactors.clear();
+    }
+    _scaleFactors[ownedKey] = scaleFactor;
+  }
+
+  static ASTextKitFontSizeMemo &shared()
+  {
+    static ASTextKitFontSizeMemo *memo = new ASTextKitFontSizeMemo();
+    return *memo;
+  }
+
+private:
+  AS::Mutex _lock;
+  std::unordered_map<ASTextKitFontSizeKey, CGFloat, ASTextKitFontSizeKey::Hash> _scaleFactors;
+};
 
 @implementation ASTextKitFontSizeAdjuster
 {
@@ -32,12 +139,8 @@
   ASTextKitAttributes _attributes;
   BOOL _measured;
   CGFloat _scaleFactor;
-  AS::Mutex __instanceLock__;
 }
 
-@synthesize sizingLayoutManager = _sizingLayoutManager;
-@synthesize sizingTextContainer = _sizingTextContainer;
-
 - (instancetype)initWithContext:(ASTextKitContext *)context
                 constrainedSize:(CGSize)constrainedSize
               textKitAttributes:(const ASTextKitAttributes &)textComponentAttributes
@@ -90,63 +193,32 @@
   [attrString endEditing];
 }
 
-- (NSUInteger)lineCountForString:(NSAttributedString *)attributedString
+/**
+ * Lays out the string once in this thread's sizing stack, for both its line count (up to one past the maximum)
+ * and its bounding box.
+ */
+- (void)measureString:(NSAttributedString *)attributedString lineCount:(NSUInteger *)outLineCount size:(CGSize *)outSize
 {
-  NSUInteger lineCount = 0;
-  
-  NSLayoutManager *sizingLayoutManager = [self sizingLayoutManager];
-  NSTextContainer *sizingTextContainer = [self sizingTextContainer];
-  
-  NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:attributedString];
-  [textStorage addLayoutManager:sizingLayoutManager];
-  
-  [sizingLayoutManager ensureLayoutForTextContainer:sizingTextContainer];
-  for (NSRange lineRange = { 0, 0 }; NSMaxRange(lineRange) < [sizingLayoutManager numberOfGlyphs] && lineCount <= _attributes.maximumNumberOfLines; lineCount++) {
-    [sizingLayoutManager lineFragmentRectForGlyphAtIndex:NSMaxRange(lineRange) effectiveRange:&lineRange];
-  }
-  
-  [textStorage removeLayoutManager:sizingLayoutManager];
-  return lineCount;
-}
+  ASTextKitSizingStack &stack = ASTextKitSizingStackForCurrentThread();
+  NSLayoutManager *sizingLayoutManager = stack.layoutManager;
+  NSTextContainer *sizingTextContainer = stack.textContainer;
+  sizingTextContainer.size = CGSizeMake(_constrainedSize.width, CGFLOAT_MAX);
+  sizingTextContainer.lineBreakMode = _attributes.lineBreakMode;
+  sizingTextContainer.exclusionPaths = _attributes.exclusionPaths;
+  [stack.textStorage setAttributedString:attributedString];
 
-- (CGSize)boundingBoxForString:(NSAttributedString *)attributedString
-{
-  NSLayoutManager *sizingLayoutManager = [self sizingLayoutManager];
-  NSTextContainer *sizingTextContainer = [self sizingTextContainer];
-  
-  NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:attributedString];
-  [textStorage addLayoutManager:sizingLayoutManager];
-  
   [sizingLayoutManager ensureLayoutForTextContainer:sizingTextContainer];
-  CGRect textRect = [sizingLayoutManager boundingRectForGlyphRange:NSMakeRange(0, [textStorage length])
-                                                   inTextContainer:sizingTextContainer];
-  [textStorage removeLayoutManager:sizingLayoutManager];
-  return textRect.size;
-}
-
-- (NSLayoutManager *)sizingLayoutManager
-{
-  AS::MutexLocker l(__instanceLock__);
-  if (_sizingLayoutManager == nil) {
-    _sizingLayoutManager = [[ASLayoutManager alloc] init];
-    _sizingLayoutManager.usesFontLeading = NO;
-    
-    if (_sizingTextContainer == nil) {
-      // make this text container unbounded in height so that the layout manager will compute the total
-      // number of lines and not stop counting when height runs out.
-      _sizingTextContainer = [[NSTextContainer alloc] initWithSize:CGSizeMake(_constrainedSize.width, CGFLOAT_MAX)];
-      _sizingTextContainer.lineFragmentPadding = 0;
-      
-      // use 0 regardless of what is in the attributes so that we get an accurate line count
-      _sizingTextContainer.maximumNumberOfLines = 0;
-      
-      _sizingTextContainer.lineBreakMode = _attributes.lineBreakMode;
-      _sizingTextContainer.exclusionPaths = _attributes.exclusionPaths;
+  if (outLineCount != NULL) {
+    NSUInteger lineCount = 0;
+    for (NSRange lineRange = { 0, 0 }; NSMaxRange(lineRange) < [sizingLayoutManager numberOfGlyphs] && lineCount <= _attributes.maximumNumberOfLines; lineCount++) {
+      [sizingLayoutManager lineFragmentRectForGlyphAtIndex:NSMaxRange(lineRange) effectiveRange:&lineRange];
     }
-    [_sizingLayoutManager addTextContainer:_sizingTextContainer];
+    *outLineCount = lineCount;
+  }
+  if (outSize != NULL) {
+    *outSize = [sizingLayoutManager boundingRectForGlyphRange:NSMakeRange(0, attributedString.length)
+                                              inTextContainer:sizingTextContainer].size;
   }
-  
-  return _sizingLayoutManager;
 }
 
 - (CGFloat)scaleFactor
@@ -160,12 +232,31 @@
     _scaleFactor = 1.0;
     return _scaleFactor;
   }
+
+  const ASTextKitFontSizeKey key = {
+    _attributes.attributedString,
+    _attributes.lineBreakMode,
+    _attributes.maximumNumberOfLines,
+    _attributes.exclusionPaths,
+    _attributes.pointSizeScaleFactors,
+    _constrainedSize,
+  };
+  CGFloat memoizedScale;
+  if (ASTextKitFontSizeMemo::shared().get(key, &memoizedScale)) {
+    _measured = YES;
+    _scaleFactor = memoizedScale;
+    return _scaleFactor;
+  }
   
   __block CGFloat adjustedScale = 1.0;
   
-  // We add the scale factor of 1 to our scaleFactors array so that in the first iteration of the loop below, we are
-  // actually determining if we need to scale at all. If something doesn't fit, we will continue to iterate our scale factors.
-  NSArray *scaleFactors = [@[@(1)] arrayByAddingObjectsFromArray:_attributes.pointSizeScaleFactors];
+  // We put the scale factor of 1 first so that we first determine if we need to scale at all. The rest are searched
+  // from largest to smallest.
+  std::vector<CGFloat> scaleFactors = { 1 };
+  for (NSNumber *scaleFactor in _attributes.pointSizeScaleFactors) {
+    scaleFactors.push_back([scaleFactor floatValue]);
+  }
+  std::sort(scaleFactors.begin() + 1, scaleFactors.end(), std::greater<CGFloat>());
   
   [_context performBlockWithLockedTextKitComponents:^(NSLayoutManager *layoutManager, NSTextStorage *textStorage, NSTextContainer *textContainer) {
     
@@ -182,56 +273,44 @@
       }
     }
     
-    // check to see if we may need to shrink for any of these things
-    BOOL longestWordFits = [longestWordNeedingResize length] ? NO : YES;
-    BOOL maxLinesFits = self->_attributes.maximumNumberOfLines > 0 ? NO : YES;
-    BOOL heightFits = isinf(self->_constrainedSize.height) ? YES : NO;
-
+    // The longest word is measured once; its width scales linearly with the font size.
     CGSize longestWordSize = CGSizeZero;
-    if (longestWordFits == NO) {
+    if ([longestWordNeedingResize length] > 0) {
         NSRange longestWordRange = [str rangeOfString:longestWordNeedingResize];
         NSAttributedString *attrString = [textStorage attributedSubstringFromRange:longestWordRange];
         longestWordSize = [attrString boundingRectWithSize:CGSizeMake(CGFLOAT_MAX, CGFLOAT_MAX) options:NSStringDrawingUsesLineFragmentOrigin context:nil].size;
     }
-    
-    // we may need to shrink for some reason, so let's iterate through our scale factors to see if we actually need to shrink
-    // Note: the first scale factor in the array is 1.0 so will make sure that things don't fit without shrinking
-    for (NSNumber *adjustedScaleObj in scaleFactors) {
-      if (longestWordFits && maxLinesFits && heightFits) {
-        break;
-      }
-      
-      adjustedScale = [adjustedScaleObj floatValue];
-      
-      if (longestWordFits == NO) {
-        // we need to check the longest word to make sure it fits
-        longestWordFits = std::ceil((longestWordSize.width * adjustedScale) <= self->_constrainedSize.width);
+
+    const NSUInteger maximumNumberOfLines = self->_attributes.maximumNumberOfLines;
+    const CGSize constrainedSize = self->_constrainedSize;
+    BOOL (^fits)(CGFloat) = ^BOOL(CGFloat scale) {
+      if (longestWordSize.width * scale > constrainedSize.width) {
+        return NO;
       }
-      
-      // if the longest word fits, go ahead and check max line and height. If it didn't fit continue to the next scale factor
-      if (longestWordFits == YES) {
-        
-        // scale our string by the current scale factor
-        NSMutableAttributedString *scaledString = [[NSMutableAttributedString alloc] initWithAttributedString:textStorage];
-        [[self class] adjustFontSizeForAttributeString:scaledString withScaleFactor:adjustedScale];
-        
-        // check to see if this scaled string fit in the max lines
-        if (maxLinesFits == NO) {
-          maxLinesFits = ([self lineCountForString:scaledString] <= self->_attributes.maximumNumberOfLines);
-        }
-        
-        // if max lines still doesn't fit, continue without checking that we fit in the constrained height
-        if (maxLinesFits == YES && heightFits == NO) {
-          // max lines fit so make sure that we fit in the constrained height.
-          CGSize stringSize = [self boundingBoxForString:scaledString];
-          heightFits = (stringSize.height <= self->_constrainedSize.height);
-        }
+      if (maximumNumberOfLines == 0 && isinf(constrainedSize.height)) {
+        return YES;
       }
-    }
-   
+
+      // scale our string by the trial scale factor, and lay it out once for both lines and height
+      NSMutableAttributedString *scaledString = [[NSMutableAttributedString alloc] initWithAttributedString:textStorage];
+      [[self class] adjustFontSizeForAttributeString:scaledString withScaleFactor:scale];
+      NSUInteger lineCount;
+      CGSize stringSize;
+      [self measureString:scaledString lineCount:&lineCount size:&stringSize];
+      return (maximumNumberOfLines == 0 || lineCount <= maximumNumberOfLines)
+          && (isinf(constrainedSize.height) || stringSize.height <= constrainedSize.height);
+    };
+
+    // The largest scale that fits, or the smallest if none does.
+    adjustedScale = scaleFactors[AS::FirstFittingScaleFactor(scaleFactors, fits)];
+
+    // Let go of the trial string.
+    NSTextStorage *sizingTextStorage = ASTextKitSizingStackForCurrentThread().textStorage;
+    [sizingTextStorage deleteCharactersInRange:NSMakeRange(0, sizingTextStorage.length)];
   }];
   _measured = YES;
   _scaleFactor = adjustedScale;
+  ASTextKitFontSizeMemo::shared().set(key, _scaleFactor);
   return _scaleFactor;
 }
 
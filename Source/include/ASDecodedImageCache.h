@@ -0,0 +1 @@
+../Details/ASDecodedImageCache.h
\ No newline at end of file
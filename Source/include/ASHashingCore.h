@@ -0,0 +1 @@
+../Details/ASHashingCore.h
\ No newline at end of file